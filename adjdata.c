@@ -0,0 +1,159 @@
+/*
+ * adjdata.c
+ *   Collect the elements of a mesh in local node numbers and write the
+ *   node adjacency (sparsity pattern of the matrix) as a CSR file
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include "adjdata.h"
+#include "largemem.h"
+#include "util.h"
+
+enum { MAX_ELEM_INIT = 1024, MAX_ROW_INIT = 64 };
+
+static const char magic[8] = {'M', 'T', 'C', 'S', 'R', '0', '0', '1'};
+
+struct AdjDB {
+  int npe;
+  index_t n_elem;
+  index_t max_elem;
+  index_t *conn; /* npe local node numbers of each element */
+};
+
+void adj_init(AdjDB **adb_p, int npe)
+{
+  AdjDB *adb;
+
+  adb = (AdjDB *) emalloc(sizeof(AdjDB));
+  adb->npe = npe;
+  adb->n_elem = 0;
+  adb->max_elem = MAX_ELEM_INIT;
+  adb->conn = (index_t *) emalloc_large(MAX_ELEM_INIT * npe * sizeof(index_t));
+  *adb_p = adb;
+}
+
+void adj_finalize(AdjDB *adb)
+{
+  free_large(adb->conn);
+  free(adb);
+}
+
+/* add an element of local node numbers ln[npe] */
+void adj_add_elem(AdjDB *adb, const index_t *ln)
+{
+  int k;
+
+  if (adb->n_elem == adb->max_elem) {
+    adb->max_elem *= 2;
+    adb->conn = (index_t *)
+      erealloc_large(adb->conn, adb->max_elem * adb->npe * sizeof(index_t));
+  }
+  for (k = 0; k < adb->npe; k++)
+    adb->conn[adb->npe * adb->n_elem + k] = ln[k];
+  adb->n_elem++;
+}
+
+static int int64_compar(const void *v1, const void *v2)
+{
+  int64_t i1 = *(const int64_t *) v1;
+  int64_t i2 = *(const int64_t *) v2;
+
+  if (i1 < i2) return -1;
+  else if (i1 == i2) return 0;
+  else return 1;
+}
+
+static void write_data(FILE *fp, const void *ptr, size_t size)
+{
+  if (size > 0 && fwrite(ptr, 1, size, fp) != size)
+    error_exit(1, "Error: writing adjacency failed: %s\n", strerror(errno));
+}
+
+/* write the adjacency of the elements added, on local node numbers
+   0 ... n-1, to fp, which has to be seekable: the row offsets are
+   written after the columns */
+void adj_write(AdjDB *adb, index_t n, FILE *fp)
+{
+  index_t m = adb->n_elem, i, j, e;
+  index_t *first, *elem, *mark;
+  int64_t *offset, *row = NULL, head[2];
+  int npe = adb->npe, max_row = 0, n_row, k;
+  off_t start;
+
+  /* elements of each node */
+  first = (index_t *) emalloc_large((n + 1) * sizeof(index_t));
+  elem = (index_t *) emalloc_large(((size_t) npe * m + 1) * sizeof(index_t));
+  memset(first, 0, (n + 1) * sizeof(index_t));
+  for (j = 0; j < npe * m; j++) {
+    if (adb->conn[j] < 0 || adb->conn[j] >= n)
+      error_exit(1, "Error: local node number %lld out of range\n",
+		 (long long) adb->conn[j]);
+    first[adb->conn[j] + 1]++;
+  }
+  for (i = 0; i < n; i++)
+    first[i + 1] += first[i];
+  for (e = 0; e < m; e++)
+    for (k = 0; k < npe; k++)
+      elem[first[adb->conn[npe*e+k]]++] = e;
+  for (i = n; i > 0; i--)
+    first[i] = first[i - 1];
+  first[0] = 0;
+
+  mark = (index_t *) emalloc_large((n + 1) * sizeof(index_t));
+  for (i = 0; i < n; i++)
+    mark[i] = -1;
+  offset = (int64_t *) emalloc_large((n + 1) * sizeof(int64_t));
+
+  write_data(fp, magic, sizeof(magic));
+  head[0] = n;
+  head[1] = 0;
+  write_data(fp, head, sizeof(head));
+  if ((start = ftello(fp)) < 0 ||
+      fseeko(fp, (off_t) ((n + 1) * sizeof(int64_t)), SEEK_CUR) != 0)
+    error_exit(1, "Error: adjacency file is not seekable\n");
+
+  offset[0] = 0;
+  for (i = 0; i < n; i++) {
+    n_row = 0;
+    for (j = first[i]; j < first[i + 1]; j++) {
+      const index_t *ln = adb->conn + npe * elem[j];
+
+      for (k = 0; k < npe; k++) {
+	if (mark[ln[k]] == i)
+	  continue;
+	mark[ln[k]] = i;
+	if (n_row == max_row) {
+	  max_row = (max_row > 0) ? 2 * max_row : MAX_ROW_INIT;
+	  row = (int64_t *) erealloc(row, max_row * sizeof(int64_t));
+	}
+	row[n_row++] = ln[k];
+      }
+    }
+    if (n_row > 1)
+      qsort(row, n_row, sizeof(int64_t), int64_compar);
+    write_data(fp, row, n_row * sizeof(int64_t));
+    offset[i + 1] = offset[i] + n_row;
+  }
+
+  head[1] = offset[n];
+  if (fseeko(fp, start - (off_t) sizeof(head), SEEK_SET) != 0)
+    error_exit(1, "Error: adjacency file is not seekable\n");
+  write_data(fp, head, sizeof(head));
+  write_data(fp, offset, (n + 1) * sizeof(int64_t));
+  if (fseeko(fp, 0, SEEK_END) != 0 || fflush(fp) != 0)
+    error_exit(1, "Error: writing adjacency failed: %s\n", strerror(errno));
+
+  free(row);
+  free_large(offset);
+  free_large(mark);
+  free_large(elem);
+  free_large(first);
+}
@@ -0,0 +1,26 @@
+#ifndef ADJDATA_H
+#define ADJDATA_H
+
+#include <stdio.h>
+#include "precision.h"
+
+/* Node adjacency of a mesh, written as a binary CSR file:
+     char    magic[8]      "MTCSR001"
+     int64_t n_row         number of nodes
+     int64_t nnz           number of column indices
+     int64_t row[n_row+1]  row i is col[row[i]] ... col[row[i+1]-1]
+     int64_t col[nnz]      nodes sharing an element with node i,
+			   including i itself, in ascending order
+   A node used by no element has an empty row, without i itself.
+   Nodes are given by local numbers 0 ... n_row-1, and the data are in
+   the byte order of the machine. */
+
+struct AdjDB;
+typedef struct AdjDB AdjDB;
+
+extern void adj_init(AdjDB **adb_p, int npe);
+extern void adj_finalize(AdjDB *adb);
+extern void adj_add_elem(AdjDB *adb, const index_t *ln);
+extern void adj_write(AdjDB *adb, index_t n_node, FILE *fp);
+
+#endif /* ADJDATA_H */
@@ -0,0 +1,69 @@
+/*
+ * arstat.c
+ *   Quality checks of refined elements
+ *
+ * Created on Oct 19, 2026 (split from sd342to341.c)
+ *
+ */
+#include <stdio.h>
+#include "arstat.h"
+
+void arstat_init(ARStat *ars)
+{
+  ars->min = 1e+10;
+  ars->max = 0;
+  ars->min_elem_id = -1;
+  ars->max_elem_id = -1;
+  ars->vmin = 1e+10;
+  ars->vmax = 0;
+  ars->vmin_elem_id = -1;
+  ars->vmax_elem_id = -1;
+}
+
+void arstat_update(ARStat *ars, Diag *dg, coord_t ar, coord_t vr,
+		   index_t elem_id, int *nerr)
+{
+  if (ar > BIG_ASPECT_RATIO) {
+    diag_warn(dg, DIAG_BIG_ASPECT_RATIO, ar, elem_id, 0);
+    (*nerr)++;
+  }
+  if (ar < ars->min) {
+    ars->min = ar;
+    ars->min_elem_id = elem_id;
+  }
+  if (ar > ars->max) {
+    ars->max = ar;
+    ars->max_elem_id = elem_id;
+  }
+  if (vr < 0.5 || vr > 2.0) {
+    diag_warn(dg, DIAG_VOLUME_RATIO, vr, elem_id, 0);
+    (*nerr)++;
+  }
+  if (vr < ars->vmin) {
+    ars->vmin = vr;
+    ars->vmin_elem_id = elem_id;
+  }
+  if (vr > ars->vmax) {
+    ars->vmax = vr;
+    ars->vmax_elem_id = elem_id;
+  }
+}
+
+void print_arstat(const ARStat *ars, FILE *fp)
+{
+  fprintf(fp,
+	  "aspect ratio: min = %f (elemID: %lld), max = %f (elemID: %lld)\n",
+	  ars->min, (long long) ars->min_elem_id, ars->max, (long long) ars->max_elem_id);
+  fprintf(fp,
+	  "volume ratio: min = %f (elemID: %lld), max = %f (elemID: %lld)\n",
+	  ars->vmin, (long long) ars->vmin_elem_id, ars->vmax, (long long) ars->vmax_elem_id);
+}
+
+coord_t volcheck(Diag *dg, index_t eid, index_t n, coord_t vol, int *nerr)
+{
+  if (vol <= 0) {
+    diag_warn(dg, DIAG_NEGATIVE_VOLUME, vol, eid, n);
+    (*nerr)++;
+  }
+  return vol;
+}
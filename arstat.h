@@ -0,0 +1,29 @@
+#ifndef ARSTAT_H
+#define ARSTAT_H
+
+#include <stdio.h>
+#include "precision.h"
+#include "diag.h"
+
+#define BIG_ASPECT_RATIO 500
+
+/* statistics of aspect ratio and volume ratio of refined elements */
+typedef struct ARStat {
+  coord_t min; /* min of aspect ratio */
+  coord_t max;     /* max of aspect ratio */
+  index_t min_elem_id;
+  index_t max_elem_id;
+  coord_t vmin;
+  coord_t vmax;
+  index_t vmin_elem_id;
+  index_t vmax_elem_id;
+} ARStat;
+
+extern void arstat_init(ARStat *ars);
+extern void arstat_update(ARStat *ars, Diag *dg, coord_t ar, coord_t vr,
+			  index_t elem_id, int *nerr);
+extern void print_arstat(const ARStat *ars, FILE *fp);
+extern coord_t volcheck(Diag *dg, index_t eid, index_t n, coord_t vol,
+		       int *nerr);
+
+#endif /* ARSTAT_H */
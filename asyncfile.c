@@ -0,0 +1,189 @@
+/*
+ * asyncfile.c
+ *   Read and write files in separate threads, so that disk I/O
+ *   overlaps with the conversion
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#ifdef USE_PTHREAD
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "asyncfile.h"
+#include "util.h"
+
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+enum { BLOCK_SIZE = 1 << 20 };
+
+/* The conversion reads and writes a FILE connected to a pipe; a reader
+   thread copies the source file into the pipe and a writer thread
+   copies the pipe into the destination file, both in blocks of
+   BLOCK_SIZE bytes.  The pipe is the bounded buffer between the
+   stages: a full pipe blocks the producer until the consumer catches
+   up.  Without USE_PTHREAD the given FILE is used as it is. */
+
+struct AsyncFile {
+  FILE *fp;    /* file read or written by the thread */
+  FILE *pfp;   /* pipe end used by the conversion */
+#ifdef USE_PTHREAD
+  int fd;      /* pipe end used by the thread */
+  int error;   /* errno of a read error of the reader thread, or 0 */
+  char *buf;   /* buffer of pfp */
+  pthread_t thread;
+#endif
+};
+
+#ifdef USE_PTHREAD
+
+/* copy the source file into the pipe */
+static void *reader(void *arg)
+{
+  AsyncFile *af = (AsyncFile *) arg;
+  char *block;
+  size_t rbytes, off;
+  ssize_t wbytes;
+  sigset_t set;
+
+  /* the conversion may stop reading before EOF: get EPIPE instead of
+     being killed by SIGPIPE */
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+  block = (char *) emalloc(BLOCK_SIZE);
+  errno = 0;
+  while ((rbytes = fread(block, 1, BLOCK_SIZE, af->fp)) > 0) {
+    for (off = 0; off < rbytes; off += wbytes) {
+      wbytes = write(af->fd, block + off, rbytes - off);
+      if (wbytes < 0) {
+	if (errno == EINTR) {
+	  wbytes = 0;
+	  continue;
+	}
+	goto done; /* reading end closed */
+      }
+    }
+    errno = 0;
+  }
+  /* the pipe ends as at EOF: report the error when closing */
+  if (ferror(af->fp))
+    af->error = (errno != 0) ? errno : EIO;
+ done:
+  free(block);
+  close(af->fd);
+  return NULL;
+}
+
+/* copy the pipe into the destination file */
+static void *writer(void *arg)
+{
+  AsyncFile *af = (AsyncFile *) arg;
+  char *block;
+  ssize_t rbytes;
+
+  block = (char *) emalloc(BLOCK_SIZE);
+  for (;;) {
+    rbytes = read(af->fd, block, BLOCK_SIZE);
+    if (rbytes < 0 && errno == EINTR)
+      continue;
+    if (rbytes <= 0)
+      break;
+    if (fwrite(block, 1, rbytes, af->fp) != (size_t) rbytes)
+      error_exit(1, "Error: writing output failed: %s\n", strerror(errno));
+  }
+  free(block);
+  close(af->fd);
+  return NULL;
+}
+
+static FILE *async_open(AsyncFile **af_p, FILE *fp, int write_mode)
+{
+  AsyncFile *af;
+  int fd[2];
+
+  *af_p = af = (AsyncFile *) emalloc(sizeof(AsyncFile));
+  af->fp = fp;
+  af->error = 0;
+  af->buf = NULL;
+
+  if (pipe(fd) != 0)
+    error_exit(2, "pipe: %s\n", strerror(errno));
+
+  if (write_mode) {
+    af->pfp = fdopen(fd[1], "w");
+    af->fd = fd[0];
+  } else {
+    af->pfp = fdopen(fd[0], "r");
+    af->fd = fd[1];
+  }
+  if (af->pfp == NULL)
+    error_exit(2, "fdopen: %s\n", strerror(errno));
+
+  af->buf = (char *) emalloc(BLOCK_SIZE);
+  setvbuf(af->pfp, af->buf, _IOFBF, BLOCK_SIZE);
+
+  if (pthread_create(&af->thread, NULL, write_mode ? writer : reader, af) != 0)
+    error_exit(2, "pthread_create failed\n");
+
+  return af->pfp;
+}
+
+/* return a FILE from which the contents of fp are read ahead by
+   a reader thread */
+FILE *async_read_open(AsyncFile **af_p, FILE *fp)
+{
+  return async_open(af_p, fp, 0);
+}
+
+/* return a FILE whose contents are written into fp by a writer thread */
+FILE *async_write_open(AsyncFile **af_p, FILE *fp)
+{
+  return async_open(af_p, fp, 1);
+}
+
+/* close the FILE returned by async_*_open and wait for the thread.
+   fp given to async_*_open is not closed.  A read error of the reader
+   thread, which the conversion took as the end of the source, is
+   reported here. */
+void async_close(AsyncFile *af)
+{
+  int error;
+
+  fclose(af->pfp);
+  pthread_join(af->thread, NULL);
+  error = af->error;
+  free(af->buf);
+  free(af);
+  if (error != 0)
+    error_exit(1, "Error: reading input failed: %s\n", strerror(error));
+}
+
+#else /* USE_PTHREAD */
+
+FILE *async_read_open(AsyncFile **af_p, FILE *fp)
+{
+  *af_p = (AsyncFile *) emalloc(sizeof(AsyncFile));
+  (*af_p)->fp = (*af_p)->pfp = fp;
+  return fp;
+}
+
+FILE *async_write_open(AsyncFile **af_p, FILE *fp)
+{
+  return async_read_open(af_p, fp);
+}
+
+void async_close(AsyncFile *af)
+{
+  free(af);
+}
+
+#endif /* USE_PTHREAD */
@@ -0,0 +1,13 @@
+#ifndef ASYNCFILE_H
+#define ASYNCFILE_H
+
+#include <stdio.h>
+
+struct AsyncFile;
+typedef struct AsyncFile AsyncFile;
+
+extern FILE *async_read_open(AsyncFile **af_p, FILE *fp);
+extern FILE *async_write_open(AsyncFile **af_p, FILE *fp);
+extern void async_close(AsyncFile *af);
+
+#endif /* ASYNCFILE_H */
@@ -0,0 +1,361 @@
+/*
+ * cache.c
+ *   Cache of converted files: the output of a conversion is stored in
+ *   the cache directory under the hash of the program, its options and
+ *   its input files, and given back by a reflink or a copy when the
+ *   same conversion is run again
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+#include "cache.h"
+#include "util.h"
+
+/* input files are hashed in chunks of this size */
+enum { HASH_CHUNK = 1 << 20 };
+
+/* version of the key, to be changed with what goes into it */
+static const char key_magic[] = "meshtools-cache 1";
+
+/*
+ * XXH64 (xxHash, 64-bit) with seed 0, on a little-endian machine
+ */
+
+#define P1 0x9E3779B185EBCA87ULL
+#define P2 0xC2B2AE3D27D4EB4FULL
+#define P3 0x165667B19E3779F9ULL
+#define P4 0x85EBCA77C2B2AE63ULL
+#define P5 0x27D4EB2F165667C5ULL
+
+typedef struct XXH64State {
+  uint64_t total;
+  uint64_t v[4];
+  unsigned char mem[32];
+  int n_mem;
+} XXH64State;
+
+static uint64_t rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t read64(const unsigned char *p)
+{
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+static uint32_t read32(const unsigned char *p)
+{
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+  acc += input * P2;
+  return rotl(acc, 31) * P1;
+}
+
+static uint64_t xxh_merge(uint64_t acc, uint64_t v)
+{
+  acc ^= xxh_round(0, v);
+  return acc * P1 + P4;
+}
+
+static void xxh64_init(XXH64State *s)
+{
+  s->total = 0;
+  s->v[0] = P1 + P2;
+  s->v[1] = P2;
+  s->v[2] = 0;
+  s->v[3] = -P1;
+  s->n_mem = 0;
+}
+
+/* consume the 32-byte stripes in p[0..len-1]; return the bytes used */
+static size_t xxh64_stripes(XXH64State *s, const unsigned char *p, size_t len)
+{
+  uint64_t v0 = s->v[0], v1 = s->v[1], v2 = s->v[2], v3 = s->v[3];
+  size_t i;
+
+  for (i = 0; i + 32 <= len; i += 32) {
+    v0 = xxh_round(v0, read64(p + i));
+    v1 = xxh_round(v1, read64(p + i + 8));
+    v2 = xxh_round(v2, read64(p + i + 16));
+    v3 = xxh_round(v3, read64(p + i + 24));
+  }
+  s->v[0] = v0;
+  s->v[1] = v1;
+  s->v[2] = v2;
+  s->v[3] = v3;
+  return i;
+}
+
+static void xxh64_update(XXH64State *s, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  size_t n;
+
+  s->total += len;
+  if (s->n_mem > 0) {
+    n = 32 - s->n_mem;
+    if (n > len)
+      n = len;
+    memcpy(s->mem + s->n_mem, p, n);
+    s->n_mem += n;
+    p += n;
+    len -= n;
+    if (s->n_mem < 32)
+      return;
+    xxh64_stripes(s, s->mem, 32);
+    s->n_mem = 0;
+  }
+  n = xxh64_stripes(s, p, len);
+  memcpy(s->mem, p + n, len - n);
+  s->n_mem = len - n;
+}
+
+static uint64_t xxh64_digest(const XXH64State *s)
+{
+  const unsigned char *p = s->mem;
+  int n = s->n_mem;
+  uint64_t h;
+  int i;
+
+  if (s->total >= 32) {
+    h = rotl(s->v[0], 1) + rotl(s->v[1], 7) +
+      rotl(s->v[2], 12) + rotl(s->v[3], 18);
+    for (i = 0; i < 4; i++)
+      h = xxh_merge(h, s->v[i]);
+  } else {
+    h = P5;
+  }
+  h += s->total;
+
+  for (; n >= 8; n -= 8, p += 8)
+    h = rotl(h ^ xxh_round(0, read64(p)), 27) * P1 + P4;
+  if (n >= 4) {
+    h = rotl(h ^ ((uint64_t) read32(p) * P1), 23) * P2 + P3;
+    n -= 4;
+    p += 4;
+  }
+  for (; n > 0; n--, p++)
+    h = rotl(h ^ (*p * P5), 11) * P1;
+
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+/*
+ * cache
+ */
+
+struct ResultCache {
+  char *dir;
+  XXH64State key_state;
+  char key[17];
+  char *entry; /* dir/key, once the key is complete */
+};
+
+/* feed the contents of the file open as fd into s; return 0 on failure */
+static int hash_fd(XXH64State *s, int fd)
+{
+  unsigned char *buf = (unsigned char *) emalloc(HASH_CHUNK);
+  ssize_t r;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  while ((r = read(fd, buf, HASH_CHUNK)) != 0) {
+    if (r < 0) {
+      if (errno == EINTR)
+	continue;
+      free(buf);
+      return 0;
+    }
+    xxh64_update(s, buf, r);
+  }
+  free(buf);
+  return 1;
+}
+
+/* start a key in cache directory dir, created if missing */
+void cache_init(ResultCache **rc_p, const char *dir)
+{
+  ResultCache *rc;
+  XXH64State exe;
+  uint64_t h;
+  int fd;
+
+  if (mkdir(dir, 0777) != 0 && errno != EEXIST)
+    error_exit(1, "Error: creating cache directory %s failed: %s\n",
+	       dir, strerror(errno));
+
+  rc = (ResultCache *) emalloc(sizeof(ResultCache));
+  rc->dir = estrdup(dir);
+  rc->key[0] = '\0';
+  rc->entry = NULL;
+  xxh64_init(&rc->key_state);
+  xxh64_update(&rc->key_state, key_magic, sizeof(key_magic));
+
+  /* the build: the executable, or the time main.c was compiled */
+  xxh64_init(&exe);
+  fd = open("/proc/self/exe", O_RDONLY);
+  if (fd < 0 || !hash_fd(&exe, fd))
+    xxh64_update(&exe, __DATE__ " " __TIME__, strlen(__DATE__ " " __TIME__));
+  if (fd >= 0)
+    close(fd);
+  h = xxh64_digest(&exe);
+  xxh64_update(&rc->key_state, &h, sizeof(h));
+  xxh64_update(&rc->key_state, progname(), strlen(progname()) + 1);
+  *rc_p = rc;
+}
+
+void cache_finalize(ResultCache *rc)
+{
+  free(rc->dir);
+  free(rc->entry);
+  free(rc);
+}
+
+/* add option -opt with argument arg (or NULL) to the key */
+void cache_add_option(ResultCache *rc, int opt, const char *arg)
+{
+  char o[2];
+
+  o[0] = '-';
+  o[1] = (char) opt;
+  xxh64_update(&rc->key_state, o, 2);
+  if (arg != NULL)
+    xxh64_update(&rc->key_state, arg, strlen(arg) + 1);
+}
+
+/* add the contents of the file path to the key */
+void cache_add_file(ResultCache *rc, const char *path)
+{
+  XXH64State s;
+  uint64_t h[2];
+  int fd;
+
+  if ((fd = open(path, O_RDONLY)) < 0)
+    error_exit(1, "Error: cannot open %s: %s\n", path, strerror(errno));
+  xxh64_init(&s);
+  if (!hash_fd(&s, fd))
+    error_exit(1, "Error: reading %s failed: %s\n", path, strerror(errno));
+  close(fd);
+  h[0] = xxh64_digest(&s);
+  h[1] = s.total;
+  xxh64_update(&rc->key_state, h, sizeof(h));
+}
+
+/* return the key as 16 hexadecimal digits; no more can be added */
+const char *cache_key(ResultCache *rc)
+{
+  if (rc->entry == NULL) {
+    sprintf(rc->key, "%016llx",
+	    (unsigned long long) xxh64_digest(&rc->key_state));
+    rc->entry = (char *) emalloc(strlen(rc->dir) + strlen(rc->key) + 2);
+    sprintf(rc->entry, "%s/%s", rc->dir, rc->key);
+  }
+  return rc->key;
+}
+
+/* make to a reflink of from (sharing the blocks on the file systems
+   supporting it); return 1 on success */
+static int reflink(const char *from, const char *to)
+{
+#ifdef FICLONE
+  int ifd, ofd, ok;
+
+  if ((ifd = open(from, O_RDONLY)) < 0)
+    return 0;
+  if ((ofd = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+    close(ifd);
+    return 0;
+  }
+  ok = (ioctl(ofd, FICLONE, ifd) == 0);
+  close(ifd);
+  if (close(ofd) != 0)
+    ok = 0;
+  if (!ok)
+    unlink(to);
+  return ok;
+#else
+  (void) from;
+  (void) to;
+  return 0;
+#endif
+}
+
+static void copy(const char *from, const char *to)
+{
+  FILE *ifp, *ofp;
+
+  ifp = efopen(from, "r");
+  ofp = efopen(to, "w");
+  file_copy(ifp, ofp);
+  fclose(ifp);
+  if (fclose(ofp) != 0)
+    error_exit(1, "Error: writing %s failed: %s\n", to, strerror(errno));
+}
+
+/* if the output of the conversion is in the cache, put it in dest
+   (replacing dest) and return 1; otherwise return 0.  dest is never
+   a hard link to the entry, which a later run writing dest without
+   the cache would change in place. */
+int cache_fetch(ResultCache *rc, const char *dest)
+{
+  cache_key(rc);
+  if (access(rc->entry, R_OK) != 0)
+    return 0;
+
+  /* the time of the last use, for removing old entries */
+  utimensat(AT_FDCWD, rc->entry, NULL, 0);
+
+  if (unlink(dest) != 0 && errno != ENOENT)
+    error_exit(1, "Error: cannot replace %s: %s\n", dest, strerror(errno));
+  if (!reflink(rc->entry, dest))
+    copy(rc->entry, dest);
+  return 1;
+}
+
+/* store dest, the output of the conversion, in the cache.  The entry
+   is written under a temporary name and renamed, so that the runs
+   sharing the directory never see a partial entry. */
+void cache_store(ResultCache *rc, const char *dest)
+{
+  char *tmp;
+
+  cache_key(rc);
+  tmp = (char *) emalloc(strlen(rc->entry) + 32);
+  sprintf(tmp, "%s.tmp.%ld", rc->entry, (long) getpid());
+  if (!reflink(dest, tmp))
+    copy(dest, tmp);
+  if (chmod(tmp, 0444) != 0 || rename(tmp, rc->entry) != 0) {
+    unlink(tmp);
+    error_exit(1, "Error: storing %s in the cache failed: %s\n",
+	       dest, strerror(errno));
+  }
+  free(tmp);
+}
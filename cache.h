@@ -0,0 +1,20 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+/* Cache of converted files in a directory, keyed by a 64-bit xxHash
+   (XXH64) of the program, its options and its input files.  The
+   program is identified by the contents of its executable, so that
+   entries are not reused across builds. */
+
+struct ResultCache;
+typedef struct ResultCache ResultCache;
+
+extern void cache_init(ResultCache **rc_p, const char *dir);
+extern void cache_finalize(ResultCache *rc);
+extern void cache_add_option(ResultCache *rc, int opt, const char *arg);
+extern void cache_add_file(ResultCache *rc, const char *path);
+extern const char *cache_key(ResultCache *rc);
+extern int cache_fetch(ResultCache *rc, const char *dest);
+extern void cache_store(ResultCache *rc, const char *dest);
+
+#endif /* CACHE_H */
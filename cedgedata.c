@@ -0,0 +1,307 @@
+/*
+ * cedgedata.c
+ *   Edge table shared by threads: edges are inserted into a flat hash
+ *   table with compare-and-swap, and their middle nodes are numbered
+ *   afterwards in an order not depending on the timing of the threads
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "nodedata.h"
+#include "cedgedata.h"
+#include "util.h"
+#include "largemem.h"
+
+/* An edge is keyed by the local IDs of its ends, (li1 << 32) | li2
+   with li1 < li2, so the number of nodes is limited to 2^32 - 1.
+   first is the smallest reference given to cedge_middle_node for the
+   edge (e.g. 6 * element index + local edge number), by which the
+   middle nodes are numbered in cedge_renumber.  After numbering, first
+   is set to -(middle node ID). */
+typedef struct CEdge {
+  unsigned long long key;
+  long long first;
+} CEdge;
+
+struct CEdgeDB {
+  NodeDB *ndb;
+  CEdge *slot;
+  index_t n_slot;   /* power of 2 */
+  int shift;        /* 64 - log2(n_slot) */
+  index_t max_fill; /* edges allowed in the table */
+  index_t n_edge;
+  index_t n_numbered;
+};
+
+#define EMPTY_KEY (~0ULL)
+
+enum { MIN_SLOT = 1024 };
+
+/* atomic operations; without threads, plain ones do */
+#ifdef USE_PTHREAD
+#define LOAD(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define CAS(p, expp, desired) \
+  __atomic_compare_exchange_n(p, expp, desired, 0, \
+			      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define FETCH_ADD(p, v) __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#else
+#define LOAD(p) (*(p))
+#define CAS(p, expp, desired) \
+  ((*(p) == *(expp)) ? (*(p) = (desired), 1) : (*(expp) = *(p), 0))
+#define FETCH_ADD(p, v) ((*(p) += (v)) - (v))
+#endif
+
+static index_t hash_key(const CEdgeDB *cedb, unsigned long long key)
+{
+  return (index_t) ((key * 0x9E3779B97F4A7C15ULL) >> cedb->shift);
+}
+
+/* allocate an empty table of at least n_slot slots */
+static void alloc_slots(CEdgeDB *cedb, index_t n_slot)
+{
+  index_t i;
+
+  cedb->n_slot = MIN_SLOT;
+  cedb->shift = 64 - 10;
+  while (cedb->n_slot < n_slot) {
+    cedb->n_slot *= 2;
+    cedb->shift--;
+  }
+  cedb->max_fill = cedb->n_slot / 4 * 3;
+
+  cedb->slot = (CEdge *) emalloc_large(cedb->n_slot * sizeof(CEdge));
+  for (i = 0; i < cedb->n_slot; i++) {
+    cedb->slot[i].key = EMPTY_KEY;
+    cedb->slot[i].first = LLONG_MAX;
+  }
+}
+
+/* initialize the table for max_edge edges (it grows by cedge_reserve
+   or cedge_grow).  Node data must not change while the table is used. */
+void cedge_init(CEdgeDB **cedb_p, NodeDB *ndb, index_t max_edge)
+{
+  CEdgeDB *cedb;
+
+  if (number_of_nodes(ndb) == 0)
+    error_exit(1, "Error: node data not set\n");
+  if ((unsigned long long) number_of_nodes(ndb) >= 0xffffffffULL)
+    error_exit(1, "Error: too many nodes for the concurrent edge table\n");
+
+  /* lookups by the threads must not sort the node data */
+  sort_node_data(ndb);
+
+  *cedb_p = (CEdgeDB *) emalloc(sizeof(CEdgeDB));
+  cedb = *cedb_p;
+
+  cedb->ndb = ndb;
+  cedb->n_edge = 0;
+  cedb->n_numbered = 0;
+  alloc_slots(cedb, 2 * max_edge);
+}
+
+/* finalize the table */
+void cedge_finalize(CEdgeDB *cedb)
+{
+  free_large(cedb->slot);
+  free(cedb);
+}
+
+/* move the edges into a table of at least n_slot slots */
+static void rehash(CEdgeDB *cedb, index_t n_slot)
+{
+  CEdge *old = cedb->slot;
+  index_t n_old = cedb->n_slot;
+  index_t i, h;
+
+  alloc_slots(cedb, n_slot);
+  for (i = 0; i < n_old; i++) {
+    if (old[i].key == EMPTY_KEY)
+      continue;
+    h = hash_key(cedb, old[i].key);
+    while (cedb->slot[h].key != EMPTY_KEY)
+      h = (h + 1) & (cedb->n_slot - 1);
+    cedb->slot[h] = old[i];
+  }
+  free_large(old);
+}
+
+/* make room for max_edge edges in total.  Not to be called
+   concurrently with cedge_middle_node; the values returned by it
+   before are invalidated. */
+void cedge_reserve(CEdgeDB *cedb, index_t max_edge)
+{
+  if (max_edge > cedb->max_fill)
+    rehash(cedb, 2 * max_edge);
+}
+
+/* double the size of the table, e.g. after cedge_middle_node returned
+   -1.  The same restriction as cedge_reserve applies. */
+void cedge_grow(CEdgeDB *cedb)
+{
+  rehash(cedb, 2 * cedb->n_slot);
+}
+
+/* lower the reference of the edge in slot s to ref */
+static void set_first(CEdge *s, long long ref)
+{
+  long long f = LOAD(&s->first);
+
+  while (ref < f && !CAS(&s->first, &f, ref))
+    ;
+}
+
+/* register the edge between the nodes of local IDs li1 and li2, which
+   is referred to by ref (>= 0), and return the edge, to be given to
+   cedge_mnid after cedge_renumber.  Return value is -1 if the edge is
+   new and the table is full; as registering an edge twice does no
+   harm, the caller can grow the table and register all the edges
+   again.  May be called by several threads at the same time. */
+index_t cedge_middle_node(CEdgeDB *cedb, index_t li1, index_t li2,
+			  long long ref)
+{
+  unsigned long long key, k;
+  index_t h, probe;
+  CEdge *s;
+
+  if (li1 > li2) {
+    index_t tmp = li1;
+    li1 = li2;
+    li2 = tmp;
+  } else if (li1 == li2) {
+    error_exit(1, "no edge between identical node\n");
+  }
+  key = ((unsigned long long) li1 << 32) | (unsigned long long) li2;
+
+  h = hash_key(cedb, key);
+  for (probe = 0; probe < cedb->n_slot; probe++) {
+    s = &(cedb->slot[h]);
+    k = LOAD(&s->key);
+    if (k == EMPTY_KEY) {
+      if (FETCH_ADD(&cedb->n_edge, 1) >= cedb->max_fill) {
+	(void) FETCH_ADD(&cedb->n_edge, -1);
+	return -1;
+      }
+      if (CAS(&s->key, &k, key)) {
+	set_first(s, ref);
+	return h;
+      }
+      /* taken by another thread; k is its key */
+      (void) FETCH_ADD(&cedb->n_edge, -1);
+    }
+    if (k == key) {
+      set_first(s, ref);
+      return h;
+    }
+    h = (h + 1) & (cedb->n_slot - 1);
+  }
+  return -1;
+}
+
+typedef struct NewEdge {
+  long long first;
+  index_t e;
+} NewEdge;
+
+static int new_edge_compar(const void *v1, const void *v2)
+{
+  const NewEdge *e1 = (const NewEdge *) v1;
+  const NewEdge *e2 = (const NewEdge *) v2;
+
+  if (e1->first < e2->first) return -1;
+  else if (e1->first == e2->first) return 0;
+  else return 1;
+}
+
+/* create the middle nodes of the edges registered since the last call,
+   in order of the smallest reference to each edge, so that the IDs are
+   the same as given by middle_node() to the edges in order of the
+   references.  The middle nodes are printed to fp unless it is NULL.
+   Return value is the number of middle nodes created.  Not to be called
+   concurrently with cedge_middle_node. */
+index_t cedge_renumber(CEdgeDB *cedb, FILE *fp)
+{
+  NewEdge *ne;
+  index_t i, n = 0;
+  CEdge *s;
+
+  for (i = 0; i < cedb->n_slot; i++)
+    if (cedb->slot[i].key != EMPTY_KEY && cedb->slot[i].first >= 0)
+      n++;
+  if (n == 0)
+    return 0;
+
+  ne = (NewEdge *) emalloc_large(n * sizeof(NewEdge));
+  n = 0;
+  for (i = 0; i < cedb->n_slot; i++) {
+    if (cedb->slot[i].key != EMPTY_KEY && cedb->slot[i].first >= 0) {
+      ne[n].first = cedb->slot[i].first;
+      ne[n].e = i;
+      n++;
+    }
+  }
+  qsort(ne, n, sizeof(NewEdge), new_edge_compar);
+
+  for (i = 0; i < n; i++) {
+    s = &(cedb->slot[ne[i].e]);
+    s->first = -new_middle_node_local(cedb->ndb, (index_t) (s->key >> 32),
+				      (index_t) (s->key & 0xffffffffULL));
+    if (fp != NULL)
+      print_last_middle_node(cedb->ndb, fp);
+  }
+  free_large(ne);
+
+  cedb->n_numbered += n;
+  return n;
+}
+
+/* return the global node-ID of the middle node of edge e */
+index_t cedge_mnid(const CEdgeDB *cedb, index_t e)
+{
+  return (index_t) -cedb->slot[e].first;
+}
+
+/* append the middle nodes of the edges whose both ends have mark[]
+   set (by local IDs) to *mid_p of allocated length *max_p (grown as
+   needed) from index n_mid; return the new number of them.  The whole
+   table is scanned, in the order of the slots. */
+index_t cedge_group_middle_nodes(const CEdgeDB *cedb, const char *mark,
+				 index_t n_mid, index_t **mid_p,
+				 index_t *max_p)
+{
+  const CEdge *s;
+  index_t i;
+
+  for (i = 0; i < cedb->n_slot; i++) {
+    s = &(cedb->slot[i]);
+    if (s->key == EMPTY_KEY || s->first >= 0 ||
+	!mark[s->key >> 32] || !mark[s->key & 0xffffffffULL])
+      continue;
+    if (n_mid == *max_p) {
+      *max_p = (*max_p > 0) ? 2 * *max_p : 16;
+      *mid_p = (index_t *) erealloc(*mid_p, *max_p * sizeof(index_t));
+    }
+    (*mid_p)[n_mid++] = (index_t) -s->first;
+  }
+  return n_mid;
+}
+
+/* return the number of edges registered */
+index_t number_of_cedges(const CEdgeDB *cedb)
+{
+  return cedb->n_edge;
+}
+
+void print_cedge_stat(const CEdgeDB *cedb, FILE *log_file)
+{
+  fprintf(log_file,
+	  "             initial number of nodes : %lld\n"
+	  "number of added nodes (middle nodes) : %lld\n"
+	  "     edges / slots of the table (%%) : %lld / %lld (%f%%)\n",
+	  (long long) number_of_nodes(cedb->ndb),
+	  (long long) cedb->n_numbered,
+	  (long long) cedb->n_edge, (long long) cedb->n_slot,
+	  100.0 * (float) cedb->n_edge / (float) cedb->n_slot);
+}
@@ -0,0 +1,25 @@
+#ifndef CEDGEDATA_H
+#define CEDGEDATA_H
+
+#include <stdio.h>
+#include "precision.h"
+#include "nodedata.h"
+
+struct CEdgeDB;
+typedef struct CEdgeDB CEdgeDB;
+
+extern void cedge_init(CEdgeDB **cedb_p, NodeDB *ndb, index_t max_edge);
+extern void cedge_finalize(CEdgeDB *cedb);
+extern void cedge_reserve(CEdgeDB *cedb, index_t max_edge);
+extern void cedge_grow(CEdgeDB *cedb);
+extern index_t cedge_middle_node(CEdgeDB *cedb, index_t li1, index_t li2,
+				 long long ref);
+extern index_t cedge_renumber(CEdgeDB *cedb, FILE *fp);
+extern index_t cedge_mnid(const CEdgeDB *cedb, index_t e);
+extern index_t cedge_group_middle_nodes(const CEdgeDB *cedb, const char *mark,
+					index_t n_mid, index_t **mid_p,
+					index_t *max_p);
+extern index_t number_of_cedges(const CEdgeDB *cedb);
+extern void print_cedge_stat(const CEdgeDB *cedb, FILE *log_file);
+
+#endif /* CEDGEDATA_H */
@@ -0,0 +1,146 @@
+/*
+ * checkpoint.c
+ *   Checkpoint files for resuming long conversions: binary data is
+ *   written to NAME.tmp, which replaces NAME only when complete, so
+ *   that NAME always holds the last complete checkpoint
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "precision.h"
+#include "util.h"
+
+static const char magic[8] = {'M', 'T', 'C', 'K', 'P', 'T', '0', '1'};
+
+/* name of the file being written */
+static char *tmp_name(const char *name)
+{
+  char *tmp = (char *) emalloc(strlen(name) + 5);
+
+  strcpy(tmp, name);
+  strcat(tmp, ".tmp");
+  return tmp;
+}
+
+/* start writing a checkpoint to be committed as name */
+FILE *ckpt_create(const char *name)
+{
+  char *tmp = tmp_name(name);
+  FILE *fp;
+  int size[2];
+
+  fp = efopen(tmp, "wb");
+  free(tmp);
+
+  size[0] = (int) sizeof(index_t);
+  size[1] = (int) sizeof(coord_t);
+  ckpt_write(fp, magic, sizeof(magic));
+  ckpt_write(fp, size, sizeof(size));
+  return fp;
+}
+
+/* finish writing the checkpoint and replace name with it */
+void ckpt_commit(FILE *fp, const char *name)
+{
+  char *tmp = tmp_name(name);
+
+  ckpt_sync(fp);
+  if (fclose(fp) != 0)
+    error_exit(1, "Error: writing checkpoint failed: %s\n", strerror(errno));
+  if (rename(tmp, name) != 0)
+    error_exit(1, "Error: renaming %s to %s failed: %s\n",
+	       tmp, name, strerror(errno));
+  free(tmp);
+}
+
+/* remove the checkpoint name, and NAME.tmp left by a run interrupted
+   while writing the next one */
+void ckpt_remove(const char *name)
+{
+  char *tmp = tmp_name(name);
+
+  remove(name);
+  remove(tmp);
+  free(tmp);
+}
+
+/* open the checkpoint name for reading */
+FILE *ckpt_open(const char *name)
+{
+  FILE *fp;
+  char m[sizeof(magic)];
+  int size[2];
+
+  fp = efopen(name, "rb");
+  ckpt_read(fp, m, sizeof(m));
+  if (memcmp(m, magic, sizeof(magic)) != 0)
+    error_exit(1, "Error: %s is not a checkpoint file\n", name);
+  ckpt_read(fp, size, sizeof(size));
+  if (size[0] != (int) sizeof(index_t) || size[1] != (int) sizeof(coord_t))
+    error_exit(1, "Error: %s is written with different sizes of "
+	       "index_t and coord_t\n", name);
+  return fp;
+}
+
+void ckpt_write(FILE *fp, const void *ptr, size_t size)
+{
+  if (size > 0 && fwrite(ptr, 1, size, fp) != size)
+    error_exit(1, "Error: writing checkpoint failed: %s\n", strerror(errno));
+}
+
+void ckpt_read(FILE *fp, void *ptr, size_t size)
+{
+  if (size > 0 && fread(ptr, 1, size, fp) != size)
+    error_exit(1, "Error: reading checkpoint failed (file truncated?)\n");
+}
+
+/* write the buffered data of fp through to the disk */
+void ckpt_sync(FILE *fp)
+{
+  if (fflush(fp) != 0 || fsync(fileno(fp)) != 0)
+    error_exit(1, "Error: syncing file failed: %s\n", strerror(errno));
+}
+
+long long ckpt_tell(FILE *fp)
+{
+  off_t pos = ftello(fp);
+
+  if (pos < 0)
+    error_exit(1, "Error: ftello failed: %s\n", strerror(errno));
+  return (long long) pos;
+}
+
+void ckpt_seek(FILE *fp, long long pos)
+{
+  if (fseeko(fp, (off_t) pos, SEEK_SET) != 0)
+    error_exit(1, "Error: fseeko failed: %s\n", strerror(errno));
+}
+
+/* cut fp at size bytes, discarding what was written after the
+   checkpoint, and continue writing there */
+void ckpt_truncate(FILE *fp, long long size)
+{
+  if (ckpt_file_size(fp) < size)
+    error_exit(1, "Error: file is shorter than at the checkpoint\n");
+  if (fflush(fp) != 0 || ftruncate(fileno(fp), (off_t) size) != 0)
+    error_exit(1, "Error: truncating file failed: %s\n", strerror(errno));
+  ckpt_seek(fp, size);
+}
+
+long long ckpt_file_size(FILE *fp)
+{
+  struct stat st;
+
+  if (fstat(fileno(fp), &st) != 0)
+    error_exit(1, "Error: fstat failed: %s\n", strerror(errno));
+  return (long long) st.st_size;
+}
@@ -0,0 +1,19 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+extern FILE *ckpt_create(const char *name);
+extern void ckpt_commit(FILE *fp, const char *name);
+extern void ckpt_remove(const char *name);
+extern FILE *ckpt_open(const char *name);
+extern void ckpt_write(FILE *fp, const void *ptr, size_t size);
+extern void ckpt_read(FILE *fp, void *ptr, size_t size);
+extern void ckpt_sync(FILE *fp);
+extern long long ckpt_tell(FILE *fp);
+extern void ckpt_seek(FILE *fp, long long pos);
+extern void ckpt_truncate(FILE *fp, long long size);
+extern long long ckpt_file_size(FILE *fp);
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,239 @@
+/*
+ * coordfmt.c
+ *   Output of node coordinates, either in the legacy "%f" form or in
+ *   the shortest form that reads back to the same value
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coordfmt.h"
+
+static int coord_format = COORD_FIXED;
+
+/* select the output mode (COORD_FIXED or COORD_SHORTEST) */
+void set_coord_format(int mode)
+{
+  coord_format = mode;
+}
+
+int get_coord_format(void)
+{
+  return coord_format;
+}
+
+#ifdef USE_DOUBLE
+
+/* shortest of "%.15g", "%.16g" and "%.17g" reading back to v */
+static int format_shortest(char *buf, coord_t v)
+{
+  int prec, len = 0;
+
+  for (prec = 15; prec <= 17; prec++) {
+    len = sprintf(buf, "%.*g", prec, v);
+    if (strtod(buf, NULL) == v)
+      break;
+  }
+  return len;
+}
+
+#else
+
+/* write the decimal number d * 10^(-s) (d > 0) to buf in the style of
+   "%g" without trailing zeros; return the length */
+static int write_decimal(char *buf, unsigned long long d, int s)
+{
+  char digits[24];
+  int nd, e, i, len = 0;
+
+  while (d % 10 == 0) {
+    d /= 10;
+    s--;
+  }
+  nd = 0;
+  do {
+    digits[nd++] = '0' + (char) (d % 10);
+    d /= 10;
+  } while (d > 0);
+  /* digits[] is in reverse order; e is the exponent of the first digit */
+  e = nd - 1 - s;
+
+  if (e >= -5 && e < 0) {
+    buf[len++] = '0';
+    buf[len++] = '.';
+    for (i = -1; i > e; i--)
+      buf[len++] = '0';
+    for (i = nd - 1; i >= 0; i--)
+      buf[len++] = digits[i];
+  } else if (e >= 0 && e < 9) {
+    for (i = nd - 1; i >= 0; i--) {
+      buf[len++] = digits[i];
+      if (i > 0 && nd - 1 - i == e)
+	buf[len++] = '.';
+    }
+    for (i = nd - 1; i < e; i++)
+      buf[len++] = '0';
+  } else {
+    buf[len++] = digits[nd - 1];
+    if (nd > 1) {
+      buf[len++] = '.';
+      for (i = nd - 2; i >= 0; i--)
+	buf[len++] = digits[i];
+    }
+    len += sprintf(buf + len, "e%c%02d", (e < 0) ? '-' : '+', abs(e));
+  }
+  buf[len] = '\0';
+  return len;
+}
+
+/* 10^n; exact for 0 <= n <= 22, within a few ulps otherwise */
+static double pow10_(int n)
+{
+  static const double tab[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  if (n < 0)
+    return 1.0 / pow10_(-n);
+  if (n > 22)
+    return tab[22] * pow10_(n - 22);
+  return tab[n];
+}
+
+/* float next to v (> 0) toward zero (dir < 0) or infinity (dir > 0) */
+static float next_float(float v, int dir)
+{
+  unsigned int bits;
+
+  memcpy(&bits, &v, sizeof(bits));
+  bits += (dir > 0) ? 1 : -1;
+  memcpy(&v, &bits, sizeof(bits));
+  return v;
+}
+
+/* Shortest decimal reading back to v, found by scanning the number of
+   significant digits k = 1..9 for an integer d with d * 10^(-s) inside
+   the rounding interval of v.  The bounds of the interval are exact in
+   double, and the scaling by 10^s is accurate to a relative error far
+   below margin; only a candidate within margin of a bound (e.g. a tie
+   of round-half-even) is checked by reading it back with strtof. */
+static int format_shortest(char *buf, coord_t v)
+{
+  const double margin = 1e-12;
+  double av, lo, hi, scale, lo_s, hi_s, d;
+  float down, up;
+  int len = 0, e10, k, s;
+
+  if (v != v || v - v != 0) /* NaN or infinity */
+    return sprintf(buf, "%g", v);
+  if (v < 0) {
+    buf[len++] = '-';
+    v = -v;
+  }
+  if (v == 0) {
+    buf[len++] = '0';
+    buf[len] = '\0';
+    return len;
+  }
+
+  av = v;
+  down = next_float(v, -1);
+  up = next_float(v, 1);
+  lo = 0.5 * (av + down);
+  if (up - up != 0) /* v is the largest float */
+    hi = av + 0.5 * (av - down);
+  else
+    hi = 0.5 * (av + up);
+
+  /* exponent of the first significant digit */
+  e10 = 0;
+  while (pow10_(e10) > av) e10--;
+  while (pow10_(e10 + 1) <= av) e10++;
+
+  for (k = 1; k <= 9; k++) {
+    s = k - 1 - e10;
+    scale = pow10_(s);
+    lo_s = lo * scale;
+    hi_s = hi * scale;
+    /* the integer nearest to v * 10^s within the bounds (with margin) */
+    d = (double) (unsigned long long) (av * scale + 0.5);
+    if (d < lo_s * (1 - margin)) {
+      d = (double) (unsigned long long) lo_s;
+      if (d < lo_s * (1 - margin)) d += 1;
+    } else if (d > hi_s * (1 + margin)) {
+      d = (double) (unsigned long long) (hi_s * (1 + margin));
+    }
+    if (d < lo_s * (1 - margin) || d > hi_s * (1 + margin))
+      continue;
+    if (d > lo_s * (1 + margin) && d < hi_s * (1 - margin))
+      break;
+    /* near a bound */
+    write_decimal(buf + len, (unsigned long long) d, s);
+    if (strtof(buf + len, NULL) == v)
+      break;
+  }
+  if (k > 9) /* not reached for float */
+    return len + sprintf(buf + len, "%.9g", av);
+
+  return len + write_decimal(buf + len, (unsigned long long) d, s);
+}
+
+#endif /* USE_DOUBLE */
+
+/* write v to buf (COORD_BUFSIZE chars) in the current output mode;
+   return the length */
+int format_coord(char *buf, coord_t v)
+{
+  if (coord_format == COORD_SHORTEST)
+    return format_shortest(buf, v);
+  return sprintf(buf, "%f", v);
+}
+
+/* write a line of !NODE section, as printed by print_node_line but
+   without the newline, to buf of size chars; return the length, which
+   is size or more if the line is cut */
+int format_node_line(char *buf, size_t size, long long id,
+		     coord_t x, coord_t y, coord_t z)
+{
+  char bx[COORD_BUFSIZE], by[COORD_BUFSIZE], bz[COORD_BUFSIZE];
+
+  if (coord_format == COORD_FIXED)
+    return snprintf(buf, size, "%lld,%f,%f,%f", id, x, y, z);
+  format_coord(bx, x);
+  format_coord(by, y);
+  format_coord(bz, z);
+  return snprintf(buf, size, "%lld,%s,%s,%s", id, bx, by, bz);
+}
+
+/* print a line of !NODE section */
+void print_node_line(FILE *fp, long long id, coord_t x, coord_t y, coord_t z)
+{
+  char bx[COORD_BUFSIZE], by[COORD_BUFSIZE], bz[COORD_BUFSIZE];
+
+  if (coord_format == COORD_FIXED) {
+    fprintf(fp, "%lld,%f,%f,%f\n", id, x, y, z);
+    return;
+  }
+  format_coord(bx, x);
+  format_coord(by, y);
+  format_coord(bz, z);
+  fprintf(fp, "%lld,%s,%s,%s\n", id, bx, by, bz);
+}
+
+/* print coordinates separated by spaces, as in Adventure .msh files */
+void print_coords(FILE *fp, coord_t x, coord_t y, coord_t z)
+{
+  char bx[COORD_BUFSIZE], by[COORD_BUFSIZE], bz[COORD_BUFSIZE];
+
+  if (coord_format == COORD_FIXED) {
+    fprintf(fp, "%f %f %f\n", x, y, z);
+    return;
+  }
+  format_coord(bx, x);
+  format_coord(by, y);
+  format_coord(bz, z);
+  fprintf(fp, "%s %s %s\n", bx, by, bz);
+}
@@ -0,0 +1,24 @@
+#ifndef COORDFMT_H
+#define COORDFMT_H
+
+#include <stdio.h>
+#include "precision.h"
+
+/* output modes of node coordinates */
+enum {
+  COORD_FIXED,   /* "%f", as in the previous versions (default) */
+  COORD_SHORTEST /* shortest string reading back to the same coord_t */
+};
+
+enum { COORD_BUFSIZE = 32, COORD_LINE_BUFSIZE = 128 };
+
+extern void set_coord_format(int mode);
+extern int get_coord_format(void);
+extern int format_coord(char *buf, coord_t v);
+extern int format_node_line(char *buf, size_t size, long long id,
+			    coord_t x, coord_t y, coord_t z);
+extern void print_node_line(FILE *fp, long long id,
+			    coord_t x, coord_t y, coord_t z);
+extern void print_coords(FILE *fp, coord_t x, coord_t y, coord_t z);
+
+#endif /* COORDFMT_H */
@@ -0,0 +1,281 @@
+/*
+ * diag.c
+ *   Diagnostics of refined elements: warnings are counted by kind with
+ *   histograms of the offending values, only the first few of each
+ *   kind are printed, and the offending elements are collected into a
+ *   single AVS UCD file
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "diag.h"
+#include "util.h"
+
+/* histogram bins are decades of |value|, 1e-9 .. 1e+9 */
+enum { HIST_MIN = -9, HIST_MAX = 9, N_HIST = HIST_MAX - HIST_MIN + 1 };
+
+/* elements written to the UCD file at most */
+enum { MAX_UCD_ELEM = 100000, UCD_NPE = 10 };
+
+typedef struct DiagKind {
+  long long count;
+  coord_t worst; /* value of the worst case */
+  index_t worst_elem_id;
+  long long hist[N_HIST];
+} DiagKind;
+
+struct Diag {
+  DiagKind kind[N_DIAG_KIND];
+  int max_print; /* number of warnings printed for each kind */
+
+  char *ucd_name; /* NULL if the UCD file is not written */
+  index_t n_elem; /* number of offending elements */
+  index_t n_ucd; /* number of elements stored below */
+  index_t max_ucd;
+  index_t *elem_id;
+  int *nerr;
+  index_t *node_id; /* UCD_NPE nodes per element */
+  coord_t *coord; /* 3 * UCD_NPE per element */
+};
+
+static const char *warn_format[N_DIAG_KIND] = {
+  "Warning: negative volume: %e at elem %lld/%lld\n",
+  "warning: big aspect ratio: %f at elem %lld\n",
+  "warning: strange volume ratio: %f at elem %lld\n"
+};
+
+static const char *kind_name[N_DIAG_KIND] = {
+  "negative volume",
+  "big aspect ratio",
+  "strange volume ratio"
+};
+
+/* initialize diagnostics; offending elements are written to ucd_name
+   by diag_finalize unless it is NULL.  max_print < 0 means no limit */
+void diag_init(Diag **dg_p, const char *ucd_name, int max_print)
+{
+  Diag *dg;
+  int k, i;
+
+  *dg_p = (Diag *) emalloc(sizeof(Diag));
+  dg = *dg_p;
+
+  for (k = 0; k < N_DIAG_KIND; k++) {
+    dg->kind[k].count = 0;
+    dg->kind[k].worst = 0;
+    dg->kind[k].worst_elem_id = -1;
+    for (i = 0; i < N_HIST; i++)
+      dg->kind[k].hist[i] = 0;
+  }
+  dg->max_print = max_print;
+
+  dg->ucd_name = (ucd_name != NULL) ? estrdup(ucd_name) : NULL;
+  dg->n_elem = 0;
+  dg->n_ucd = 0;
+  dg->max_ucd = 0;
+  dg->elem_id = NULL;
+  dg->nerr = NULL;
+  dg->node_id = NULL;
+  dg->coord = NULL;
+}
+
+/* write the collected elements in AVS UCD format, with the original
+   node and element IDs as data */
+static void write_ucd(const Diag *dg)
+{
+  static const int f2u[UCD_NPE] = {0, 1, 3, 2, 6, 7, 5, 8, 9, 4};
+  FILE *fp;
+  index_t i;
+  int j;
+
+  fp = efopen(dg->ucd_name, "w");
+
+  fprintf(fp, "1\ndata\nstep1\n%lld %lld\n",
+	  (long long) (UCD_NPE * dg->n_ucd), (long long) dg->n_ucd);
+  for (i = 0; i < UCD_NPE * dg->n_ucd; i++)
+    fprintf(fp, "%lld %f %f %f\n", (long long) (i + 1),
+	    dg->coord[3*i], dg->coord[3*i+1], dg->coord[3*i+2]);
+  for (i = 0; i < dg->n_ucd; i++) {
+    fprintf(fp, "%lld 0 tet2", (long long) (i + 1));
+    for (j = 0; j < UCD_NPE; j++)
+      fprintf(fp, " %lld", (long long) (UCD_NPE * i + f2u[j] + 1));
+    fprintf(fp, "\n");
+  }
+  fprintf(fp, "1 2\n1 1\nID,\n");
+  for (i = 0; i < UCD_NPE * dg->n_ucd; i++)
+    fprintf(fp, "%lld %lld\n", (long long) (i + 1),
+	    (long long) dg->node_id[i]);
+  fprintf(fp, "2 1 1\nID,\nNWARN,\n");
+  for (i = 0; i < dg->n_ucd; i++)
+    fprintf(fp, "%lld %lld %d\n", (long long) (i + 1),
+	    (long long) dg->elem_id[i], dg->nerr[i]);
+
+  fclose(fp);
+}
+
+/* finalize diagnostics, writing the UCD file if any elements are
+   collected */
+void diag_finalize(Diag *dg)
+{
+  if (dg->ucd_name != NULL && dg->n_ucd > 0)
+    write_ucd(dg);
+
+  free(dg->ucd_name);
+  free(dg->elem_id);
+  free(dg->nerr);
+  free(dg->node_id);
+  free(dg->coord);
+  free(dg);
+}
+
+/* decade of |v|, clipped to the histogram range */
+static int decade(coord_t v)
+{
+  double a = (v < 0) ? -v : v;
+  int d = 0;
+
+  if (a == 0)
+    return HIST_MIN;
+  while (d > HIST_MIN && a < 1) {
+    a *= 10;
+    d--;
+  }
+  while (d < HIST_MAX && a >= 10) {
+    a /= 10;
+    d++;
+  }
+  return d;
+}
+
+/* distance of volume ratio v from 1 */
+static double ratio_badness(coord_t v)
+{
+  if (v <= 0)
+    return 1e+10 - v;
+  return (v < 1) ? 1 / v : v;
+}
+
+/* return 1 if v is worse than the current worst case of kind k */
+static int is_worse(const DiagKind *dk, int k, coord_t v)
+{
+  if (dk->count == 1)
+    return 1;
+  switch (k) {
+  case DIAG_NEGATIVE_VOLUME:
+    return v < dk->worst;
+  case DIAG_BIG_ASPECT_RATIO:
+    return v > dk->worst;
+  default:
+    return ratio_badness(v) > ratio_badness(dk->worst);
+  }
+}
+
+/* register a warning of kind on the element elem_id (and sub_id-th
+   subelement for DIAG_NEGATIVE_VOLUME) with the offending value */
+void diag_warn(Diag *dg, int kind, coord_t value,
+	       index_t elem_id, index_t sub_id)
+{
+  DiagKind *dk = &(dg->kind[kind]);
+
+  dk->count++;
+  dk->hist[decade(value) - HIST_MIN]++;
+  if (is_worse(dk, kind, value)) {
+    dk->worst = value;
+    dk->worst_elem_id = elem_id;
+  }
+
+  if (dg->max_print >= 0 && dk->count > dg->max_print) {
+    if (dk->count == dg->max_print + 1)
+      fprintf(stderr, "warning: further %s warnings are not printed\n",
+	      kind_name[kind]);
+    return;
+  }
+  if (kind == DIAG_NEGATIVE_VOLUME)
+    fprintf(stderr, warn_format[kind],
+	    value, (long long) elem_id, (long long) sub_id);
+  else
+    fprintf(stderr, warn_format[kind], value, (long long) elem_id);
+}
+
+/* register the element elem_id having nerr warnings, with its
+   UCD_NPE (quadratic tetrahedron) nodes n[] */
+void diag_elem(Diag *dg, index_t elem_id, int nerr,
+	       const index_t *n, NodeDB *ndb)
+{
+  index_t i;
+  int j;
+
+  dg->n_elem++;
+  if (dg->ucd_name == NULL || dg->n_ucd == MAX_UCD_ELEM)
+    return;
+
+  if (dg->n_ucd == dg->max_ucd) {
+    dg->max_ucd = (dg->max_ucd == 0) ? 64 : 2 * dg->max_ucd;
+    if (dg->max_ucd > MAX_UCD_ELEM)
+      dg->max_ucd = MAX_UCD_ELEM;
+    dg->elem_id = (index_t *) erealloc(dg->elem_id,
+				       dg->max_ucd * sizeof(index_t));
+    dg->nerr = (int *) erealloc(dg->nerr, dg->max_ucd * sizeof(int));
+    dg->node_id = (index_t *) erealloc(dg->node_id, UCD_NPE *
+				       dg->max_ucd * sizeof(index_t));
+    dg->coord = (coord_t *) erealloc(dg->coord, 3 * UCD_NPE *
+				     dg->max_ucd * sizeof(coord_t));
+  }
+
+  i = dg->n_ucd++;
+  dg->elem_id[i] = elem_id;
+  dg->nerr[i] = nerr;
+  for (j = 0; j < UCD_NPE; j++) {
+    dg->node_id[UCD_NPE*i+j] = n[j];
+    node_coord(ndb, n[j], &dg->coord[3*(UCD_NPE*i+j)],
+	       &dg->coord[3*(UCD_NPE*i+j)+1], &dg->coord[3*(UCD_NPE*i+j)+2]);
+  }
+}
+
+/* return the total number of warnings */
+long long diag_count(const Diag *dg)
+{
+  long long sum = 0;
+  int k;
+
+  for (k = 0; k < N_DIAG_KIND; k++)
+    sum += dg->kind[k].count;
+  return sum;
+}
+
+/* print the counts and histograms of warnings */
+void print_diag(const Diag *dg, FILE *fp)
+{
+  const DiagKind *dk;
+  int k, i;
+
+  for (k = 0; k < N_DIAG_KIND; k++) {
+    dk = &(dg->kind[k]);
+    if (dk->count == 0)
+      continue;
+    fprintf(fp, "%s: %lld warnings, worst = %g (elemID: %lld)\n",
+	    kind_name[k], dk->count, dk->worst, (long long) dk->worst_elem_id);
+    for (i = 0; i < N_HIST; i++) {
+      if (dk->hist[i] == 0)
+	continue;
+      if (i == 0)
+	fprintf(fp, "                    |value| < 1e%+03d : %lld\n",
+		HIST_MIN + 1, dk->hist[i]);
+      else if (i == N_HIST - 1)
+	fprintf(fp, "   1e%+03d <= |value|           : %lld\n",
+		HIST_MAX, dk->hist[i]);
+      else
+	fprintf(fp, "   1e%+03d <= |value| < 1e%+03d : %lld\n",
+		i + HIST_MIN, i + HIST_MIN + 1, dk->hist[i]);
+    }
+  }
+  if (dg->n_elem == 0)
+    return;
+  fprintf(fp, "%lld elements with warnings", (long long) dg->n_elem);
+  if (dg->ucd_name != NULL)
+    fprintf(fp, ", %lld of them written to %s",
+	    (long long) dg->n_ucd, dg->ucd_name);
+  fprintf(fp, "\n");
+}
@@ -0,0 +1,31 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdio.h>
+#include "precision.h"
+#include "nodedata.h"
+
+/* kinds of warnings on refined elements */
+enum {
+  DIAG_NEGATIVE_VOLUME,
+  DIAG_BIG_ASPECT_RATIO,
+  DIAG_VOLUME_RATIO,
+  N_DIAG_KIND
+};
+
+/* default number of warnings printed for each kind */
+enum { DIAG_MAX_PRINT = 10 };
+
+struct Diag;
+typedef struct Diag Diag;
+
+extern void diag_init(Diag **dg_p, const char *ucd_name, int max_print);
+extern void diag_finalize(Diag *dg);
+extern void diag_warn(Diag *dg, int kind, coord_t value,
+		      index_t elem_id, index_t sub_id);
+extern void diag_elem(Diag *dg, index_t elem_id, int nerr,
+		      const index_t *n, NodeDB *ndb);
+extern long long diag_count(const Diag *dg);
+extern void print_diag(const Diag *dg, FILE *fp);
+
+#endif /* DIAG_H */
@@ -11,34 +11,71 @@
 #include "nodedata.h"
 #include "edgedata.h"
 #include "util.h"
-
-struct Edge {
-  index_t onid; /* node id of the other end of the edge */
-  index_t mnid; /* node id of the middle node */
-};
-
-typedef struct Edge Edge;
+#include "largemem.h"
+#include "checkpoint.h"
 
 struct EdgeData {
-  index_t nid;
-  index_t n_edge;  /* number of edges to nodes with greater node-ID *
-                    * these nodes are recorded in edge[].           */
-  index_t n_edge_s; /* number of edges to nodes with smaller node-ID *
-                     * these nodes are not recorded.                 */
-  Edge *edge; /* edge detail */
-  index_t max_edge; /* allocated length of edge[] */
+  int n_edge;  /* number of edges to nodes with greater node-ID *
+                * these nodes are recorded in edge[].           */
+  int n_edge_s; /* number of edges to nodes with smaller node-ID *
+                 * these nodes are not recorded.                 */
+  void *edge; /* edge detail, Edge32 or Edge64 */
+  int max_edge; /* allocated length of edge[] */
 
 };
 
 typedef struct EdgeData EdgeData;
 
+/* Node IDs in edges are stored in int while the IDs (including middle
+   nodes) are expected to fit, and all edge[] are converted to index_t
+   when a larger ID appears.  The kernels in edgekernel.h are compiled
+   for both widths (Edge32 and Edge64) and selected by wide. */
 struct EdgeDB {
   index_t n_node_init;
+  index_t n_node; /* length of edge_data[] */
   EdgeData *edge_data;
   NodeDB *ndb;
+  int wide; /* 1 if node IDs are stored in index_t */
+  index_t n_reserved; /* number of edges registered by reserve_edge */
+  index_t n_reused; /* number of reserved middle nodes created */
 };
 
-enum { MAX_EDGE_GROW_LEN = 4 };
+#define ID_T int
+#define K(name) name##32
+#include "edgekernel.h"
+#undef ID_T
+#undef K
+
+#define ID_T index_t
+#define K(name) name##64
+#include "edgekernel.h"
+#undef ID_T
+#undef K
+
+#define EDGE_SIZE(edb) ((edb)->wide ? sizeof(Edge64) : sizeof(Edge32))
+
+enum { MAX_EDGE_GROW_LEN = 4, EDGES_PER_NODE = 8 };
+
+/* return 1 if id can be stored in int */
+static int fits_int(index_t id)
+{
+  return (index_t) (int) id == id;
+}
+
+static int edge_find(const EdgeDB *edb, const EdgeData *edp, index_t i2)
+{
+  return edb->wide ? edge_find64(edp, i2) : edge_find32(edp, i2);
+}
+
+static index_t edge_onid(const EdgeDB *edb, const EdgeData *edp, int j)
+{
+  return edb->wide ? edge_onid64(edp, j) : edge_onid32(edp, j);
+}
+
+static index_t edge_mnid(const EdgeDB *edb, const EdgeData *edp, int j)
+{
+  return edb->wide ? edge_mnid64(edp, j) : edge_mnid32(edp, j);
+}
 
 /* initialize edge_data */
 void edge_init(EdgeDB **edb_p, NodeDB *ndb)
@@ -46,20 +83,25 @@ void edge_init(EdgeDB **edb_p, NodeDB *ndb)
   index_t i;
   EdgeDB *edb;
 
-  *edb_p = (EdgeDB *) emalloc(sizeof(EdgeDB));
+  if (number_of_nodes(ndb) == 0)
+    error_exit(1, "Error: node data not set\n");
 
-  edb = *edb_p;
+  /* *edb_p is set last, as in node_init */
+  edb = (EdgeDB *) emalloc(sizeof(EdgeDB));
 
   edb->n_node_init = number_of_nodes(ndb);
-  if (edb->n_node_init == 0) {
-    fprintf(stderr, "Error: node data not set\n");
-    exit(1);
-  }
+  edb->n_node = edb->n_node_init;
 
-  edb->edge_data = (EdgeData *) emalloc(edb->n_node_init * sizeof(EdgeData));
+  /* middle nodes get IDs after the last node; start with int unless
+     they may not fit */
+  sort_node_data(ndb);
+  edb->wide = !fits_int(get_global_node_id(ndb, edb->n_node_init - 1) +
+			EDGES_PER_NODE * edb->n_node_init);
+
+  edb->edge_data = (EdgeData *) emalloc_large(edb->n_node_init *
+					       sizeof(EdgeData));
 
   for (i = 0; i < edb->n_node_init; i++) {
-    edb->edge_data[i].nid = get_global_node_id(ndb, i);
     edb->edge_data[i].n_edge = 0;
     edb->edge_data[i].n_edge_s = 0;
     edb->edge_data[i].edge = NULL;
@@ -67,6 +109,10 @@ void edge_init(EdgeDB **edb_p, NodeDB *ndb)
   }
 
   edb->ndb = ndb;
+  edb->n_reserved = 0;
+  edb->n_reused = 0;
+
+  *edb_p = edb;
 }
 
 /* finalize edge_data */
@@ -74,72 +120,294 @@ void edge_finalize(EdgeDB *edb)
 {
   index_t i;
 
-  for (i = 0; i < edb->n_node_init; i++)
+  for (i = 0; i < edb->n_node; i++)
     free(edb->edge_data[i].edge);
-  free(edb->edge_data);
+  free_large(edb->edge_data);
   edb->n_node_init = 0;
+  edb->n_node = 0;
   edb->ndb = NULL;
 
   free(edb);
 }
 
 /* resize edge_data */
-static void resize_edge(EdgeData *edp, size_t len)
+static void resize_edge(EdgeDB *edb, EdgeData *edp, size_t len)
 {
-  edp->edge = (Edge *) erealloc(edp->edge, len * sizeof(Edge));
+  edp->edge = erealloc(edp->edge, len * EDGE_SIZE(edb));
   edp->max_edge = len;
 }
 
+/* convert edge[] of all nodes to Edge64 */
+static void widen_edge_data(EdgeDB *edb)
+{
+  EdgeData *edp;
+  Edge32 *e32;
+  Edge64 *e64;
+  index_t i;
+  int j;
+
+  for (i = 0; i < edb->n_node; i++) {
+    edp = &(edb->edge_data[i]);
+    if (edp->max_edge == 0)
+      continue;
+    e32 = (Edge32 *) edp->edge;
+    e64 = (Edge64 *) emalloc(edp->max_edge * sizeof(Edge64));
+    for (j = 0; j < edp->n_edge; j++) {
+      e64[j].onid = e32[j].onid;
+      e64[j].mnid = e32[j].mnid;
+    }
+    free(edp->edge);
+    edp->edge = e64;
+  }
+  edb->wide = 1;
+}
+
+static void set_edge(EdgeDB *edb, EdgeData *edp, int j,
+		     index_t onid, index_t mnid)
+{
+  if (!edb->wide && (!fits_int(onid) || !fits_int(mnid)))
+    widen_edge_data(edb);
+
+  if (edb->wide)
+    set_edge64(edp, j, onid, mnid);
+  else
+    set_edge32(edp, j, onid, mnid);
+}
+
+/* extend edge_data for the nodes added to ndb after edge_init,
+   i.e. middle nodes registered by add_last_middle_node */
+static void extend_edge_data(EdgeDB *edb)
+{
+  index_t i, n_node;
+
+  n_node = number_of_nodes(edb->ndb);
+  if (n_node <= edb->n_node)
+    return;
+
+  edb->edge_data = (EdgeData *) erealloc_large(edb->edge_data,
+					       n_node * sizeof(EdgeData));
+  for (i = edb->n_node; i < n_node; i++) {
+    edb->edge_data[i].n_edge = 0;
+    edb->edge_data[i].n_edge_s = 0;
+    edb->edge_data[i].edge = NULL;
+    edb->edge_data[i].max_edge = 0;
+  }
+  edb->n_node = n_node;
+}
+
+/* search the edge i1-i2 (i1 < i2) and set the edge data of i1 in
+   *edp_p; return the index in edge[], or -1 if not registered */
+static int find_edge(EdgeDB *edb, index_t i1, index_t i2, EdgeData **edp_p)
+{
+  *edp_p = &(edb->edge_data[get_local_node_id(edb->ndb, i1)]);
+  return edge_find(edb, *edp_p, i2);
+}
+
+/* register an edge i1-i2 with the middle node ID given in the previous
+   refinement, which is used when the edge is found by middle_node().
+   Return value is 1 if reserved, or 0 if not because either end or
+   the middle node ID is not available in the current node data. */
+int reserve_edge(EdgeDB *edb, index_t i1, index_t i2, index_t mnid)
+{
+  EdgeData *edp;
+
+  set_middle_node_base(edb->ndb, mnid + 1);
+
+  if (i1 > i2) {
+    index_t tmp = i1;
+    i1 = i2;
+    i2 = tmp;
+  }
+  if (i1 == i2 || mnid <= 0 ||
+      !has_node(edb->ndb, i1) || !has_node(edb->ndb, i2) ||
+      has_node(edb->ndb, mnid))
+    return 0;
+  if (find_edge(edb, i1, i2, &edp) >= 0)
+    return 0;
+
+  if (edp->n_edge == edp->max_edge)
+    resize_edge(edb, edp, edp->max_edge + MAX_EDGE_GROW_LEN);
+
+  set_edge(edb, edp, edp->n_edge, i2, -mnid);
+  edp->n_edge++;
+  edb->n_reserved++;
+  return 1;
+}
+
 /* Global node-ID of the middle node between nodes i1 and i2 (global
    IDs) are set in *mnidp.
-   Return value is 1 if the middle node is newly created, or 0 if the
-   middle node already exists. */
+   Return value is 1 if the middle node is newly created, 2 if it is
+   created with the ID reserved by reserve_edge(), or 0 if the middle
+   node already exists. */
 index_t middle_node(EdgeDB *edb, index_t i1, index_t i2, index_t *mnidp)
 {
-  index_t li1, li2; /* local IDs of i1 and i2 */
+  return middle_node_local(edb, i1, get_local_node_id(edb->ndb, i1),
+			   i2, get_local_node_id(edb->ndb, i2), mnidp);
+}
+
+/* same as middle_node, with the local IDs li1 and li2 of the nodes
+   i1 and i2 already looked up (e.g. by lookup_nodes) */
+index_t middle_node_local(EdgeDB *edb, index_t i1, index_t li1,
+			  index_t i2, index_t li2, index_t *mnidp)
+{
   EdgeData *edp;
-  Edge *ep;
-  index_t j;
+  index_t mnid;
+  int j;
 
   /* make i1 smaller than  i2 */
   if (i1 > i2) {
     index_t tmp = i1;
     i1 = i2;
     i2 = tmp;
+    tmp = li1;
+    li1 = li2;
+    li2 = tmp;
   } else if (i1 == i2) {
-    fprintf(stderr, "no edge between identical node\n");
-    exit(1);
+    error_exit(1, "no edge between identical node\n");
   }
 
-  li1 = get_local_node_id(edb->ndb, i1);
-  edp = &(edb->edge_data[li1]);
+  extend_edge_data(edb);
 
   /* if the edge i1-i2 is registered, return the middle-node */
-  for (j = 0; j < edp->n_edge; j++) {
-    if (edp->edge[j].onid == i2) {
-      *mnidp = edp->edge[j].mnid;
+  edp = &(edb->edge_data[li1]);
+  j = edge_find(edb, edp, i2);
+  if (j >= 0) {
+    mnid = edge_mnid(edb, edp, j);
+    if (mnid > 0) {
+      *mnidp = mnid;
       return 0; /* not created */
     }
+    /* reserved: create the middle node with the reserved ID */
+    mnid = reuse_middle_node_local(edb->ndb, -mnid, li1, li2);
+    set_edge(edb, edp, j, i2, mnid);
+    edb->n_reused++;
+    edb->edge_data[li2].n_edge_s++;
+    *mnidp = mnid;
+    return 2; /* created with reserved ID */
   }
 
   /* not found: register as a new edge */
   if (edp->n_edge == edp->max_edge)
-    resize_edge(edp, edp->max_edge + MAX_EDGE_GROW_LEN);
-
-  j = edp->n_edge;
-  ep = &(edp->edge[j]);
+    resize_edge(edb, edp, edp->max_edge + MAX_EDGE_GROW_LEN);
 
-  ep->onid = i2;
-  ep->mnid = new_middle_node(edb->ndb, i1, i2);
+  mnid = new_middle_node_local(edb->ndb, li1, li2);
+  set_edge(edb, edp, edp->n_edge, i2, mnid);
   edp->n_edge++;
 
-  li2 = get_local_node_id(edb->ndb, i2);
   edb->edge_data[li2].n_edge_s++;
 
-  *mnidp = ep->mnid;
+  *mnidp = mnid;
   return 1; /* newly created */
 }
 
+/* prefetch the edge data of the n nodes of local IDs li[], to be given
+   to middle_node_local shortly */
+void prefetch_edge_data(const EdgeDB *edb, int n, const index_t *li)
+{
+  int k;
+
+  for (k = 0; k < n; k++)
+    PREFETCH(&(edb->edge_data[li[k]]));
+}
+
+/* remove the edge data of the nodes of local IDs li with drop[li] set,
+   e.g. nodes whose elements are all refined, keeping the order of the
+   others.  To be called just before compact_node_data with the same
+   drop[], so that the local IDs stay the same in both. */
+void compact_edge_data(EdgeDB *edb, const char *drop)
+{
+  index_t i, n = 0;
+
+  for (i = 0; i < edb->n_node; i++) {
+    if (drop[i]) {
+      free(edb->edge_data[i].edge);
+      continue;
+    }
+    edb->edge_data[n++] = edb->edge_data[i];
+  }
+  edb->edge_data = (EdgeData *) erealloc_large(edb->edge_data,
+					       n * sizeof(EdgeData));
+  edb->n_node = n;
+}
+
+/* return the global node-ID of the middle node between nodes i1 and i2,
+   or 0 if the middle node is not created */
+index_t find_middle_node(EdgeDB *edb, index_t i1, index_t i2)
+{
+  EdgeData *edp;
+  index_t mnid;
+  int j;
+
+  if (i1 > i2) {
+    index_t tmp = i1;
+    i1 = i2;
+    i2 = tmp;
+  }
+  extend_edge_data(edb);
+  if ((j = find_edge(edb, i1, i2, &edp)) < 0)
+    return 0;
+  mnid = edge_mnid(edb, edp, j);
+  return (mnid > 0) ? mnid : 0;
+}
+
+/* append the middle nodes of the edges between the n nodes of local IDs
+   li[], which have mark[] set, to *mid_p of allocated length *max_p
+   (grown as needed) from index n_mid; return the new number of them */
+index_t group_middle_nodes(EdgeDB *edb, index_t n, const index_t *li,
+			   const char *mark, index_t n_mid,
+			   index_t **mid_p, index_t *max_p)
+{
+  const EdgeData *edp;
+  index_t i, onid, mnid;
+  int j;
+
+  for (i = 0; i < n; i++) {
+    edp = &(edb->edge_data[li[i]]);
+    for (j = 0; j < edp->n_edge; j++) {
+      onid = edge_onid(edb, edp, j);
+      if ((mnid = edge_mnid(edb, edp, j)) <= 0 ||
+	  !mark[get_local_node_id(edb->ndb, onid)])
+	continue;
+      if (n_mid == *max_p) {
+	*max_p = (*max_p > 0) ? 2 * *max_p : 16;
+	*mid_p = (index_t *) erealloc(*mid_p, *max_p * sizeof(index_t));
+      }
+      (*mid_p)[n_mid++] = mnid;
+    }
+  }
+  return n_mid;
+}
+
+/* write the edge to middle-node map, to be given to reserve_edge() in
+   the next refinement */
+void edge_save(const EdgeDB *edb, FILE *fp)
+{
+  index_t i, nid, mnid;
+  int j;
+  const EdgeData *edp;
+
+  for (i = 0; i < edb->n_node; i++) {
+    edp = &(edb->edge_data[i]);
+    nid = get_global_node_id(edb->ndb, i);
+    for (j = 0; j < edp->n_edge; j++)
+      if ((mnid = edge_mnid(edb, edp, j)) > 0)
+	fprintf(fp, "%lld,%lld,%lld\n", (long long) nid,
+		(long long) edge_onid(edb, edp, j), (long long) mnid);
+  }
+}
+
+/* return the number of reserved edges whose middle nodes are created */
+index_t number_of_reused_edges(const EdgeDB *edb)
+{
+  return edb->n_reused;
+}
+
+/* return the number of reserved edges not used by any element */
+index_t number_of_unused_edges(const EdgeDB *edb)
+{
+  return edb->n_reserved - edb->n_reused;
+}
+
 /* print statistic data, just for interest. */
 void print_edge_stat(const EdgeDB *edb, FILE *log_file)
 {
@@ -151,13 +419,13 @@ void print_edge_stat(const EdgeDB *edb, FILE *log_file)
   index_t sum_max = 0;
   index_t i;
 
-  for (i = 0; i < edb->n_node_init; i++) {
+  for (i = 0; i < edb->n_node; i++) {
     neg = edb->edge_data[i].n_edge;
     ne = neg + edb->edge_data[i].n_edge_s;
 
     /* for debugging...
     fprintf(log_file, "%d: %d ( %d / %d )\n",
-	    edge_data[i].nid, ne, neg, edge_data[i].max_edge);
+	    get_global_node_id(edb->ndb, i), ne, neg, edge_data[i].max_edge);
     */
     sum_max += edb->edge_data[i].max_edge;
 
@@ -183,10 +451,65 @@ void print_edge_stat(const EdgeDB *edb, FILE *log_file)
 	  "             minimum number of edges : %lld\n"
 	  "             maximum number of edges : %lld\n"
 	  "             average number of edges : %f\n"
-	  "                used / allocated (%%) : %lld / %lld (%f%%)\n",
+	  "                used / allocated (%%) : %lld / %lld (%f%%)\n"
+	  "     bits of stored IDs (node / edge) : %d / %d\n",
 	  (long long) edb->n_node_init,
 	  (long long) n_node_actv,
 	  (long long) number_of_middle_nodes(edb->ndb),
 	  (long long) min, (long long) max, avr,
-	  (long long) sumg, (long long) sum_max, 100.0*(float)sumg/(float)sum_max);
+	  (long long) sumg, (long long) sum_max, 100.0*(float)sumg/(float)sum_max,
+	  node_id_bits(edb->ndb),
+	  8 * (int) (edb->wide ? sizeof(index_t) : sizeof(int)));
+}
+
+/* write edge data into a checkpoint */
+void write_edge_checkpoint(const EdgeDB *edb, FILE *fp)
+{
+  const EdgeData *edp;
+  index_t i;
+
+  ckpt_write(fp, &edb->n_node_init, sizeof(index_t));
+  ckpt_write(fp, &edb->n_node, sizeof(index_t));
+  ckpt_write(fp, &edb->wide, sizeof(int));
+  ckpt_write(fp, &edb->n_reserved, sizeof(index_t));
+  ckpt_write(fp, &edb->n_reused, sizeof(index_t));
+  for (i = 0; i < edb->n_node; i++) {
+    edp = &(edb->edge_data[i]);
+    ckpt_write(fp, &edp->n_edge, sizeof(int));
+    ckpt_write(fp, &edp->n_edge_s, sizeof(int));
+    ckpt_write(fp, edp->edge, edp->n_edge * EDGE_SIZE(edb));
+  }
+}
+
+/* create edge data from a checkpoint written by write_edge_checkpoint,
+   on the node data ndb read from the same checkpoint */
+void read_edge_checkpoint(EdgeDB **edb_p, NodeDB *ndb, FILE *fp)
+{
+  EdgeDB *edb;
+  EdgeData *edp;
+  index_t i;
+
+  /* *edb_p is set last, as in node_init */
+  edb = (EdgeDB *) emalloc(sizeof(EdgeDB));
+
+  ckpt_read(fp, &edb->n_node_init, sizeof(index_t));
+  ckpt_read(fp, &edb->n_node, sizeof(index_t));
+  ckpt_read(fp, &edb->wide, sizeof(int));
+  ckpt_read(fp, &edb->n_reserved, sizeof(index_t));
+  ckpt_read(fp, &edb->n_reused, sizeof(index_t));
+  edb->ndb = ndb;
+
+  edb->edge_data = (EdgeData *) emalloc_large(edb->n_node *
+					       sizeof(EdgeData));
+  for (i = 0; i < edb->n_node; i++) {
+    edp = &(edb->edge_data[i]);
+    ckpt_read(fp, &edp->n_edge, sizeof(int));
+    ckpt_read(fp, &edp->n_edge_s, sizeof(int));
+    edp->max_edge = edp->n_edge;
+    edp->edge = (edp->n_edge > 0) ?
+      emalloc(edp->n_edge * EDGE_SIZE(edb)) : NULL;
+    ckpt_read(fp, edp->edge, edp->n_edge * EDGE_SIZE(edb));
+  }
+
+  *edb_p = edb;
 }
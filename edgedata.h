@@ -9,7 +9,21 @@ typedef struct EdgeDB EdgeDB;
 
 extern void edge_init(EdgeDB **edb_p, NodeDB *ndb);
 extern void edge_finalize(EdgeDB *edb);
+extern int reserve_edge(EdgeDB *edb, index_t i1, index_t i2, index_t mnid);
 extern index_t middle_node(EdgeDB *edb, index_t i1, index_t i2, index_t *mnidp);
+extern index_t middle_node_local(EdgeDB *edb, index_t i1, index_t li1,
+				 index_t i2, index_t li2, index_t *mnidp);
+extern void prefetch_edge_data(const EdgeDB *edb, int n, const index_t *li);
+extern void compact_edge_data(EdgeDB *edb, const char *drop);
+extern index_t find_middle_node(EdgeDB *edb, index_t i1, index_t i2);
+extern index_t group_middle_nodes(EdgeDB *edb, index_t n, const index_t *li,
+				  const char *mark, index_t n_mid,
+				  index_t **mid_p, index_t *max_p);
+extern void edge_save(const EdgeDB *edb, FILE *fp);
+extern index_t number_of_reused_edges(const EdgeDB *edb);
+extern index_t number_of_unused_edges(const EdgeDB *edb);
 extern void print_edge_stat(const EdgeDB *edb, FILE *log_file);
+extern void write_edge_checkpoint(const EdgeDB *edb, FILE *fp);
+extern void read_edge_checkpoint(EdgeDB **edb_p, NodeDB *ndb, FILE *fp);
 
 #endif /* EDGEDATA_H */
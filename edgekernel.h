@@ -0,0 +1,44 @@
+/*
+ * edgekernel.h
+ *   Edge data kernels for one width of stored node IDs, included by
+ *   edgedata.c with ID_T (type of stored IDs) and K() (name suffix)
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+
+typedef struct K(Edge) {
+  ID_T onid; /* node id of the other end of the edge */
+  ID_T mnid; /* node id of the middle node;                *
+              * -mnid if reserved but not created yet     */
+} K(Edge);
+
+/* index of the edge to node i2 in edp->edge[], or -1 if not found */
+static int K(edge_find)(const EdgeData *edp, index_t i2)
+{
+  const K(Edge) *ep = (const K(Edge) *) edp->edge;
+  int j;
+
+  for (j = 0; j < edp->n_edge; j++)
+    if (ep[j].onid == i2)
+      return j;
+  return -1;
+}
+
+static index_t K(edge_onid)(const EdgeData *edp, int j)
+{
+  return ((const K(Edge) *) edp->edge)[j].onid;
+}
+
+static index_t K(edge_mnid)(const EdgeData *edp, int j)
+{
+  return ((const K(Edge) *) edp->edge)[j].mnid;
+}
+
+static void K(set_edge)(EdgeData *edp, int j, index_t onid, index_t mnid)
+{
+  K(Edge) *ep = (K(Edge) *) edp->edge + j;
+
+  ep->onid = (ID_T) onid;
+  ep->mnid = (ID_T) mnid;
+}
@@ -12,60 +12,110 @@
 #include "elemdata.h"
 #include "nodedata.h"
 #include "util.h"
+#include "largemem.h"
 
-/* data set for a single element. */
-struct ElemData {
-  index_t id;
-  index_t n[10];
-};
-
-typedef struct ElemData ElemData;
-
+/* Element IDs and connectivity are stored in int while they fit, and
+   converted to index_t when a larger ID appears.  The kernels in
+   elemkernel.h are compiled for both widths and selected by wide. */
 struct ElemDB {
   index_t n_elem;
   int npe; /* number of nodes per element */
-  ElemData *elem_data;
+  int wide; /* 1 if IDs are stored in index_t */
+  void *ids; /* elementIDs */
+  void *conn; /* connectivity, npe nodes per element */
   index_t max_elem;
   char *elem_header;
 };
 
 enum { MAX_ELEM_INIT = 1024, MAX_ELEM_GROW = 2 };
 
+#define ID_T int
+#define K(name) name##32
+#include "elemkernel.h"
+#undef ID_T
+#undef K
+
+#define ID_T index_t
+#define K(name) name##64
+#include "elemkernel.h"
+#undef ID_T
+#undef K
+
+#define ID_SIZE(eldb) ((eldb)->wide ? sizeof(index_t) : sizeof(int))
+
+/* return 1 if id can be stored in int */
+static int fits_int(index_t id)
+{
+  return (index_t) (int) id == id;
+}
+
+/* (re)allocate ids and conn for max_elem elements */
+static void resize_elem(ElemDB *eldb, index_t max_elem)
+{
+  /* conn holds at least one entry when npe is not known (0) */
+  index_t npe = (eldb->npe > 0) ? eldb->npe : 1;
+
+  eldb->ids = erealloc_large(eldb->ids, max_elem * ID_SIZE(eldb));
+  eldb->conn = erealloc_large(eldb->conn, max_elem * npe * ID_SIZE(eldb));
+  eldb->max_elem = max_elem;
+}
+
+/* convert ids and conn to index_t */
+static void widen_elem_data(ElemDB *eldb)
+{
+  index_t *ids, *conn;
+  index_t i;
+
+  ids = (index_t *) emalloc_large(eldb->max_elem * sizeof(index_t));
+  conn = (index_t *) emalloc_large(eldb->max_elem *
+			     ((eldb->npe > 0) ? eldb->npe : 1) *
+			     sizeof(index_t));
+  for (i = 0; i < eldb->n_elem; i++) {
+    ids[i] = elem_id32(eldb, i);
+    elem_nodes32(eldb, i, conn + i * eldb->npe);
+  }
+  free_large(eldb->ids);
+  free_large(eldb->conn);
+  eldb->ids = ids;
+  eldb->conn = conn;
+  eldb->wide = 1;
+}
 
 /* initialize elem_data */
 void elem_init(ElemDB **eldb_p, const char *header)
 {
   ElemDB *eldb;
+  int npe = 0;
+
+  if (header != NULL) {
+    if (strstr(header, "342") != NULL)
+      npe = 10;
+    else if (strstr(header, "341") != NULL)
+      npe = 4;
+    else
+      error_exit(1, "Error: element type not supported\n");
+  }
 
-  *eldb_p = (ElemDB *) emalloc(sizeof(ElemDB));
-
-  eldb = *eldb_p;
+  /* *eldb_p is set last, as in node_init */
+  eldb = (ElemDB *) emalloc(sizeof(ElemDB));
 
   eldb->n_elem = 0;
-  eldb->elem_data = (ElemData *) emalloc(MAX_ELEM_INIT * sizeof(ElemData));
-  eldb->max_elem = MAX_ELEM_INIT;
-
-  if (header == NULL) {
-    eldb->elem_header = NULL;
-    return;
-  }
+  eldb->npe = npe;
+  eldb->wide = 0;
+  eldb->ids = NULL;
+  eldb->conn = NULL;
+  resize_elem(eldb, MAX_ELEM_INIT);
 
-  eldb->elem_header = estrdup(header);
+  eldb->elem_header = (header != NULL) ? estrdup(header) : NULL;
 
-  if (strstr(eldb->elem_header, "342") != NULL)
-    eldb->npe = 10;
-  else if (strstr(eldb->elem_header, "341") != NULL)
-    eldb->npe = 4;
-  else {
-    fprintf(stderr, "Error: element type not supported\n");
-    exit(1);
-  }
+  *eldb_p = eldb;
 }
 
 /* finalize elem_data */
 void elem_finalize(ElemDB *eldb)
 {
-  free(eldb->elem_data);
+  free_large(eldb->ids);
+  free_large(eldb->conn);
   free(eldb->elem_header);
 
   free(eldb);
@@ -76,21 +126,24 @@ void new_elem(ElemDB *eldb, index_t id, const index_t *n)
 {
   int i;
 
-  if (eldb->n_elem == eldb->max_elem) {
-    eldb->max_elem *= MAX_ELEM_GROW;
-    eldb->elem_data = 
-      (ElemData *) erealloc(eldb->elem_data,
-			    eldb->max_elem * sizeof(ElemData));
-  }
+  if (eldb->n_elem == eldb->max_elem)
+    resize_elem(eldb, eldb->max_elem * MAX_ELEM_GROW);
 
-  if (eldb->n_elem > 0 && eldb->elem_data[eldb->n_elem - 1].id >= id) {
-    fprintf(stderr, "Error: elem id is not sorted\n");
-    exit(1);
+  if (eldb->n_elem > 0 && get_elem_id(eldb, eldb->n_elem - 1) >= id)
+    error_exit(1, "Error: elem id is not sorted\n");
+
+  if (!eldb->wide) {
+    int fits = fits_int(id);
+    for (i = 0; fits && i < eldb->npe; i++)
+      fits = fits_int(n[i]);
+    if (!fits)
+      widen_elem_data(eldb);
   }
 
-  eldb->elem_data[eldb->n_elem].id = id;
-  for (i = 0; i < eldb->npe; i++)
-    eldb->elem_data[eldb->n_elem].n[i] = n[i];
+  if (eldb->wide)
+    set_elem64(eldb, eldb->n_elem, id, n);
+  else
+    set_elem32(eldb, eldb->n_elem, id, n);
   eldb->n_elem++;
 }
 
@@ -100,18 +153,72 @@ index_t number_of_elems(ElemDB *eldb)
   return eldb->n_elem;
 }
 
+/* return the number of nodes per element */
+int nodes_per_elem(const ElemDB *eldb)
+{
+  return eldb->npe;
+}
+
+/* return the header line of the element section */
+const char *get_elem_header(const ElemDB *eldb)
+{
+  return eldb->elem_header;
+}
+
+/* return the elementID of i-th (local) element */
+index_t get_elem_id(const ElemDB *eldb, index_t i)
+{
+  return eldb->wide ? elem_id64(eldb, i) : elem_id32(eldb, i);
+}
+
+/* copy the connectivity (global nodeIDs) of i-th (local) element to n[] */
+void get_elem_nodes(const ElemDB *eldb, index_t i, index_t *n)
+{
+  if (eldb->wide)
+    elem_nodes64(eldb, i, n);
+  else
+    elem_nodes32(eldb, i, n);
+}
+
+/* return the local index of element having elementID id, or -1 */
+static index_t find_elem(ElemDB *eldb, index_t id)
+{
+  if (eldb->wide)
+    return find_elem64(eldb, id);
+  return fits_int(id) ? find_elem32(eldb, id) : -1;
+}
+
+int has_elem(ElemDB *eldb, index_t id)
+{
+  return find_elem(eldb, id) >= 0;
+}
+
+/* return the local index of element having elementID id */
+index_t get_local_elem_id(ElemDB *eldb, index_t id)
+{
+  index_t i;
+
+  i = find_elem(eldb, id);
+  if (i < 0)
+    error_exit(1, "Error: could not find data for element %lld\n",
+	       (long long) id);
+  return i;
+}
+
 /* print element data */
 void print_elem(ElemDB *eldb, FILE *fp)
 {
   index_t i;
+  index_t n[10];
   int j;
 
   if (eldb->elem_header != NULL)
     fprintf(fp, "%s", eldb->elem_header);
   for (i = 0; i < eldb->n_elem; i++) {
-    fprintf(fp, "%lld", (long long) eldb->elem_data[i].id);
+    fprintf(fp, "%lld", (long long) get_elem_id(eldb, i));
+    get_elem_nodes(eldb, i, n);
     for (j = 0; j < eldb->npe; j++)
-      fprintf(fp, ",%lld", (long long) eldb->elem_data[i].n[j]);
+      fprintf(fp, ",%lld", (long long) n[j]);
     fprintf(fp, "\n");
   }
 }
@@ -120,12 +227,14 @@ void print_elem(ElemDB *eldb, FILE *fp)
 void print_elem_adv(ElemDB *eldb, NodeDB *ndb, FILE *fp)
 {
   index_t i;
+  index_t n[10];
   int j;
   static int f2a[10] = {3, 1, 0, 2, 8, 7, 9, 6, 5, 4};
 
   for (i = 0; i < eldb->n_elem; i++) {
+    get_elem_nodes(eldb, i, n);
     for (j = 0; j < eldb->npe; j++)
-      fprintf(fp, " %lld", (long long) get_local_node_id(ndb, eldb->elem_data[i].n[f2a[j]]));
+      fprintf(fp, " %lld", (long long) get_local_node_id(ndb, n[f2a[j]]));
     fprintf(fp, "\n");
   }
 }
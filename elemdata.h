@@ -12,6 +12,12 @@ extern void elem_init(ElemDB **eldb_p, const char *header);
 extern void elem_finalize(ElemDB *eldb);
 extern void new_elem(ElemDB *eldb, index_t id, const index_t *n);
 extern index_t number_of_elems(ElemDB *eldb);
+extern int nodes_per_elem(const ElemDB *eldb);
+extern const char *get_elem_header(const ElemDB *eldb);
+extern index_t get_elem_id(const ElemDB *eldb, index_t i);
+extern void get_elem_nodes(const ElemDB *eldb, index_t i, index_t *n);
+extern int has_elem(ElemDB *eldb, index_t id);
+extern index_t get_local_elem_id(ElemDB *eldb, index_t id);
 extern void print_elem(ElemDB *eldb, FILE *fp);
 extern void print_elem_adv(ElemDB *eldb, NodeDB *ndb, FILE *fp);
 
@@ -0,0 +1,51 @@
+/*
+ * elemkernel.h
+ *   Element data kernels for one width of stored IDs, included by
+ *   elemdata.c with ID_T (type of stored IDs) and K() (name suffix)
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+
+static void K(set_elem)(ElemDB *eldb, index_t i, index_t id, const index_t *n)
+{
+  ID_T *conn = (ID_T *) eldb->conn + i * eldb->npe;
+  int j;
+
+  ((ID_T *) eldb->ids)[i] = (ID_T) id;
+  for (j = 0; j < eldb->npe; j++)
+    conn[j] = (ID_T) n[j];
+}
+
+static index_t K(elem_id)(const ElemDB *eldb, index_t i)
+{
+  return ((const ID_T *) eldb->ids)[i];
+}
+
+static void K(elem_nodes)(const ElemDB *eldb, index_t i, index_t *n)
+{
+  const ID_T *conn = (const ID_T *) eldb->conn + i * eldb->npe;
+  int j;
+
+  for (j = 0; j < eldb->npe; j++)
+    n[j] = conn[j];
+}
+
+/* local index of the element having elementID id, or -1 if not found;
+   elements are sorted by ID (see new_elem) */
+static index_t K(find_elem)(const ElemDB *eldb, index_t id)
+{
+  const ID_T *ids = (const ID_T *) eldb->ids;
+  index_t lo = 0, hi = eldb->n_elem - 1, mid;
+
+  while (lo <= hi) {
+    mid = lo + (hi - lo) / 2;
+    if (ids[mid] < id)
+      lo = mid + 1;
+    else if (ids[mid] > id)
+      hi = mid - 1;
+    else
+      return mid;
+  }
+  return -1;
+}
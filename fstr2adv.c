@@ -7,6 +7,7 @@
  * Last modified on Jun 24, 2013
  *
  */
+#define _XOPEN_SOURCE 700 /* for realpath() */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +17,7 @@
 #include "meshio.h"
 #include "nodedata.h"
 #include "elemdata.h"
+#include "vizout.h"
 #include "refine.h"
 
 void usage(void)
@@ -26,18 +28,56 @@ void usage(void)
 	  "or standard input, into "
 	  "Adventure-format mesh file DEST, "
 	  "or standard output.\n"
-	  "  -v   verbose mode\n"
-	  "  -h   display help\n",
+	  "  -t TYPE  output format: adv (default), vtu (VTK XML with raw "
+	  "binary data)\n"
+	  "           or xdmf (XDMF with binary data in RAW)\n"
+	  "  -b RAW   binary data file of xdmf output\n"
+	  "  -v       verbose mode\n"
+	  "  -S       disable reader/writer threads\n"
+	  "  -R       print coordinates in the shortest form reading back "
+	  "exactly\n"
+	  "  -H       allocate large arrays on reserved huge pages\n"
+	  "  -I       interleave large arrays over NUMA nodes\n"
+	  "  -C DIR   take DEST from cache directory DIR if converted before,\n"
+	  "           or store it there (SOURCE and DEST must be files)\n"
+	  "  -h       display help\n",
 	  progname());
   exit(1);
 }
 
+const char refine_options[] = "t:b:";
+const char input_file_options[] = "";
+const char output_file_options[] = "b";
+
+enum { OUT_ADV, OUT_VTU, OUT_XDMF };
+
+static int out_type = OUT_ADV;
+static const char *raw_name = NULL;
+
+void refine_option(int opt, const char *arg)
+{
+  if (opt == 'b') {
+    raw_name = arg;
+  } else if (opt == 't') {
+    if (strcmp(arg, "adv") == 0)
+      out_type = OUT_ADV;
+    else if (strcmp(arg, "vtu") == 0)
+      out_type = OUT_VTU;
+    else if (strcmp(arg, "xdmf") == 0)
+      out_type = OUT_XDMF;
+    else {
+      fprintf(stderr, "Error: unknown output format %s\n", arg);
+      usage();
+    }
+  }
+}
+
 static void proceed_node_data(const char *line, NodeDB *ndb)
 {
   long long node_id;
-  float x, y, z;
+  coord_t x, y, z;
 
-  if (sscanf(line, "%lld,%f,%f,%f", &node_id, &x, &y, &z) != 4) {
+  if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4) {
     fprintf(stderr, "Error: reading node data failed\n");
     exit(1);
   }
@@ -63,6 +103,30 @@ static void proceed_elem_data(const char *line,
   new_elem(eldb, elem_id, n);
 }
 
+/* name by which the XDMF file dest refers to raw file raw (to be
+   freed).  XDMF readers take a relative name from the directory of
+   dest, so raw is given relative to it if raw is in that directory
+   or below, and as an absolute path otherwise.  Written to standard
+   output, raw is referred to as given, i.e. from the directory where
+   the XDMF file is read. */
+static char *raw_reference(const char *raw, const char *dest)
+{
+  const char *p;
+  char *path;
+  size_t dir_len;
+
+  if (raw[0] == '/' || dest == NULL)
+    return estrdup(raw);
+  p = strrchr(dest, '/');
+  dir_len = (p != NULL) ? (size_t) (p - dest) + 1 : 0;
+  if (dest[0] != '/' && strncmp(raw, dest, dir_len) == 0)
+    return estrdup(raw + dir_len);
+  path = realpath(raw, NULL);
+  if (path == NULL)
+    error_exit(2, "Error: cannot resolve %s\n", raw);
+  return path;
+}
+
 void refine(FILE *from_file, const char *from_file_name,
 	    FILE *to_file, int verbose)
 {
@@ -72,6 +136,15 @@ void refine(FILE *from_file, const char *from_file_name,
   MeshIO *mio;
   NodeDB *nodeDB;
   ElemDB *elemDB;
+  FILE *raw_file = NULL;
+
+  if (out_type == OUT_XDMF) {
+    if (raw_name == NULL) {
+      fprintf(stderr, "Error: xdmf output requires -b RAW\n");
+      usage();
+    }
+    raw_file = efopen(raw_name, "wb");
+  }
 
   if (verbose) {
     print_log(stderr, "Starting mesh-type conversion (reading from %s)...",
@@ -123,11 +196,23 @@ void refine(FILE *from_file, const char *from_file_name,
     }
   }
 
-  fprintf(to_file, "%lld\n", (long long) number_of_elems(elemDB));
-  print_elem_adv(elemDB, nodeDB, to_file);
+  if (out_type == OUT_VTU) {
+    print_mesh_vtu(nodeDB, elemDB, to_file);
 
-  fprintf(to_file, "%lld\n", (long long) number_of_nodes(nodeDB));
-  print_node_adv(nodeDB, to_file);
+  } else if (out_type == OUT_XDMF) {
+    char *raw_ref = raw_reference(raw_name, dest_file_name());
+
+    print_mesh_xdmf(nodeDB, elemDB, to_file, raw_file, raw_ref);
+    fclose(raw_file);
+    free(raw_ref);
+
+  } else {
+    fprintf(to_file, "%lld\n", (long long) number_of_elems(elemDB));
+    print_elem_adv(elemDB, nodeDB, to_file);
+
+    fprintf(to_file, "%lld\n", (long long) number_of_nodes(nodeDB));
+    print_node_adv(nodeDB, to_file);
+  }
 
   meshio_finalize(mio);
   node_finalize(nodeDB);
@@ -0,0 +1,108 @@
+/*
+ * groupdata.c
+ *   Parse data lines and print headers of NGROUP and EGROUP sections
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "groupdata.h"
+#include "util.h"
+
+enum { MAX_IDS_INIT = 16 };
+
+/* return 1 if the group header has the GENERATE option */
+int group_is_generate(const char *header)
+{
+  return strstr(header, "GENERATE") != NULL;
+}
+
+/* copy the group name given by NGRP= or EGRP= in the group header to
+   name (at most len-1 characters).
+   return 1 if found, or 0 if not. */
+int group_name(const char *header, char *name, int len)
+{
+  const char *p;
+  int i;
+
+  if ((p = strstr(header, "GRP=")) == NULL)
+    return 0;
+  p += 4;
+  while (*p == ' ' || *p == '\t')
+    p++;
+  for (i = 0; i < len - 1 && p[i] != '\0' && p[i] != ',' &&
+	 !isspace((unsigned char) p[i]); i++)
+    name[i] = p[i];
+  name[i] = '\0';
+  return i > 0;
+}
+
+/* append id to the buffer *ids_p, growing it as needed */
+static void push_id(index_t **ids_p, index_t *max_p, index_t n, index_t id)
+{
+  if (n == *max_p) {
+    *max_p = (*max_p > 0) ? 2 * *max_p : MAX_IDS_INIT;
+    *ids_p = (index_t *) erealloc(*ids_p, *max_p * sizeof(index_t));
+  }
+  (*ids_p)[n] = id;
+}
+
+/* parse a data line of NGROUP/EGROUP section.
+   IDs are stored in *ids_p, which is (re)allocated as needed and
+   whose allocated length is kept in *max_p.
+   If generate is set, the line is "start, end[, step]" and the range
+   is expanded.
+   return value is the number of IDs on the line. */
+index_t parse_group_data(const char *line, int generate,
+			 index_t **ids_p, index_t *max_p)
+{
+  index_t n = 0;
+
+  if (generate) {
+    long long start, end, step = 1, id;
+    int nret;
+
+    nret = sscanf(line, "%lld,%lld,%lld", &start, &end, &step);
+    if (nret < 2 || step <= 0)
+      error_exit(1, "Error: reading group data (GENERATE) failed\n");
+    for (id = start; id <= end; id += step)
+      push_id(ids_p, max_p, n++, id);
+
+  } else {
+    const char *p = line;
+    char *q;
+    long long id;
+
+    for (;;) {
+      while (isspace((unsigned char) *p) || *p == ',')
+	p++;
+      if (*p == '\0')
+	break;
+      id = strtoll(p, &q, 10);
+      if (q == p)
+	error_exit(1, "Error: reading group data failed\n");
+      push_id(ids_p, max_p, n++, id);
+      p = q;
+    }
+  }
+  return n;
+}
+
+/* print group header, dropping GENERATE option for the members to be
+   written one by one */
+void print_group_header(FILE *fp, const char *line)
+{
+  const char *p, *q;
+
+  if ((p = strstr(line, "GENERATE")) == NULL) {
+    fprintf(fp, "%s", line);
+    return;
+  }
+  q = p + strlen("GENERATE");
+  while (p > line && (p[-1] == ' ' || p[-1] == '\t' || p[-1] == ','))
+    p--;
+  fprintf(fp, "%.*s%s", (int) (p - line), line, q);
+}
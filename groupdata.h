@@ -0,0 +1,13 @@
+#ifndef GROUPDATA_H
+#define GROUPDATA_H
+
+#include <stdio.h>
+#include "precision.h"
+
+extern int group_is_generate(const char *header);
+extern int group_name(const char *header, char *name, int len);
+extern index_t parse_group_data(const char *line, int generate,
+				index_t **ids_p, index_t *max_p);
+extern void print_group_header(FILE *fp, const char *line);
+
+#endif /* GROUPDATA_H */
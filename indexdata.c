@@ -0,0 +1,385 @@
+/*
+ * indexdata.c
+ *   Index of a mesh file, kept in MESHFILE.idx: byte offsets and line
+ *   counts of the sections, and the offsets and IDs of every step-th
+ *   data line, by which readers seek into the file without reading it
+ *   from the start
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "indexdata.h"
+#include "meshio.h"
+#include "util.h"
+
+/* a mark on a data line of a section */
+typedef struct IndexMark {
+  long long line;   /* number of the data line in the section, from 0 */
+  long long offset; /* byte offset of the line */
+  long long id;     /* its first field (NODE and ELEMENT only) */
+} IndexMark;
+
+struct MeshIndex {
+  long long size;   /* size of the mesh file */
+  int step;
+  int n_section;
+  int max_section;
+  MeshSection *section;
+  long long n_mark;
+  long long max_mark;
+  IndexMark *mark;
+};
+
+static const char index_magic[] = "MESHINDEX 1";
+
+/* return the name of the index of mesh_name (to be freed) */
+char *meshindex_name(const char *mesh_name)
+{
+  char *name = (char *) emalloc(strlen(mesh_name) + 5);
+
+  strcpy(name, mesh_name);
+  strcat(name, ".idx");
+  return name;
+}
+
+/* size and modification time of file name, by which an index is
+   checked to be up to date */
+static int file_stamp(const char *name, long long stamp[3])
+{
+  struct stat st;
+
+  if (stat(name, &st) != 0)
+    return 0;
+  stamp[0] = (long long) st.st_size;
+  stamp[1] = (long long) st.st_mtim.tv_sec;
+  stamp[2] = (long long) st.st_mtim.tv_nsec;
+  return 1;
+}
+
+static MeshIndex *new_index(int step)
+{
+  MeshIndex *idx = (MeshIndex *) emalloc(sizeof(MeshIndex));
+
+  idx->size = 0;
+  idx->step = step;
+  idx->n_section = 0;
+  idx->max_section = 16;
+  idx->section = (MeshSection *) emalloc(idx->max_section *
+					  sizeof(MeshSection));
+  idx->n_mark = 0;
+  idx->max_mark = 1024;
+  idx->mark = (IndexMark *) emalloc(idx->max_mark * sizeof(IndexMark));
+  return idx;
+}
+
+static MeshSection *add_section(MeshIndex *idx)
+{
+  MeshSection *sec;
+
+  if (idx->n_section == idx->max_section) {
+    idx->max_section *= 2;
+    idx->section = (MeshSection *)
+      erealloc(idx->section, idx->max_section * sizeof(MeshSection));
+  }
+  sec = &(idx->section[idx->n_section++]);
+  memset(sec, 0, sizeof(MeshSection));
+  sec->mark = idx->n_mark;
+  return sec;
+}
+
+static void add_mark(MeshIndex *idx, long long line, long long offset,
+		     long long id)
+{
+  IndexMark *m;
+
+  if (idx->n_mark == idx->max_mark) {
+    idx->max_mark *= 2;
+    idx->mark = (IndexMark *)
+      erealloc(idx->mark, idx->max_mark * sizeof(IndexMark));
+  }
+  m = &(idx->mark[idx->n_mark++]);
+  m->line = line;
+  m->offset = offset;
+  m->id = id;
+}
+
+/* build the index of the mesh file fp, read from its start, marking
+   every step-th data line of each section */
+void meshindex_build(MeshIndex **idx_p, FILE *fp, int step)
+{
+  MeshIndex *idx;
+  MeshIO *mio;
+  MeshSection *sec = NULL;
+  char *line;
+  int mode, header;
+  long long pos, id;
+
+  if (step < 1)
+    error_exit(1, "Error: index step must be positive\n");
+  *idx_p = idx = new_index(step);
+
+  meshio_init(&mio, fp);
+  pos = meshio_tell(mio);
+  while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
+    if (mode == HEADER) {
+      size_t len = strcspn(line, "\r\n");
+
+      if (sec != NULL)
+	sec->end = pos;
+      sec = add_section(idx);
+      sec->header = header;
+      sec->line = (char *) emalloc(len + 1);
+      memcpy(sec->line, line, len);
+      sec->line[len] = '\0';
+      sec->offset = pos;
+      sec->data_offset = meshio_tell(mio);
+      sec->sorted = (header == NODE || header == ELEMENT);
+    } else if (sec != NULL) {
+      sec->n_line++;
+      if (mode == DATA) {
+	id = 0;
+	if (header == NODE || header == ELEMENT) {
+	  id = strtoll(line, NULL, 10);
+	  if (sec->n_data == 0)
+	    sec->first_id = id;
+	  else if (id <= sec->last_id)
+	    sec->sorted = 0;
+	  sec->last_id = id;
+	}
+	if (sec->n_data % step == 0) {
+	  add_mark(idx, sec->n_data, pos, id);
+	  sec->n_mark++;
+	}
+	sec->n_data++;
+      }
+    }
+    pos = meshio_tell(mio);
+  }
+  if (sec != NULL)
+    sec->end = pos;
+  idx->size = pos;
+  meshio_finalize(mio);
+}
+
+/* write the index of mesh_name to mesh_name.idx */
+void meshindex_write(const MeshIndex *idx, const char *mesh_name)
+{
+  char *name = meshindex_name(mesh_name);
+  long long stamp[3] = {0, 0, 0};
+  FILE *fp;
+  int k;
+  long long i;
+
+  if (!file_stamp(mesh_name, stamp))
+    error_exit(1, "Error: cannot stat %s\n", mesh_name);
+  if (stamp[0] != idx->size)
+    error_exit(1, "Error: %s has changed while indexed\n", mesh_name);
+
+  fp = efopen(name, "w");
+  fprintf(fp, "%s\n", index_magic);
+  fprintf(fp, "SOURCE %lld %lld %lld\n", stamp[0], stamp[1], stamp[2]);
+  fprintf(fp, "STEP %d\n", idx->step);
+  fprintf(fp, "SECTIONS %d\n", idx->n_section);
+  for (k = 0; k < idx->n_section; k++) {
+    const MeshSection *sec = &(idx->section[k]);
+
+    fprintf(fp, "S %d %lld %lld %lld %lld %lld %d %lld %lld %lld\n",
+	    sec->header, sec->offset, sec->data_offset, sec->end,
+	    sec->n_line, sec->n_data, sec->sorted,
+	    sec->first_id, sec->last_id, sec->n_mark);
+    fprintf(fp, "%s\n", sec->line);
+    for (i = sec->mark; i < sec->mark + sec->n_mark; i++)
+      fprintf(fp, "M %lld %lld %lld\n", idx->mark[i].line,
+	      idx->mark[i].offset, idx->mark[i].id);
+  }
+  if (fclose(fp) != 0)
+    error_exit(1, "Error: writing %s failed\n", name);
+  free(name);
+}
+
+/* read the index of mesh_name from mesh_name.idx.  Return value is 1
+   on success, or 0 (with *idx_p set to NULL) if there is no index or
+   it is older than the mesh file. */
+int meshindex_load(MeshIndex **idx_p, const char *mesh_name)
+{
+  char *name = meshindex_name(mesh_name);
+  char buf[1100];
+  long long stamp[3], s[3];
+  MeshIndex *idx;
+  FILE *fp;
+  int n, k, step;
+  long long i;
+
+  *idx_p = NULL;
+  fp = fopen(name, "r");
+  if (fp == NULL || !file_stamp(mesh_name, stamp)) {
+    if (fp != NULL) fclose(fp);
+    free(name);
+    return 0;
+  }
+
+  if (fgets(buf, sizeof(buf), fp) == NULL ||
+      strncmp(buf, index_magic, strlen(index_magic)) != 0 ||
+      fscanf(fp, "SOURCE %lld %lld %lld STEP %d SECTIONS %d",
+	     &s[0], &s[1], &s[2], &step, &n) != 5 ||
+      step < 1 || n < 0)
+    goto broken;
+  if (s[0] != stamp[0] || s[1] != stamp[1] || s[2] != stamp[2]) {
+    fclose(fp);
+    free(name);
+    return 0;
+  }
+
+  idx = new_index(step);
+  idx->size = stamp[0];
+  for (k = 0; k < n; k++) {
+    MeshSection *sec = add_section(idx);
+    size_t len;
+
+    if (fscanf(fp, " S %d %lld %lld %lld %lld %lld %d %lld %lld %lld",
+	       &sec->header, &sec->offset, &sec->data_offset, &sec->end,
+	       &sec->n_line, &sec->n_data, &sec->sorted,
+	       &sec->first_id, &sec->last_id, &sec->n_mark) != 10 ||
+	fgetc(fp) != '\n' || fgets(buf, sizeof(buf), fp) == NULL) {
+      meshindex_finalize(idx);
+      goto broken;
+    }
+    len = strcspn(buf, "\n");
+    sec->line = (char *) emalloc(len + 1);
+    memcpy(sec->line, buf, len);
+    sec->line[len] = '\0';
+    sec->mark = idx->n_mark;
+    for (i = 0; i < sec->n_mark; i++) {
+      IndexMark m;
+
+      if (fscanf(fp, " M %lld %lld %lld", &m.line, &m.offset, &m.id) != 3) {
+	meshindex_finalize(idx);
+	goto broken;
+      }
+      add_mark(idx, m.line, m.offset, m.id);
+    }
+  }
+  fclose(fp);
+  free(name);
+  *idx_p = idx;
+  return 1;
+
+ broken:
+  fprintf(stderr, "Warning: ignoring broken index %s\n", name);
+  fclose(fp);
+  free(name);
+  return 0;
+}
+
+/* build the index of the file mesh_name and write it to mesh_name.idx */
+void meshindex_create(const char *mesh_name, int step)
+{
+  MeshIndex *idx;
+  FILE *fp;
+
+  fp = efopen(mesh_name, "r");
+  meshindex_build(&idx, fp, step);
+  fclose(fp);
+  meshindex_write(idx, mesh_name);
+  meshindex_finalize(idx);
+}
+
+void meshindex_finalize(MeshIndex *idx)
+{
+  int k;
+
+  for (k = 0; k < idx->n_section; k++)
+    free(idx->section[k].line);
+  free(idx->section);
+  free(idx->mark);
+  free(idx);
+}
+
+int meshindex_n_section(const MeshIndex *idx)
+{
+  return idx->n_section;
+}
+
+const MeshSection *meshindex_section(const MeshIndex *idx, int k)
+{
+  return &(idx->section[k]);
+}
+
+/* return the number of data lines in the sections of type header */
+long long meshindex_count(const MeshIndex *idx, int header)
+{
+  long long n = 0;
+  int k;
+
+  for (k = 0; k < idx->n_section; k++)
+    if (idx->section[k].header == header)
+      n += idx->section[k].n_data;
+  return n;
+}
+
+/* find the data line of ID id in the sorted sections of type header
+   (NODE or ELEMENT).  Return value is the section whose IDs range over
+   id, with *offset set to the offset of a data line at most step lines
+   before the one of id (if any), or -1 if no sorted section has id in
+   its range.  Sections not sorted by ID have to be searched by the
+   caller. */
+int meshindex_find(const MeshIndex *idx, int header, long long id,
+		   long long *offset)
+{
+  int k;
+
+  for (k = 0; k < idx->n_section; k++) {
+    const MeshSection *sec = &(idx->section[k]);
+    const IndexMark *m;
+    long long lo, hi;
+
+    if (sec->header != header || !sec->sorted || sec->n_data == 0 ||
+	id < sec->first_id || id > sec->last_id)
+      continue;
+
+    /* the last mark with ID not larger than id */
+    m = &(idx->mark[sec->mark]);
+    lo = 0;
+    hi = sec->n_mark - 1;
+    while (lo < hi) {
+      long long mid = (lo + hi + 1) / 2;
+      if (m[mid].id <= id)
+	lo = mid;
+      else
+	hi = mid - 1;
+    }
+    *offset = m[lo].offset;
+    return k;
+  }
+  return -1;
+}
+
+/* split the data of section k into up to n_part ranges of about the
+   same number of data lines, starting at marked lines.  The ranges are
+   [offsets[i], offsets[i+1]) for i < return value; offsets must have
+   room for n_part + 1 offsets. */
+int meshindex_split(const MeshIndex *idx, int k, int n_part,
+		    long long *offsets)
+{
+  const MeshSection *sec = &(idx->section[k]);
+  const IndexMark *m = &(idx->mark[sec->mark]);
+  long long j, prev = 0;
+  int i, n = 0;
+
+  offsets[n++] = sec->data_offset;
+  for (i = 1; i < n_part; i++) {
+    j = (long long) ((double) sec->n_mark * i / n_part);
+    if (j > prev && j < sec->n_mark) {
+      offsets[n++] = m[j].offset;
+      prev = j;
+    }
+  }
+  offsets[n] = sec->end;
+  return n;
+}
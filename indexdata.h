@@ -0,0 +1,43 @@
+#ifndef INDEXDATA_H
+#define INDEXDATA_H
+
+#include <stdio.h>
+
+/* a section of the mesh file: a header line and the lines up to the
+   next header */
+typedef struct MeshSection {
+  int header;           /* NODE, ELEMENT, NGROUP, EGROUP or OTHER */
+  char *line;           /* header line without newline */
+  long long offset;     /* byte offset of the header line */
+  long long data_offset; /* of the line following the header line */
+  long long end;        /* of the next header line, or the file size */
+  long long n_line;     /* lines following the header line */
+  long long n_data;     /* data lines among them */
+  int sorted;           /* IDs ascending (NODE and ELEMENT only) */
+  long long first_id;   /* IDs of the first and last data lines */
+  long long last_id;
+  long long n_mark;     /* marks of every step-th data line */
+  long long mark;       /* index of the first mark of the section */
+} MeshSection;
+
+struct MeshIndex;
+typedef struct MeshIndex MeshIndex;
+
+enum { DEFAULT_INDEX_STEP = 1024 };
+
+extern void meshindex_build(MeshIndex **idx_p, FILE *fp, int step);
+extern int meshindex_load(MeshIndex **idx_p, const char *mesh_name);
+extern void meshindex_write(const MeshIndex *idx, const char *mesh_name);
+extern void meshindex_create(const char *mesh_name, int step);
+extern void meshindex_finalize(MeshIndex *idx);
+extern char *meshindex_name(const char *mesh_name);
+
+extern int meshindex_n_section(const MeshIndex *idx);
+extern const MeshSection *meshindex_section(const MeshIndex *idx, int k);
+extern long long meshindex_count(const MeshIndex *idx, int header);
+extern int meshindex_find(const MeshIndex *idx, int header, long long id,
+			  long long *offset);
+extern int meshindex_split(const MeshIndex *idx, int k, int n_part,
+			   long long *offsets);
+
+#endif /* INDEXDATA_H */
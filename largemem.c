@@ -0,0 +1,241 @@
+/*
+ * largemem.c
+ *   Allocation of large arrays (node, edge and element data) on huge
+ *   pages, optionally interleaved over NUMA nodes
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#ifdef USE_HUGEPAGE
+#define _GNU_SOURCE /* for MAP_ANONYMOUS, MAP_HUGETLB, mremap() and syscall() */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "largemem.h"
+#include "util.h"
+
+#ifdef USE_HUGEPAGE
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+#endif
+
+/* Arrays of LARGE_MIN bytes or more are mapped directly, in multiples
+   of HUGE_PAGE: with LARGE_MEM_HUGETLB from the reserved huge pages if
+   available, otherwise as normal pages advised for transparent huge
+   pages.  Pages are placed on the NUMA node of the thread touching
+   them first (the kernel default), or interleaved over all nodes with
+   LARGE_MEM_INTERLEAVE, which suits arrays shared by threads running
+   on several sockets.  Smaller arrays, and all arrays without
+   USE_HUGEPAGE, are allocated by malloc.  Each array is preceded by a
+   header of HEADER_SIZE bytes recording how it was allocated. */
+
+enum { LARGE_MIN = 4 << 20, HUGE_PAGE = 2 << 20, HEADER_SIZE = 64 };
+
+/* how an array is allocated */
+enum { BY_MALLOC, BY_HUGETLB, BY_THP, N_BY };
+
+typedef struct Header {
+  size_t size;    /* size requested */
+  size_t map_len; /* length of the mapping including the header */
+  int by;
+} Header;
+
+static int mem_flags = 0;
+
+static struct {
+  size_t cur;        /* bytes of large arrays in use */
+  size_t peak;
+  long long n[N_BY]; /* number of arrays allocated */
+  long long n_interleave;
+} mstat;
+
+void set_large_mem(int flags)
+{
+  mem_flags = flags;
+}
+
+int get_large_mem(void)
+{
+  return mem_flags;
+}
+
+static void count_alloc(int by, size_t len)
+{
+  mstat.n[by]++;
+  mstat.cur += len;
+  if (mstat.cur > mstat.peak)
+    mstat.peak = mstat.cur;
+}
+
+#ifdef USE_HUGEPAGE
+
+/* interleave the pages of [p, p+len) over all NUMA nodes allowed;
+   nodes not present are ignored by the kernel */
+static void interleave(void *p, size_t len)
+{
+  unsigned long mask[16];
+
+  memset(mask, 0xff, sizeof(mask));
+  if (syscall(SYS_mbind, p, len, MPOL_INTERLEAVE, mask,
+	      8 * sizeof(mask), 0) == 0)
+    mstat.n_interleave++;
+}
+
+/* map len bytes (a multiple of HUGE_PAGE); return NULL on failure */
+static Header *map_pages(size_t len)
+{
+  void *p = MAP_FAILED;
+  int by = BY_HUGETLB;
+
+#ifdef MAP_HUGETLB
+  if (mem_flags & LARGE_MEM_HUGETLB)
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  if (p == MAP_FAILED) {
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      return NULL;
+    by = BY_THP;
+#ifdef MADV_HUGEPAGE
+    madvise(p, len, MADV_HUGEPAGE);
+#endif
+  }
+  if (mem_flags & LARGE_MEM_INTERLEAVE)
+    interleave(p, len);
+
+  ((Header *) p)->map_len = len;
+  ((Header *) p)->by = by;
+  count_alloc(by, len);
+  return (Header *) p;
+}
+
+static void unmap_pages(Header *h)
+{
+  mstat.cur -= h->map_len;
+  munmap(h, h->map_len);
+}
+
+static size_t map_length(size_t size)
+{
+  return (size + HEADER_SIZE + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+}
+
+#endif /* USE_HUGEPAGE */
+
+void *emalloc_large(size_t size)
+{
+  Header *h;
+
+#ifdef USE_HUGEPAGE
+  if (size + HEADER_SIZE >= LARGE_MIN &&
+      (h = map_pages(map_length(size))) != NULL) {
+    h->size = size;
+    return (char *) h + HEADER_SIZE;
+  }
+#endif
+
+  h = (Header *) emalloc(size + HEADER_SIZE);
+  h->size = size;
+  h->map_len = 0;
+  h->by = BY_MALLOC;
+  count_alloc(BY_MALLOC, 0);
+  return (char *) h + HEADER_SIZE;
+}
+
+void *erealloc_large(void *ptr, size_t size)
+{
+  Header *h;
+
+  if (ptr == NULL)
+    return emalloc_large(size);
+  h = (Header *) ((char *) ptr - HEADER_SIZE);
+
+  if (h->by == BY_MALLOC) {
+#ifdef USE_HUGEPAGE
+    if (size + HEADER_SIZE >= LARGE_MIN) {
+      Header *hn = map_pages(map_length(size));
+      if (hn != NULL) {
+	memcpy((char *) hn + HEADER_SIZE, ptr,
+	       (size < h->size) ? size : h->size);
+	hn->size = size;
+	free(h);
+	return (char *) hn + HEADER_SIZE;
+      }
+    }
+#endif
+    h = (Header *) erealloc(h, size + HEADER_SIZE);
+    h->size = size;
+    return (char *) h + HEADER_SIZE;
+  }
+
+#ifdef USE_HUGEPAGE
+  {
+    size_t len = map_length(size), old_len;
+    void *p;
+
+    if (len == h->map_len) {
+      h->size = size;
+      return ptr;
+    }
+    /* the pages keep their placement policy when the mapping moves */
+    old_len = h->map_len;
+    p = mremap(h, old_len, len, MREMAP_MAYMOVE);
+    if (p != MAP_FAILED) {
+      mstat.cur = mstat.cur + len - old_len;
+      if (mstat.cur > mstat.peak)
+	mstat.peak = mstat.cur;
+      h = (Header *) p;
+      h->size = size;
+      h->map_len = len;
+      return (char *) h + HEADER_SIZE;
+    }
+    /* e.g. huge pages exhausted: copy to a new array */
+    p = emalloc_large(size);
+    memcpy(p, ptr, (size < h->size) ? size : h->size);
+    unmap_pages(h);
+    return p;
+  }
+#else
+  return ptr; /* not reached */
+#endif
+}
+
+void free_large(void *ptr)
+{
+  Header *h;
+
+  if (ptr == NULL)
+    return;
+  h = (Header *) ((char *) ptr - HEADER_SIZE);
+#ifdef USE_HUGEPAGE
+  if (h->by != BY_MALLOC) {
+    unmap_pages(h);
+    return;
+  }
+#endif
+  free(h);
+}
+
+/* print how the large arrays were allocated */
+void print_large_mem_stat(FILE *fp)
+{
+  fprintf(fp,
+	  " Large arrays: %.1f MB mapped at peak; %lld on huge pages, "
+	  "%lld on transparent huge pages, %lld by malloc\n",
+	  mstat.peak / 1048576.0, mstat.n[BY_HUGETLB], mstat.n[BY_THP],
+	  mstat.n[BY_MALLOC]);
+  if (mem_flags & LARGE_MEM_INTERLEAVE)
+    fprintf(fp, "               %lld of %lld mapped arrays interleaved "
+	    "over NUMA nodes\n", mstat.n_interleave,
+	    mstat.n[BY_HUGETLB] + mstat.n[BY_THP]);
+  else
+    fprintf(fp, "               pages placed on first touch\n");
+}
@@ -0,0 +1,20 @@
+#ifndef LARGEMEM_H
+#define LARGEMEM_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* flags of set_large_mem() */
+enum {
+  LARGE_MEM_HUGETLB = 1,   /* try reserved huge pages (MAP_HUGETLB) first */
+  LARGE_MEM_INTERLEAVE = 2 /* interleave pages over NUMA nodes */
+};
+
+extern void set_large_mem(int flags);
+extern int get_large_mem(void);
+extern void *emalloc_large(size_t size);
+extern void *erealloc_large(void *ptr, size_t size);
+extern void free_large(void *ptr);
+extern void print_large_mem_stat(FILE *fp);
+
+#endif /* LARGEMEM_H */
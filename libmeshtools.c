@@ -0,0 +1,678 @@
+/*
+ * libmeshtools.c
+ *   Library interface of meshtools working on in-memory meshes
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#define _POSIX_C_SOURCE 200809L /* for fmemopen() and open_memstream() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "meshtools.h"
+#include "util.h"
+#include "coordfmt.h"
+#include "meshio.h"
+#include "nodedata.h"
+#include "edgedata.h"
+#include "elemdata.h"
+#include "subdivide.h"
+#include "locate.h"
+
+struct MTMesh {
+  index_t n_node;
+  index_t *node_id;  /* sorted */
+  coord_t *coord;    /* x, y, z of each node */
+  index_t n_elem;
+  int npe;           /* 4 (341) or 10 (342) */
+  index_t *elem_id;  /* sorted */
+  index_t *conn;     /* npe global nodeIDs of each element */
+};
+
+struct MTLocator {
+  Locator *loc;
+  index_t *elem_id;  /* of the mesh indexed */
+};
+
+/* resources of a library call, released by run() */
+typedef struct Work {
+  const MTMesh *in;
+  MTMesh *out;
+  const char *buf;
+  size_t len;
+  char *obuf;
+  size_t olen;
+  const char *path;
+  FILE *fp;
+  MeshIO *mio;
+  NodeDB *ndb;
+  EdgeDB *edb;
+  ElemDB *eldb;
+  index_t n_node;
+  index_t n_elem;
+  MTLocator *oloc;
+  const MTLocator *iloc;
+  index_t n_point;
+  const coord_t *xyz;
+  double tol;
+  int n_threads;
+  index_t *ids;
+  double *bary;
+} Work;
+
+static void work_init(Work *w)
+{
+  memset(w, 0, sizeof(Work));
+}
+
+/* call f(w) catching errors of the modules; return the status */
+static int run(void (*f)(Work *), Work *w)
+{
+  jmp_buf env, *prev;
+  int status;
+
+  set_node_messages(0);
+  prev = set_error_handler(&env);
+  switch (setjmp(env)) {
+  case 0:
+    f(w);
+    status = MT_OK;
+    break;
+  case MT_EDATA:
+    status = MT_EDATA;
+    break;
+  case MT_EARG:
+    status = MT_EARG;
+    break;
+  default:
+    status = MT_ESYS;
+    break;
+  }
+  set_error_handler(prev);
+
+  if (w->mio != NULL) meshio_finalize(w->mio);
+  if (w->fp != NULL) fclose(w->fp);
+  if (w->edb != NULL) edge_finalize(w->edb);
+  if (w->eldb != NULL) elem_finalize(w->eldb);
+  if (w->ndb != NULL) node_finalize(w->ndb);
+  if (status != MT_OK) {
+    mt_mesh_free(w->out);
+    free(w->obuf);
+    mt_locator_free(w->oloc);
+    w->out = NULL;
+    w->obuf = NULL;
+    w->oloc = NULL;
+  }
+  return status;
+}
+
+const char *mt_error_message(void)
+{
+  return error_message();
+}
+
+int mt_index_size(void)
+{
+  return sizeof(index_t);
+}
+
+int mt_coord_size(void)
+{
+  return sizeof(coord_t);
+}
+
+/* print coordinates in the shortest form reading back exactly (on != 0)
+   or with "%f" (on == 0, default) in mt_mesh_write */
+void mt_set_shortest_coords(int on)
+{
+  set_coord_format(on ? COORD_SHORTEST : COORD_FIXED);
+}
+
+/* allocate a mesh to *mesh_p.  *mesh_p is set before the arrays are
+   allocated, so that run() frees it if one of them fails. */
+static MTMesh *mesh_alloc(MTMesh **mesh_p, index_t n_node, index_t n_elem,
+			  int npe)
+{
+  MTMesh *mesh;
+
+  mesh = (MTMesh *) emalloc(sizeof(MTMesh));
+  mesh->node_id = NULL;
+  mesh->coord = NULL;
+  mesh->elem_id = NULL;
+  mesh->conn = NULL;
+  *mesh_p = mesh;
+  mesh->n_node = n_node;
+  mesh->n_elem = n_elem;
+  mesh->npe = npe;
+  mesh->node_id = (index_t *) emalloc((n_node + 1) * sizeof(index_t));
+  mesh->coord = (coord_t *) emalloc((3 * n_node + 1) * sizeof(coord_t));
+  mesh->elem_id = (index_t *) emalloc((n_elem + 1) * sizeof(index_t));
+  mesh->conn = (index_t *) emalloc((npe * n_elem + 1) * sizeof(index_t));
+  return mesh;
+}
+
+void mt_mesh_free(MTMesh *mesh)
+{
+  if (mesh == NULL) return;
+  free(mesh->node_id);
+  free(mesh->coord);
+  free(mesh->elem_id);
+  free(mesh->conn);
+  free(mesh);
+}
+
+index_t mt_number_of_nodes(const MTMesh *mesh)
+{
+  return mesh->n_node;
+}
+
+index_t mt_number_of_elems(const MTMesh *mesh)
+{
+  return mesh->n_elem;
+}
+
+int mt_nodes_per_elem(const MTMesh *mesh)
+{
+  return mesh->npe;
+}
+
+const index_t *mt_node_ids(const MTMesh *mesh)
+{
+  return mesh->node_id;
+}
+
+const coord_t *mt_node_coords(const MTMesh *mesh)
+{
+  return mesh->coord;
+}
+
+const index_t *mt_elem_ids(const MTMesh *mesh)
+{
+  return mesh->elem_id;
+}
+
+const index_t *mt_elem_conn(const MTMesh *mesh)
+{
+  return mesh->conn;
+}
+
+static const char *elem_header(int npe)
+{
+  return (npe == 10) ? "!ELEMENT, TYPE=342\n" : "!ELEMENT, TYPE=341\n";
+}
+
+/* set up NodeDB (and ElemDB if eldb_p is given) from the mesh */
+static void mesh_to_db(const MTMesh *mesh, NodeDB **ndb_p, ElemDB **eldb_p)
+{
+  index_t i;
+
+  node_init(ndb_p);
+  for (i = 0; i < mesh->n_node; i++)
+    new_node(*ndb_p, mesh->node_id[i], mesh->coord[3*i],
+	     mesh->coord[3*i+1], mesh->coord[3*i+2]);
+  reduce_node_data(*ndb_p);
+
+  if (eldb_p == NULL) return;
+  elem_init(eldb_p, elem_header(mesh->npe));
+  for (i = 0; i < mesh->n_elem; i++)
+    new_elem(*eldb_p, mesh->elem_id[i], mesh->conn + mesh->npe * i);
+}
+
+/* set up a mesh *mesh_p from NodeDB and ElemDB */
+static void db_to_mesh(MTMesh **mesh_p, NodeDB *ndb, ElemDB *eldb)
+{
+  MTMesh *mesh;
+  index_t i;
+  int npe;
+
+  sort_node_data(ndb);
+  npe = nodes_per_elem(eldb);
+  mesh = mesh_alloc(mesh_p, number_of_nodes(ndb), number_of_elems(eldb),
+		    npe);
+  for (i = 0; i < mesh->n_node; i++) {
+    mesh->node_id[i] = get_global_node_id(ndb, i);
+    node_coord(ndb, mesh->node_id[i], &mesh->coord[3*i],
+	       &mesh->coord[3*i+1], &mesh->coord[3*i+2]);
+  }
+  for (i = 0; i < mesh->n_elem; i++) {
+    mesh->elem_id[i] = get_elem_id(eldb, i);
+    get_elem_nodes(eldb, i, &mesh->conn[npe*i]);
+  }
+}
+
+static void do_create(Work *w)
+{
+  const MTMesh *in = w->in;
+  index_t i;
+
+  if (in->n_node < 0 || in->n_elem < 0 ||
+      (in->npe != 4 && in->npe != 10) ||
+      (in->n_node > 0 && (in->node_id == NULL || in->coord == NULL)) ||
+      (in->n_elem > 0 && (in->elem_id == NULL || in->conn == NULL)))
+    error_exit(MT_EARG, "Error: invalid mesh arrays\n");
+  for (i = 1; i < in->n_node; i++)
+    if (in->node_id[i-1] >= in->node_id[i])
+      error_exit(MT_EDATA, "Error: node id is not sorted\n");
+  for (i = 1; i < in->n_elem; i++)
+    if (in->elem_id[i-1] >= in->elem_id[i])
+      error_exit(MT_EDATA, "Error: elem id is not sorted\n");
+
+  mesh_alloc(&w->out, in->n_node, in->n_elem, in->npe);
+  memcpy(w->out->node_id, in->node_id, in->n_node * sizeof(index_t));
+  memcpy(w->out->coord, in->coord, 3 * in->n_node * sizeof(coord_t));
+  memcpy(w->out->elem_id, in->elem_id, in->n_elem * sizeof(index_t));
+  memcpy(w->out->conn, in->conn, in->npe * in->n_elem * sizeof(index_t));
+}
+
+/* create a mesh by copying the arrays.
+   node_id[] and elem_id[] have to be sorted in ascending order;
+   coord[] holds x, y, z of each node and conn[] npe (4 or 10) nodeIDs
+   of each element in the FrontSTR order. */
+int mt_mesh_create(MTMesh **mesh_p,
+		   index_t n_node, const index_t *node_id,
+		   const coord_t *coord,
+		   index_t n_elem, int npe, const index_t *elem_id,
+		   const index_t *conn)
+{
+  MTMesh in;
+  Work w;
+  int status;
+
+  in.n_node = n_node;
+  in.node_id = (index_t *) node_id;
+  in.coord = (coord_t *) coord;
+  in.n_elem = n_elem;
+  in.npe = npe;
+  in.elem_id = (index_t *) elem_id;
+  in.conn = (index_t *) conn;
+
+  work_init(&w);
+  w.in = &in;
+  status = run(do_create, &w);
+  *mesh_p = w.out;
+  return status;
+}
+
+/* read NODE and ELEMENT sections from w->fp */
+static void do_parse(Work *w)
+{
+  char *line;
+  int mode, header;
+
+  meshio_init(&w->mio, w->fp);
+  node_init(&w->ndb);
+
+  while ((line = meshio_readline(w->mio, &mode, &header)) != NULL) {
+
+    if (mode == COMMENT) continue;
+
+    if (mode == HEADER) {
+      if (header == ELEMENT && w->eldb == NULL)
+	elem_init(&w->eldb, line);
+      continue;
+    }
+
+    if (header == NODE) {
+      long long node_id;
+      coord_t x, y, z;
+
+      if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4)
+	error_exit(MT_EDATA, "Error: reading node data failed\n");
+      new_node(w->ndb, node_id, x, y, z);
+
+    } else if (header == ELEMENT) {
+      long long elem_id, nl[10], dummy;
+      index_t n[10];
+      int nret, i;
+
+      nret = sscanf(line,
+		    "%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld",
+		    &elem_id, nl, nl+1, nl+2, nl+3, nl+4,
+		    nl+5, nl+6, nl+7, nl+8, nl+9, &dummy);
+      if (nret != nodes_per_elem(w->eldb) + 1)
+	error_exit(MT_EDATA, "Error: reading element data failed\n");
+      for (i = 0; i < 10; i++) n[i] = nl[i];
+      new_elem(w->eldb, elem_id, n);
+    }
+  }
+
+  if (w->eldb == NULL)
+    error_exit(MT_EDATA, "Error: no element data\n");
+
+  db_to_mesh(&w->out, w->ndb, w->eldb);
+}
+
+static void do_read(Work *w)
+{
+  if (w->len == 0)
+    error_exit(MT_EDATA, "Error: empty mesh data\n");
+  w->fp = fmemopen((void *) w->buf, w->len, "r");
+  if (w->fp == NULL)
+    error_exit(MT_ESYS, "Error: fmemopen failed\n");
+  do_parse(w);
+}
+
+/* read FrontSTR-format mesh data buf[0..len-1] into a mesh */
+int mt_mesh_read(MTMesh **mesh_p, const char *buf, size_t len)
+{
+  Work w;
+  int status;
+
+  work_init(&w);
+  w.buf = buf;
+  w.len = len;
+  status = run(do_read, &w);
+  *mesh_p = w.out;
+  return status;
+}
+
+static void do_read_file(Work *w)
+{
+  w->fp = efopen(w->path, "r");
+  do_parse(w);
+}
+
+/* read FrontSTR-format mesh file into a mesh */
+int mt_mesh_read_file(MTMesh **mesh_p, const char *path)
+{
+  Work w;
+  int status;
+
+  work_init(&w);
+  w.path = path;
+  status = run(do_read_file, &w);
+  *mesh_p = w.out;
+  return status;
+}
+
+static void do_subdivide(Work *w)
+{
+  const MTMesh *in = w->in;
+  MTMesh *out;
+  index_t i, sub[8][4], li[10];
+  coord_t vol[9], xyz[30];
+  int k, j;
+
+  if (in->npe != 10)
+    error_exit(MT_EARG, "Error: element type is not \"342\"?\n");
+
+  mesh_to_db(in, &w->ndb, NULL);
+  out = mesh_alloc(&w->out, in->n_node, 8 * in->n_elem, 4);
+  memcpy(out->node_id, in->node_id, in->n_node * sizeof(index_t));
+  memcpy(out->coord, in->coord, 3 * in->n_node * sizeof(coord_t));
+
+  for (i = 0; i < in->n_elem; i++) {
+    lookup_nodes(w->ndb, 10, in->conn + 10 * i, li, xyz);
+    subdivide_elem(in->conn + 10 * i, xyz, sub, vol);
+    for (k = 0; k < 8; k++) {
+      out->elem_id[8*i+k] = 8 * in->elem_id[i] - 7 + k;
+      for (j = 0; j < 4; j++)
+	out->conn[4*(8*i+k)+j] = sub[k][j];
+    }
+  }
+}
+
+/* subdivide each 342 element into 8 341 elements (as sd342to341) */
+int mt_subdivide(const MTMesh *mesh, MTMesh **out_p)
+{
+  Work w;
+  int status;
+
+  work_init(&w);
+  w.in = mesh;
+  status = run(do_subdivide, &w);
+  *out_p = w.out;
+  return status;
+}
+
+static const int mnid[6][3] = {
+  {1, 2, 4},
+  {0, 2, 5},
+  {0, 1, 6},
+  {0, 3, 7},
+  {1, 3, 8},
+  {2, 3, 9}
+};
+
+static void do_refine(Work *w)
+{
+  const MTMesh *in = w->in;
+  MTMesh *out;
+  index_t i, n_node;
+  int k;
+
+  if (in->npe != 4)
+    error_exit(MT_EARG, "Error: element type is not \"341\"?\n");
+
+  mesh_to_db(in, &w->ndb, NULL);
+  edge_init(&w->edb, w->ndb);
+
+  /* there are at most 6 new nodes per element */
+  out = mesh_alloc(&w->out, in->n_node + 6 * in->n_elem, in->n_elem, 10);
+  memcpy(out->node_id, in->node_id, in->n_node * sizeof(index_t));
+  memcpy(out->coord, in->coord, 3 * in->n_node * sizeof(coord_t));
+  memcpy(out->elem_id, in->elem_id, in->n_elem * sizeof(index_t));
+
+  n_node = in->n_node;
+  for (i = 0; i < in->n_elem; i++) {
+    index_t *n = out->conn + 10 * i;
+
+    for (k = 0; k < 4; k++)
+      n[k] = in->conn[4*i+k];
+    for (k = 0; k < 6; k++) {
+      if (middle_node(w->edb, n[mnid[k][0]], n[mnid[k][1]], &n[mnid[k][2]])) {
+	get_last_middle_node(w->ndb, &out->node_id[n_node],
+			     &out->coord[3*n_node], &out->coord[3*n_node+1],
+			     &out->coord[3*n_node+2]);
+	n_node++;
+      }
+    }
+  }
+  out->n_node = n_node;
+  out->node_id = (index_t *) erealloc(out->node_id,
+				      (n_node + 1) * sizeof(index_t));
+  out->coord = (coord_t *) erealloc(out->coord,
+				    (3 * n_node + 1) * sizeof(coord_t));
+}
+
+/* refine a 341 mesh into a 342 mesh by adding middle nodes
+   (as rf341to342) */
+int mt_refine(const MTMesh *mesh, MTMesh **out_p)
+{
+  Work w;
+  int status;
+
+  work_init(&w);
+  w.in = mesh;
+  status = run(do_refine, &w);
+  *out_p = w.out;
+  return status;
+}
+
+static void do_count(Work *w)
+{
+  int mode, header;
+
+  if (w->len == 0)
+    return;
+  w->fp = fmemopen((void *) w->buf, w->len, "r");
+  if (w->fp == NULL)
+    error_exit(MT_ESYS, "Error: fmemopen failed\n");
+  meshio_init(&w->mio, w->fp);
+
+  while (meshio_readline(w->mio, &mode, &header)) {
+    if (mode != DATA) continue;
+    if (header == NODE) w->n_node++;
+    else if (header == ELEMENT) w->n_elem++;
+  }
+}
+
+/* count the number of nodes and elements in FrontSTR-format mesh data
+   buf[0..len-1] (as meshcount) */
+int mt_count(const char *buf, size_t len, index_t *n_node, index_t *n_elem)
+{
+  Work w;
+  int status;
+
+  work_init(&w);
+  w.buf = buf;
+  w.len = len;
+  status = run(do_count, &w);
+  *n_node = w.n_node;
+  *n_elem = w.n_elem;
+  return status;
+}
+
+static void open_output(Work *w)
+{
+  w->fp = open_memstream(&w->obuf, &w->olen);
+  if (w->fp == NULL)
+    error_exit(MT_ESYS, "Error: open_memstream failed\n");
+}
+
+/* close the output stream, leaving the data in w->obuf */
+static void close_output(Work *w)
+{
+  if (fclose(w->fp) != 0) {
+    w->fp = NULL;
+    error_exit(MT_ESYS, "Error: writing to memory failed\n");
+  }
+  w->fp = NULL;
+}
+
+static void do_write(Work *w)
+{
+  const MTMesh *in = w->in;
+  index_t i;
+  int j;
+
+  open_output(w);
+  fprintf(w->fp, "!NODE\n");
+  for (i = 0; i < in->n_node; i++)
+    print_node_line(w->fp, (long long) in->node_id[i],
+		    in->coord[3*i], in->coord[3*i+1], in->coord[3*i+2]);
+  fprintf(w->fp, "%s", elem_header(in->npe));
+  for (i = 0; i < in->n_elem; i++) {
+    fprintf(w->fp, "%lld", (long long) in->elem_id[i]);
+    for (j = 0; j < in->npe; j++)
+      fprintf(w->fp, ",%lld", (long long) in->conn[in->npe*i+j]);
+    fprintf(w->fp, "\n");
+  }
+  fprintf(w->fp, "!END\n");
+  close_output(w);
+}
+
+/* write the mesh in FrontSTR format into a buffer allocated with
+   malloc(); the caller has to free *buf_p */
+int mt_mesh_write(const MTMesh *mesh, char **buf_p, size_t *len_p)
+{
+  Work w;
+  int status;
+
+  work_init(&w);
+  w.in = mesh;
+  status = run(do_write, &w);
+  *buf_p = w.obuf;
+  *len_p = w.olen;
+  return status;
+}
+
+static void do_convert_adv(Work *w)
+{
+  mesh_to_db(w->in, &w->ndb, &w->eldb);
+  open_output(w);
+  fprintf(w->fp, "%lld\n", (long long) number_of_elems(w->eldb));
+  print_elem_adv(w->eldb, w->ndb, w->fp);
+  fprintf(w->fp, "%lld\n", (long long) number_of_nodes(w->ndb));
+  print_node_adv(w->ndb, w->fp);
+  close_output(w);
+}
+
+/* write the mesh in Adventure format (as fstr2adv) into a buffer
+   allocated with malloc(); the caller has to free *buf_p */
+int mt_convert_adv(const MTMesh *mesh, char **buf_p, size_t *len_p)
+{
+  Work w;
+  int status;
+
+  work_init(&w);
+  w.in = mesh;
+  status = run(do_convert_adv, &w);
+  *buf_p = w.obuf;
+  *len_p = w.olen;
+  return status;
+}
+
+static void do_locator_create(Work *w)
+{
+  const MTMesh *in = w->in;
+
+  mesh_to_db(in, &w->ndb, NULL);
+  w->oloc = (MTLocator *) emalloc(sizeof(MTLocator));
+  w->oloc->loc = NULL;
+  w->oloc->elem_id = (index_t *) emalloc((in->n_elem + 1) * sizeof(index_t));
+  memcpy(w->oloc->elem_id, in->elem_id, in->n_elem * sizeof(index_t));
+  locator_init(&w->oloc->loc, w->ndb, in->n_elem, in->npe, in->conn);
+}
+
+/* index the elements of the mesh for mt_locate(); the locator does not
+   refer to the mesh, which may be freed */
+int mt_locator_create(const MTMesh *mesh, MTLocator **loc_p)
+{
+  Work w;
+  int status;
+
+  work_init(&w);
+  w.in = mesh;
+  status = run(do_locator_create, &w);
+  *loc_p = w.oloc;
+  return status;
+}
+
+void mt_locator_free(MTLocator *loc)
+{
+  if (loc == NULL) return;
+  if (loc->loc != NULL)
+    locator_finalize(loc->loc);
+  free(loc->elem_id);
+  free(loc);
+}
+
+static void do_locate(Work *w)
+{
+  index_t i;
+
+  if (w->n_point < 0 || w->tol < 0 || w->n_threads < 1 ||
+      (w->n_point > 0 && (w->xyz == NULL || w->ids == NULL)))
+    error_exit(MT_EARG, "Error: invalid arguments of mt_locate\n");
+  locate_points(w->iloc->loc, w->n_point, w->xyz, w->tol, w->n_threads,
+		w->ids, w->bary);
+  for (i = 0; i < w->n_point; i++)
+    if (w->ids[i] >= 0)
+      w->ids[i] = w->iloc->elem_id[w->ids[i]];
+}
+
+/* find the elements containing the n_point points xyz[3*n_point] with
+   n_threads threads: elem_id[i] is set to the ID of the element
+   containing point i, or -1 if there is none, and, unless bary is
+   NULL, bary[4*i] ... bary[4*i+3] to the barycentric coordinates of
+   the point for the corner nodes of the element.  A point on a face
+   shared by elements is given the first of them in the mesh.  A point
+   outside the mesh by no more than tol (in barycentric coordinates)
+   is given the element it is least outside of. */
+int mt_locate(const MTLocator *loc, index_t n_point, const coord_t *xyz,
+	      double tol, int n_threads, index_t *elem_id, double *bary)
+{
+  Work w;
+
+  work_init(&w);
+  w.iloc = loc;
+  w.n_point = n_point;
+  w.xyz = xyz;
+  w.tol = tol;
+  w.n_threads = n_threads;
+  w.ids = elem_id;
+  w.bary = bary;
+  return run(do_locate, &w);
+}
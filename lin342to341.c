@@ -0,0 +1,316 @@
+/*
+ * lin342to341.c
+ *   Linearize FrontSTR-format 342 mesh data into 341 mesh data of the
+ *   same elements, dropping the middle nodes
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "util.h"
+#include "meshio.h"
+#include "largemem.h"
+#include "groupdata.h"
+#include "refine.h"
+
+void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] SOURCE [DEST]\n"
+	  "Linearize FrontSTR-format 342 mesh file SOURCE into 341 mesh "
+	  "file DEST, or\nstandard output, keeping the 4 corner nodes of "
+	  "each element and dropping the\nnodes used only as middle "
+	  "nodes.  SOURCE is read twice, so it must be a file.\n"
+	  "  -v      verbose mode\n"
+	  "  -S      disable reader/writer threads\n"
+	  "  -H      allocate large arrays on reserved huge pages\n"
+	  "  -I      interleave large arrays over NUMA nodes\n"
+	  "  -C DIR  take DEST from cache directory DIR if converted before,\n"
+	  "          or store it there (SOURCE and DEST must be files)\n"
+	  "  -X      write the index of DEST to DEST.idx (see meshindex)\n"
+	  "  -h      display help\n",
+	  progname());
+  exit(1);
+}
+
+const char refine_options[] = "";
+const char input_file_options[] = "";
+const char output_file_options[] = "";
+
+void refine_option(int opt, const char *arg)
+{
+  (void) opt;
+  (void) arg;
+}
+
+/* 2 bits for each node ID: the node is used as a corner node, or as a
+   middle node, of some element */
+enum { USED_CORNER = 1, USED_MIDDLE = 2 };
+
+struct NodeMap {
+  unsigned char *bits; /* bits of node i at bits[i/4] >> (2*(i%4)) */
+  index_t n_id;        /* IDs 0 ... n_id-1 are covered */
+};
+
+typedef struct NodeMap NodeMap;
+
+static void node_map_set(NodeMap *map, long long id, int used)
+{
+  index_t n;
+
+  if (id < 0) {
+    fprintf(stderr, "Error: negative node ID %lld\n", id);
+    exit(1);
+  }
+  if (id >= map->n_id) {
+    n = (2 * map->n_id > id + 1) ? 2 * map->n_id : (index_t) id + 1;
+    n = (n + 3) / 4 * 4;
+    map->bits = (unsigned char *) erealloc_large(map->bits, n / 4);
+    memset(map->bits + map->n_id / 4, 0, (n - map->n_id) / 4);
+    map->n_id = n;
+  }
+  map->bits[id / 4] |= used << (2 * (id % 4));
+}
+
+/* return 1 if node id is used only as a middle node */
+static int middle_only(const NodeMap *map, long long id)
+{
+  if (id < 0 || id >= map->n_id)
+    return 0;
+  return ((map->bits[id / 4] >> (2 * (id % 4))) & 3) == USED_MIDDLE;
+}
+
+/* parse element data line into elem_id and its nodes n[10]; return the
+   number of nodes */
+static int parse_elem_data(const char *line, long long *elem_id,
+			   long long *n)
+{
+  const char *p = line;
+  char *q;
+  int k;
+
+  *elem_id = strtoll(p, &q, 10);
+  if (q == p) {
+    fprintf(stderr, "Error: reading element data failed\n");
+    exit(1);
+  }
+  p = q;
+  for (k = 0; k < 10; k++) {
+    while (*p == ' ' || *p == '\t' || *p == ',')
+      p++;
+    n[k] = strtoll(p, &q, 10);
+    if (q == p)
+      break;
+    p = q;
+  }
+  if (k < 4) {
+    fprintf(stderr, "Error: reading element data failed\n");
+    exit(1);
+  }
+  return k;
+}
+
+/* the bitmap pass: mark the nodes used by the elements of the source */
+static void map_nodes(NodeMap *map, const char *from_file_name)
+{
+  FILE *fp;
+  MeshIO *mio;
+  char *line;
+  int mode, header, n_node, k;
+  long long elem_id, n[10];
+
+  map->bits = NULL;
+  map->n_id = 0;
+
+  fp = efopen(from_file_name, "r");
+  meshio_init(&mio, fp);
+  while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
+    if (mode != DATA || header != ELEMENT)
+      continue;
+    n_node = parse_elem_data(line, &elem_id, n);
+    for (k = 0; k < n_node; k++)
+      node_map_set(map, n[k], (k < 4) ? USED_CORNER : USED_MIDDLE);
+  }
+  meshio_finalize(mio);
+  fclose(fp);
+}
+
+static void print_header(FILE *to_file, const char *from_file_name)
+{
+  time_t t;
+  time(&t);
+  fprintf(to_file,
+	  "##############################################################\n"
+	  "# FrontSTR 341 mesh file linearized by %s\n"
+	  "# Date: %s"
+	  "# Original 342 mesh: %s\n"
+	  "# CAUTION: Middle nodes are removed from NGROUPs only.\n"
+	  "##############################################################\n",
+	  progname(), ctime(&t), from_file_name);
+}
+
+/* NGROUP section being written: its header is written with the first
+   member kept, so that groups of middle nodes only are dropped */
+struct GroupOut {
+  char *header;
+  int generate;
+  index_t n_in;
+  index_t n_out;
+  index_t *ids;
+  index_t max_ids;
+};
+
+typedef struct GroupOut GroupOut;
+
+static void end_group(GroupOut *go, FILE *to_file)
+{
+  if (go->header != NULL && go->n_in == 0)
+    print_group_header(to_file, go->header);
+  free(go->header);
+  go->header = NULL;
+}
+
+/* write the members of the group on line not dropped; return the
+   number of members dropped */
+static index_t proceed_group_data(const char *line, GroupOut *go,
+				  const NodeMap *map, FILE *to_file)
+{
+  index_t n, i, n_drop = 0;
+
+  n = parse_group_data(line, go->generate, &go->ids, &go->max_ids);
+  for (i = 0; i < n; i++) {
+    go->n_in++;
+    if (middle_only(map, go->ids[i])) {
+      n_drop++;
+      continue;
+    }
+    if (go->n_out++ == 0)
+      print_group_header(to_file, go->header);
+    fprintf(to_file, "%lld\n", (long long) go->ids[i]);
+  }
+  return n_drop;
+}
+
+void refine(FILE *from_file, const char *from_file_name,
+	    FILE *to_file, int verbose)
+{
+  char *line;
+  int mode;
+  int header, header_prev = NONE;
+  MeshIO *mio;
+  NodeMap map;
+  GroupOut go;
+  long long id, elem_id, n[10];
+  index_t n_node_drop = 0, n_member_drop = 0;
+  char *p;
+
+  if (strcmp(from_file_name, "stdin") == 0) {
+    fprintf(stderr, "Error: SOURCE must be a file\n");
+    usage();
+  }
+
+  if (verbose)
+    print_log(stderr, "Marking nodes of the elements (reading from %s)...",
+	      from_file_name);
+  map_nodes(&map, from_file_name);
+
+  if (verbose)
+    print_log(stderr, "Starting linearization (reading from %s)...",
+              from_file_name);
+
+  print_header(to_file, from_file_name);
+
+  meshio_init(&mio, from_file);
+  go.header = NULL;
+  go.ids = NULL;
+  go.max_ids = 0;
+
+  while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
+
+    if (mode == COMMENT) {
+      fprintf(to_file, "%s", line);
+      continue;
+    }
+
+    if (mode == HEADER) {
+      end_group(&go, to_file);
+
+      /* check the previous header */
+      if (verbose) {
+	if (header_prev == NODE && header != NODE)
+	  print_log(stderr, "reading NODE-part completed.");
+	else if (header_prev == ELEMENT && header != ELEMENT)
+	  print_log(stderr, "reading ELEMENT-part completed.");
+      }
+
+      /* check the current header */
+      if (header == NODE) {
+	if (verbose && header_prev != NODE)
+	  print_log(stderr, "Start reading NODE-part...");
+	fprintf(to_file, "%s", line);
+
+      } else if (header == ELEMENT) {
+	if (verbose && header_prev != ELEMENT)
+	  print_log(stderr, "Start reading ELEMENT-part...");
+	p = strstr(line, "342");
+	if (p == NULL) {
+	  fprintf(stderr, "Error: element type is not \"342\"?\n");
+	  exit(1);
+	}
+	p[2] = '1';
+	fprintf(to_file, "%s", line);
+
+      } else if (header == NGROUP) {
+	go.header = estrdup(line);
+	go.generate = group_is_generate(line);
+	go.n_in = go.n_out = 0;
+
+      } else {
+	fprintf(to_file, "%s", line);
+      }
+      header_prev = header;
+      continue;
+    }
+
+    assert(mode == DATA);
+
+    if (header == NODE) {
+      if (sscanf(line, "%lld", &id) != 1) {
+	fprintf(stderr, "Error: reading node data failed\n");
+	exit(1);
+      }
+      if (middle_only(&map, id))
+	n_node_drop++;
+      else
+	fprintf(to_file, "%s", line);
+
+    } else if (header == ELEMENT) {
+      parse_elem_data(line, &elem_id, n);
+      fprintf(to_file, "%lld,%lld,%lld,%lld,%lld\n",
+	      elem_id, n[0], n[1], n[2], n[3]);
+
+    } else if (header == NGROUP) {
+      n_member_drop += proceed_group_data(line, &go, &map, to_file);
+
+    } else {
+      fprintf(to_file, "%s", line);
+    }
+  }
+  end_group(&go, to_file);
+
+  free(go.ids);
+  if (map.bits != NULL)
+    free_large(map.bits);
+  meshio_finalize(mio);
+
+  if (verbose) {
+    print_log(stderr, "linearization completed.");
+    fprintf(stderr, "   dropped nodes : %lld\n"
+	    " dropped members : %lld\n",
+	    (long long) n_node_drop, (long long) n_member_drop);
+  }
+}
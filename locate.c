@@ -0,0 +1,329 @@
+/*
+ * locate.c
+ *   Find the elements containing given points, by a uniform grid over
+ *   the elements and signed volumes of tetrahedra
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
+#include "locate.h"
+#include "util.h"
+#include "largemem.h"
+
+/* number of elements whose nodes are looked up at once, and the
+   largest number of grid cells per element */
+enum { ELEM_BLOCK = 64, MAX_CELL_RATIO = 4 };
+
+/* The elements overlapping a cell by their bounding boxes are listed
+   in the cell in ascending order.  The cells are about as wide as the
+   elements, so a point is checked against a few elements. */
+struct Locator {
+  index_t n_elem;
+  coord_t *xyz;        /* x, y, z of the 4 corners of each element */
+  double min[3];
+  double h;            /* cell size */
+  index_t n_cell[3];
+  index_t *cell_start; /* elements of cell c are cell_elem[cell_start[c]]
+			  ... cell_elem[cell_start[c+1]-1] */
+  index_t *cell_elem;
+};
+
+static index_t cell_index(const Locator *loc, int d, double v)
+{
+  double t = (v - loc->min[d]) / loc->h;
+
+  if (t < 0)
+    return 0;
+  if (t >= (double) loc->n_cell[d])
+    return loc->n_cell[d] - 1;
+  return (index_t) t;
+}
+
+/* cells lo[3] ... hi[3] overlapped by the bounding box of element e */
+static void elem_cells(const Locator *loc, index_t e, index_t *lo, index_t *hi)
+{
+  const coord_t *x = loc->xyz + 12 * e;
+  coord_t emin, emax;
+  int d, k;
+
+  for (d = 0; d < 3; d++) {
+    emin = emax = x[d];
+    for (k = 1; k < 4; k++) {
+      if (x[3*k+d] < emin) emin = x[3*k+d];
+      if (x[3*k+d] > emax) emax = x[3*k+d];
+    }
+    lo[d] = cell_index(loc, d, emin);
+    hi[d] = cell_index(loc, d, emax);
+  }
+}
+
+/* set up the grid over the elements in loc->xyz */
+static void build_grid(Locator *loc)
+{
+  index_t n_elem = loc->n_elem, e, c, lo[3], hi[3], i[3], *pos;
+  double max[3], size = 0, ext, emax, n_cells;
+  int d, k;
+
+  for (d = 0; d < 3; d++) {
+    loc->min[d] = 0;
+    max[d] = 0;
+  }
+  for (e = 0; e < n_elem; e++) {
+    const coord_t *x = loc->xyz + 12 * e;
+
+    emax = 0;
+    for (d = 0; d < 3; d++) {
+      coord_t xmin = x[d], xmax = x[d];
+
+      for (k = 1; k < 4; k++) {
+	if (x[3*k+d] < xmin) xmin = x[3*k+d];
+	if (x[3*k+d] > xmax) xmax = x[3*k+d];
+      }
+      if (e == 0 || xmin < loc->min[d]) loc->min[d] = xmin;
+      if (e == 0 || xmax > max[d]) max[d] = xmax;
+      if (xmax - xmin > emax) emax = xmax - xmin;
+    }
+    size += emax;
+  }
+
+  /* cells of the mean element size, but not too many of them */
+  loc->h = (n_elem > 0) ? size / n_elem : 0;
+  for (d = 0; d < 3; d++)
+    if (loc->h == 0 && max[d] - loc->min[d] > 0)
+      loc->h = max[d] - loc->min[d];
+  if (loc->h == 0)
+    loc->h = 1;
+  for (;;) {
+    n_cells = 1;
+    for (d = 0; d < 3; d++) {
+      ext = (max[d] - loc->min[d]) / loc->h;
+      n_cells *= ext + 1;
+    }
+    if (n_cells <= (double) MAX_CELL_RATIO * n_elem + 1)
+      break;
+    loc->h *= 1.25;
+  }
+  n_cells = 1;
+  for (d = 0; d < 3; d++) {
+    loc->n_cell[d] = (index_t) ((max[d] - loc->min[d]) / loc->h) + 1;
+    n_cells *= loc->n_cell[d];
+  }
+  c = (index_t) n_cells;
+
+  /* count the elements of each cell, then list them in element order */
+  loc->cell_start = (index_t *) emalloc_large((c + 1) * sizeof(index_t));
+  memset(loc->cell_start, 0, (c + 1) * sizeof(index_t));
+  for (e = 0; e < n_elem; e++) {
+    elem_cells(loc, e, lo, hi);
+    for (i[0] = lo[0]; i[0] <= hi[0]; i[0]++)
+      for (i[1] = lo[1]; i[1] <= hi[1]; i[1]++)
+	for (i[2] = lo[2]; i[2] <= hi[2]; i[2]++)
+	  loc->cell_start[(i[0] * loc->n_cell[1] + i[1]) * loc->n_cell[2]
+			  + i[2] + 1]++;
+  }
+  for (e = 0; e < c; e++)
+    loc->cell_start[e+1] += loc->cell_start[e];
+
+  loc->cell_elem = (index_t *)
+    emalloc_large((loc->cell_start[c] + 1) * sizeof(index_t));
+  pos = (index_t *) emalloc_large((c + 1) * sizeof(index_t));
+  memcpy(pos, loc->cell_start, (c + 1) * sizeof(index_t));
+  for (e = 0; e < n_elem; e++) {
+    elem_cells(loc, e, lo, hi);
+    for (i[0] = lo[0]; i[0] <= hi[0]; i[0]++)
+      for (i[1] = lo[1]; i[1] <= hi[1]; i[1]++)
+	for (i[2] = lo[2]; i[2] <= hi[2]; i[2]++)
+	  loc->cell_elem[pos[(i[0] * loc->n_cell[1] + i[1]) * loc->n_cell[2]
+			     + i[2]]++] = e;
+  }
+  free_large(pos);
+}
+
+/* index the elements of npe global node IDs conn[npe*n_elem], whose
+   nodes are in ndb */
+void locator_init(Locator **loc_p, NodeDB *ndb, index_t n_elem,
+		  int npe, const index_t *conn)
+{
+  Locator *loc;
+  index_t ids[4*ELEM_BLOCK], li[4*ELEM_BLOCK], i;
+  int m, e, k;
+
+  loc = (Locator *) emalloc(sizeof(Locator));
+  loc->n_elem = n_elem;
+  loc->xyz = (coord_t *) emalloc_large((12 * n_elem + 1) * sizeof(coord_t));
+  for (i = 0; i < n_elem; i += m) {
+    m = (n_elem - i < ELEM_BLOCK) ? (int) (n_elem - i) : ELEM_BLOCK;
+    for (e = 0; e < m; e++)
+      for (k = 0; k < 4; k++)
+	ids[4*e+k] = conn[npe*(i+e)+k];
+    lookup_nodes(ndb, 4 * m, ids, li, loc->xyz + 12 * i);
+  }
+  build_grid(loc);
+  *loc_p = loc;
+}
+
+void locator_finalize(Locator *loc)
+{
+  free_large(loc->xyz);
+  free_large(loc->cell_start);
+  free_large(loc->cell_elem);
+  free(loc);
+}
+
+/* 6 times the signed volume of tetrahedron a, b, c, d (as penta_vol) */
+static double vol6(const double *a, const double *b, const double *c,
+		   const double *d)
+{
+  double v1[3], v2[3], v3[3];
+  int k;
+
+  for (k = 0; k < 3; k++) {
+    v1[k] = b[k] - a[k];
+    v2[k] = c[k] - a[k];
+    v3[k] = d[k] - a[k];
+  }
+  return (v1[1] * v2[2] - v1[2] * v2[1]) * v3[0] +
+    (v1[2] * v2[0] - v1[0] * v2[2]) * v3[1] +
+    (v1[0] * v2[1] - v1[1] * v2[0]) * v3[2];
+}
+
+/* barycentric coordinates b[4] of point p in the tetrahedron of
+   corners x[12]; return 0 if it has no volume */
+static int barycentric(const coord_t *x, const double *p, double *b)
+{
+  double q[4][3], v;
+  int k, d;
+
+  for (k = 0; k < 4; k++)
+    for (d = 0; d < 3; d++)
+      q[k][d] = x[3*k+d];
+  v = vol6(q[0], q[1], q[2], q[3]);
+  if (v == 0)
+    return 0;
+  b[0] = vol6(p, q[1], q[2], q[3]) / v;
+  b[1] = vol6(q[0], p, q[2], q[3]) / v;
+  b[2] = vol6(q[0], q[1], p, q[3]) / v;
+  b[3] = vol6(q[0], q[1], q[2], p) / v;
+  return 1;
+}
+
+/* return the index of the element containing point p[3], and set its
+   barycentric coordinates to bary[4] unless bary is NULL.  The first
+   element containing p is taken; if none, the one p is least outside
+   of, as long as no barycentric coordinate is below -tol.  return -1
+   if p is not in any element. */
+index_t locate_point(const Locator *loc, const coord_t *p, double tol,
+		     double *bary)
+{
+  double q[3], b[4], best_b[4], minb, best_min = 0;
+  index_t c, j, e, best = -1;
+  int d, k;
+
+  if (loc->n_elem == 0)
+    return -1;
+  for (d = 0; d < 3; d++)
+    q[d] = p[d];
+  c = (cell_index(loc, 0, q[0]) * loc->n_cell[1] + cell_index(loc, 1, q[1]))
+    * loc->n_cell[2] + cell_index(loc, 2, q[2]);
+
+  for (j = loc->cell_start[c]; j < loc->cell_start[c+1]; j++) {
+    e = loc->cell_elem[j];
+    if (!barycentric(loc->xyz + 12 * e, q, b))
+      continue;
+    minb = b[0];
+    for (k = 1; k < 4; k++)
+      if (b[k] < minb) minb = b[k];
+    if (minb >= 0) {
+      best = e;
+      memcpy(best_b, b, sizeof(b));
+      break;
+    }
+    if (minb >= -tol && (best < 0 || minb > best_min)) {
+      best = e;
+      best_min = minb;
+      memcpy(best_b, b, sizeof(b));
+    }
+  }
+  if (bary != NULL) {
+    for (k = 0; k < 4; k++)
+      bary[k] = (best >= 0) ? best_b[k] : 0;
+  }
+  return best;
+}
+
+typedef struct LocateJob {
+  const Locator *loc;
+  const coord_t *p;
+  double tol;
+  index_t begin;
+  index_t end;
+  index_t *elem;
+  double *bary;
+} LocateJob;
+
+static void *locate_job(void *arg)
+{
+  LocateJob *job = (LocateJob *) arg;
+  index_t i;
+
+  for (i = job->begin; i < job->end; i++)
+    job->elem[i] = locate_point(job->loc, job->p + 3 * i, job->tol,
+				(job->bary != NULL) ? job->bary + 4 * i : NULL);
+  return NULL;
+}
+
+/* locate the n points p[3*n] with n_threads threads: elem[i] is set
+   to the index of the element containing point i or -1, and, unless
+   bary is NULL, bary[4*i] ... bary[4*i+3] to its barycentric
+   coordinates (as locate_point) */
+void locate_points(const Locator *loc, index_t n, const coord_t *p,
+		   double tol, int n_threads, index_t *elem, double *bary)
+{
+  LocateJob *job;
+  int t;
+
+  job = (LocateJob *) emalloc(n_threads * sizeof(LocateJob));
+  for (t = 0; t < n_threads; t++) {
+    job[t].loc = loc;
+    job[t].p = p;
+    job[t].tol = tol;
+    job[t].begin = n / n_threads * t + (n % n_threads) * t / n_threads;
+    job[t].end = n / n_threads * (t + 1) +
+      (n % n_threads) * (t + 1) / n_threads;
+    job[t].elem = elem;
+    job[t].bary = bary;
+  }
+#ifdef USE_PTHREAD
+  {
+    pthread_t *thread;
+    char *started;
+
+    thread = (pthread_t *) emalloc(n_threads * sizeof(pthread_t));
+    started = (char *) emalloc(n_threads);
+    /* a slice whose thread cannot be created is run on this thread,
+       so that no worker is left running on an error exit */
+    for (t = 1; t < n_threads; t++)
+      started[t] =
+	(pthread_create(&thread[t], NULL, locate_job, &job[t]) == 0);
+    locate_job(&job[0]);
+    for (t = 1; t < n_threads; t++) {
+      if (started[t])
+	pthread_join(thread[t], NULL);
+      else
+	locate_job(&job[t]);
+    }
+    free(started);
+    free(thread);
+  }
+#else
+  for (t = 0; t < n_threads; t++)
+    locate_job(&job[t]);
+#endif
+  free(job);
+}
@@ -0,0 +1,24 @@
+#ifndef LOCATE_H
+#define LOCATE_H
+
+#include "precision.h"
+#include "nodedata.h"
+
+/* Index of the elements of a mesh on a uniform grid, for finding the
+   element containing a point.  Elements are given by npe global node
+   IDs each, of which the 4 corners are used: 342 elements are located
+   as straight-sided tetrahedra. */
+
+struct Locator;
+typedef struct Locator Locator;
+
+extern void locator_init(Locator **loc_p, NodeDB *ndb, index_t n_elem,
+			 int npe, const index_t *conn);
+extern void locator_finalize(Locator *loc);
+extern index_t locate_point(const Locator *loc, const coord_t *p,
+			    double tol, double *bary);
+extern void locate_points(const Locator *loc, index_t n, const coord_t *p,
+			  double tol, int n_threads, index_t *elem,
+			  double *bary);
+
+#endif /* LOCATE_H */
@@ -0,0 +1,654 @@
+/*
+ * lrf341to341.c
+ *   Locally refine FrontSTR-format 341 mesh data by longest-edge
+ *   bisection, keeping the mesh conforming
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "util.h"
+#include "coordfmt.h"
+#include "meshio.h"
+#include "nodedata.h"
+#include "edgedata.h"
+#include "groupdata.h"
+#include "arstat.h"
+#include "refine.h"
+
+enum { MAX_TET_INIT = 1024, MAX_GROUP_INIT = 8, NAME_LEN = 64,
+       DEFAULT_LEVEL = 3 };
+
+void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] [SOURCE [DEST]]\n"
+	  "Locally refine FrontSTR-format 341 mesh file SOURCE, "
+	  "or standard input, into "
+	  "341 mesh file DEST, "
+	  "or standard output.\n"
+	  "Selected elements are bisected LEVEL times along the longest "
+	  "edge, and their\nneighbors as needed to keep the mesh "
+	  "conforming.\n"
+	  "  -g EGRP     select elements in EGROUP EGRP\n"
+	  "  -b X0,Y0,Z0,X1,Y1,Z1\n"
+	  "              select elements whose centroid is in the box\n"
+	  "  -m FILE     select elements whose IDs are listed in FILE\n"
+	  "  -l LEVEL    number of bisections of selected elements "
+	  "(default: %d)\n"
+	  "  -w N        print at most N warnings of each kind "
+	  "(default: %d, -1: all)\n"
+	  "  -v          verbose mode\n"
+	  "  -S          disable reader/writer threads\n"
+	  "  -R          print coordinates in the shortest form reading back "
+	  "exactly\n"
+	  "  -H          allocate large arrays on reserved huge pages\n"
+	  "  -I          interleave large arrays over NUMA nodes\n"
+	  "  -C DIR      take DEST from cache directory DIR if converted before,\n"
+	  "              or store it there (SOURCE and DEST must be files)\n"
+	  "  -X          write the index of DEST to DEST.idx (see meshindex)\n"
+	  "  -h          display help\n",
+	  progname(), DEFAULT_LEVEL, DIAG_MAX_PRINT);
+  exit(1);
+}
+
+const char refine_options[] = "g:b:m:l:w:";
+const char input_file_options[] = "m";
+const char output_file_options[] = "";
+
+static const char *sel_group = NULL;
+static const char *sel_marker = NULL;
+static int sel_box = 0;
+static coord_t box[6];
+static int level = DEFAULT_LEVEL;
+static int max_print = DIAG_MAX_PRINT;
+
+void refine_option(int opt, const char *arg)
+{
+  switch (opt) {
+  case 'g':
+    sel_group = arg;
+    break;
+  case 'b':
+    if (sscanf(arg, "%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD
+	       ",%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD,
+	       box, box+1, box+2, box+3, box+4, box+5) != 6) {
+      fprintf(stderr, "Error: option -b requires X0,Y0,Z0,X1,Y1,Z1\n");
+      usage();
+    }
+    sel_box = 1;
+    break;
+  case 'm':
+    sel_marker = arg;
+    break;
+  case 'l':
+    level = atoi(arg);
+    if (level < 1) {
+      fprintf(stderr, "Error: LEVEL must be positive\n");
+      usage();
+    }
+    break;
+  case 'w':
+    max_print = atoi(arg);
+    break;
+  }
+}
+
+/* element being refined */
+typedef struct Tet {
+  index_t id;
+  index_t root; /* ID of the original element */
+  index_t n[4];
+  int mark;     /* number of bisections still requested */
+} Tet;
+
+typedef struct TetList {
+  index_t n;
+  index_t max;
+  Tet *tet;
+} TetList;
+
+/* EGROUP of the original mesh; sections of the same name are merged */
+typedef struct Group {
+  char name[NAME_LEN];
+  index_t n;
+  index_t max;
+  index_t *ids;
+} Group;
+
+typedef struct GroupList {
+  int n;
+  int max;
+  Group *grp;
+} GroupList;
+
+/* edges of a tetrahedron */
+static const int tet_edge[6][2] = {
+  {0, 1}, {1, 2}, {0, 2}, {0, 3}, {1, 3}, {2, 3}
+};
+
+static void print_header(FILE *to_file, const char *from_file_name)
+{
+  time_t t;
+  time(&t);
+  fprintf(to_file,
+	  "##############################################################\n"
+	  "# FrontSTR 341 mesh file locally refined by %s\n"
+	  "# Date: %s"
+	  "# Original 341 mesh: %s\n"
+	  "# CAUTION: BCs are not applied on new nodes.\n"
+	  "##############################################################\n",
+	  progname(), ctime(&t), from_file_name);
+}
+
+static void proceed_node_data(const char *line, NodeDB *ndb, FILE *to_file)
+{
+  long long node_id;
+  coord_t x, y, z;
+
+  if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4) {
+    fprintf(stderr, "Error: reading node data failed\n");
+    exit(1);
+  }
+  new_node(ndb, node_id, x, y, z);
+
+  print_node_line(to_file, node_id, x, y, z);
+}
+
+static Tet *new_tet(TetList *tl)
+{
+  if (tl->n == tl->max) {
+    tl->max = (tl->max > 0) ? 2 * tl->max : MAX_TET_INIT;
+    tl->tet = (Tet *) erealloc(tl->tet, tl->max * sizeof(Tet));
+  }
+  return &(tl->tet[tl->n++]);
+}
+
+static void proceed_elem_data(const char *line, TetList *tl)
+{
+  int nret, i;
+  long long elem_id, nl[4], dummy;
+  Tet *t;
+
+  nret = sscanf(line,
+                "%lld,%lld,%lld,%lld,%lld,%lld",
+                &elem_id, nl, nl+1, nl+2, nl+3, &dummy);
+  if (nret != 5) {
+    fprintf(stderr, "Error: reading element data failed\n");
+    exit(1);
+  }
+  t = new_tet(tl);
+  t->id = t->root = elem_id;
+  for (i = 0; i < 4; i++) t->n[i] = nl[i];
+  t->mark = 0;
+}
+
+static Group *new_group(GroupList *gl, const char *header)
+{
+  char name[NAME_LEN];
+  Group *gp;
+  int i;
+
+  if (!group_name(header, name, NAME_LEN)) {
+    fprintf(stderr, "Error: EGROUP without EGRP name\n");
+    exit(1);
+  }
+  for (i = 0; i < gl->n; i++)
+    if (strcmp(gl->grp[i].name, name) == 0)
+      return &(gl->grp[i]);
+
+  if (gl->n == gl->max) {
+    gl->max = (gl->max > 0) ? 2 * gl->max : MAX_GROUP_INIT;
+    gl->grp = (Group *) erealloc(gl->grp, gl->max * sizeof(Group));
+  }
+  gp = &(gl->grp[gl->n++]);
+  strcpy(gp->name, name);
+  gp->n = 0;
+  gp->max = 0;
+  gp->ids = NULL;
+  return gp;
+}
+
+static void proceed_group_data(const char *line, int generate, Group *gp)
+{
+  static index_t *ids = NULL;
+  static index_t max_ids = 0;
+  index_t n, i;
+
+  n = parse_group_data(line, generate, &ids, &max_ids);
+  for (i = 0; i < n; i++) {
+    if (gp->n == gp->max) {
+      gp->max = (gp->max > 0) ? 2 * gp->max : MAX_GROUP_INIT;
+      gp->ids = (index_t *) erealloc(gp->ids, gp->max * sizeof(index_t));
+    }
+    gp->ids[gp->n++] = ids[i];
+  }
+}
+
+static int id_compar(const void *v1, const void *v2)
+{
+  index_t i1 = *(const index_t *) v1;
+  index_t i2 = *(const index_t *) v2;
+
+  if (i1 < i2) return -1;
+  else if (i1 == i2) return 0;
+  else return 1;
+}
+
+/* return 1 if id is in ids[n] sorted by id_compar */
+static int has_id(const index_t *ids, index_t n, index_t id)
+{
+  return n > 0 && bsearch(&id, ids, n, sizeof(index_t), id_compar) != NULL;
+}
+
+/* read element IDs listed in the marker file */
+static index_t *read_marker(const char *file_name, index_t *n_p)
+{
+  FILE *fp;
+  char line[1024];
+  index_t *ids = NULL, *line_ids = NULL;
+  index_t n = 0, max = 0, max_line = 0, nl, i;
+
+  fp = efopen(file_name, "r");
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (line[0] == '#' || line[0] == '!')
+      continue;
+    nl = parse_group_data(line, 0, &line_ids, &max_line);
+    for (i = 0; i < nl; i++) {
+      if (n == max) {
+	max = (max > 0) ? 2 * max : MAX_TET_INIT;
+	ids = (index_t *) erealloc(ids, max * sizeof(index_t));
+      }
+      ids[n++] = line_ids[i];
+    }
+  }
+  fclose(fp);
+  free(line_ids);
+
+  qsort(ids, n, sizeof(index_t), id_compar);
+  *n_p = n;
+  return ids;
+}
+
+/* mark the elements selected by -g, -b and -m;
+   return value is the number of selected elements */
+static index_t select_elems(TetList *tl, NodeDB *ndb, GroupList *gl)
+{
+  Group *gp = NULL;
+  index_t *marker = NULL, n_marker = 0;
+  index_t i, n_sel = 0;
+  coord_t x, y, z, cx, cy, cz;
+  Tet *t;
+  int j, sel;
+
+  if (sel_group != NULL) {
+    for (j = 0; j < gl->n; j++)
+      if (strcmp(gl->grp[j].name, sel_group) == 0)
+	gp = &(gl->grp[j]);
+    if (gp == NULL) {
+      fprintf(stderr, "Error: EGROUP %s not found\n", sel_group);
+      exit(1);
+    }
+  }
+  if (sel_marker != NULL)
+    marker = read_marker(sel_marker, &n_marker);
+
+  for (i = 0; i < tl->n; i++) {
+    t = &(tl->tet[i]);
+    sel = 0;
+    if (gp != NULL && has_id(gp->ids, gp->n, t->id))
+      sel = 1;
+    if (marker != NULL && has_id(marker, n_marker, t->id))
+      sel = 1;
+    if (sel_box && !sel) {
+      cx = cy = cz = 0;
+      for (j = 0; j < 4; j++) {
+	node_coord(ndb, t->n[j], &x, &y, &z);
+	cx += 0.25 * x;
+	cy += 0.25 * y;
+	cz += 0.25 * z;
+      }
+      if (box[0] <= cx && cx <= box[3] &&
+	  box[1] <= cy && cy <= box[4] &&
+	  box[2] <= cz && cz <= box[5])
+	sel = 1;
+    }
+    if (sel) {
+      t->mark = level;
+      n_sel++;
+    }
+  }
+  free(marker);
+  return n_sel;
+}
+
+/* index of the longest edge of a tetrahedron n[4].  Ties are broken by
+   the node IDs so that every element sharing an edge makes the same
+   choice, which the termination of the bisection relies on. */
+static int longest_edge(NodeDB *ndb, const index_t *n)
+{
+  int k, kmax = 0;
+  coord_t d, dmax = -1;
+  index_t a, b, amax = 0, bmax = 0;
+
+  for (k = 0; k < 6; k++) {
+    a = n[tet_edge[k][0]];
+    b = n[tet_edge[k][1]];
+    if (a > b) {
+      index_t tmp = a;
+      a = b;
+      b = tmp;
+    }
+    d = node_dist2(ndb, a, b);
+    if (d > dmax || (d == dmax && (a < amax || (a == amax && b < bmax)))) {
+      dmax = d;
+      amax = a;
+      bmax = b;
+      kmax = k;
+    }
+  }
+  return kmax;
+}
+
+/* ratio of the longest edge to the shortest (both squared) */
+static coord_t edge_ratio(NodeDB *ndb, const index_t *n)
+{
+  int k;
+  coord_t d, dmin = 0, dmax = 0;
+
+  for (k = 0; k < 6; k++) {
+    d = node_dist2(ndb, n[tet_edge[k][0]], n[tet_edge[k][1]]);
+    if (k == 0 || d < dmin) dmin = d;
+    if (k == 0 || d > dmax) dmax = d;
+  }
+  return dmax / dmin;
+}
+
+/* return 1 if an edge of the element has a middle node, i.e. the
+   element is not conforming to a bisected neighbor */
+static int has_hanging_node(EdgeDB *edb, const index_t *n)
+{
+  int k;
+
+  for (k = 0; k < 6; k++)
+    if (find_middle_node(edb, n[tet_edge[k][0]], n[tet_edge[k][1]]))
+      return 1;
+  return 0;
+}
+
+/* bisect element tl->tet[i] along its longest edge; the first half
+   keeps the element ID and the second half gets ID *next_id */
+static void bisect(TetList *tl, index_t i, NodeDB *ndb, EdgeDB *edb,
+		   index_t *next_id, ARStat *ars, Diag *dg)
+{
+  Tet *t, *c;
+  int k, nerr = 0;
+  index_t a, b, m;
+  coord_t vol, vol1, vol2, ar1, ar2;
+
+  k = longest_edge(ndb, tl->tet[i].n);
+  t = &(tl->tet[i]);
+  a = t->n[tet_edge[k][0]];
+  b = t->n[tet_edge[k][1]];
+  vol = penta_vol(ndb, t->n[0], t->n[1], t->n[2], t->n[3]);
+  if (middle_node(edb, a, b, &m))
+    add_last_middle_node(ndb);
+
+  c = new_tet(tl);
+  t = &(tl->tet[i]); /* tl->tet may be reallocated */
+  *c = *t;
+  c->id = (*next_id)++;
+  t->n[tet_edge[k][1]] = m;
+  c->n[tet_edge[k][0]] = m;
+  if (t->mark > 0)
+    t->mark = c->mark = t->mark - 1;
+
+  vol1 = volcheck(dg, t->root, t->id,
+		  penta_vol(ndb, t->n[0], t->n[1], t->n[2], t->n[3]), &nerr);
+  vol2 = volcheck(dg, c->root, c->id,
+		  penta_vol(ndb, c->n[0], c->n[1], c->n[2], c->n[3]), &nerr);
+  ar1 = edge_ratio(ndb, t->n);
+  ar2 = edge_ratio(ndb, c->n);
+  arstat_update(ars, dg, (ar1 > ar2) ? ar1 : ar2, (vol1 + vol2) / vol,
+		t->id, &nerr);
+}
+
+/* bisect the marked elements, and then the elements having hanging
+   nodes until the mesh gets conforming.
+   return value is the number of bisections */
+static index_t refine_tets(TetList *tl, NodeDB *ndb, EdgeDB *edb,
+			   ARStat *ars, Diag *dg, int verbose)
+{
+  index_t i, n, next_id = 0, n_bisect, n_total = 0;
+  int pass = 0;
+
+  for (i = 0; i < tl->n; i++)
+    if (tl->tet[i].id >= next_id)
+      next_id = tl->tet[i].id + 1;
+
+  do {
+    n = tl->n;
+    n_bisect = 0;
+    for (i = 0; i < n; i++) {
+      if (tl->tet[i].mark > 0 || has_hanging_node(edb, tl->tet[i].n)) {
+	bisect(tl, i, ndb, edb, &next_id, ars, dg);
+	n_bisect++;
+      }
+    }
+    pass++;
+    n_total += n_bisect;
+    if (verbose)
+      print_log(stderr, "pass %d: %lld elements bisected.",
+		pass, (long long) n_bisect);
+  } while (n_bisect > 0);
+
+  return n_total;
+}
+
+static void print_elems(const TetList *tl, FILE *to_file)
+{
+  index_t i;
+  const Tet *t;
+
+  for (i = 0; i < tl->n; i++) {
+    t = &(tl->tet[i]);
+    fprintf(to_file, "%lld,%lld,%lld,%lld,%lld\n", (long long) t->id,
+	    (long long) t->n[0], (long long) t->n[1],
+	    (long long) t->n[2], (long long) t->n[3]);
+  }
+}
+
+/* add the new elements to the groups of their original elements */
+static void print_groups(const TetList *tl, GroupList *gl, FILE *to_file)
+{
+  index_t i;
+  int j, first;
+  Group *gp;
+  const Tet *t;
+
+  for (j = 0; j < gl->n; j++) {
+    gp = &(gl->grp[j]);
+    qsort(gp->ids, gp->n, sizeof(index_t), id_compar);
+    first = 1;
+    for (i = 0; i < tl->n; i++) {
+      t = &(tl->tet[i]);
+      if (t->id == t->root || !has_id(gp->ids, gp->n, t->root))
+	continue;
+      if (first) {
+	fprintf(to_file, "!EGROUP, EGRP=%s\n", gp->name);
+	first = 0;
+      }
+      fprintf(to_file, "%lld\n", (long long) t->id);
+    }
+  }
+}
+
+void refine(FILE *from_file, const char *from_file_name,
+	    FILE *to_file, int verbose)
+{
+  char *line;
+  int mode;
+  int header, header_prev = NONE;
+  MeshIO *mio;
+  NodeDB *nodeDB;
+  EdgeDB *edgeDB;
+  FILE *tmp_file;
+  FILE *out;
+  char *elem_header = NULL;
+  TetList tl = {0, 0, NULL};
+  GroupList gl = {0, 0, NULL};
+  Group *gp = NULL;
+  int generate = 0;
+  ARStat ars;
+  Diag *diag;
+  index_t n_node, n_elem, n_sel, n_bisect, i, id;
+  coord_t x, y, z;
+
+  if (sel_group == NULL && sel_marker == NULL && !sel_box) {
+    fprintf(stderr, "Error: no elements selected (use -g, -b or -m)\n");
+    usage();
+  }
+
+  if (verbose) {
+    print_log(stderr, "Starting local refinement (reading from %s)...",
+              from_file_name);
+  }
+
+  print_header(to_file, from_file_name);
+
+  meshio_init(&mio, from_file);
+  node_init(&nodeDB);
+  arstat_init(&ars);
+  diag_init(&diag, NULL, max_print);
+  tmp_file = etmpfile();
+
+  /* everything from the ELEMENT section on is kept in tmp_file until
+     the new nodes and elements are written */
+  out = to_file;
+
+  while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
+
+    if (mode == COMMENT) {
+      fprintf(out, "%s", line);
+      continue;
+    }
+
+    if (mode == HEADER) {
+      if (verbose) {
+	if (header_prev == NODE && header != NODE)
+	  print_log(stderr, "reading NODE-part completed.");
+	else if (header_prev == ELEMENT && header != ELEMENT)
+	  print_log(stderr, "reading ELEMENT-part completed.");
+      }
+
+      if (header == NODE) {
+	if (verbose && header_prev != NODE)
+	  print_log(stderr, "Start reading NODE-part...");
+	fprintf(out, "%s", line);
+
+      } else if (header == ELEMENT) {
+	if (verbose && header_prev != ELEMENT)
+	  print_log(stderr, "Start reading ELEMENT-part...");
+	if (strstr(line, "341") == NULL) {
+	  fprintf(stderr, "Error: element type is not \"341\"?\n");
+	  exit(1);
+	}
+	if (elem_header == NULL)
+	  elem_header = estrdup(line);
+	out = tmp_file;
+
+      } else if (header == EGROUP) {
+	gp = new_group(&gl, line);
+	generate = group_is_generate(line);
+	fprintf(out, "%s", line);
+
+      } else {
+	fprintf(out, "%s", line);
+      }
+      header_prev = header;
+      continue;
+    }
+
+    assert(mode == DATA);
+
+    if (header == NODE) {
+      proceed_node_data(line, nodeDB, out);
+
+    } else if (header == ELEMENT) {
+      proceed_elem_data(line, &tl);
+
+    } else if (header == EGROUP) {
+      proceed_group_data(line, generate, gp);
+      fprintf(out, "%s", line);
+
+    } else {
+      fprintf(out, "%s", line);
+    }
+  }
+  meshio_finalize(mio);
+
+  if (elem_header == NULL) {
+    fprintf(stderr, "Error: no element data\n");
+    exit(1);
+  }
+
+  reduce_node_data(nodeDB);
+  sort_node_data(nodeDB);
+  edge_init(&edgeDB, nodeDB);
+  n_node = number_of_nodes(nodeDB);
+  n_elem = tl.n;
+
+  for (i = 0; i < gl.n; i++)
+    qsort(gl.grp[i].ids, gl.grp[i].n, sizeof(index_t), id_compar);
+  n_sel = select_elems(&tl, nodeDB, &gl);
+  if (verbose)
+    print_log(stderr, "%lld elements selected; start bisection...",
+	      (long long) n_sel);
+
+  n_bisect = refine_tets(&tl, nodeDB, edgeDB, &ars, diag, verbose);
+
+  if (number_of_nodes(nodeDB) > n_node) {
+    fprintf(to_file, "!NODE\n");
+    for (i = n_node; i < number_of_nodes(nodeDB); i++) {
+      id = get_global_node_id(nodeDB, i);
+      node_coord(nodeDB, id, &x, &y, &z);
+      print_node_line(to_file, (long long) id, x, y, z);
+    }
+  }
+  fprintf(to_file, "%s", elem_header);
+  print_elems(&tl, to_file);
+  print_groups(&tl, &gl, to_file);
+
+  rewind(tmp_file);
+  file_copy(tmp_file, to_file);
+
+  if (verbose) {
+    print_log(stderr, "local refinement completed.");
+    fprintf(stderr,
+	    "   selected elements : %lld\n"
+	    "          bisections : %lld\n"
+	    "            elements : %lld -> %lld\n"
+	    "               nodes : %lld -> %lld\n",
+	    (long long) n_sel, (long long) n_bisect,
+	    (long long) n_elem, (long long) tl.n,
+	    (long long) n_node, (long long) number_of_nodes(nodeDB));
+    if (n_bisect > 0)
+      print_arstat(&ars, stderr);
+  }
+  if (diag_count(diag) > 0)
+    print_diag(diag, stderr);
+
+  for (i = 0; i < gl.n; i++)
+    free(gl.grp[i].ids);
+  free(gl.grp);
+  free(tl.tet);
+  free(elem_header);
+  fclose(tmp_file);
+  diag_finalize(diag);
+  edge_finalize(edgeDB);
+  node_finalize(nodeDB);
+}
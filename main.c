@@ -10,14 +10,77 @@
 #include <stdio.h>
 #include <string.h>
 #include "util.h"
+#include "asyncfile.h"
+#include "coordfmt.h"
+#include "largemem.h"
+#include "indexdata.h"
+#include "cache.h"
 #include "refine.h"
 
-int main(int argc, char *argv[])
+static const char *dest_name = NULL;
+
+/* name of DEST, or NULL if writing to standard output */
+const char *dest_file_name(void)
 {
-  int verbose = 0;
+  return dest_name;
+}
+
+/* convert from_name (or stdin if NULL) into to_name (or stdout) */
+static void convert(const char *from_name, const char *to_name,
+		    int async, int verbose)
+{
+  AsyncFile *async_in, *async_out;
+  FILE *in, *out;
   FILE *from_file;
-  char from_file_name[64];
+  const char *from_file_name;
   FILE *to_file;
+
+  if (from_name != NULL) {
+    from_file = efopen(from_name, "r");
+    from_file_name = from_name;
+  } else {
+    from_file = stdin;
+    from_file_name = "stdin";
+  }
+
+  dest_name = to_name;
+  if (to_name != NULL)
+    to_file = efopen(to_name, "w");
+  else
+    to_file = stdout;
+
+  if (async) {
+    in = async_read_open(&async_in, from_file);
+    out = async_write_open(&async_out, to_file);
+  } else {
+    in = from_file;
+    out = to_file;
+  }
+
+  refine(in, from_file_name, out, verbose);
+
+  if (async) {
+    async_close(async_out);
+    async_close(async_in);
+  } else if (ferror(in)) {
+    error_exit(1, "Error: reading input failed\n");
+  }
+
+  if (from_file != stdin) fclose(from_file);
+  if (to_file != stdout) fclose(to_file);
+}
+
+int main(int argc, char *argv[])
+{
+  int verbose = 0;
+  int async = 1;
+  int write_index = 0;
+  const char *cache_dir = NULL;
+  ResultCache *cache = NULL;
+  int n_opt = 0, i, hit;
+  int *opt;
+  const char **opt_arg;
+  const char *p = NULL, *arg;
   double tc_s, tc_e;
   double te_s, te_e;
 
@@ -28,6 +91,10 @@ int main(int argc, char *argv[])
   argc--;
   argv++;
 
+  /* options changing the output, for the key of the cache */
+  opt = (int *) emalloc((argc + 1) * sizeof(int));
+  opt_arg = (const char **) emalloc((argc + 1) * sizeof(char *));
+
   for (; argc > 0; argc--, argv++) {
     if (argv[0][0] != '-')
       break;
@@ -35,11 +102,61 @@ int main(int argc, char *argv[])
     case 'v':
       verbose++;
       break;
+    case 'S':
+      async = 0;
+      break;
+    case 'R':
+      set_coord_format(COORD_SHORTEST);
+      opt[n_opt] = 'R';
+      opt_arg[n_opt++] = NULL;
+      break;
+    case 'H':
+      set_large_mem(get_large_mem() | LARGE_MEM_HUGETLB);
+      break;
+    case 'I':
+      set_large_mem(get_large_mem() | LARGE_MEM_INTERLEAVE);
+      break;
+    case 'X':
+      write_index = 1;
+      break;
+    case 'C':
+      if (argv[0][2] != '\0') {
+	cache_dir = &argv[0][2];
+      } else if (argc > 1) {
+	argc--;
+	argv++;
+	cache_dir = argv[0];
+      } else {
+	fprintf(stderr, "Error: option -C requires an argument\n");
+	usage();
+      }
+      break;
     case 'h':
       usage();
     default:
-      fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
-      usage();
+      if (argv[0][1] == '\0' || argv[0][1] == ':' ||
+	  (p = strchr(refine_options, argv[0][1])) == NULL) {
+	fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
+	usage();
+      }
+      arg = NULL;
+      if (*p == '-') {
+	arg = &argv[0][2]; /* long option --NAME */
+      } else if (p[1] == ':') {
+	if (argv[0][2] != '\0') {
+	  arg = &argv[0][2];
+	} else if (argc > 1) {
+	  argc--;
+	  argv++;
+	  arg = argv[0];
+	} else {
+	  fprintf(stderr, "Error: option -%c requires an argument\n", *p);
+	  usage();
+	}
+      }
+      refine_option(*p, arg);
+      opt[n_opt] = *p;
+      opt_arg[n_opt++] = arg;
     }
   }
 
@@ -48,25 +165,64 @@ int main(int argc, char *argv[])
     usage();
   }
 
-  if (argc >= 1) {
-    from_file = efopen(argv[0], "r");
-    strcpy(from_file_name, argv[0]);
-  } else {
-    from_file = stdin;
-    strcpy(from_file_name, "stdin");
+  if (write_index && argc < 2) {
+    fprintf(stderr, "Error: option -X requires DEST given as a file\n");
+    usage();
   }
 
-  if (argc == 2)
-    to_file = efopen(argv[1], "w");
-  else
-    to_file = stdout;
+  if (cache_dir != NULL && argc < 2) {
+    fprintf(stderr, "Error: option -C requires SOURCE and DEST given as "
+	    "files\n");
+    usage();
+  }
+  for (i = 0; cache_dir != NULL && i < n_opt; i++) {
+    if (strchr(output_file_options, opt[i]) != NULL) {
+      fprintf(stderr, "Warning: -C is ignored with -%c\n", opt[i]);
+      cache_dir = NULL;
+    }
+  }
 
-  refine(from_file, from_file_name, to_file, verbose);
+  hit = 0;
+  if (cache_dir != NULL) {
+    /* the source is read again by the conversion on a miss, mostly
+       from the page cache */
+    cache_init(&cache, cache_dir);
+    for (i = 0; i < n_opt; i++) {
+      cache_add_option(cache, opt[i], opt_arg[i]);
+      if (strchr(input_file_options, opt[i]) != NULL)
+	cache_add_file(cache, opt_arg[i]);
+    }
+    cache_add_file(cache, argv[0]);
+    hit = cache_fetch(cache, argv[1]);
+    if (verbose && hit)
+      print_log(stderr, "%s taken from cache %s (key %s)",
+		argv[1], cache_dir, cache_key(cache));
+    if (!hit)
+      remove(argv[1]); /* may be a hard link to an entry */
+  }
 
-  if (from_file != stdin) fclose(from_file);
-  if (to_file != stdout) fclose(to_file);
+  if (!hit)
+    convert(argc >= 1 ? argv[0] : NULL, argc == 2 ? argv[1] : NULL,
+	    async, verbose);
+
+  if (cache != NULL && !hit) {
+    cache_store(cache, argv[1]);
+    if (verbose)
+      print_log(stderr, "%s stored in cache %s (key %s)",
+		argv[1], cache_dir, cache_key(cache));
+  }
+
+  /* the output is read again, mostly from the page cache */
+  if (write_index)
+    meshindex_create(argv[1], DEFAULT_INDEX_STEP);
+
+  if (cache != NULL)
+    cache_finalize(cache);
+  free(opt);
+  free(opt_arg);
 
   if (verbose) {
+    print_large_mem_stat(stderr);
     tc_e = get_cputime();
     te_e = get_wtime();
     fprintf(stderr, " Total time [sec]: %.3f (cpu), %.3f (elapse)\n",
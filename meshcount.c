@@ -13,12 +13,16 @@
 #include <assert.h>
 #include "util.h"
 #include "meshio.h"
+#include "indexdata.h"
 #include "precision.h"
 
 static void usage(void)
 {
   fprintf(stderr, "Usage: %s [OPTION] [MESHFILE]\n"
 	  "Count the number of nodes and elements in MESHFILE.\n"
+	  "The counts are taken from MESHFILE.idx if it is up to date "
+	  "(see meshindex).\n"
+	  "  -n   read MESHFILE even if indexed\n"
 	  "  -h   display help\n",
 	  progname());
   exit(1);
@@ -28,6 +32,8 @@ int main(int argc, char *argv[])
 {
   FILE *mesh_file;
   MeshIO *mio;
+  MeshIndex *idx;
+  int use_index = 1;
   int mode;
   int header;
   index_t n_node = 0;
@@ -41,6 +47,9 @@ int main(int argc, char *argv[])
     if (argv[0][0] != '-')
       break;
     switch (argv[0][1]) {
+    case 'n':
+      use_index = 0;
+      break;
     case 'h':
       usage();
     default:
@@ -54,6 +63,13 @@ int main(int argc, char *argv[])
     usage();
   }
 
+  if (argc == 1 && use_index && meshindex_load(&idx, argv[0])) {
+    printf("%lld nodes, %lld elements\n", meshindex_count(idx, NODE),
+	   meshindex_count(idx, ELEMENT));
+    meshindex_finalize(idx);
+    return 0;
+  }
+
   if (argc == 1) {
     mesh_file = fopen(argv[0], "r");
     if (mesh_file == NULL) {
@@ -0,0 +1,689 @@
+/*
+ * meshd.c
+ *   Mesh daemon: load FrontSTR-format mesh file once and answer the
+ *   requests of meshq (see meshd.h for the protocol) on a Unix-domain
+ *   socket, loading the file again when it has changed
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include "util.h"
+#include "meshio.h"
+#include "nodedata.h"
+#include "elemdata.h"
+#include "vizout.h"
+#include "meshd.h"
+
+static void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] MESHFILE\n"
+	  "Load FrontSTR-format mesh file MESHFILE and answer requests "
+	  "of meshq on\n"
+	  "socket MESHFILE.sock until stopped.\n"
+	  "  -s SOCKET  socket to listen on\n"
+	  "  -d         run in the background once the mesh is loaded\n"
+	  "  -v         verbose mode\n"
+	  "  -h         display help\n",
+	  progname());
+  exit(1);
+}
+
+/* maximum length of request data (file names) */
+enum { MAX_REQUEST_LEN = 4096 };
+
+/* the mesh being served */
+typedef struct Mesh {
+  NodeDB *ndb;
+  ElemDB *eldb;
+  long long version;
+  long long stamp[3];  /* of the file when loaded */
+  int has_quality;
+  MDQuality quality;
+  char shm_name[64];   /* shared memory object, or "" */
+} Mesh;
+
+/* a request being processed; resources are released by run() also
+   when the handler fails */
+typedef struct Work {
+  const char *mesh_name;
+  Mesh *mesh;
+  MDRequest req;
+  char *data;          /* request data */
+  char *out;           /* reply data */
+  size_t out_len;
+  FILE *fp;
+  FILE *raw_fp;
+  MeshIO *mio;
+  NodeDB *ndb;         /* mesh being loaded */
+  ElemDB *eldb;
+} Work;
+
+static volatile sig_atomic_t stop = 0;
+static int verbose = 0;
+
+static void on_signal(int sig)
+{
+  (void) sig;
+  stop = 1;
+}
+
+/* size and modification time of file name */
+static int file_stamp(const char *name, long long stamp[3])
+{
+  struct stat st;
+
+  if (stat(name, &st) != 0)
+    return 0;
+  stamp[0] = (long long) st.st_size;
+  stamp[1] = (long long) st.st_mtim.tv_sec;
+  stamp[2] = (long long) st.st_mtim.tv_nsec;
+  return 1;
+}
+
+static void set_reply(Work *w, const void *data, size_t len)
+{
+  w->out = (char *) emalloc(len > 0 ? len : 1);
+  memcpy(w->out, data, len);
+  w->out_len = len;
+}
+
+/* call f(w) catching errors of the modules; return the status */
+static int run(void (*f)(Work *), Work *w)
+{
+  jmp_buf env, *prev;
+  int status;
+
+  prev = set_error_handler(&env);
+  status = setjmp(env);
+  if (status == 0)
+    f(w);
+  set_error_handler(prev);
+
+  if (w->mio != NULL) meshio_finalize(w->mio);
+  if (w->fp != NULL) fclose(w->fp);
+  if (w->raw_fp != NULL) fclose(w->raw_fp);
+  w->mio = NULL;
+  w->fp = w->raw_fp = NULL;
+  if (status != MD_OK) {
+    if (w->eldb != NULL) elem_finalize(w->eldb);
+    if (w->ndb != NULL) node_finalize(w->ndb);
+    w->eldb = NULL;
+    w->ndb = NULL;
+    free(w->out);
+    set_reply(w, error_message(), strlen(error_message()));
+  }
+  return status;
+}
+
+static void proceed_node_data(const char *line, NodeDB *ndb)
+{
+  long long node_id;
+  coord_t x, y, z;
+
+  if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4)
+    error_exit(1, "Error: reading node data failed\n");
+  new_node(ndb, node_id, x, y, z);
+}
+
+static void proceed_elem_data(const char *line, ElemDB *eldb)
+{
+  int nret, i;
+  long long elem_id, nl[10], dummy;
+  index_t n[10];
+
+  nret = sscanf(line,
+                "%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld",
+		&elem_id, nl, nl+1, nl+2, nl+3, nl+4,
+		nl+5, nl+6, nl+7, nl+8, nl+9, &dummy);
+  if (nret != 5 && nret != 11)
+    error_exit(1, "Error: reading element data failed\n");
+  for (i = 0; i < 10; i++) n[i] = nl[i];
+  new_elem(eldb, elem_id, n);
+}
+
+/* read the mesh file into w->ndb and w->eldb */
+static void do_load(Work *w)
+{
+  char *line;
+  int mode, header;
+
+  w->fp = efopen(w->mesh_name, "r");
+  meshio_init(&w->mio, w->fp);
+  node_init(&w->ndb);
+  while ((line = meshio_readline(w->mio, &mode, &header)) != NULL) {
+    if (mode == COMMENT)
+      continue;
+    if (mode == HEADER) {
+      if (header == ELEMENT && w->eldb == NULL)
+	elem_init(&w->eldb, line);
+      continue;
+    }
+    if (header == NODE)
+      proceed_node_data(line, w->ndb);
+    else if (header == ELEMENT)
+      proceed_elem_data(line, w->eldb);
+  }
+  if (w->eldb == NULL)
+    error_exit(1, "Error: no ELEMENT part in %s\n", w->mesh_name);
+  reduce_node_data(w->ndb);
+  sort_node_data(w->ndb);
+}
+
+static void remove_shm(Mesh *mesh)
+{
+  if (mesh->shm_name[0] != '\0')
+    shm_unlink(mesh->shm_name);
+  mesh->shm_name[0] = '\0';
+}
+
+/* load the mesh file if it has changed since loaded.  Return value is
+   the status; on failure, the mesh loaded before is kept. */
+static int update_mesh(Work *w)
+{
+  Mesh *mesh = w->mesh;
+  long long stamp[3];
+  int status;
+
+  if (!file_stamp(w->mesh_name, stamp)) {
+    set_reply(w, "Error: cannot stat mesh file\n", 29);
+    return MD_ESYS;
+  }
+  if (mesh->ndb != NULL && memcmp(stamp, mesh->stamp, sizeof(stamp)) == 0)
+    return MD_OK;
+
+  if (verbose)
+    print_log(stderr, "Loading %s...", w->mesh_name);
+  status = run(do_load, w);
+  if (status != MD_OK)
+    return status;
+
+  if (mesh->ndb != NULL) {
+    elem_finalize(mesh->eldb);
+    node_finalize(mesh->ndb);
+  }
+  mesh->ndb = w->ndb;
+  mesh->eldb = w->eldb;
+  w->ndb = NULL;
+  w->eldb = NULL;
+  memcpy(mesh->stamp, stamp, sizeof(stamp));
+  mesh->version++;
+  mesh->has_quality = 0;
+  remove_shm(mesh);
+  if (verbose)
+    print_log(stderr, "loaded version %lld: %lld nodes, %lld elements",
+	      mesh->version, (long long) number_of_nodes(mesh->ndb),
+	      (long long) number_of_elems(mesh->eldb));
+  return MD_OK;
+}
+
+static void do_count(Work *w)
+{
+  int64_t n[2];
+
+  n[0] = number_of_nodes(w->mesh->ndb);
+  n[1] = number_of_elems(w->mesh->eldb);
+  set_reply(w, n, sizeof(n));
+}
+
+static void do_node(Work *w)
+{
+  coord_t x, y, z;
+  double xyz[3];
+
+  if (!has_node(w->mesh->ndb, w->req.arg))
+    error_exit(MD_EARG, "Error: node %lld not found\n",
+	       (long long) w->req.arg);
+  node_coord(w->mesh->ndb, w->req.arg, &x, &y, &z);
+  xyz[0] = x;
+  xyz[1] = y;
+  xyz[2] = z;
+  set_reply(w, xyz, sizeof(xyz));
+}
+
+static void do_elem(Work *w)
+{
+  ElemDB *eldb = w->mesh->eldb;
+  index_t n[10];
+  int64_t n64[10];
+  int j;
+
+  if (!has_elem(eldb, w->req.arg))
+    error_exit(MD_EARG, "Error: element %lld not found\n",
+	       (long long) w->req.arg);
+  get_elem_nodes(eldb, get_local_elem_id(eldb, w->req.arg), n);
+  for (j = 0; j < nodes_per_elem(eldb); j++)
+    n64[j] = n[j];
+  set_reply(w, n64, nodes_per_elem(eldb) * sizeof(int64_t));
+}
+
+static void do_convert(Work *w)
+{
+  NodeDB *ndb = w->mesh->ndb;
+  ElemDB *eldb = w->mesh->eldb;
+  const char *raw_name = NULL;
+
+  if (w->req.arg == MD_XDMF) {
+    raw_name = w->data + strlen(w->data) + 1;
+    if (raw_name >= w->data + w->req.len)
+      error_exit(MD_EARG, "Error: xdmf output requires the raw file\n");
+    w->raw_fp = efopen(raw_name, "wb");
+  } else if (w->req.arg != MD_ADV && w->req.arg != MD_VTU) {
+    error_exit(MD_EARG, "Error: unknown output format\n");
+  }
+  w->fp = efopen(w->data, "w");
+
+  if (w->req.arg == MD_VTU) {
+    print_mesh_vtu(ndb, eldb, w->fp);
+  } else if (w->req.arg == MD_XDMF) {
+    print_mesh_xdmf(ndb, eldb, w->fp, w->raw_fp, raw_name);
+  } else {
+    fprintf(w->fp, "%lld\n", (long long) number_of_elems(eldb));
+    print_elem_adv(eldb, ndb, w->fp);
+    fprintf(w->fp, "%lld\n", (long long) number_of_nodes(ndb));
+    print_node_adv(ndb, w->fp);
+  }
+  if (fclose(w->fp) != 0) {
+    w->fp = NULL;
+    error_exit(MD_ESYS, "Error: writing %s failed\n", w->data);
+  }
+  w->fp = NULL;
+  set_reply(w, NULL, 0);
+}
+
+/* volume and edge ratio of the corner tetrahedra, computed once for
+   each version */
+static void do_quality(Work *w)
+{
+  Mesh *mesh = w->mesh;
+  MDQuality *q = &(mesh->quality);
+  index_t n[10], li[4], i;
+  coord_t xyz[12];
+  double v[3][3], vol, d2, d2min, d2max, ratio;
+  int a, b, k;
+
+  if (!mesh->has_quality) {
+    memset(q, 0, sizeof(MDQuality));
+    q->n_elem = number_of_elems(mesh->eldb);
+    for (i = 0; i < q->n_elem; i++) {
+      get_elem_nodes(mesh->eldb, i, n);
+      lookup_nodes(mesh->ndb, 4, n, li, xyz);
+
+      for (a = 0; a < 3; a++)
+	for (k = 0; k < 3; k++)
+	  v[a][k] = xyz[3*(a+1)+k] - xyz[k];
+      vol = ((v[0][1] * v[1][2] - v[0][2] * v[1][1]) * v[2][0] +
+	     (v[0][2] * v[1][0] - v[0][0] * v[1][2]) * v[2][1] +
+	     (v[0][0] * v[1][1] - v[0][1] * v[1][0]) * v[2][2]) / 6.0;
+
+      d2min = d2max = -1.0;
+      for (a = 0; a < 4; a++)
+	for (b = a + 1; b < 4; b++) {
+	  d2 = 0.0;
+	  for (k = 0; k < 3; k++)
+	    d2 += (xyz[3*a+k] - xyz[3*b+k]) * (xyz[3*a+k] - xyz[3*b+k]);
+	  if (d2min < 0.0 || d2 < d2min) d2min = d2;
+	  if (d2 > d2max) d2max = d2;
+	}
+      ratio = (d2min > 0.0) ? sqrt(d2max / d2min) : HUGE_VAL;
+
+      if (vol < 0.0)
+	q->n_negative++;
+      if (i == 0 || vol < q->vol_min) {
+	q->vol_min = vol;
+	q->vol_min_id = get_elem_id(mesh->eldb, i);
+      }
+      if (i == 0 || vol > q->vol_max) {
+	q->vol_max = vol;
+	q->vol_max_id = get_elem_id(mesh->eldb, i);
+      }
+      if (i == 0 || ratio < q->ratio_min)
+	q->ratio_min = ratio;
+      if (i == 0 || ratio > q->ratio_max) {
+	q->ratio_max = ratio;
+	q->ratio_max_id = get_elem_id(mesh->eldb, i);
+      }
+      q->vol_sum += vol;
+      q->ratio_sum += ratio;
+    }
+    mesh->has_quality = 1;
+  }
+  set_reply(w, q, sizeof(MDQuality));
+}
+
+/* copy the mesh into a shared memory object, once for each version */
+static void do_shm(Work *w)
+{
+  Mesh *mesh = w->mesh;
+  MDShm hdr;
+  char *p;
+  int64_t *ids, *conn;
+  double *coord;
+  index_t i, n[10];
+  coord_t x, y, z;
+  int fd, j;
+
+  if (mesh->shm_name[0] == '\0') {
+    hdr.magic = MESHD_MAGIC;
+    hdr.npe = nodes_per_elem(mesh->eldb);
+    hdr.version = mesh->version;
+    hdr.n_node = number_of_nodes(mesh->ndb);
+    hdr.n_elem = number_of_elems(mesh->eldb);
+    hdr.node_id = sizeof(MDShm);
+    hdr.coord = hdr.node_id + hdr.n_node * sizeof(int64_t);
+    hdr.elem_id = hdr.coord + 3 * hdr.n_node * sizeof(double);
+    hdr.conn = hdr.elem_id + hdr.n_elem * sizeof(int64_t);
+    hdr.size = hdr.conn + hdr.npe * hdr.n_elem * sizeof(int64_t);
+
+    sprintf(mesh->shm_name, "/meshd.%ld.%lld", (long) getpid(),
+	    mesh->version);
+    /* readable only by the user running meshd, as the socket */
+    fd = shm_open(mesh->shm_name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+      mesh->shm_name[0] = '\0';
+      error_exit(MD_ESYS, "Error: shm_open failed: %s\n", strerror(errno));
+    }
+    p = MAP_FAILED;
+    if (ftruncate(fd, (off_t) hdr.size) == 0)
+      p = mmap(NULL, hdr.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      remove_shm(mesh);
+      error_exit(MD_ESYS, "Error: mapping shared memory failed: %s\n",
+		 strerror(errno));
+    }
+
+    memcpy(p, &hdr, sizeof(MDShm));
+    ids = (int64_t *) (p + hdr.node_id);
+    coord = (double *) (p + hdr.coord);
+    for (i = 0; i < hdr.n_node; i++) {
+      ids[i] = get_global_node_id(mesh->ndb, i);
+      get_local_node_coord(mesh->ndb, i, &x, &y, &z);
+      coord[3*i] = x;
+      coord[3*i+1] = y;
+      coord[3*i+2] = z;
+    }
+    ids = (int64_t *) (p + hdr.elem_id);
+    conn = (int64_t *) (p + hdr.conn);
+    for (i = 0; i < hdr.n_elem; i++) {
+      ids[i] = get_elem_id(mesh->eldb, i);
+      get_elem_nodes(mesh->eldb, i, n);
+      for (j = 0; j < hdr.npe; j++)
+	conn[hdr.npe*i+j] = n[j];
+    }
+    munmap(p, hdr.size);
+  }
+  set_reply(w, mesh->shm_name, strlen(mesh->shm_name) + 1);
+}
+
+static void do_stop(Work *w)
+{
+  stop = 1;
+  set_reply(w, NULL, 0);
+}
+
+/* read or write len bytes; return 1 on success, or 0 at EOF or on
+   failure */
+static int read_full(int fd, void *buf, size_t len)
+{
+  char *p = (char *) buf;
+  ssize_t r;
+
+  while (len > 0) {
+    r = read(fd, p, len);
+    if (r < 0 && errno == EINTR && !stop)
+      continue;
+    if (r <= 0)
+      return 0;
+    p += r;
+    len -= r;
+  }
+  return 1;
+}
+
+static int write_full(int fd, const void *buf, size_t len)
+{
+  const char *p = (const char *) buf;
+  ssize_t r;
+
+  while (len > 0) {
+    r = write(fd, p, len);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return 0;
+    p += r;
+    len -= r;
+  }
+  return 1;
+}
+
+/* answer the requests on connection fd until closed, or until idle
+   for MESHD_TIMEOUT seconds, as the other clients wait meanwhile */
+static void serve(int fd, const char *mesh_name, Mesh *mesh)
+{
+  static void (*const handler[])(Work *) = {
+    NULL, do_count, do_node, do_elem, do_convert, do_quality, do_shm,
+    do_stop
+  };
+  Work w;
+  MDReply rep;
+  struct timeval tv;
+
+  tv.tv_sec = MESHD_TIMEOUT;
+  tv.tv_usec = 0;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) != 0) {
+    fprintf(stderr, "Warning: setting timeout failed: %s; "
+	    "connection closed\n", strerror(errno));
+    return;
+  }
+
+  while (!stop) {
+    memset(&w, 0, sizeof(Work));
+    w.mesh_name = mesh_name;
+    w.mesh = mesh;
+    errno = 0;
+    if (!read_full(fd, &w.req, sizeof(MDRequest))) {
+      if (verbose > 1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	print_log(stderr, "connection idle; closed");
+      break;
+    }
+    if (w.req.magic != MESHD_MAGIC || w.req.len < 0 ||
+	w.req.len > MAX_REQUEST_LEN) {
+      fprintf(stderr, "Warning: invalid request; connection closed\n");
+      break;
+    }
+    w.data = (char *) emalloc(w.req.len + 1);
+    if (!read_full(fd, w.data, w.req.len)) {
+      free(w.data);
+      break;
+    }
+    w.data[w.req.len] = '\0';
+
+    if (verbose > 1)
+      print_log(stderr, "request %d (%lld)", (int) w.req.op,
+		(long long) w.req.arg);
+    if (w.req.op < MD_COUNT || w.req.op > MD_STOP) {
+      rep.status = MD_EARG;
+      set_reply(&w, "Error: unknown request\n", 23);
+    } else if (w.req.op == MD_STOP ||
+	       (rep.status = update_mesh(&w)) == MD_OK) {
+      rep.status = run(handler[w.req.op], &w);
+    }
+
+    rep.npe = (mesh->eldb != NULL) ? nodes_per_elem(mesh->eldb) : 0;
+    rep.version = mesh->version;
+    rep.len = w.out_len;
+    if (!write_full(fd, &rep, sizeof(MDReply)) ||
+	!write_full(fd, w.out, w.out_len)) {
+      free(w.data);
+      free(w.out);
+      break;
+    }
+    free(w.data);
+    free(w.out);
+  }
+}
+
+/* return a socket listening on path; a socket file left by a daemon
+   no longer running is replaced.  The socket is made with mode 0600,
+   as a client can make the daemon write files (MD_CONVERT). */
+static int listen_on(const char *path)
+{
+  struct sockaddr_un addr;
+  mode_t mask;
+  int fd, ret;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+    error_exit(1, "Error: socket path too long: %s\n", path);
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    error_exit(2, "Error: socket failed: %s\n", strerror(errno));
+  if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0)
+    error_exit(1, "Error: a daemon is already listening on %s\n", path);
+  close(fd);
+  unlink(path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    error_exit(2, "Error: socket failed: %s\n", strerror(errno));
+  mask = umask(077);
+  ret = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+  umask(mask);
+  if (ret != 0 || chmod(path, 0600) != 0 || listen(fd, 16) != 0)
+    error_exit(2, "Error: listening on %s failed: %s\n", path,
+	       strerror(errno));
+  return fd;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *mesh_name;
+  const char *sock_opt = NULL;
+  char *sock_name;
+  int detach = 0;
+  int sock, fd;
+  Mesh mesh;
+  Work w;
+  struct sigaction sa;
+
+  setprogname(argv[0]);
+  argc--;
+  argv++;
+
+  for (; argc > 0; argc--, argv++) {
+    if (argv[0][0] != '-')
+      break;
+    switch (argv[0][1]) {
+    case 's':
+      if (argv[0][2] != '\0') {
+	sock_opt = argv[0] + 2;
+      } else if (argc > 1) {
+	sock_opt = argv[1];
+	argc--;
+	argv++;
+      } else {
+	fprintf(stderr, "Error: option -s requires an argument\n");
+	usage();
+      }
+      break;
+    case 'd':
+      detach = 1;
+      break;
+    case 'v':
+      verbose++;
+      break;
+    case 'h':
+      usage();
+      break;
+    default:
+      fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
+      usage();
+    }
+  }
+  if (argc != 1) {
+    fprintf(stderr, "Error: %s\n",
+	    argc == 0 ? "no mesh file given" : "too many arguments");
+    usage();
+  }
+  mesh_name = argv[0];
+  if (sock_opt != NULL) {
+    sock_name = estrdup(sock_opt);
+  } else {
+    sock_name = (char *) emalloc(strlen(mesh_name) + 6);
+    sprintf(sock_name, "%s.sock", mesh_name);
+  }
+
+  memset(&mesh, 0, sizeof(Mesh));
+  memset(&w, 0, sizeof(Work));
+  w.mesh_name = mesh_name;
+  w.mesh = &mesh;
+  if (update_mesh(&w) != MD_OK) {
+    fprintf(stderr, "%s", w.out);
+    exit(1);
+  }
+  free(w.out);
+
+  sock = listen_on(sock_name);
+
+  if (detach) {
+    pid_t pid = fork();
+    if (pid < 0)
+      error_exit(2, "Error: fork failed: %s\n", strerror(errno));
+    if (pid > 0)
+      _exit(0); /* the socket is ready for the clients */
+    setsid();
+  }
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sa.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE, &sa, NULL);
+
+  if (verbose)
+    print_log(stderr, "Listening on %s", sock_name);
+  while (!stop) {
+    fd = accept(sock, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR)
+	continue;
+      error_exit(2, "Error: accept failed: %s\n", strerror(errno));
+    }
+    serve(fd, mesh_name, &mesh);
+    close(fd);
+  }
+
+  close(sock);
+  unlink(sock_name);
+  remove_shm(&mesh);
+  elem_finalize(mesh.eldb);
+  node_finalize(mesh.ndb);
+  free(sock_name);
+  if (verbose)
+    print_log(stderr, "stopped.");
+  return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef MESHD_H
+#define MESHD_H
+
+#include <stdint.h>
+
+/* Protocol of meshd on its Unix-domain socket.  A client sends
+   requests, each an MDRequest followed by len bytes, and reads an
+   MDReply followed by len bytes for each; the connection is kept
+   until the client closes it or it is idle for MESHD_TIMEOUT seconds.
+   Clients are served one at a time, so a client should not keep the
+   connection while not sending requests.  Data are in the byte order
+   of the machine.  If status is not MD_OK, the reply data is the
+   error message. */
+
+#define MESHD_MAGIC 0x4448534d /* "MSHD" */
+
+enum { MESHD_TIMEOUT = 10 };
+
+enum {
+  MD_COUNT = 1, /* reply: int64_t n_node, n_elem */
+  MD_NODE,      /* arg: node ID; reply: double x, y, z */
+  MD_ELEM,      /* arg: element ID; reply: int64_t node IDs[npe] */
+  MD_CONVERT,   /* arg: MD_ADV, MD_VTU or MD_XDMF; data: output file
+		   name, and for MD_XDMF '\0' and the raw file name */
+  MD_QUALITY,   /* reply: MDQuality */
+  MD_SHM,       /* reply: name of the shared memory object holding the
+		   mesh (starting with MDShm), to be given to shm_open */
+  MD_STOP       /* stop the daemon */
+};
+
+enum { MD_ADV, MD_VTU, MD_XDMF };
+
+enum { MD_OK = 0, MD_EDATA = 1, MD_ESYS = 2, MD_EARG = 3 };
+
+typedef struct MDRequest {
+  int32_t magic;
+  int32_t op;
+  int64_t arg;
+  int64_t len;
+} MDRequest;
+
+typedef struct MDReply {
+  int32_t status;
+  int32_t npe;     /* nodes per element */
+  int64_t version; /* incremented each time the mesh is loaded */
+  int64_t len;
+} MDReply;
+
+/* quality of the elements, on their corner tetrahedra */
+typedef struct MDQuality {
+  int64_t n_elem;
+  int64_t n_negative;   /* elements of negative volume */
+  double vol_min;
+  double vol_max;
+  double vol_sum;
+  int64_t vol_min_id;
+  int64_t vol_max_id;
+  double ratio_min;     /* ratio of the longest edge to the shortest */
+  double ratio_max;
+  double ratio_sum;
+  int64_t ratio_max_id;
+} MDQuality;
+
+/* header of the shared memory object; the arrays are at the given
+   byte offsets from the start: node IDs (int64_t, sorted),
+   coordinates (double x, y, z of each node), element IDs (int64_t)
+   and connectivity (npe int64_t node IDs of each element) */
+typedef struct MDShm {
+  int32_t magic;
+  int32_t npe;
+  int64_t version;
+  int64_t size;    /* of the whole object */
+  int64_t n_node;
+  int64_t n_elem;
+  int64_t node_id;
+  int64_t coord;
+  int64_t elem_id;
+  int64_t conn;
+} MDShm;
+
+#endif /* MESHD_H */
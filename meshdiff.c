@@ -0,0 +1,593 @@
+/*
+ * meshdiff.c
+ *   Compare two FrontSTR-format (or Adventure-format) mesh files
+ *   section by section, with a tolerance on real numbers
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
+#include "util.h"
+#include "meshio.h"
+#include "asyncfile.h"
+
+#define DEFAULT_MAX_REPORT 10
+
+/* pairs of data lines compared by a thread at once, and the longest
+   line of Adventure-format files (as in meshio.c) */
+enum { BATCH_LINES = 16384, ADV_MAXLEN = 1024, LABEL_LEN = 40 };
+
+static double abs_tol = 0.0;
+static double rel_tol = 0.0;
+static int max_report = DEFAULT_MAX_REPORT;
+static int n_threads = 1;
+
+static void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] FILE1 FILE2\n"
+	  "Compare FrontSTR-format (or Adventure-format) mesh files FILE1 "
+	  "and FILE2\nsection by section, ignoring comment lines, and "
+	  "print the differences.  Real\nnumbers x1 and x2 are taken as "
+	  "equal if |x1 - x2| <= ATOL + RTOL * max(|x1|, |x2|).\n"
+	  "Exit status is 0 if the meshes are the same, 1 if different, "
+	  "and 2 if trouble.\n"
+	  "  -a ATOL  absolute tolerance (default: 0)\n"
+	  "  -r RTOL  relative tolerance (default: 0)\n"
+	  "  -n N     stop after N differences (default: %d, 0: no limit)\n"
+	  "  -j N     compare data lines with N threads (default: 1)\n"
+	  "  -h       display help\n",
+	  progname(), DEFAULT_MAX_REPORT);
+  exit(2);
+}
+
+/* a mesh file read line by line.  FrontSTR files are read by MeshIO;
+   Adventure files have no headers, so the lines giving the number of
+   elements or nodes are taken as the headers of the parts after them. */
+struct MeshFile {
+  const char *name;
+  FILE *fp;
+  FILE *in;
+  AsyncFile *async;
+  MeshIO *mio;       /* NULL for Adventure files */
+  char *adv_line;
+  long long adv_left; /* data lines left in the Adventure part */
+  int adv_part;
+  long long lineno;
+  /* the line read ahead, by mesh_file_peek */
+  char *line;
+  int mode;          /* HEADER or DATA; line is NULL at the end */
+  int peeked;
+};
+
+typedef struct MeshFile MeshFile;
+
+static void mesh_file_open(MeshFile *mf, const char *name)
+{
+  int c;
+
+  mf->name = name;
+  mf->fp = efopen(name, "r");
+  mf->in = async_read_open(&mf->async, mf->fp);
+  mf->lineno = 0;
+  mf->peeked = 0;
+  mf->adv_line = NULL;
+  mf->adv_left = 0;
+  mf->adv_part = 0;
+
+  /* FrontSTR files start with a header or a comment */
+  c = getc(mf->in);
+  if (c != EOF)
+    ungetc(c, mf->in);
+  if (c == '!' || c == '#') {
+    meshio_init(&mf->mio, mf->in);
+  } else {
+    mf->mio = NULL;
+    mf->adv_line = (char *) emalloc(ADV_MAXLEN);
+  }
+}
+
+static void mesh_file_close(MeshFile *mf)
+{
+  if (mf->mio != NULL)
+    meshio_finalize(mf->mio);
+  free(mf->adv_line);
+  async_close(mf->async);
+  fclose(mf->fp);
+}
+
+/* read the next line of an Adventure file into mf->line */
+static void read_adv_line(MeshFile *mf)
+{
+  size_t len;
+  long long n;
+  char *end;
+
+  mf->line = NULL;
+  if (!fgets(mf->adv_line, ADV_MAXLEN, mf->in))
+    return;
+  len = strlen(mf->adv_line);
+  if (len == ADV_MAXLEN - 1 && mf->adv_line[ADV_MAXLEN - 2] != '\n')
+    error_exit(2, "too long line (longer than %d)\n", ADV_MAXLEN);
+  mf->line = mf->adv_line;
+
+  if (mf->adv_left > 0) {
+    mf->mode = DATA;
+    mf->adv_left--;
+    return;
+  }
+  mf->mode = HEADER;
+  mf->adv_part++;
+  n = strtoll(mf->line, &end, 10);
+  while (isspace((unsigned char) *end))
+    end++;
+  mf->adv_left = (end != mf->line && *end == '\0' && n > 0) ? n : 0;
+}
+
+/* read ahead the next line other than comments, if not yet; return
+   its mode, or -1 at the end of the file */
+static int mesh_file_peek(MeshFile *mf)
+{
+  int header;
+
+  if (!mf->peeked) {
+    do {
+      if (mf->mio != NULL)
+	mf->line = meshio_readline(mf->mio, &mf->mode, &header);
+      else
+	read_adv_line(mf);
+      if (mf->line != NULL)
+	mf->lineno++;
+    } while (mf->line != NULL && mf->mode == COMMENT);
+    mf->peeked = 1;
+  }
+  return (mf->line != NULL) ? mf->mode : -1;
+}
+
+/* take the line read ahead */
+static void mesh_file_next(MeshFile *mf)
+{
+  mf->peeked = 0;
+}
+
+/* copy line to label without the newline, cut at LABEL_LEN-1 chars */
+static void trim_line(const char *line, char *label)
+{
+  int i = 0;
+
+  while (line[i] != '\0' && line[i] != '\n' && line[i] != '\r' &&
+	 i < LABEL_LEN - 1) {
+    label[i] = line[i];
+    i++;
+  }
+  label[i] = '\0';
+}
+
+/* label of the current section of mf, from its header line */
+static void section_label(const MeshFile *mf, const char *header,
+			  char *label)
+{
+  if (mf->mio == NULL)
+    sprintf(label, "part %d", mf->adv_part);
+  else
+    trim_line(header, label);
+}
+
+/* field i (from 0) of line: its start is returned and its length set
+   in *len, or NULL if the line has fewer fields */
+static const char *field(const char *line, int i, int *len)
+{
+  const char *p = line, *q;
+  int k;
+
+  for (k = 0; ; k++) {
+    while (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r' || *p == '\n')
+      p++;
+    if (*p == '\0')
+      return NULL;
+    q = p;
+    while (*q != '\0' && *q != ' ' && *q != '\t' && *q != ',' &&
+	   *q != '\r' && *q != '\n')
+      q++;
+    if (k == i) {
+      *len = (int) (q - p);
+      return p;
+    }
+    p = q;
+  }
+}
+
+/* return 1 if fields a and b of lengths la and lb are equal: the same
+   text, the same integer, or real numbers within the tolerance */
+static int field_equal(const char *a, int la, const char *b, int lb)
+{
+  char sa[64], sb[64], *ea, *eb;
+  double xa, xb, m;
+
+  if (la == lb && memcmp(a, b, la) == 0)
+    return 1;
+  if (la >= (int) sizeof(sa) || lb >= (int) sizeof(sb))
+    return 0;
+  memcpy(sa, a, la);
+  sa[la] = '\0';
+  memcpy(sb, b, lb);
+  sb[lb] = '\0';
+
+  if (strpbrk(sa, ".eEnN") == NULL && strpbrk(sb, ".eEnN") == NULL) {
+    long long ia = strtoll(sa, &ea, 10), ib = strtoll(sb, &eb, 10);
+
+    return *ea == '\0' && *eb == '\0' && ea != sa && eb != sb && ia == ib;
+  }
+  xa = strtod(sa, &ea);
+  xb = strtod(sb, &eb);
+  if (*ea != '\0' || *eb != '\0' || ea == sa || eb == sb)
+    return 0;
+  m = (fabs(xa) > fabs(xb)) ? fabs(xa) : fabs(xb);
+  return fabs(xa - xb) <= abs_tol + rel_tol * m;
+}
+
+/* return the index of the first field differing between lines a and b,
+   or -1 if all are equal */
+static int compare_lines(const char *a, const char *b)
+{
+  const char *fa, *fb;
+  int i, la, lb;
+
+  if (strcmp(a, b) == 0)
+    return -1;
+  for (i = 0; ; i++) {
+    fa = field(a, i, &la);
+    fb = field(b, i, &lb);
+    if (fa == NULL && fb == NULL)
+      return -1;
+    if (fa == NULL || fb == NULL || !field_equal(fa, la, fb, lb))
+      return i;
+  }
+}
+
+/* pairs of data lines to be compared, and the differences found */
+struct Batch {
+  int n;
+  size_t len;
+  size_t max_len;
+  char *text;             /* the lines, each terminated by '\0' */
+  size_t off[2*BATCH_LINES];
+  long long lineno[2*BATCH_LINES];
+  int sect[BATCH_LINES];  /* index of the section label */
+  int n_diff;
+  int diff[BATCH_LINES];  /* pairs differing */
+  int diff_field[BATCH_LINES];
+};
+
+typedef struct Batch Batch;
+
+static void batch_add_line(Batch *b, int k, const char *line, long long lineno)
+{
+  size_t len = strlen(line) + 1;
+
+  if (b->len + len > b->max_len) {
+    b->max_len = 2 * (b->len + len);
+    b->text = (char *) erealloc(b->text, b->max_len);
+  }
+  memcpy(b->text + b->len, line, len);
+  b->off[2*b->n+k] = b->len;
+  b->lineno[2*b->n+k] = lineno;
+  b->len += len;
+}
+
+static void *compare_batch(void *arg)
+{
+  Batch *b = (Batch *) arg;
+  int i, f;
+
+  b->n_diff = 0;
+  for (i = 0; i < b->n; i++) {
+    f = compare_lines(b->text + b->off[2*i], b->text + b->off[2*i+1]);
+    if (f >= 0) {
+      b->diff[b->n_diff] = i;
+      b->diff_field[b->n_diff++] = f;
+      if (max_report > 0 && b->n_diff > max_report)
+	break;
+    }
+  }
+  return NULL;
+}
+
+/* the comparison */
+struct Diff {
+  MeshFile f[2];
+  Batch *batch;      /* n_threads batches */
+  int n_batch;       /* batches filled */
+  char (*label)[LABEL_LEN]; /* labels of the sections */
+  int n_sect;
+  int max_sect;
+  long long n_diff;
+  int stopped;       /* 1 after max_report differences */
+};
+
+typedef struct Diff Diff;
+
+/* count a difference; return 1 if it is to be printed, or 0 if
+   max_report differences are already printed */
+static int count_diff(Diff *d)
+{
+  if (max_report > 0 && d->n_diff >= max_report)
+    d->stopped = 1;
+  if (d->stopped)
+    return 0;
+  d->n_diff++;
+  return 1;
+}
+
+static void print_field(const char *line, int i)
+{
+  const char *p;
+  int len;
+
+  if ((p = field(line, i, &len)) == NULL)
+    printf("(none)");
+  else
+    printf("%.*s", len, p);
+}
+
+/* compare the batches filled so far with the threads, and print their
+   differences in order */
+static void run_batches(Diff *d)
+{
+  Batch *b;
+  int t, k, i, f;
+
+#ifdef USE_PTHREAD
+  {
+    pthread_t *thread;
+
+    thread = (pthread_t *) emalloc(d->n_batch * sizeof(pthread_t));
+    for (t = 1; t < d->n_batch; t++)
+      if (pthread_create(&thread[t], NULL, compare_batch, &d->batch[t]) != 0)
+	error_exit(2, "pthread_create failed\n");
+    if (d->n_batch > 0)
+      compare_batch(&d->batch[0]);
+    for (t = 1; t < d->n_batch; t++)
+      pthread_join(thread[t], NULL);
+    free(thread);
+  }
+#else
+  for (t = 0; t < d->n_batch; t++)
+    compare_batch(&d->batch[t]);
+#endif
+
+  for (t = 0; t < d->n_batch; t++) {
+    b = &d->batch[t];
+    for (k = 0; k < b->n_diff && count_diff(d); k++) {
+      i = b->diff[k];
+      f = b->diff_field[k];
+      printf("%s:%lld: %s:%lld: %s: field %d: ",
+	     d->f[0].name, b->lineno[2*i], d->f[1].name, b->lineno[2*i+1],
+	     d->label[b->sect[i]], f + 1);
+      print_field(b->text + b->off[2*i], f);
+      printf(" != ");
+      print_field(b->text + b->off[2*i+1], f);
+      printf("\n");
+    }
+    b->n = 0;
+    b->len = 0;
+  }
+  d->n_batch = 0;
+}
+
+static void add_pair(Diff *d)
+{
+  Batch *b;
+
+  if (d->n_batch == 0 || d->batch[d->n_batch-1].n == BATCH_LINES) {
+    if (d->n_batch == n_threads)
+      run_batches(d);
+    d->n_batch++;
+  }
+  b = &d->batch[d->n_batch-1];
+  batch_add_line(b, 0, d->f[0].line, d->f[0].lineno);
+  batch_add_line(b, 1, d->f[1].line, d->f[1].lineno);
+  b->sect[b->n++] = d->n_sect - 1;
+}
+
+static void new_section(Diff *d, const MeshFile *mf, const char *header)
+{
+  if (d->n_sect == d->max_sect) {
+    d->max_sect = (d->max_sect > 0) ? 2 * d->max_sect : 16;
+    d->label = (char (*)[LABEL_LEN])
+      erealloc(d->label, d->max_sect * LABEL_LEN);
+  }
+  section_label(mf, header, d->label[d->n_sect++]);
+}
+
+/* return 1 if header lines a and b are the same but for white space */
+static int header_equal(const char *a, const char *b)
+{
+  for (;;) {
+    while (isspace((unsigned char) *a))
+      a++;
+    while (isspace((unsigned char) *b))
+      b++;
+    if (*a != *b)
+      return 0;
+    if (*a == '\0')
+      return 1;
+    a++;
+    b++;
+  }
+}
+
+/* skip the data lines of f[k] up to the next header, which are not in
+   the other file */
+static void skip_extra_lines(Diff *d, int k)
+{
+  MeshFile *mf = &d->f[k];
+  long long first = mf->lineno, n = 0;
+
+  while (mesh_file_peek(mf) == DATA) {
+    n++;
+    mesh_file_next(mf);
+  }
+  if (count_diff(d))
+    printf("%s:%lld: %s: %lld more data lines than in %s\n",
+	   mf->name, first, d->label[d->n_sect-1], n, d->f[1-k].name);
+}
+
+static void compare_files(Diff *d)
+{
+  MeshFile *f0 = &d->f[0], *f1 = &d->f[1];
+  int m0, m1, k;
+
+  new_section(d, f0, "(top)");
+  while (!d->stopped) {
+    m0 = mesh_file_peek(f0);
+    m1 = mesh_file_peek(f1);
+    if (m0 == DATA && m1 == DATA) {
+      add_pair(d);
+      mesh_file_next(f0);
+      mesh_file_next(f1);
+      continue;
+    }
+
+    /* the end of a section: differences in it are printed first */
+    run_batches(d);
+    if (d->stopped)
+      break;
+    if (m0 == -1 && m1 == -1)
+      break;
+    if (m0 == DATA || m1 == DATA) {
+      skip_extra_lines(d, (m0 == DATA) ? 0 : 1);
+      continue;
+    }
+    if (m0 == -1 || m1 == -1) {
+      k = (m0 == -1) ? 1 : 0;
+      if (count_diff(d))
+	printf("%s:%lld: sections from here are not in %s\n",
+	       d->f[k].name, d->f[k].lineno, d->f[1-k].name);
+      break;
+    }
+    if (!header_equal(f0->line, f1->line) && count_diff(d)) {
+      char h0[LABEL_LEN], h1[LABEL_LEN];
+
+      trim_line(f0->line, h0);
+      trim_line(f1->line, h1);
+      printf("%s:%lld: %s:%lld: header: %s != %s\n", f0->name, f0->lineno,
+	     f1->name, f1->lineno, h0, h1);
+    }
+    new_section(d, f0, f0->line);
+    mesh_file_next(f0);
+    mesh_file_next(f1);
+  }
+  run_batches(d);
+}
+
+int main(int argc, char *argv[])
+{
+  Diff d;
+  int t;
+  char *end;
+
+  setprogname(argv[0]);
+  argc--;
+  argv++;
+
+  for (; argc > 0; argc--, argv++) {
+    if (argv[0][0] != '-' || argv[0][1] == '\0')
+      break;
+    switch (argv[0][1]) {
+    case 'a':
+    case 'r':
+    case 'n':
+    case 'j':
+      {
+	int opt = argv[0][1];
+	const char *arg;
+	double v;
+
+	if (argv[0][2] != '\0') {
+	  arg = argv[0] + 2;
+	} else if (argc > 1) {
+	  arg = argv[1];
+	  argc--;
+	  argv++;
+	} else {
+	  fprintf(stderr, "Error: option -%c requires an argument\n", opt);
+	  usage();
+	}
+	v = strtod(arg, &end);
+	if (end == arg || *end != '\0' || !(v >= 0)) {
+	  fprintf(stderr, "Error: argument of -%c must be a non-negative "
+		  "number\n", opt);
+	  usage();
+	}
+	if (opt == 'a')
+	  abs_tol = v;
+	else if (opt == 'r')
+	  rel_tol = v;
+	else if (opt == 'n')
+	  max_report = (int) v;
+	else if (v >= 1)
+	  n_threads = (int) v;
+	else {
+	  fprintf(stderr, "Error: number of threads must be positive\n");
+	  usage();
+	}
+      }
+      break;
+    case 'h':
+      usage();
+      break;
+    default:
+      fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
+      usage();
+    }
+  }
+
+  if (argc != 2) {
+    fprintf(stderr, "Error: two files must be given\n");
+    usage();
+  }
+
+  mesh_file_open(&d.f[0], argv[0]);
+  mesh_file_open(&d.f[1], argv[1]);
+  if ((d.f[0].mio == NULL) != (d.f[1].mio == NULL))
+    error_exit(2, "Error: %s and %s are in different formats\n",
+	       argv[0], argv[1]);
+
+  d.batch = (Batch *) emalloc(n_threads * sizeof(Batch));
+  for (t = 0; t < n_threads; t++) {
+    d.batch[t].n = 0;
+    d.batch[t].len = 0;
+    d.batch[t].max_len = 0;
+    d.batch[t].text = NULL;
+  }
+  d.n_batch = 0;
+  d.label = NULL;
+  d.n_sect = d.max_sect = 0;
+  d.n_diff = 0;
+  d.stopped = 0;
+
+  compare_files(&d);
+
+  if (d.stopped)
+    printf("%s: stopped after %lld differences\n", progname(), d.n_diff);
+  else if (d.n_diff > 0)
+    printf("%s: %lld difference%s\n", progname(), d.n_diff,
+	   (d.n_diff > 1) ? "s" : "");
+
+  mesh_file_close(&d.f[0]);
+  mesh_file_close(&d.f[1]);
+  for (t = 0; t < n_threads; t++)
+    free(d.batch[t].text);
+  free(d.batch);
+  free(d.label);
+
+  return (d.n_diff > 0) ? 1 : 0;
+}
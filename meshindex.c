@@ -0,0 +1,225 @@
+/*
+ * meshindex.c
+ *   Write the index of FrontSTR-format mesh file (MESHFILE.idx), or
+ *   look up nodes, elements and sections with it
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util.h"
+#include "meshio.h"
+#include "indexdata.h"
+
+static void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] MESHFILE\n"
+	  "Write the index of FrontSTR-format mesh file MESHFILE to "
+	  "MESHFILE.idx,\n"
+	  "or look up MESHFILE with the index.\n"
+	  "  -s STEP  mark every STEP-th data line in the index "
+	  "(default: %d)\n"
+	  "  -l       list the sections\n"
+	  "  -n ID    print the data line of node ID\n"
+	  "  -e ID    print the data line of element ID\n"
+	  "  -p N     print byte ranges splitting each section into N parts\n"
+	  "  -h       display help\n",
+	  progname(), DEFAULT_INDEX_STEP);
+  exit(1);
+}
+
+static const char *header_name(int header)
+{
+  switch (header) {
+  case NODE: return "NODE";
+  case ELEMENT: return "ELEMENT";
+  case NGROUP: return "NGROUP";
+  case EGROUP: return "EGROUP";
+  default: return "OTHER";
+  }
+}
+
+static void list_sections(const MeshIndex *idx)
+{
+  int k;
+
+  for (k = 0; k < meshindex_n_section(idx); k++) {
+    const MeshSection *sec = meshindex_section(idx, k);
+
+    printf("%d %s offset %lld end %lld lines %lld data %lld",
+	   k, header_name(sec->header), sec->offset, sec->end,
+	   sec->n_line, sec->n_data);
+    if ((sec->header == NODE || sec->header == ELEMENT) && sec->n_data > 0)
+      printf(" ids %lld-%lld%s", sec->first_id, sec->last_id,
+	     sec->sorted ? "" : " (unsorted)");
+    printf(": %s\n", sec->line);
+  }
+}
+
+static void split_sections(const MeshIndex *idx, int n_part)
+{
+  long long *offsets;
+  int k, i, n;
+
+  offsets = (long long *) emalloc((n_part + 1) * sizeof(long long));
+  for (k = 0; k < meshindex_n_section(idx); k++) {
+    if (meshindex_section(idx, k)->n_data == 0)
+      continue;
+    n = meshindex_split(idx, k, n_part, offsets);
+    for (i = 0; i < n; i++)
+      printf("%d %lld %lld\n", k, offsets[i], offsets[i + 1]);
+  }
+  free(offsets);
+}
+
+/* read the data lines from offset to end in a section of type header
+   and print the one of ID id.  Return value is 1 if found.  If sorted,
+   stop at the first larger ID. */
+static int scan_lines(MeshIO *mio, int header, long long offset,
+		      long long end, long long id, int sorted)
+{
+  char *line;
+  int mode, h;
+  long long i;
+
+  meshio_seek(mio, offset, header);
+  while (meshio_tell(mio) < end &&
+	 (line = meshio_readline(mio, &mode, &h)) != NULL) {
+    if (mode != DATA)
+      continue;
+    i = strtoll(line, NULL, 10);
+    if (i == id) {
+      fputs(line, stdout);
+      return 1;
+    }
+    if (sorted && i > id)
+      break;
+  }
+  return 0;
+}
+
+/* print the data line of ID id in the sections of type header */
+static int lookup(const MeshIndex *idx, FILE *fp, int header, long long id)
+{
+  MeshIO *mio;
+  long long offset;
+  int k, found = 0;
+
+  meshio_init(&mio, fp);
+  k = meshindex_find(idx, header, id, &offset);
+  if (k >= 0)
+    found = scan_lines(mio, header, offset,
+		       meshindex_section(idx, k)->end, id, 1);
+
+  /* sections not sorted by ID are read through */
+  for (k = 0; !found && k < meshindex_n_section(idx); k++) {
+    const MeshSection *sec = meshindex_section(idx, k);
+
+    if (sec->header == header && !sec->sorted)
+      found = scan_lines(mio, header, sec->data_offset, sec->end, id, 0);
+  }
+  meshio_finalize(mio);
+
+  if (!found)
+    fprintf(stderr, "%s %lld not found\n", header_name(header), id);
+  return found;
+}
+
+static const char *option_arg(int *argc, char ***argv)
+{
+  const char *arg;
+
+  if ((*argv)[0][2] != '\0') {
+    arg = (*argv)[0] + 2;
+  } else if (*argc > 1) {
+    (*argc)--;
+    (*argv)++;
+    arg = (*argv)[0];
+  } else {
+    fprintf(stderr, "Error: option -%c requires an argument\n", (*argv)[0][1]);
+    usage();
+  }
+  return arg;
+}
+
+int main(int argc, char *argv[])
+{
+  int step = DEFAULT_INDEX_STEP;
+  int list = 0;
+  int n_part = 0;
+  long long node_id = -1, elem_id = -1;
+  const char *mesh_name;
+  MeshIndex *idx;
+  FILE *fp;
+  int ret = 0;
+
+  setprogname(argv[0]);
+  argc--;
+  argv++;
+
+  for (; argc > 0; argc--, argv++) {
+    if (argv[0][0] != '-')
+      break;
+    switch (argv[0][1]) {
+    case 's':
+      step = atoi(option_arg(&argc, &argv));
+      break;
+    case 'l':
+      list = 1;
+      break;
+    case 'n':
+      node_id = atoll(option_arg(&argc, &argv));
+      break;
+    case 'e':
+      elem_id = atoll(option_arg(&argc, &argv));
+      break;
+    case 'p':
+      n_part = atoi(option_arg(&argc, &argv));
+      if (n_part < 1) {
+	fprintf(stderr, "Error: number of parts must be positive\n");
+	usage();
+      }
+      break;
+    case 'h':
+      usage();
+      break;
+    default:
+      fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
+      usage();
+    }
+  }
+
+  if (argc != 1) {
+    fprintf(stderr, "Error: %s\n",
+	    argc == 0 ? "no mesh file given" : "too many arguments");
+    usage();
+  }
+  mesh_name = argv[0];
+
+  if (!list && n_part == 0 && node_id < 0 && elem_id < 0) {
+    meshindex_create(mesh_name, step);
+    return 0;
+  }
+
+  if (!meshindex_load(&idx, mesh_name))
+    error_exit(1, "Error: no index of %s up to date; "
+	       "run %s %s first\n", mesh_name, progname(), mesh_name);
+
+  if (list)
+    list_sections(idx);
+  if (n_part > 0)
+    split_sections(idx, n_part);
+  if (node_id >= 0 || elem_id >= 0) {
+    fp = efopen(mesh_name, "r");
+    if (node_id >= 0 && !lookup(idx, fp, NODE, node_id))
+      ret = 1;
+    if (elem_id >= 0 && !lookup(idx, fp, ELEMENT, elem_id))
+      ret = 1;
+    fclose(fp);
+  }
+  meshindex_finalize(idx);
+  return ret;
+}
@@ -6,10 +6,13 @@
  * Last modified: Jun 24, 2013
  *
  */
+#define _POSIX_C_SOURCE 200809L /* for fseeko() */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <sys/types.h>
 #include "meshio.h"
 #include "util.h"
 
@@ -18,6 +21,7 @@ struct MeshIO {
   size_t maxlen;
   FILE *meshfile;
   int header_mode;
+  long long offset; /* bytes read */
 };
 
 enum {INIT_MAXLEN = 1024};
@@ -26,20 +30,21 @@ void meshio_init(MeshIO **mio_p, FILE *fp)
 {
   MeshIO *mio;
 
-  *mio_p = (MeshIO *) emalloc(sizeof(MeshIO));
+  if (fp == NULL)
+    error_exit(2, "Error: meshio_init(NULL)\n");
 
-  mio = *mio_p;
+  /* *mio_p is set last, as in node_init */
+  mio = (MeshIO *) emalloc(sizeof(MeshIO));
 
-  if (fp == NULL) {
-    fprintf(stderr, "Error: meshio_init(NULL)\n");
-    exit(2);
-  }
   mio->meshfile = fp;
 
   mio->line = (char *) emalloc(INIT_MAXLEN * sizeof(char));
   mio->maxlen = INIT_MAXLEN;
 
   mio->header_mode = NONE;
+  mio->offset = 0;
+
+  *mio_p = mio;
 }
 
 void meshio_finalize(MeshIO *mio)
@@ -51,52 +56,81 @@ void meshio_finalize(MeshIO *mio)
   free(mio);
 }
 
+/* type of the section of header line (starting with '!'): either
+   NODE, ELEMENT, NGROUP, EGROUP or OTHER */
+int meshio_header(const char *line)
+{
+  const char *p = line + 1;
+
+  while (isspace(*p))
+    p++;
+  if (strncmp(p, "NODE", 4) == 0)
+    return NODE;
+  else if (strncmp(p, "ELEMENT", 7) == 0)
+    return ELEMENT;
+  else if (strncmp(p, "NGROUP", 6) == 0)
+    return NGROUP;
+  else if (strncmp(p, "EGROUP", 6) == 0)
+    return EGROUP;
+  return OTHER;
+}
+
 /* read a line from mesh file.
    return value is the pointer to the line.
    either COMMENT, HEADER or DATA is set to *mode, and
    either NODE, ELEMENT, NGROUP, EGROUP or OTHER is set to *header */
 char *meshio_readline(MeshIO *mio, int *mode, int *header)
 {
+  size_t len;
+
   if (!fgets(mio->line, mio->maxlen, mio->meshfile))
     return NULL;
 
-  if (strlen(mio->line) == mio->maxlen - 1 &&
-      mio->line[mio->maxlen - 2] != '\n') {
-    fprintf(stderr, "too long line (longer than %lu)\n", mio->maxlen);
-    exit(2);
-  }
+  len = strlen(mio->line);
+  if (len == mio->maxlen - 1 &&
+      mio->line[mio->maxlen - 2] != '\n')
+    error_exit(2, "too long line (longer than %lu)\n",
+	       (unsigned long) mio->maxlen);
+  mio->offset += len;
 
   if (mio->line[0] == '#' ||
       (mio->line[0] == '!' && mio->line[1] == '!'))
     *mode = COMMENT;
   else if (mio->line[0] == '!') {
-    char *p;
-
     *mode = HEADER;
-
-    p = mio->line + 1;
-    while (isspace(*p))
-      p++;
-    if (strncmp(p, "NODE", 4) == 0)
-      *header = NODE;
-    else if (strncmp(p, "ELEMENT", 7) == 0)
-      *header = ELEMENT;
-    else if (strncmp(p, "NGROUP", 6) == 0)
-      *header = NGROUP;
-    else if (strncmp(p, "EGROUP", 6) == 0)
-      *header = EGROUP;
-    else
-      *header = OTHER;
+    *header = meshio_header(mio->line);
     mio->header_mode = *header;
   } else {
     *mode = DATA;
-    if (mio->header_mode == NONE) {
-      fprintf(stderr,
-              "Error: unknown file format (no header before data line)\n");
-      exit(1);
-    }
+    if (mio->header_mode == NONE)
+      error_exit(1, "Error: unknown file format (no header before data line)\n");
     *header = mio->header_mode;
   }
 
   return mio->line;
 }
+
+/* return the number of bytes read so far */
+long long meshio_tell(const MeshIO *mio)
+{
+  return mio->offset;
+}
+
+/* continue reading a file positioned at offset (as returned by
+   meshio_tell) in the data of a section of type header, e.g. when
+   resuming from a checkpoint */
+void meshio_resume(MeshIO *mio, long long offset, int header)
+{
+  mio->offset = offset;
+  mio->header_mode = header;
+}
+
+/* continue reading at offset in the data of a section of type header,
+   e.g. at an offset found in the index of the file (indexdata.h) */
+void meshio_seek(MeshIO *mio, long long offset, int header)
+{
+  if (fseeko(mio->meshfile, (off_t) offset, SEEK_SET) != 0)
+    error_exit(2, "Error: seeking in mesh file failed: %s\n",
+	       strerror(errno));
+  meshio_resume(mio, offset, header);
+}
@@ -11,6 +11,10 @@ typedef struct MeshIO MeshIO;
 
 extern void meshio_init(MeshIO **mio_p, FILE *fp);
 extern void meshio_finalize(MeshIO *mio);
+extern int meshio_header(const char *line);
 extern char *meshio_readline(MeshIO *mio, int *mode, int *header);
+extern long long meshio_tell(const MeshIO *mio);
+extern void meshio_resume(MeshIO *mio, long long offset, int header);
+extern void meshio_seek(MeshIO *mio, long long offset, int header);
 
 #endif /* MESHIO_H */
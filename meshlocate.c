@@ -0,0 +1,193 @@
+/*
+ * meshlocate.c
+ *   Find the elements of a FrontSTR-format mesh containing given points
+ *   and the barycentric coordinates of the points in them
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "meshtools.h"
+#include "util.h"
+
+#define DEFAULT_TOL 1e-6
+
+enum { MAX_POINT_INIT = 1024 };
+
+static void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] MESH [POINTS [OUT]]\n"
+	  "Find the elements of FrontSTR-format mesh file MESH containing "
+	  "the points in\nfile POINTS, or standard input, one \"X Y Z\" "
+	  "on a line.  For each point, the\nelement ID (-1 if none) and "
+	  "the barycentric coordinates of the point for the\n4 corner "
+	  "nodes are written to OUT, or standard output.\n"
+	  "  -e TOL  take points outside the mesh by TOL in barycentric "
+	  "coordinates\n"
+	  "          (default: %g)\n"
+	  "  -j N    locate points with N threads (default: 1)\n"
+	  "  -v      verbose mode\n"
+	  "  -h      display help\n",
+	  progname(), DEFAULT_TOL);
+  exit(1);
+}
+
+static void check(int status)
+{
+  if (status != MT_OK)
+    error_exit(status, "%s", mt_error_message());
+}
+
+/* read the points of fp into *xyz_p; return the number of points */
+static index_t read_points(FILE *fp, coord_t **xyz_p)
+{
+  char line[1024], *p, *q;
+  index_t n = 0, max = MAX_POINT_INIT;
+  coord_t *xyz;
+  double v;
+  int k;
+
+  xyz = (coord_t *) emalloc(3 * max * sizeof(coord_t));
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    p = line;
+    while (*p == ' ' || *p == '\t')
+      p++;
+    if (*p == '#' || *p == '!' || *p == '\n' || *p == '\r' || *p == '\0')
+      continue;
+    if (n == max) {
+      max *= 2;
+      xyz = (coord_t *) erealloc(xyz, 3 * max * sizeof(coord_t));
+    }
+    for (k = 0; k < 3; k++) {
+      while (*p == ' ' || *p == '\t' || *p == ',')
+	p++;
+      v = strtod(p, &q);
+      if (q == p)
+	error_exit(1, "Error: reading point %lld failed\n",
+		   (long long) n + 1);
+      xyz[3*n+k] = (coord_t) v;
+      p = q;
+    }
+    n++;
+  }
+  *xyz_p = xyz;
+  return n;
+}
+
+int main(int argc, char *argv[])
+{
+  int verbose = 0;
+  int n_threads = 1;
+  double tol = DEFAULT_TOL;
+  FILE *points_file, *out_file;
+  MTMesh *mesh;
+  MTLocator *loc;
+  coord_t *xyz;
+  index_t *elem_id, n_point, n_found = 0, i;
+  double *bary;
+  char *end;
+
+  setprogname(argv[0]);
+  argc--;
+  argv++;
+
+  for (; argc > 0; argc--, argv++) {
+    if (argv[0][0] != '-')
+      break;
+    switch (argv[0][1]) {
+    case 'e':
+    case 'j':
+      {
+	int opt = argv[0][1];
+	const char *arg;
+
+	if (argv[0][2] != '\0') {
+	  arg = argv[0] + 2;
+	} else if (argc > 1) {
+	  arg = argv[1];
+	  argc--;
+	  argv++;
+	} else {
+	  fprintf(stderr, "Error: option -%c requires an argument\n", opt);
+	  usage();
+	}
+	if (opt == 'e') {
+	  tol = strtod(arg, &end);
+	  if (end == arg || *end != '\0' || !(tol >= 0)) {
+	    fprintf(stderr, "Error: TOL must be a non-negative number\n");
+	    usage();
+	  }
+	} else {
+	  n_threads = atoi(arg);
+	  if (n_threads < 1) {
+	    fprintf(stderr, "Error: number of threads must be positive\n");
+	    usage();
+	  }
+	}
+      }
+      break;
+    case 'v':
+      verbose++;
+      break;
+    case 'h':
+      usage();
+      break;
+    default:
+      fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
+      usage();
+    }
+  }
+
+  if (argc < 1) {
+    fprintf(stderr, "Error: no mesh file given\n");
+    usage();
+  }
+  if (argc > 3) {
+    fprintf(stderr, "Error: too many arguments\n");
+    usage();
+  }
+
+  if (verbose)
+    print_log(stderr, "Start reading mesh (from %s)...", argv[0]);
+  check(mt_mesh_read_file(&mesh, argv[0]));
+  check(mt_locator_create(mesh, &loc));
+  if (verbose)
+    print_log(stderr, "indexing %lld elements completed.",
+	      (long long) mt_number_of_elems(mesh));
+  mt_mesh_free(mesh);
+
+  points_file = (argc >= 2) ? efopen(argv[1], "r") : stdin;
+  n_point = read_points(points_file, &xyz);
+  if (points_file != stdin) fclose(points_file);
+  if (verbose)
+    print_log(stderr, "reading %lld points completed.", (long long) n_point);
+
+  elem_id = (index_t *) emalloc((n_point + 1) * sizeof(index_t));
+  bary = (double *) emalloc((4 * n_point + 1) * sizeof(double));
+  check(mt_locate(loc, n_point, xyz, tol, n_threads, elem_id, bary));
+  if (verbose)
+    print_log(stderr, "locating points completed.");
+
+  out_file = (argc == 3) ? efopen(argv[2], "w") : stdout;
+  for (i = 0; i < n_point; i++) {
+    fprintf(out_file, "%lld,%.7g,%.7g,%.7g,%.7g\n", (long long) elem_id[i],
+	    bary[4*i], bary[4*i+1], bary[4*i+2], bary[4*i+3]);
+    if (elem_id[i] >= 0)
+      n_found++;
+  }
+  if (out_file != stdout && fclose(out_file) != 0)
+    error_exit(1, "Error: writing %s failed\n", argv[2]);
+
+  if (n_found < n_point)
+    fprintf(stderr, "Warning: %lld of %lld points are not in the mesh\n",
+	    (long long) (n_point - n_found), (long long) n_point);
+
+  mt_locator_free(loc);
+  free(xyz);
+  free(elem_id);
+  free(bary);
+  return 0;
+}
@@ -0,0 +1,610 @@
+/*
+ * meshmerge.c
+ *   Merge coincident nodes of FrontSTR-format mesh data, found by
+ *   hashing the node coordinates into a uniform grid
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
+#include "util.h"
+#include "coordfmt.h"
+#include "largemem.h"
+#include "meshio.h"
+#include "nodedata.h"
+#include "groupdata.h"
+#include "refine.h"
+
+/* number of elements whose nodes are looked up at once, and the
+   largest number of nodes of an element (362: 20) */
+enum { ELEM_BLOCK = 64, MAX_NPE = 20, MIN_BUCKET = 1024 };
+
+void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] [SOURCE [DEST]]\n"
+	  "Merge coincident nodes of FrontSTR-format mesh file SOURCE, "
+	  "or standard input,\ninto mesh file DEST, or standard output.\n"
+	  "Nodes closer than TOL are merged into the one of the smallest "
+	  "ID.\n"
+	  "  -t TOL  distance of nodes to be merged (default: 0, the same "
+	  "coordinates)\n"
+	  "  -j N    search coincident nodes with N threads (default: 1)\n"
+	  "  -v      verbose mode\n"
+	  "  -S      disable reader/writer threads\n"
+	  "  -R      print coordinates in the shortest form reading back "
+	  "exactly\n"
+	  "  -H      allocate large arrays on reserved huge pages\n"
+	  "  -I      interleave large arrays over NUMA nodes\n"
+	  "  -C DIR  take DEST from cache directory DIR if converted before,\n"
+	  "          or store it there (SOURCE and DEST must be files)\n"
+	  "  -X      write the index of DEST to DEST.idx (see meshindex)\n"
+	  "  -h      display help\n",
+	  progname());
+  exit(1);
+}
+
+const char refine_options[] = "t:j:";
+const char input_file_options[] = "";
+const char output_file_options[] = "";
+
+static double tol = 0;
+static int n_threads = 1;
+
+void refine_option(int opt, const char *arg)
+{
+  char *end;
+
+  switch (opt) {
+  case 't':
+    tol = strtod(arg, &end);
+    if (end == arg || *end != '\0' || !(tol >= 0)) {
+      fprintf(stderr, "Error: TOL must be a non-negative number\n");
+      usage();
+    }
+    break;
+  case 'j':
+    n_threads = atoi(arg);
+    if (n_threads < 1) {
+      fprintf(stderr, "Error: number of threads must be positive\n");
+      usage();
+    }
+    break;
+  }
+}
+
+/* Nodes are put in buckets by the grid cell containing them; the cells
+   are at least 2 * tol wide, so the nodes within tol of a node are in
+   at most 2 cells along each axis.  The buckets are linked lists built
+   by the threads with atomic exchanges.  rep[li] is set to the
+   smallest local ID of the nodes within tol of node li, which does not
+   depend on the order of the lists; following rep[] down to a node
+   with rep[li] == li gives the node li is merged into. */
+typedef struct Grid {
+  NodeDB *ndb;
+  index_t n_node;
+  double min[3];
+  double h;          /* cell size */
+  double r;          /* tol, a little enlarged for selecting cells */
+  index_t n_bucket;  /* power of 2 */
+  int shift;         /* 64 - log2(n_bucket) */
+  index_t *head;     /* first node of each bucket, or -1 */
+  index_t *next;     /* next node in the same bucket, or -1 */
+  index_t *rep;
+} Grid;
+
+enum { CLEAR_BUCKETS, FILL_BUCKETS, FIND_REPS };
+
+typedef struct GridJob {
+  Grid *g;
+  int phase;
+  int t;  /* this thread */
+  int n;  /* number of threads */
+} GridJob;
+
+#ifdef USE_PTHREAD
+#define EXCHANGE(p, v) __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL)
+#else
+#define EXCHANGE(p, v) exchange(p, v)
+
+static index_t exchange(index_t *p, index_t v)
+{
+  index_t old = *p;
+  *p = v;
+  return old;
+}
+#endif
+
+static long long cell_of(const Grid *g, int d, double v)
+{
+  return (long long) floor((v - g->min[d]) / g->h);
+}
+
+static index_t bucket_of(const Grid *g, const long long *c)
+{
+  unsigned long long k;
+
+  k = (unsigned long long) c[0] * 0x9E3779B97F4A7C15ULL ^
+    (unsigned long long) c[1] * 0xC2B2AE3D27D4EB4FULL ^
+    (unsigned long long) c[2] * 0x165667B19E3779F9ULL;
+  k ^= k >> 29;
+  return (index_t) ((k * 0x9E3779B97F4A7C15ULL) >> g->shift);
+}
+
+static void node_point(const Grid *g, index_t li, double *p)
+{
+  coord_t x, y, z;
+
+  get_local_node_coord(g->ndb, li, &x, &y, &z);
+  p[0] = x;
+  p[1] = y;
+  p[2] = z;
+}
+
+/* smallest local ID of the nodes within tol of node li */
+static index_t find_rep(const Grid *g, index_t li)
+{
+  double p[3], q[3], dx, dy, dz;
+  long long lo[3], hi[3], c[3];
+  index_t best = li, j;
+  int d;
+
+  node_point(g, li, p);
+  for (d = 0; d < 3; d++) {
+    lo[d] = cell_of(g, d, p[d] - g->r);
+    hi[d] = cell_of(g, d, p[d] + g->r);
+  }
+  for (c[0] = lo[0]; c[0] <= hi[0]; c[0]++)
+    for (c[1] = lo[1]; c[1] <= hi[1]; c[1]++)
+      for (c[2] = lo[2]; c[2] <= hi[2]; c[2]++)
+	for (j = g->head[bucket_of(g, c)]; j >= 0; j = g->next[j]) {
+	  if (j >= best)
+	    continue;
+	  node_point(g, j, q);
+	  dx = q[0] - p[0];
+	  dy = q[1] - p[1];
+	  dz = q[2] - p[2];
+	  if (dx*dx + dy*dy + dz*dz <= tol * tol)
+	    best = j;
+	}
+  return best;
+}
+
+static void *grid_job(void *arg)
+{
+  GridJob *job = (GridJob *) arg;
+  Grid *g = job->g;
+  index_t n, begin, end, i;
+  long long c[3];
+  double p[3];
+  int d;
+
+  n = (job->phase == CLEAR_BUCKETS) ? g->n_bucket : g->n_node;
+  begin = n / job->n * job->t + ((n % job->n) * job->t) / job->n;
+  end = n / job->n * (job->t + 1) + ((n % job->n) * (job->t + 1)) / job->n;
+
+  for (i = begin; i < end; i++) {
+    switch (job->phase) {
+    case CLEAR_BUCKETS:
+      g->head[i] = -1;
+      break;
+    case FILL_BUCKETS:
+      node_point(g, i, p);
+      for (d = 0; d < 3; d++)
+	c[d] = cell_of(g, d, p[d]);
+      g->next[i] = EXCHANGE(&g->head[bucket_of(g, c)], i);
+      break;
+    case FIND_REPS:
+      g->rep[i] = find_rep(g, i);
+      break;
+    }
+  }
+  return NULL;
+}
+
+/* run a phase on n_threads threads; the threads are joined before the
+   next phase, which reads what this one wrote */
+static void run_phase(Grid *g, int phase)
+{
+  GridJob *job;
+  int t;
+
+  job = (GridJob *) emalloc(n_threads * sizeof(GridJob));
+  for (t = 0; t < n_threads; t++) {
+    job[t].g = g;
+    job[t].phase = phase;
+    job[t].t = t;
+    job[t].n = n_threads;
+  }
+#ifdef USE_PTHREAD
+  {
+    pthread_t *thread;
+
+    thread = (pthread_t *) emalloc(n_threads * sizeof(pthread_t));
+    for (t = 1; t < n_threads; t++)
+      if (pthread_create(&thread[t], NULL, grid_job, &job[t]) != 0)
+	error_exit(2, "pthread_create failed\n");
+    grid_job(&job[0]);
+    for (t = 1; t < n_threads; t++)
+      pthread_join(thread[t], NULL);
+    free(thread);
+  }
+#else
+  for (t = 0; t < n_threads; t++)
+    grid_job(&job[t]);
+#endif
+  free(job);
+}
+
+/* find the nodes to be merged: rep[li] is the local ID of the node
+   that node li is merged into (li itself if it is kept).  return rep
+   and set the number of nodes merged into others to *n_merged_p. */
+static index_t *merge_nodes(NodeDB *ndb, index_t *n_merged_p)
+{
+  Grid g;
+  index_t i, n_merged = 0;
+  double p[3], max[3], size = 0;
+  int d;
+
+  /* local IDs in the order of node IDs */
+  sort_node_data(ndb);
+
+  g.ndb = ndb;
+  g.n_node = number_of_nodes(ndb);
+  g.rep = (index_t *) emalloc_large((g.n_node + 1) * sizeof(index_t));
+  if (g.n_node == 0) {
+    *n_merged_p = 0;
+    return g.rep;
+  }
+
+  node_point(&g, 0, g.min);
+  node_point(&g, 0, max);
+  for (i = 1; i < g.n_node; i++) {
+    node_point(&g, i, p);
+    for (d = 0; d < 3; d++) {
+      if (p[d] < g.min[d]) g.min[d] = p[d];
+      if (p[d] > max[d]) max[d] = p[d];
+    }
+  }
+
+  /* about one node in a cell, if they are spread over the box */
+  for (d = 0; d < 3; d++)
+    if (max[d] - g.min[d] > size)
+      size = max[d] - g.min[d];
+  g.h = size / cbrt((double) g.n_node);
+  g.r = tol * 1.001;
+  if (g.h < 2 * g.r)
+    g.h = 2 * g.r;
+  if (g.h == 0)
+    g.h = 1;
+
+  g.n_bucket = MIN_BUCKET;
+  g.shift = 64 - 10;
+  while (g.n_bucket < g.n_node) {
+    g.n_bucket *= 2;
+    g.shift--;
+  }
+  g.head = (index_t *) emalloc_large(g.n_bucket * sizeof(index_t));
+  g.next = (index_t *) emalloc_large(g.n_node * sizeof(index_t));
+
+  run_phase(&g, CLEAR_BUCKETS);
+  run_phase(&g, FILL_BUCKETS);
+  run_phase(&g, FIND_REPS);
+
+  free_large(g.next);
+  free_large(g.head);
+
+  /* rep[i] <= i, so rep[rep[i]] is final when i is reached */
+  for (i = 0; i < g.n_node; i++) {
+    if (g.rep[i] != i) {
+      g.rep[i] = g.rep[g.rep[i]];
+      n_merged++;
+    }
+  }
+  *n_merged_p = n_merged;
+  return g.rep;
+}
+
+/* elements read but not written yet */
+typedef struct ElemBlock {
+  int n_elem;
+  int n_id;
+  long long elem_id[ELEM_BLOCK];
+  int npe[ELEM_BLOCK];
+  index_t n[MAX_NPE*ELEM_BLOCK];
+} ElemBlock;
+
+static void print_header(FILE *to_file, const char *from_file_name)
+{
+  time_t t;
+  time(&t);
+  fprintf(to_file,
+	  "##############################################################\n"
+	  "# FrontSTR mesh file with coincident nodes merged by %s\n"
+	  "# Date: %s"
+	  "# Original mesh: %s\n"
+	  "##############################################################\n",
+	  progname(), ctime(&t), from_file_name);
+}
+
+static void proceed_node_data(const char *line, NodeDB *ndb)
+{
+  long long node_id;
+  coord_t x, y, z;
+
+  if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4) {
+    fprintf(stderr, "Error: reading node data failed\n");
+    exit(1);
+  }
+  new_node(ndb, node_id, x, y, z);
+}
+
+/* merge the nodes read so far and write the ones kept under
+   node_header */
+static index_t *flush_nodes(NodeDB *ndb, const char *node_header,
+			    FILE *to_file, int verbose)
+{
+  index_t *rep, n_node, n_merged, i;
+  coord_t x, y, z;
+
+  reduce_node_data(ndb);
+  rep = merge_nodes(ndb, &n_merged);
+  n_node = number_of_nodes(ndb);
+
+  fprintf(to_file, "%s", node_header);
+  for (i = 0; i < n_node; i++) {
+    if (rep[i] != i)
+      continue;
+    get_local_node_coord(ndb, i, &x, &y, &z);
+    print_node_line(to_file, (long long) get_global_node_id(ndb, i), x, y, z);
+  }
+
+  fprintf(stderr, "%s: %lld of %lld nodes merged (tolerance %g), "
+	  "%lld nodes left\n", progname(), (long long) n_merged,
+	  (long long) n_node, tol, (long long) (n_node - n_merged));
+  if (verbose)
+    print_log(stderr, "merging nodes completed.");
+  return rep;
+}
+
+/* return 1 if the element of local IDs li[npe] has a node twice */
+static int collapsed(const index_t *li, int npe)
+{
+  int i, j;
+
+  for (i = 0; i < npe; i++)
+    for (j = i + 1; j < npe; j++)
+      if (li[i] == li[j])
+	return 1;
+  return 0;
+}
+
+/* write the elements in blk with the nodes replaced by the ones they
+   are merged into; return the number of collapsed elements */
+static index_t flush_elem_block(ElemBlock *blk, NodeDB *ndb,
+				const index_t *rep, FILE *to_file)
+{
+  index_t li[MAX_NPE*ELEM_BLOCK], n_collapsed = 0;
+  int e, k, m = 0;
+
+  lookup_nodes(ndb, blk->n_id, blk->n, li, NULL);
+  for (k = 0; k < blk->n_id; k++)
+    li[k] = rep[li[k]];
+  for (e = 0; e < blk->n_elem; e++) {
+    fprintf(to_file, "%lld", blk->elem_id[e]);
+    for (k = 0; k < blk->npe[e]; k++)
+      fprintf(to_file, ",%lld",
+	      (long long) get_global_node_id(ndb, li[m+k]));
+    fprintf(to_file, "\n");
+    n_collapsed += collapsed(li + m, blk->npe[e]);
+    m += blk->npe[e];
+  }
+  blk->n_elem = 0;
+  blk->n_id = 0;
+  return n_collapsed;
+}
+
+static index_t proceed_elem_data(const char *line, ElemBlock *blk,
+				 NodeDB *ndb, const index_t *rep,
+				 FILE *to_file)
+{
+  const char *p = line;
+  char *q;
+  long long id;
+  int k = -1;
+
+  for (;;) {
+    while (*p == ' ' || *p == '\t' || *p == ',')
+      p++;
+    if (*p == '\0' || *p == '\n' || *p == '\r')
+      break;
+    id = strtoll(p, &q, 10);
+    if (q == p || k == MAX_NPE) {
+      fprintf(stderr, "Error: reading element data failed\n");
+      exit(1);
+    }
+    if (k < 0)
+      blk->elem_id[blk->n_elem] = id;
+    else
+      blk->n[blk->n_id + k] = (index_t) id;
+    k++;
+    p = q;
+  }
+  if (k < 1) {
+    fprintf(stderr, "Error: reading element data failed\n");
+    exit(1);
+  }
+  blk->npe[blk->n_elem++] = k;
+  blk->n_id += k;
+
+  if (blk->n_elem == ELEM_BLOCK)
+    return flush_elem_block(blk, ndb, rep, to_file);
+  return 0;
+}
+
+/* write the members of NGROUP section number grp on line, replaced by
+   the nodes they are merged into and each written once */
+static void proceed_ngroup_data(const char *line, int generate, int grp,
+				NodeDB *ndb, const index_t *rep, int *stamp,
+				FILE *to_file)
+{
+  static index_t *ids = NULL, *li = NULL;
+  static index_t max_ids = 0, max_li = 0;
+  index_t n, i, r;
+
+  n = parse_group_data(line, generate, &ids, &max_ids);
+  if (max_li < max_ids) {
+    max_li = max_ids;
+    li = (index_t *) erealloc(li, max_li * sizeof(index_t));
+  }
+  for (i = 0; i < n; i += ELEM_BLOCK)
+    lookup_nodes(ndb, (n - i < ELEM_BLOCK) ? (int) (n - i) : ELEM_BLOCK,
+		 ids + i, li + i, NULL);
+  for (i = 0; i < n; i++) {
+    r = rep[li[i]];
+    if (stamp[r] == grp)
+      continue;
+    stamp[r] = grp;
+    fprintf(to_file, "%lld\n", (long long) get_global_node_id(ndb, r));
+  }
+}
+
+void refine(FILE *from_file, const char *from_file_name,
+	    FILE *to_file, int verbose)
+{
+  char *line;
+  int mode;
+  int header, header_prev = NONE;
+  MeshIO *mio;
+  NodeDB *nodeDB;
+  char *node_header = NULL;
+  index_t *rep = NULL, n_collapsed = 0, i;
+  int *stamp = NULL;
+  int grp = -1, generate = 0;
+  ElemBlock *blk;
+
+  if (verbose) {
+    print_log(stderr, "Starting node merging (reading from %s)...",
+              from_file_name);
+  }
+
+  print_header(to_file, from_file_name);
+
+  meshio_init(&mio, from_file);
+  node_init(&nodeDB);
+  blk = (ElemBlock *) emalloc(sizeof(ElemBlock));
+  blk->n_elem = 0;
+  blk->n_id = 0;
+
+  while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
+
+    /* keep the order of the output */
+    if (blk->n_elem > 0 && !(mode == DATA && header == ELEMENT))
+      n_collapsed += flush_elem_block(blk, nodeDB, rep, to_file);
+
+    if (mode == COMMENT) {
+      fprintf(to_file, "%s", line);
+      continue;
+    }
+
+    if (mode == HEADER) {
+      if (verbose) {
+	if (header_prev == NODE && header != NODE)
+	  print_log(stderr, "reading NODE-part completed.");
+	else if (header_prev == ELEMENT && header != ELEMENT)
+	  print_log(stderr, "reading ELEMENT-part completed.");
+      }
+
+      /* the nodes of all NODE sections are merged together and written
+	 at the first other section */
+      if (header == NODE) {
+	if (rep != NULL) {
+	  fprintf(stderr, "Error: NODE section after other sections\n");
+	  exit(1);
+	}
+	if (verbose && header_prev != NODE)
+	  print_log(stderr, "Start reading NODE-part...");
+	if (node_header == NULL)
+	  node_header = estrdup(line);
+
+      } else {
+	if (rep == NULL && node_header != NULL)
+	  rep = flush_nodes(nodeDB, node_header, to_file, verbose);
+
+	if (header == ELEMENT) {
+	  if (verbose && header_prev != ELEMENT)
+	    print_log(stderr, "Start reading ELEMENT-part...");
+	  fprintf(to_file, "%s", line);
+
+	} else if (header == NGROUP) {
+	  if (stamp == NULL) {
+	    index_t n_node = number_of_nodes(nodeDB);
+
+	    stamp = (int *) emalloc_large((n_node + 1) * sizeof(int));
+	    for (i = 0; i < n_node; i++)
+	      stamp[i] = -1;
+	  }
+	  grp++;
+	  generate = group_is_generate(line);
+	  print_group_header(to_file, line);
+
+	} else {
+	  fprintf(to_file, "%s", line);
+	}
+      }
+      header_prev = header;
+      continue;
+    }
+
+    assert(mode == DATA);
+
+    if (header == NODE) {
+      proceed_node_data(line, nodeDB);
+
+    } else if (header == ELEMENT) {
+      if (rep == NULL) {
+	fprintf(stderr, "Error: ELEMENT section before NODE section\n");
+	exit(1);
+      }
+      n_collapsed += proceed_elem_data(line, blk, nodeDB, rep, to_file);
+
+    } else if (header == NGROUP) {
+      if (rep == NULL) {
+	fprintf(stderr, "Error: NGROUP section before NODE section\n");
+	exit(1);
+      }
+      proceed_ngroup_data(line, generate, grp, nodeDB, rep, stamp, to_file);
+
+    } else {
+      fprintf(to_file, "%s", line);
+    }
+  }
+  if (blk->n_elem > 0)
+    n_collapsed += flush_elem_block(blk, nodeDB, rep, to_file);
+  if (rep == NULL && node_header != NULL)
+    rep = flush_nodes(nodeDB, node_header, to_file, verbose);
+
+  if (n_collapsed > 0)
+    fprintf(stderr, "Warning: %lld elements have a node twice after merging\n",
+	    (long long) n_collapsed);
+
+  free(blk);
+  free(node_header);
+  if (stamp != NULL)
+    free_large(stamp);
+  if (rep != NULL)
+    free_large(rep);
+  node_finalize(nodeDB);
+  meshio_finalize(mio);
+
+  if (verbose)
+    print_log(stderr, "node merging completed.");
+}
@@ -0,0 +1,758 @@
+/*
+ * meshpart.c
+ *   Partition FrontSTR-format mesh file into domains by recursive
+ *   coordinate bisection, optionally refined on the element face graph
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "util.h"
+#include "coordfmt.h"
+#include "largemem.h"
+#include "meshio.h"
+#include "nodedata.h"
+#include "elemdata.h"
+#include "groupdata.h"
+
+#define MAX_IMBALANCE 0.03
+
+enum { MAX_SEC_INIT = 16, MAX_LINES_INIT = 16, MAX_REFINE_PASS = 10 };
+
+static void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] [SOURCE [PREFIX]]\n"
+	  "Partition FrontSTR-format mesh file SOURCE, "
+	  "or standard input, into domain mesh files "
+	  "PREFIX.<domain>.msh.\n"
+	  "  -n K       number of domains (default: 2)\n"
+	  "  -o PREFIX  prefix of domain mesh files\n"
+	  "  -g         refine the partition on the element face graph\n"
+	  "  -R         print coordinates in the shortest form reading "
+	  "back exactly\n"
+	  "  -H         allocate large arrays on reserved huge pages\n"
+	  "  -I         interleave large arrays over NUMA nodes\n"
+	  "  -v         verbose mode\n"
+	  "  -h         display help\n",
+	  progname());
+  exit(1);
+}
+
+/* a section of the original mesh, reproduced in every domain */
+typedef struct Section {
+  int header;     /* NODE, ELEMENT, NGROUP, EGROUP or OTHER */
+  char *line;     /* header line */
+  int generate;   /* NGROUP/EGROUP has GENERATE option */
+  index_t n;      /* number of members (groups) or data lines (others) */
+  index_t max;
+  index_t *ids;   /* members of NGROUP/EGROUP */
+  char **data;    /* data lines of other sections */
+} Section;
+
+typedef struct SectionList {
+  int n_sec;
+  int max_sec;
+  Section *sec;
+} SectionList;
+
+static Section *new_section(SectionList *sl, int header, const char *line)
+{
+  Section *sp;
+
+  if (sl->n_sec == sl->max_sec) {
+    sl->max_sec = (sl->max_sec > 0) ? 2 * sl->max_sec : MAX_SEC_INIT;
+    sl->sec = (Section *) erealloc(sl->sec, sl->max_sec * sizeof(Section));
+  }
+  sp = &(sl->sec[sl->n_sec++]);
+  sp->header = header;
+  sp->line = estrdup(line);
+  sp->generate = (header == NGROUP || header == EGROUP) ?
+    group_is_generate(line) : 0;
+  sp->n = 0;
+  sp->max = 0;
+  sp->ids = NULL;
+  sp->data = NULL;
+  return sp;
+}
+
+static void proceed_group_data(const char *line, Section *sp)
+{
+  static index_t *ids = NULL;
+  static index_t max_ids = 0;
+  index_t n, i;
+
+  n = parse_group_data(line, sp->generate, &ids, &max_ids);
+  for (i = 0; i < n; i++) {
+    if (sp->n == sp->max) {
+      sp->max = (sp->max > 0) ? 2 * sp->max : MAX_LINES_INIT;
+      sp->ids = (index_t *) erealloc(sp->ids, sp->max * sizeof(index_t));
+    }
+    sp->ids[sp->n++] = ids[i];
+  }
+}
+
+static void proceed_other_data(const char *line, Section *sp)
+{
+  if (sp->n == sp->max) {
+    sp->max = (sp->max > 0) ? 2 * sp->max : MAX_LINES_INIT;
+    sp->data = (char **) erealloc(sp->data, sp->max * sizeof(char *));
+  }
+  sp->data[sp->n++] = estrdup(line);
+}
+
+static void section_finalize(SectionList *sl)
+{
+  int i;
+  index_t j;
+
+  for (i = 0; i < sl->n_sec; i++) {
+    free(sl->sec[i].line);
+    free(sl->sec[i].ids);
+    for (j = 0; sl->sec[i].data != NULL && j < sl->sec[i].n; j++)
+      free(sl->sec[i].data[j]);
+    free(sl->sec[i].data);
+  }
+  free(sl->sec);
+}
+
+static void proceed_node_data(const char *line, NodeDB *ndb)
+{
+  long long node_id;
+  coord_t x, y, z;
+
+  if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4) {
+    fprintf(stderr, "Error: reading node data failed\n");
+    exit(1);
+  }
+  new_node(ndb, node_id, x, y, z);
+}
+
+static void proceed_elem_data(const char *line, ElemDB *eldb)
+{
+  int nret, i;
+  long long elem_id, nl[10], dummy;
+  index_t n[10];
+
+  nret = sscanf(line,
+                "%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld",
+		&elem_id, nl, nl+1, nl+2, nl+3, nl+4,
+		nl+5, nl+6, nl+7, nl+8, nl+9, &dummy);
+  if (nret != nodes_per_elem(eldb) + 1) {
+    fprintf(stderr, "Error: reading element data failed\n");
+    exit(1);
+  }
+  for (i = 0; i < 10; i++) n[i] = nl[i];
+  new_elem(eldb, elem_id, n);
+}
+
+/* centroid of the corner nodes of every element */
+static coord_t *elem_centroid(ElemDB *eldb, NodeDB *ndb)
+{
+  index_t n_elem, i;
+  coord_t *cent;
+  coord_t x, y, z;
+  index_t n[10];
+  int j;
+
+  n_elem = number_of_elems(eldb);
+  cent = (coord_t *) emalloc(3 * n_elem * sizeof(coord_t));
+  for (i = 0; i < n_elem; i++) {
+    get_elem_nodes(eldb, i, n);
+    cent[3*i] = cent[3*i+1] = cent[3*i+2] = 0;
+    for (j = 0; j < 4; j++) {
+      node_coord(ndb, n[j], &x, &y, &z);
+      cent[3*i] += 0.25 * x;
+      cent[3*i+1] += 0.25 * y;
+      cent[3*i+2] += 0.25 * z;
+    }
+  }
+  return cent;
+}
+
+/* order of elements a and b along dim; ties are broken by index
+   so that the partition does not depend on the qsort implementation */
+static int cent_less(const coord_t *cent, int dim, index_t a, index_t b)
+{
+  if (cent[3*a+dim] < cent[3*b+dim]) return 1;
+  if (cent[3*a+dim] > cent[3*b+dim]) return 0;
+  return a < b;
+}
+
+/* reorder idx[] so that idx[k] is the k-th smallest along dim and
+   idx[0..k-1] are not greater than it (Hoare's selection) */
+static void select_nth(index_t *idx, index_t n, index_t k,
+		       const coord_t *cent, int dim)
+{
+  index_t lo = 0, hi = n - 1;
+
+  while (lo < hi) {
+    index_t i = lo, j = hi, pivot = idx[lo + (hi - lo) / 2], tmp;
+
+    while (i <= j) {
+      while (cent_less(cent, dim, idx[i], pivot)) i++;
+      while (cent_less(cent, dim, pivot, idx[j])) j--;
+      if (i <= j) {
+	tmp = idx[i]; idx[i] = idx[j]; idx[j] = tmp;
+	i++;
+	j--;
+      }
+    }
+    if (k <= j) hi = j;
+    else if (k >= i) lo = i;
+    else break;
+  }
+}
+
+/* recursive coordinate bisection of elements idx[0..n-1] into
+   domains part0, ..., part0+npart-1 */
+static void rcb(index_t *idx, index_t n, const coord_t *cent,
+		int *part, int part0, int npart)
+{
+  coord_t min[3], max[3];
+  index_t i, n1;
+  int npart1, dim, d;
+
+  if (npart == 1) {
+    for (i = 0; i < n; i++)
+      part[idx[i]] = part0;
+    return;
+  }
+  if (n == 0) return;
+
+  for (d = 0; d < 3; d++)
+    min[d] = max[d] = cent[3*idx[0]+d];
+  for (i = 1; i < n; i++) {
+    for (d = 0; d < 3; d++) {
+      if (cent[3*idx[i]+d] < min[d]) min[d] = cent[3*idx[i]+d];
+      if (cent[3*idx[i]+d] > max[d]) max[d] = cent[3*idx[i]+d];
+    }
+  }
+  dim = 0;
+  for (d = 1; d < 3; d++)
+    if (max[d] - min[d] > max[dim] - min[dim]) dim = d;
+
+  npart1 = npart / 2;
+  n1 = (index_t) ((double) n * npart1 / npart + 0.5);
+  if (n1 < n)
+    select_nth(idx, n, n1, cent, dim);
+
+  rcb(idx, n1, cent, part, part0, npart1);
+  rcb(idx + n1, n - n1, cent, part, part0 + npart1, npart - npart1);
+}
+
+typedef struct Face {
+  index_t n[3];  /* sorted corner nodes */
+  index_t ef;    /* 4 * element + local face number */
+} Face;
+
+static const int face_node[4][3] = {
+  {0, 1, 2},
+  {0, 1, 3},
+  {0, 2, 3},
+  {1, 2, 3}
+};
+
+static int face_compar(const void *vf1, const void *vf2)
+{
+  const Face *f1, *f2;
+  int i;
+
+  f1 = (Face *) vf1;
+  f2 = (Face *) vf2;
+
+  for (i = 0; i < 3; i++) {
+    if (f1->n[i] < f2->n[i]) return -1;
+    if (f1->n[i] > f2->n[i]) return 1;
+  }
+  return 0;
+}
+
+/* build the element face graph.
+   adj[4*i+k] is the element sharing the k-th face of element i, or -1 */
+static index_t *face_graph(ElemDB *eldb)
+{
+  index_t n_elem, i, *adj;
+  Face *face, *fp;
+  index_t n[10];
+  index_t tmp;
+  int k;
+
+  n_elem = number_of_elems(eldb);
+  face = (Face *) emalloc(4 * n_elem * sizeof(Face));
+  adj = (index_t *) emalloc(4 * n_elem * sizeof(index_t));
+
+  for (i = 0; i < n_elem; i++) {
+    get_elem_nodes(eldb, i, n);
+    for (k = 0; k < 4; k++) {
+      fp = &face[4*i+k];
+      fp->n[0] = n[face_node[k][0]];
+      fp->n[1] = n[face_node[k][1]];
+      fp->n[2] = n[face_node[k][2]];
+      if (fp->n[0] > fp->n[1]) { tmp = fp->n[0]; fp->n[0] = fp->n[1]; fp->n[1] = tmp; }
+      if (fp->n[1] > fp->n[2]) { tmp = fp->n[1]; fp->n[1] = fp->n[2]; fp->n[2] = tmp; }
+      if (fp->n[0] > fp->n[1]) { tmp = fp->n[0]; fp->n[0] = fp->n[1]; fp->n[1] = tmp; }
+      fp->ef = 4*i+k;
+      adj[4*i+k] = -1;
+    }
+  }
+
+  qsort(face, 4 * n_elem, sizeof(Face), face_compar);
+
+  for (i = 0; i + 1 < 4 * n_elem; i++) {
+    if (face_compar(&face[i], &face[i+1]) == 0) {
+      adj[face[i].ef] = face[i+1].ef / 4;
+      adj[face[i+1].ef] = face[i].ef / 4;
+      i++;
+    }
+  }
+  free(face);
+  return adj;
+}
+
+/* number of faces shared by elements in different domains */
+static index_t count_cut(const index_t *adj, index_t n_elem, const int *part)
+{
+  index_t i, cut = 0;
+  int k;
+
+  for (i = 0; i < n_elem; i++)
+    for (k = 0; k < 4; k++)
+      if (adj[4*i+k] > i && part[adj[4*i+k]] != part[i])
+	cut++;
+  return cut;
+}
+
+/* greedy boundary refinement: move an element to the neighbouring
+   domain sharing the most faces with it, as long as this reduces the
+   cut and keeps the domain sizes within MAX_IMBALANCE */
+static void refine_partition(const index_t *adj, index_t n_elem,
+			     int *part, int npart)
+{
+  index_t *size, max_size, i;
+  int pass, moved, k, l, p, q, nq;
+  int nbr[4], cnt[4];
+
+  size = (index_t *) emalloc(npart * sizeof(index_t));
+  for (p = 0; p < npart; p++) size[p] = 0;
+  for (i = 0; i < n_elem; i++) size[part[i]]++;
+  max_size = (index_t) ((1.0 + MAX_IMBALANCE) * n_elem / npart) + 1;
+
+  for (pass = 0; pass < MAX_REFINE_PASS; pass++) {
+    moved = 0;
+    for (i = 0; i < n_elem; i++) {
+      int self = 0, best = -1, best_gain = 0;
+
+      p = part[i];
+      nq = 0;
+      for (k = 0; k < 4; k++) {
+	if (adj[4*i+k] < 0) continue;
+	q = part[adj[4*i+k]];
+	if (q == p) {
+	  self++;
+	  continue;
+	}
+	for (l = 0; l < nq; l++)
+	  if (nbr[l] == q) break;
+	if (l == nq) {
+	  nbr[nq] = q;
+	  cnt[nq++] = 0;
+	}
+	cnt[l]++;
+      }
+      for (l = 0; l < nq; l++) {
+	if (cnt[l] - self > best_gain ||
+	    (best >= 0 && cnt[l] - self == best_gain && nbr[l] < best)) {
+	  best = nbr[l];
+	  best_gain = cnt[l] - self;
+	}
+      }
+      if (best >= 0 && size[best] < max_size && size[p] > 1) {
+	part[i] = best;
+	size[p]--;
+	size[best]++;
+	moved++;
+      }
+    }
+    if (moved == 0) break;
+  }
+  free(size);
+}
+
+static void print_header(FILE *fp, const char *from_file_name,
+			 int dom, int npart)
+{
+  time_t t;
+  time(&t);
+  fprintf(fp,
+	  "##############################################################\n"
+	  "# FrontSTR mesh file of domain %d/%d partitioned by %s\n"
+	  "# Date: %s"
+	  "# Original mesh: %s\n"
+	  "##############################################################\n",
+	  dom, npart, progname(), ctime(&t), from_file_name);
+}
+
+int main(int argc, char *argv[])
+{
+  int verbose = 0;
+  int graph = 0;
+  int npart = 2;
+  FILE *from_file;
+  const char *from_file_name;
+  const char *opt_prefix = NULL;
+  char prefix[1024];
+  char fname[1100];
+  FILE *fp;
+  MeshIO *mio;
+  char *line;
+  int mode, header;
+  NodeDB *nodeDB;
+  ElemDB *elemDB = NULL;
+  SectionList sl = {0, 0, NULL};
+  Section *sp = NULL;
+  index_t n_node, n_elem, i, j, k;
+  int npe, p, q, s;
+  coord_t *cent;
+  index_t *idx, *lnode, *adj = NULL;
+  int *part;
+  index_t *eoff, *eorder;        /* elements of each domain */
+  index_t *ndoff;                /* domains of each node */
+  int *ndpart;
+  index_t *pnoff, *pnode;        /* nodes of each domain */
+  int *stamp;
+  coord_t x, y, z;
+
+  setprogname(argv[0]);
+  argc--;
+  argv++;
+
+  for (; argc > 0; argc--, argv++) {
+    if (argv[0][0] != '-')
+      break;
+    switch (argv[0][1]) {
+    case 'n':
+      if (argv[0][2] != '\0') {
+	npart = atoi(argv[0] + 2);
+      } else if (argc > 1) {
+	npart = atoi(argv[1]);
+	argc--;
+	argv++;
+      } else {
+	fprintf(stderr, "Error: option -n requires an argument\n");
+	usage();
+      }
+      break;
+    case 'o':
+      if (argv[0][2] != '\0') {
+	opt_prefix = argv[0] + 2;
+      } else if (argc > 1) {
+	opt_prefix = argv[1];
+	argc--;
+	argv++;
+      } else {
+	fprintf(stderr, "Error: option -o requires an argument\n");
+	usage();
+      }
+      break;
+    case 'g':
+      graph = 1;
+      break;
+    case 'R':
+      set_coord_format(COORD_SHORTEST);
+      break;
+    case 'H':
+      set_large_mem(get_large_mem() | LARGE_MEM_HUGETLB);
+      break;
+    case 'I':
+      set_large_mem(get_large_mem() | LARGE_MEM_INTERLEAVE);
+      break;
+    case 'v':
+      verbose++;
+      break;
+    case 'h':
+      usage();
+      break;
+    default:
+      fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
+      usage();
+    }
+  }
+
+  if (npart < 1) {
+    fprintf(stderr, "Error: number of domains must be positive\n");
+    usage();
+  }
+
+  if (argc > 2) {
+    fprintf(stderr, "Error: too many arguments\n");
+    usage();
+  }
+
+  if (argc >= 1) {
+    char *ext;
+    from_file = efopen(argv[0], "r");
+    from_file_name = argv[0];
+    snprintf(prefix, sizeof(prefix), "%s", argv[0]);
+    if ((ext = strrchr(prefix, '.')) != NULL && strcmp(ext, ".msh") == 0)
+      *ext = '\0';
+  } else {
+    from_file = stdin;
+    from_file_name = "stdin";
+    strcpy(prefix, "part");
+  }
+  if (argc == 2)
+    opt_prefix = argv[1];
+  if (opt_prefix != NULL)
+    snprintf(prefix, sizeof(prefix), "%s", opt_prefix);
+
+  if (verbose)
+    print_log(stderr, "Start reading mesh (from %s)...", from_file_name);
+
+  meshio_init(&mio, from_file);
+  node_init(&nodeDB);
+
+  while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
+
+    if (mode == COMMENT) continue;
+
+    if (mode == HEADER) {
+      if (header == ELEMENT) {
+	if (elemDB == NULL)
+	  elem_init(&elemDB, line);
+	else if ((strstr(line, "342") != NULL) !=
+		 (nodes_per_elem(elemDB) == 10)) {
+	  fprintf(stderr, "Error: mesh has more than one element type\n");
+	  exit(1);
+	}
+      }
+      sp = new_section(&sl, header, line);
+      continue;
+    }
+
+    assert(mode == DATA);
+
+    if (header == NODE) {
+      proceed_node_data(line, nodeDB);
+
+    } else if (header == ELEMENT) {
+      proceed_elem_data(line, elemDB);
+
+    } else if (header == NGROUP || header == EGROUP) {
+      proceed_group_data(line, sp);
+
+    } else {
+      proceed_other_data(line, sp);
+    }
+  }
+
+  meshio_finalize(mio);
+  if (from_file != stdin) fclose(from_file);
+
+  if (elemDB == NULL) {
+    fprintf(stderr, "Error: no element data\n");
+    exit(1);
+  }
+
+  reduce_node_data(nodeDB);
+  n_node = number_of_nodes(nodeDB);
+  n_elem = number_of_elems(elemDB);
+  npe = nodes_per_elem(elemDB);
+
+  if (verbose)
+    print_log(stderr, "reading mesh completed (%lld nodes, %lld elements).",
+	      (long long) n_node, (long long) n_elem);
+
+  /* partitioning */
+  cent = elem_centroid(elemDB, nodeDB);
+  idx = (index_t *) emalloc(n_elem * sizeof(index_t));
+  part = (int *) emalloc(n_elem * sizeof(int));
+  for (i = 0; i < n_elem; i++)
+    idx[i] = i;
+  rcb(idx, n_elem, cent, part, 0, npart);
+  free(idx);
+  free(cent);
+
+  if (verbose)
+    print_log(stderr, "coordinate bisection completed.");
+
+  if (graph) {
+    adj = face_graph(elemDB);
+    if (verbose)
+      fprintf(stderr, " cut faces before refinement: %lld\n",
+	      (long long) count_cut(adj, n_elem, part));
+    refine_partition(adj, n_elem, part, npart);
+    if (verbose) {
+      fprintf(stderr, " cut faces after refinement: %lld\n",
+	      (long long) count_cut(adj, n_elem, part));
+      print_log(stderr, "graph refinement completed.");
+    }
+    free(adj);
+  }
+
+  /* elements of each domain, in the order of elementID */
+  eoff = (index_t *) emalloc((npart + 1) * sizeof(index_t));
+  eorder = (index_t *) emalloc(n_elem * sizeof(index_t));
+  for (p = 0; p <= npart; p++) eoff[p] = 0;
+  for (i = 0; i < n_elem; i++) eoff[part[i]+1]++;
+  for (p = 0; p < npart; p++) eoff[p+1] += eoff[p];
+  for (i = 0; i < n_elem; i++) eorder[eoff[part[i]]++] = i;
+  for (p = npart; p > 0; p--) eoff[p] = eoff[p-1];
+  eoff[0] = 0;
+
+  /* local node IDs of connectivity */
+  lnode = (index_t *) emalloc(n_elem * npe * sizeof(index_t));
+  for (i = 0; i < n_elem; i++) {
+    get_elem_nodes(elemDB, i, &lnode[npe*i]);
+    for (j = 0; j < npe; j++)
+      lnode[npe*i+j] = get_local_node_id(nodeDB, lnode[npe*i+j]);
+  }
+
+  /* domains of each node */
+  stamp = (int *) emalloc(n_node * sizeof(int));
+  ndoff = (index_t *) emalloc((n_node + 1) * sizeof(index_t));
+  for (i = 0; i < n_node; i++) stamp[i] = -1;
+  for (i = 0; i <= n_node; i++) ndoff[i] = 0;
+  for (p = 0; p < npart; p++)
+    for (k = eoff[p]; k < eoff[p+1]; k++)
+      for (j = 0; j < npe; j++) {
+	index_t li = lnode[npe*eorder[k]+j];
+	if (stamp[li] != p) {
+	  stamp[li] = p;
+	  ndoff[li+1]++;
+	}
+      }
+  for (i = 0; i < n_node; i++) ndoff[i+1] += ndoff[i];
+  ndpart = (int *) emalloc(ndoff[n_node] * sizeof(int));
+  for (i = 0; i < n_node; i++) stamp[i] = -1;
+  for (p = 0; p < npart; p++)
+    for (k = eoff[p]; k < eoff[p+1]; k++)
+      for (j = 0; j < npe; j++) {
+	index_t li = lnode[npe*eorder[k]+j];
+	if (stamp[li] != p) {
+	  stamp[li] = p;
+	  ndpart[ndoff[li]++] = p;
+	}
+      }
+  for (i = n_node; i > 0; i--) ndoff[i] = ndoff[i-1];
+  ndoff[0] = 0;
+  free(lnode);
+
+  /* nodes of each domain, in the order of nodeID */
+  pnoff = (index_t *) emalloc((npart + 1) * sizeof(index_t));
+  pnode = (index_t *) emalloc(ndoff[n_node] * sizeof(index_t));
+  for (p = 0; p <= npart; p++) pnoff[p] = 0;
+  for (k = 0; k < ndoff[n_node]; k++) pnoff[ndpart[k]+1]++;
+  for (p = 0; p < npart; p++) pnoff[p+1] += pnoff[p];
+  for (i = 0; i < n_node; i++)
+    for (k = ndoff[i]; k < ndoff[i+1]; k++)
+      pnode[pnoff[ndpart[k]]++] = i;
+  for (p = npart; p > 0; p--) pnoff[p] = pnoff[p-1];
+  pnoff[0] = 0;
+
+  /* write domain mesh files */
+  for (i = 0; i < n_node; i++) stamp[i] = -1;
+  for (p = 0; p < npart; p++) {
+    int node_done = 0, elem_done = 0;
+    index_t n_bnd = 0;
+
+    for (k = pnoff[p]; k < pnoff[p+1]; k++) {
+      stamp[pnode[k]] = p;
+      if (ndoff[pnode[k]+1] - ndoff[pnode[k]] > 1) n_bnd++;
+    }
+
+    sprintf(fname, "%s.%d.msh", prefix, p);
+    fp = efopen(fname, "w");
+    print_header(fp, from_file_name, p, npart);
+
+    for (s = 0; s < sl.n_sec; s++) {
+      sp = &(sl.sec[s]);
+
+      if (sp->header == NODE) {
+	if (node_done) continue;
+	fprintf(fp, "%s", sp->line);
+	for (k = pnoff[p]; k < pnoff[p+1]; k++) {
+	  index_t id = get_global_node_id(nodeDB, pnode[k]);
+	  node_coord(nodeDB, id, &x, &y, &z);
+	  print_node_line(fp, (long long) id, x, y, z);
+	}
+	node_done = 1;
+
+      } else if (sp->header == ELEMENT) {
+	if (elem_done) continue;
+	fprintf(fp, "%s", sp->line);
+	for (k = eoff[p]; k < eoff[p+1]; k++) {
+	  index_t n[10];
+	  get_elem_nodes(elemDB, eorder[k], n);
+	  fprintf(fp, "%lld", (long long) get_elem_id(elemDB, eorder[k]));
+	  for (j = 0; j < npe; j++)
+	    fprintf(fp, ",%lld", (long long) n[j]);
+	  fprintf(fp, "\n");
+	}
+	elem_done = 1;
+
+	/* partition-boundary nodes shared with each neighbouring domain */
+	for (q = 0; q < npart; q++) {
+	  int found = 0;
+	  if (q == p) continue;
+	  for (k = pnoff[p]; k < pnoff[p+1]; k++) {
+	    index_t li = pnode[k], l;
+	    for (l = ndoff[li]; l < ndoff[li+1]; l++)
+	      if (ndpart[l] == q) break;
+	    if (l == ndoff[li+1]) continue;
+	    if (!found) {
+	      fprintf(fp, "!NGROUP, NGRP=PART_BOUNDARY_%d\n", q);
+	      found = 1;
+	    }
+	    fprintf(fp, "%lld\n", (long long) get_global_node_id(nodeDB, li));
+	  }
+	}
+
+      } else if (sp->header == NGROUP) {
+	print_group_header(fp, sp->line);
+	for (k = 0; k < sp->n; k++)
+	  if (stamp[get_local_node_id(nodeDB, sp->ids[k])] == p)
+	    fprintf(fp, "%lld\n", (long long) sp->ids[k]);
+
+      } else if (sp->header == EGROUP) {
+	print_group_header(fp, sp->line);
+	for (k = 0; k < sp->n; k++)
+	  if (part[get_local_elem_id(elemDB, sp->ids[k])] == p)
+	    fprintf(fp, "%lld\n", (long long) sp->ids[k]);
+
+      } else {
+	fprintf(fp, "%s", sp->line);
+	for (k = 0; k < sp->n; k++)
+	  fprintf(fp, "%s", sp->data[k]);
+      }
+    }
+    fclose(fp);
+
+    printf("domain %d: %lld nodes, %lld elements, %lld boundary nodes\n", p,
+	   (long long) (pnoff[p+1] - pnoff[p]),
+	   (long long) (eoff[p+1] - eoff[p]), (long long) n_bnd);
+    if (verbose)
+      print_log(stderr, "%s written.", fname);
+  }
+
+  free(pnoff);
+  free(pnode);
+  free(ndoff);
+  free(ndpart);
+  free(stamp);
+  free(eoff);
+  free(eorder);
+  free(part);
+  section_finalize(&sl);
+  elem_finalize(elemDB);
+  node_finalize(nodeDB);
+
+  if (verbose)
+    print_large_mem_stat(stderr);
+
+  return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * meshq.c
+ *   Query the mesh loaded by meshd
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "util.h"
+#include "coordfmt.h"
+#include "meshd.h"
+
+static void usage(void)
+{
+  fprintf(stderr,
+	  "Usage: %s [OPTION] MESHFILE COMMAND [ARG]...\n"
+	  "Query the mesh MESHFILE loaded by meshd.\n"
+	  "Commands:\n"
+	  "  count                     print the number of nodes and elements\n"
+	  "  node ID                   print the data line of node ID\n"
+	  "  elem ID                   print the data line of element ID\n"
+	  "  convert adv|vtu DEST      write the mesh to file DEST\n"
+	  "  convert xdmf DEST RAW     write the mesh to files DEST and RAW\n"
+	  "  quality                   print volume and edge ratio statistics\n"
+	  "  shm                       print the name of the shared memory\n"
+	  "                            object holding the mesh\n"
+	  "  stop                      stop the daemon\n"
+	  "Options:\n"
+	  "  -s SOCKET  socket of the daemon (default: MESHFILE.sock; "
+	  "MESHFILE is\n"
+	  "             omitted if given)\n"
+	  "  -h         display help\n",
+	  progname());
+  exit(1);
+}
+
+static int connect_to(const char *path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+    error_exit(1, "Error: socket path too long: %s\n", path);
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+    error_exit(2, "Error: connecting to %s failed: %s\n"
+	       "(is meshd running?)\n", path, strerror(errno));
+  return fd;
+}
+
+static void write_full(int fd, const void *buf, size_t len)
+{
+  const char *p = (const char *) buf;
+  ssize_t r;
+
+  while (len > 0) {
+    r = write(fd, p, len);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      error_exit(2, "Error: sending request failed\n");
+    p += r;
+    len -= r;
+  }
+}
+
+static void read_full(int fd, void *buf, size_t len)
+{
+  char *p = (char *) buf;
+  ssize_t r;
+
+  while (len > 0) {
+    r = read(fd, p, len);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      error_exit(2, "Error: receiving reply failed\n");
+    p += r;
+    len -= r;
+  }
+}
+
+/* send a request and return the reply data (NUL-terminated, to be
+   freed); exit with the status of the daemon on error */
+static char *request(int fd, int op, long long arg,
+		     const char *data, size_t len, MDReply *rep)
+{
+  MDRequest req;
+  char *out;
+
+  req.magic = MESHD_MAGIC;
+  req.op = op;
+  req.arg = arg;
+  req.len = len;
+  write_full(fd, &req, sizeof(MDRequest));
+  write_full(fd, data, len);
+
+  read_full(fd, rep, sizeof(MDReply));
+  out = (char *) emalloc(rep->len + 1);
+  read_full(fd, out, rep->len);
+  out[rep->len] = '\0';
+  if (rep->status != MD_OK) {
+    fputs(out, stderr);
+    exit(rep->status);
+  }
+  return out;
+}
+
+/* name as seen from the daemon, which may run in another directory */
+static char *absolute_path(const char *name)
+{
+  char *cwd, *path;
+  size_t size = 256;
+
+  if (name[0] == '/')
+    return estrdup(name);
+  cwd = (char *) emalloc(size);
+  while (getcwd(cwd, size) == NULL) {
+    if (errno != ERANGE)
+      error_exit(2, "Error: getcwd failed: %s\n", strerror(errno));
+    size *= 2;
+    cwd = (char *) erealloc(cwd, size);
+  }
+  path = (char *) emalloc(strlen(cwd) + strlen(name) + 2);
+  sprintf(path, "%s/%s", cwd, name);
+  free(cwd);
+  return path;
+}
+
+static long long id_arg(int argc, char *argv[])
+{
+  if (argc != 2) {
+    fprintf(stderr, "Error: %s requires an ID\n", argv[0]);
+    usage();
+  }
+  return atoll(argv[1]);
+}
+
+static void convert(int fd, int argc, char *argv[])
+{
+  MDReply rep;
+  char *dest, *raw = NULL, *data;
+  size_t len;
+  int type;
+
+  if (argc < 3) {
+    fprintf(stderr, "Error: convert requires a format and a file\n");
+    usage();
+  }
+  if (strcmp(argv[1], "adv") == 0) {
+    type = MD_ADV;
+  } else if (strcmp(argv[1], "vtu") == 0) {
+    type = MD_VTU;
+  } else if (strcmp(argv[1], "xdmf") == 0) {
+    type = MD_XDMF;
+  } else {
+    fprintf(stderr, "Error: unknown format %s\n", argv[1]);
+    usage();
+  }
+  if (argc != (type == MD_XDMF ? 4 : 3)) {
+    fprintf(stderr, "Error: wrong number of arguments of convert\n");
+    usage();
+  }
+
+  dest = absolute_path(argv[2]);
+  len = strlen(dest);
+  if (type == MD_XDMF) {
+    raw = absolute_path(argv[3]);
+    len += strlen(raw) + 1;
+  }
+  data = (char *) emalloc(len + 1);
+  strcpy(data, dest);
+  if (raw != NULL)
+    strcpy(data + strlen(dest) + 1, raw);
+  free(request(fd, MD_CONVERT, type, data, len, &rep));
+  free(data);
+  free(dest);
+  free(raw);
+}
+
+static void print_quality(const MDQuality *q)
+{
+  printf("elements                  : %lld\n", (long long) q->n_elem);
+  printf("negative volume           : %lld\n", (long long) q->n_negative);
+  if (q->n_elem == 0)
+    return;
+  printf("volume min                : %e (element %lld)\n",
+	 q->vol_min, (long long) q->vol_min_id);
+  printf("volume max                : %e (element %lld)\n",
+	 q->vol_max, (long long) q->vol_max_id);
+  printf("volume average            : %e\n", q->vol_sum / q->n_elem);
+  printf("edge ratio min            : %f\n", q->ratio_min);
+  printf("edge ratio max            : %f (element %lld)\n",
+	 q->ratio_max, (long long) q->ratio_max_id);
+  printf("edge ratio average        : %f\n", q->ratio_sum / q->n_elem);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *sock_opt = NULL;
+  char *sock_name;
+  const char *cmd;
+  MDReply rep;
+  char *out;
+  int fd, j;
+
+  setprogname(argv[0]);
+  argc--;
+  argv++;
+
+  for (; argc > 0; argc--, argv++) {
+    if (argv[0][0] != '-')
+      break;
+    switch (argv[0][1]) {
+    case 's':
+      if (argv[0][2] != '\0') {
+	sock_opt = argv[0] + 2;
+      } else if (argc > 1) {
+	sock_opt = argv[1];
+	argc--;
+	argv++;
+      } else {
+	fprintf(stderr, "Error: option -s requires an argument\n");
+	usage();
+      }
+      break;
+    case 'h':
+      usage();
+      break;
+    default:
+      fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
+      usage();
+    }
+  }
+
+  if (sock_opt != NULL) {
+    sock_name = estrdup(sock_opt);
+  } else {
+    if (argc == 0) {
+      fprintf(stderr, "Error: no mesh file given\n");
+      usage();
+    }
+    sock_name = (char *) emalloc(strlen(argv[0]) + 6);
+    sprintf(sock_name, "%s.sock", argv[0]);
+    argc--;
+    argv++;
+  }
+  if (argc == 0) {
+    fprintf(stderr, "Error: no command given\n");
+    usage();
+  }
+  cmd = argv[0];
+
+  fd = connect_to(sock_name);
+  if (strcmp(cmd, "count") == 0) {
+    int64_t *n;
+
+    out = request(fd, MD_COUNT, 0, NULL, 0, &rep);
+    n = (int64_t *) out;
+    printf("%lld nodes, %lld elements\n", (long long) n[0], (long long) n[1]);
+    free(out);
+
+  } else if (strcmp(cmd, "node") == 0) {
+    long long id = id_arg(argc, argv);
+    double *xyz;
+
+    out = request(fd, MD_NODE, id, NULL, 0, &rep);
+    xyz = (double *) out;
+    print_node_line(stdout, id, xyz[0], xyz[1], xyz[2]);
+    free(out);
+
+  } else if (strcmp(cmd, "elem") == 0) {
+    long long id = id_arg(argc, argv);
+    int64_t *n;
+
+    out = request(fd, MD_ELEM, id, NULL, 0, &rep);
+    n = (int64_t *) out;
+    printf("%lld", id);
+    for (j = 0; j < rep.npe; j++)
+      printf(",%lld", (long long) n[j]);
+    printf("\n");
+    free(out);
+
+  } else if (strcmp(cmd, "convert") == 0) {
+    convert(fd, argc, argv);
+
+  } else if (strcmp(cmd, "quality") == 0) {
+    out = request(fd, MD_QUALITY, 0, NULL, 0, &rep);
+    print_quality((MDQuality *) out);
+    free(out);
+
+  } else if (strcmp(cmd, "shm") == 0) {
+    out = request(fd, MD_SHM, 0, NULL, 0, &rep);
+    printf("%s\n", out);
+    free(out);
+
+  } else if (strcmp(cmd, "stop") == 0) {
+    free(request(fd, MD_STOP, 0, NULL, 0, &rep));
+
+  } else {
+    fprintf(stderr, "Error: unknown command %s\n", cmd);
+    usage();
+  }
+
+  close(fd);
+  free(sock_name);
+  return 0;
+}
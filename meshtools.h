@@ -0,0 +1,64 @@
+#ifndef MESHTOOLS_H
+#define MESHTOOLS_H
+
+/*
+ * libmeshtools: mesh conversions of meshtools on in-memory meshes.
+ *
+ * Every function returns MT_OK or an error code, and never exits; the
+ * message of the last error is returned by mt_error_message().
+ * Programs using the library have to be compiled with the same
+ * USE_INT64/USE_DOUBLE as the library (see mt_index_size() and
+ * mt_coord_size()).  The library is not thread-safe.
+ */
+
+#include <stddef.h>
+#include "precision.h"
+
+enum {
+  MT_OK = 0,
+  MT_EDATA = 1,  /* invalid mesh data */
+  MT_ESYS = 2,   /* memory allocation or I/O failed */
+  MT_EARG = 3    /* invalid argument */
+};
+
+struct MTMesh;
+typedef struct MTMesh MTMesh;
+struct MTLocator;
+typedef struct MTLocator MTLocator;
+
+extern const char *mt_error_message(void);
+extern int mt_index_size(void);
+extern int mt_coord_size(void);
+extern void mt_set_shortest_coords(int on);
+
+extern int mt_mesh_create(MTMesh **mesh_p,
+			  index_t n_node, const index_t *node_id,
+			  const coord_t *coord,
+			  index_t n_elem, int npe, const index_t *elem_id,
+			  const index_t *conn);
+extern int mt_mesh_read(MTMesh **mesh_p, const char *buf, size_t len);
+extern int mt_mesh_read_file(MTMesh **mesh_p, const char *path);
+extern void mt_mesh_free(MTMesh *mesh);
+
+extern index_t mt_number_of_nodes(const MTMesh *mesh);
+extern index_t mt_number_of_elems(const MTMesh *mesh);
+extern int mt_nodes_per_elem(const MTMesh *mesh);
+extern const index_t *mt_node_ids(const MTMesh *mesh);
+extern const coord_t *mt_node_coords(const MTMesh *mesh);
+extern const index_t *mt_elem_ids(const MTMesh *mesh);
+extern const index_t *mt_elem_conn(const MTMesh *mesh);
+
+extern int mt_subdivide(const MTMesh *mesh, MTMesh **out_p);
+extern int mt_refine(const MTMesh *mesh, MTMesh **out_p);
+extern int mt_count(const char *buf, size_t len,
+		    index_t *n_node, index_t *n_elem);
+extern int mt_mesh_write(const MTMesh *mesh, char **buf_p, size_t *len_p);
+extern int mt_convert_adv(const MTMesh *mesh, char **buf_p, size_t *len_p);
+
+extern int mt_locator_create(const MTMesh *mesh, MTLocator **loc_p);
+extern void mt_locator_free(MTLocator *loc);
+extern int mt_locate(const MTLocator *loc, index_t n_point,
+		     const coord_t *xyz, double tol, int n_threads,
+		     index_t *elem_id, double *bary);
+
+#endif /* MESHTOOLS_H */
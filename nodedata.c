@@ -8,50 +8,107 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "nodedata.h"
 #include "util.h"
-
-struct NodeData {
-  index_t id;
-  coord_t x;
-  coord_t y;
-  coord_t z;
-};
-
-typedef struct NodeData NodeData;
-
+#include "largemem.h"
+#include "coordfmt.h"
+#include "checkpoint.h"
+
+/* Node IDs are stored in int while all of them fit, and node_data is
+   converted to index_t when a larger ID is registered.  The kernels
+   in nodekernel.h are compiled for both widths (NodeData32 and
+   NodeData64) and selected by wide. */
 struct NodeDB {
   index_t n_node;
-  NodeData *node_data;
+  void *node_data; /* NodeData32 or NodeData64 */
+  int wide;        /* 1 if node IDs are stored in index_t */
   index_t max_node;
   int issorted;
   index_t n_mnode;
-  NodeData middle_node; /* last added middle node */
+  index_t next_mnid; /* ID of the next new middle node, if set */
+  struct {
+    index_t id;
+    coord_t x;
+    coord_t y;
+    coord_t z;
+  } middle_node; /* last added middle node */
 };
 
+/* number of IDs searched together by find_nodes() */
+enum { LOOKUP_CHUNK = 64 };
+
+#define ID_T int
+#define K(name) name##32
+#include "nodekernel.h"
+#undef ID_T
+#undef K
+
+#define ID_T index_t
+#define K(name) name##64
+#include "nodekernel.h"
+#undef ID_T
+#undef K
+
+#define NODE_SIZE(ndb) \
+  ((ndb)->wide ? sizeof(NodeData64) : sizeof(NodeData32))
+
 enum { MAX_NODE_INIT = 1024, MAX_NODE_GROW = 2 };
 
+/* return 1 if id can be stored in int */
+static int fits_int(index_t id)
+{
+  return (index_t) (int) id == id;
+}
+
+static void set_node(NodeDB *ndb, index_t li, index_t id,
+		     coord_t x, coord_t y, coord_t z)
+{
+  if (ndb->wide)
+    set_node64(ndb, li, id, x, y, z);
+  else
+    set_node32(ndb, li, id, x, y, z);
+}
+
+static index_t node_id(const NodeDB *ndb, index_t li)
+{
+  return ndb->wide ? node_id64(ndb, li) : node_id32(ndb, li);
+}
+
+static void node_xyz(const NodeDB *ndb, index_t li,
+		     coord_t *x, coord_t *y, coord_t *z)
+{
+  if (ndb->wide)
+    node_xyz64(ndb, li, x, y, z);
+  else
+    node_xyz32(ndb, li, x, y, z);
+}
+
 /* initialize node_data */
 void node_init(NodeDB **ndb_p)
 {
   NodeDB *ndb;
 
-  *ndb_p = (NodeDB *) emalloc(sizeof(NodeDB));
-
-  ndb = *ndb_p;
+  /* *ndb_p is set last, so that it is not finalized half made if an
+     allocation fails */
+  ndb = (NodeDB *) emalloc(sizeof(NodeDB));
 
   ndb->n_node = 0;
-  ndb->node_data = (NodeData *) emalloc(MAX_NODE_INIT * sizeof(NodeData));
+  ndb->wide = 0;
+  ndb->node_data = emalloc_large(MAX_NODE_INIT * NODE_SIZE(ndb));
   ndb->max_node = MAX_NODE_INIT;
   ndb->issorted = 1;
   ndb->n_mnode = 0;
+  ndb->next_mnid = 0;
+
+  *ndb_p = ndb;
 }
 
 /* finalize node_data */
 void node_finalize(NodeDB *ndb)
 {
   ndb->n_node = 0;
-  free(ndb->node_data);
+  free_large(ndb->node_data);
   ndb->node_data = NULL;
   ndb->max_node = 0;
   ndb->issorted = 0;
@@ -63,26 +120,53 @@ void node_finalize(NodeDB *ndb)
 /* resize node_data */
 static void resize_node_data(NodeDB *ndb, size_t len)
 {
-  ndb->node_data = (NodeData *) erealloc(ndb->node_data, len * sizeof(NodeData));
+  ndb->node_data = erealloc_large(ndb->node_data, len * NODE_SIZE(ndb));
   ndb->max_node = len;
 }
 
+/* convert node_data to NodeData64 */
+static void widen_node_data(NodeDB *ndb)
+{
+  NodeData32 *nd32 = (NodeData32 *) ndb->node_data;
+  NodeData64 *nd64;
+  index_t i;
+
+  nd64 = (NodeData64 *) emalloc_large(ndb->max_node * sizeof(NodeData64));
+  for (i = 0; i < ndb->n_node; i++) {
+    nd64[i].id = nd32[i].id;
+    nd64[i].x = nd32[i].x;
+    nd64[i].y = nd32[i].y;
+    nd64[i].z = nd32[i].z;
+  }
+  free_large(ndb->node_data);
+  ndb->node_data = nd64;
+  ndb->wide = 1;
+}
+
+/* warnings and progress messages on stderr; off in libmeshtools */
+static int node_messages = 1;
+
+void set_node_messages(int on)
+{
+  node_messages = on;
+}
+
 /* register a new node in node_data */
 void new_node(NodeDB *ndb, index_t id, coord_t x, coord_t y, coord_t z)
 {
+  if (!ndb->wide && !fits_int(id))
+    widen_node_data(ndb);
+
   if (ndb->n_node == ndb->max_node)
     resize_node_data(ndb, ndb->max_node * MAX_NODE_GROW);
 
-  if (ndb->n_node > 0 && ndb->node_data[ndb->n_node-1].id >= id) {
-    fprintf(stderr, "Warning: node id is not sorted\n");
+  if (ndb->n_node > 0 && node_id(ndb, ndb->n_node-1) >= id) {
+    if (ndb->issorted && node_messages)
+      fprintf(stderr, "Warning: node id is not sorted\n");
     ndb->issorted = 0;
   }
 
-  ndb->node_data[ndb->n_node].id = id;
-  ndb->node_data[ndb->n_node].x = x;
-  ndb->node_data[ndb->n_node].y = y;
-  ndb->node_data[ndb->n_node].z = z;
-
+  set_node(ndb, ndb->n_node, id, x, y, z);
   ndb->n_node++;
 }
 
@@ -92,77 +176,124 @@ void reduce_node_data(NodeDB *ndb)
   resize_node_data(ndb, ndb->n_node);
 }
 
-/* node comparison, to be used by bsearch and qsort */
-static int node_compar(const void *vn1, const void *vn2)
+/* remove the nodes of local IDs li with drop[li] set, keeping the
+   order of the others; the local IDs of the others change */
+void compact_node_data(NodeDB *ndb, const char *drop)
 {
-  const NodeData *n1, *n2;
+  char *nd = (char *) ndb->node_data;
+  size_t size = NODE_SIZE(ndb);
+  index_t i, n = 0;
+
+  for (i = 0; i < ndb->n_node; i++) {
+    if (drop[i])
+      continue;
+    if (n < i)
+      memcpy(nd + n * size, nd + i * size, size);
+    n++;
+  }
+  ndb->n_node = n;
+  resize_node_data(ndb, (n > 0) ? n : 1);
+}
 
-  n1 = (NodeData *) vn1;
-  n2 = (NodeData *) vn2;
+/* sort node_data by globalID, if not sorted yet */
+void sort_node_data(NodeDB *ndb)
+{
+  if (!ndb->issorted) {
+    if (node_messages)
+      fprintf(stderr, "start sorting node data... ");
+    if (ndb->wide)
+      sort_nodes64(ndb);
+    else
+      sort_nodes32(ndb);
+    if (node_messages)
+      fprintf(stderr, "done.\n");
+    ndb->issorted = 1;
+  }
+}
+
+/* return the local ID of the node having globalID i1, or -1 */
+static index_t find_node(NodeDB *ndb, index_t i1)
+{
+  sort_node_data(ndb);
 
-  if (n1->id < n2->id) return -1;
-  else if (n1->id == n2->id) return 0;
-  else return 1;
+  return ndb->wide ? find_node64(ndb, i1) : find_node32(ndb, i1);
 }
 
-/* find a node having globalID i1 */
-static NodeData *search_node(NodeDB *ndb, index_t i1)
+/* return the local ID of the node having globalID i1 */
+static index_t search_node(NodeDB *ndb, index_t i1)
 {
-  NodeData node1, *n1p;
+  index_t li1;
 
-  if (!ndb->issorted) {
-    fprintf(stderr, "start sorting node data... ");
-    qsort(ndb->node_data, ndb->n_node, sizeof(NodeData), node_compar);
-    fprintf(stderr, "done.\n");
-    ndb->issorted = 1;
+  li1 = find_node(ndb, i1);
+  if (li1 < 0)
+    error_exit(1, "Error: searching node id failed (node_id may not be sorted)\n"
+	       " could not find data for node %lld\n", (long long) i1);
+  return li1;
+}
+
+/* look up the n nodes having globalIDs ids[] at once: their local IDs
+   are set in li[] and, unless xyz is NULL, their coordinates in
+   xyz[3*n].  Giving all the nodes of a block of elements overlaps the
+   cache misses of the lookups, which dominate on large meshes. */
+void lookup_nodes(NodeDB *ndb, int n, const index_t *ids,
+		  index_t *li, coord_t *xyz)
+{
+  int k, m;
+
+  sort_node_data(ndb);
+
+  for (k = 0; k < n; k += m) {
+    m = (n - k < LOOKUP_CHUNK) ? n - k : LOOKUP_CHUNK;
+    if (ndb->wide)
+      find_nodes64(ndb, m, ids + k, li + k);
+    else
+      find_nodes32(ndb, m, ids + k, li + k);
   }
 
-  node1.id = i1;
-  n1p = bsearch(&node1, ndb->node_data, ndb->n_node, sizeof(NodeData), node_compar);
-  if (n1p == NULL) {
-    fprintf(stderr,
-            "Error: searching node id failed (node_id may not be sorted)\n"
-	    " could not find data for node %lld\n", (long long) i1);
-    exit(1);
+  for (k = 0; k < n; k++) {
+    if (li[k] < 0)
+      error_exit(1, "Error: searching node id failed (node_id may not be sorted)\n"
+		 " could not find data for node %lld\n", (long long) ids[k]);
+    if (xyz != NULL)
+      node_xyz(ndb, li[k], &xyz[3*k], &xyz[3*k+1], &xyz[3*k+2]);
   }
-  return n1p;
 }
 
 /* return a square of distance between two nodes */
 coord_t node_dist2(NodeDB *ndb, index_t i1, index_t i2)
 {
-  NodeData *n1p, *n2p;
+  coord_t x1, y1, z1, x2, y2, z2;
   coord_t dx, dy, dz;
 
-  n1p = search_node(ndb, i1);
-  n2p = search_node(ndb, i2);
-  dx = n1p->x - n2p->x;
-  dy = n1p->y - n2p->y;
-  dz = n1p->z - n2p->z;
+  node_xyz(ndb, search_node(ndb, i1), &x1, &y1, &z1);
+  node_xyz(ndb, search_node(ndb, i2), &x2, &y2, &z2);
+  dx = x1 - x2;
+  dy = y1 - y2;
+  dz = z1 - z2;
   return dx*dx + dy*dy + dz*dz;
 }
 
 coord_t penta_vol(NodeDB *ndb, index_t i0, index_t i1, index_t i2, index_t i3)
 {
-  NodeData *np[4];
+  coord_t p[4][3];
   coord_t v1[3], v2[3], v3[3];
 
-  np[0] = search_node(ndb, i0);
-  np[1] = search_node(ndb, i1);
-  np[2] = search_node(ndb, i2);
-  np[3] = search_node(ndb, i3);
+  node_xyz(ndb, search_node(ndb, i0), &p[0][0], &p[0][1], &p[0][2]);
+  node_xyz(ndb, search_node(ndb, i1), &p[1][0], &p[1][1], &p[1][2]);
+  node_xyz(ndb, search_node(ndb, i2), &p[2][0], &p[2][1], &p[2][2]);
+  node_xyz(ndb, search_node(ndb, i3), &p[3][0], &p[3][1], &p[3][2]);
 
-  v1[0] = np[1]->x - np[0]->x;
-  v1[1] = np[1]->y - np[0]->y;
-  v1[2] = np[1]->z - np[0]->z;
+  v1[0] = p[1][0] - p[0][0];
+  v1[1] = p[1][1] - p[0][1];
+  v1[2] = p[1][2] - p[0][2];
 
-  v2[0] = np[2]->x - np[0]->x;
-  v2[1] = np[2]->y - np[0]->y;
-  v2[2] = np[2]->z - np[0]->z;
+  v2[0] = p[2][0] - p[0][0];
+  v2[1] = p[2][1] - p[0][1];
+  v2[2] = p[2][2] - p[0][2];
 
-  v3[0] = np[3]->x - np[0]->x;
-  v3[1] = np[3]->y - np[0]->y;
-  v3[2] = np[3]->z - np[0]->z;
+  v3[0] = p[3][0] - p[0][0];
+  v3[1] = p[3][1] - p[0][1];
+  v3[2] = p[3][2] - p[0][2];
 
   return ((v1[1] * v2[2] - v1[2] * v2[1]) * v3[0] +
 	  (v1[2] * v2[0] - v1[0] * v2[2]) * v3[1] +
@@ -171,12 +302,26 @@ coord_t penta_vol(NodeDB *ndb, index_t i0, index_t i1, index_t i2, index_t i3)
 
 void node_coord(NodeDB *ndb, index_t id, coord_t *x, coord_t *y, coord_t *z)
 {
-  NodeData *np;
+  node_xyz(ndb, search_node(ndb, id), x, y, z);
+}
+
+/* coordinates of li-th (local) node */
+void get_local_node_coord(const NodeDB *ndb, index_t li,
+			  coord_t *x, coord_t *y, coord_t *z)
+{
+  node_xyz(ndb, li, x, y, z);
+}
 
-  np = search_node(ndb, id);
-  *x = np->x;
-  *y = np->y;
-  *z = np->z;
+/* return 1 if node i1 (globalID) is registered, or 0 if not */
+int has_node(NodeDB *ndb, index_t i1)
+{
+  return find_node(ndb, i1) >= 0;
+}
+
+/* return the number of bits of stored node IDs */
+int node_id_bits(const NodeDB *ndb)
+{
+  return 8 * (int) (ndb->wide ? sizeof(index_t) : sizeof(int));
 }
 
 /* return the number of nodes */
@@ -188,21 +333,13 @@ index_t number_of_nodes(const NodeDB *ndb)
 /* return the local nodeID of node i1 (globalID) */
 index_t get_local_node_id(NodeDB *ndb, index_t i1)
 {
-  index_t li1;
-  li1 = search_node(ndb, i1) - ndb->node_data;
-  if (ndb->node_data[li1].id != i1) {
-    fprintf(stderr, "Error: failed get_local_node_id; "
-	    "(node_data[%lld].id = %lld) != (i1 = %lld)\n",
-	    (long long) li1, (long long) ndb->node_data[li1].id, (long long) i1);
-    exit(1);
-  }
-  return li1;
+  return search_node(ndb, i1);
 }
 
 /* return the global nodeID of node li1 (localID) */
 index_t get_global_node_id(const NodeDB *ndb, index_t li1)
 {
-  return ndb->node_data[li1].id;
+  return node_id(ndb, li1);
 }
 
 
@@ -212,44 +349,118 @@ index_t number_of_middle_nodes(const NodeDB *ndb)
   return ndb->n_mnode;
 }
 
+/* let new middle nodes have IDs not less than id */
+void set_middle_node_base(NodeDB *ndb, index_t id)
+{
+  if (ndb->next_mnid < id)
+    ndb->next_mnid = id;
+}
+
 /* register a middle node between i1 and i2 as a new node */
 index_t new_middle_node(NodeDB *ndb, index_t i1, index_t i2)
 {
-  NodeData *n1p, *n2p;
+  return new_middle_node_local(ndb, search_node(ndb, i1),
+			       search_node(ndb, i2));
+}
 
-  if (ndb->n_mnode == 0)
-    ndb->middle_node.id = ndb->node_data[ndb->n_node-1].id + 1;
-  else
-    ndb->middle_node.id++;
+/* same as new_middle_node, with the local IDs li1 and li2 of the ends */
+index_t new_middle_node_local(NodeDB *ndb, index_t li1, index_t li2)
+{
+  index_t last_id = node_id(ndb, ndb->n_node-1);
+
+  if (ndb->next_mnid <= last_id)
+    ndb->next_mnid = last_id + 1;
+
+  return reuse_middle_node_local(ndb, ndb->next_mnid++, li1, li2);
+}
+
+/* register a middle node between i1 and i2 with the given node-ID,
+   e.g. the one given in the previous refinement */
+index_t reuse_middle_node(NodeDB *ndb, index_t id, index_t i1, index_t i2)
+{
+  return reuse_middle_node_local(ndb, id, search_node(ndb, i1),
+				 search_node(ndb, i2));
+}
+
+/* same as reuse_middle_node, with the local IDs li1 and li2 of the
+   ends */
+index_t reuse_middle_node_local(NodeDB *ndb, index_t id,
+				index_t li1, index_t li2)
+{
+  coord_t x1, y1, z1, x2, y2, z2;
 
-  n1p = search_node(ndb, i1);
-  n2p = search_node(ndb, i2);
+  ndb->middle_node.id = id;
 
-  ndb->middle_node.x = 0.5 * (n1p->x + n2p->x);
-  ndb->middle_node.y = 0.5 * (n1p->y + n2p->y);
-  ndb->middle_node.z = 0.5 * (n1p->z + n2p->z);
+  node_xyz(ndb, li1, &x1, &y1, &z1);
+  node_xyz(ndb, li2, &x2, &y2, &z2);
+
+  ndb->middle_node.x = 0.5 * (x1 + x2);
+  ndb->middle_node.y = 0.5 * (y1 + y2);
+  ndb->middle_node.z = 0.5 * (z1 + z2);
   ndb->n_mnode++;
 
   return ndb->middle_node.id;
 }
 
+/* get node data of the last middle node */
+void get_last_middle_node(const NodeDB *ndb, index_t *id,
+			  coord_t *x, coord_t *y, coord_t *z)
+{
+  *id = ndb->middle_node.id;
+  *x = ndb->middle_node.x;
+  *y = ndb->middle_node.y;
+  *z = ndb->middle_node.z;
+}
+
+/* register the last middle node as a node, so that it can be used as
+   a corner of elements */
+void add_last_middle_node(NodeDB *ndb)
+{
+  new_node(ndb, ndb->middle_node.id, ndb->middle_node.x,
+	   ndb->middle_node.y, ndb->middle_node.z);
+}
+
 /* print node data of the last middle node */
 void print_last_middle_node(const NodeDB *ndb, FILE *fp)
 {
-  fprintf(fp, "%lld,%f,%f,%f\n",
-	  (long long) ndb->middle_node.id,
-	  ndb->middle_node.x,
-	  ndb->middle_node.y,
-	  ndb->middle_node.z);
+  print_node_line(fp, (long long) ndb->middle_node.id,
+		  ndb->middle_node.x, ndb->middle_node.y, ndb->middle_node.z);
 }
 
 /* print node data in Adventure .msh format */
 void print_node_adv(const NodeDB *ndb, FILE *fp)
 {
   index_t i;
-  for (i = 0; i < ndb->n_node; i++)
-    fprintf(fp, "%f %f %f\n",
-	    ndb->node_data[i].x,
-	    ndb->node_data[i].y,
-	    ndb->node_data[i].z);
+  coord_t x, y, z;
+  for (i = 0; i < ndb->n_node; i++) {
+    node_xyz(ndb, i, &x, &y, &z);
+    print_coords(fp, x, y, z);
+  }
+}
+
+/* write node data into a checkpoint */
+void write_node_checkpoint(const NodeDB *ndb, FILE *fp)
+{
+  ckpt_write(fp, &ndb->n_node, sizeof(index_t));
+  ckpt_write(fp, &ndb->wide, sizeof(int));
+  ckpt_write(fp, &ndb->issorted, sizeof(int));
+  ckpt_write(fp, &ndb->n_mnode, sizeof(index_t));
+  ckpt_write(fp, &ndb->next_mnid, sizeof(index_t));
+  ckpt_write(fp, ndb->node_data, ndb->n_node * NODE_SIZE(ndb));
+}
+
+/* read node data written by write_node_checkpoint into ndb, which is
+   just initialized by node_init */
+void read_node_checkpoint(NodeDB *ndb, FILE *fp)
+{
+  ckpt_read(fp, &ndb->n_node, sizeof(index_t));
+  ckpt_read(fp, &ndb->wide, sizeof(int));
+  ckpt_read(fp, &ndb->issorted, sizeof(int));
+  ckpt_read(fp, &ndb->n_mnode, sizeof(index_t));
+  ckpt_read(fp, &ndb->next_mnid, sizeof(index_t));
+
+  free_large(ndb->node_data);
+  ndb->max_node = (ndb->n_node > 0) ? ndb->n_node : MAX_NODE_INIT;
+  ndb->node_data = emalloc_large(ndb->max_node * NODE_SIZE(ndb));
+  ckpt_read(fp, ndb->node_data, ndb->n_node * NODE_SIZE(ndb));
 }
@@ -8,19 +8,38 @@
 struct NodeDB;
 typedef struct NodeDB NodeDB;
 
+extern void set_node_messages(int on);
 extern void node_init(NodeDB **ndb_p);
 extern void node_finalize(NodeDB *ndb);
 extern void new_node(NodeDB *ndb, index_t id, coord_t x, coord_t y, coord_t z);
 extern void reduce_node_data(NodeDB *ndb);
+extern void compact_node_data(NodeDB *ndb, const char *drop);
+extern void sort_node_data(NodeDB *ndb);
 extern coord_t node_dist2(NodeDB *ndb, index_t i1, index_t i2);
 extern coord_t penta_vol(NodeDB *ndb, index_t i0, index_t i1, index_t i2, index_t i3);
 extern void node_coord(NodeDB *ndb, index_t id, coord_t *x, coord_t *y, coord_t *z);
+extern void lookup_nodes(NodeDB *ndb, int n, const index_t *ids,
+			 index_t *li, coord_t *xyz);
+extern void get_local_node_coord(const NodeDB *ndb, index_t li,
+				 coord_t *x, coord_t *y, coord_t *z);
+extern int has_node(NodeDB *ndb, index_t i1);
+extern int node_id_bits(const NodeDB *ndb);
 extern index_t number_of_nodes(const NodeDB *ndb);
 extern index_t get_local_node_id(NodeDB *ndb, index_t i1);
 extern index_t get_global_node_id(const NodeDB *ndb, index_t li1);
 extern index_t number_of_middle_nodes(const NodeDB *ndb);
+extern void set_middle_node_base(NodeDB *ndb, index_t id);
 extern index_t new_middle_node(NodeDB *ndb, index_t i1, index_t i2);
+extern index_t reuse_middle_node(NodeDB *ndb, index_t id, index_t i1, index_t i2);
+extern index_t new_middle_node_local(NodeDB *ndb, index_t li1, index_t li2);
+extern index_t reuse_middle_node_local(NodeDB *ndb, index_t id,
+				       index_t li1, index_t li2);
+extern void get_last_middle_node(const NodeDB *ndb, index_t *id,
+				 coord_t *x, coord_t *y, coord_t *z);
+extern void add_last_middle_node(NodeDB *ndb);
 extern void print_last_middle_node(const NodeDB *ndb, FILE *fp);
 extern void print_node_adv(const NodeDB *ndb, FILE *fp);
+extern void write_node_checkpoint(const NodeDB *ndb, FILE *fp);
+extern void read_node_checkpoint(NodeDB *ndb, FILE *fp);
 
 #endif /* NODEDATA_H */
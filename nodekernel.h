@@ -0,0 +1,116 @@
+/*
+ * nodekernel.h
+ *   Node data kernels for one width of stored node IDs, included by
+ *   nodedata.c with ID_T (type of stored IDs) and K() (name suffix)
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+
+typedef struct K(NodeData) {
+  ID_T id;
+  coord_t x;
+  coord_t y;
+  coord_t z;
+} K(NodeData);
+
+/* node comparison, to be used by bsearch and qsort */
+static int K(node_compar)(const void *vn1, const void *vn2)
+{
+  const K(NodeData) *n1, *n2;
+
+  n1 = (const K(NodeData) *) vn1;
+  n2 = (const K(NodeData) *) vn2;
+
+  if (n1->id < n2->id) return -1;
+  else if (n1->id == n2->id) return 0;
+  else return 1;
+}
+
+static void K(set_node)(NodeDB *ndb, index_t li, index_t id,
+			coord_t x, coord_t y, coord_t z)
+{
+  K(NodeData) *np = (K(NodeData) *) ndb->node_data + li;
+
+  np->id = (ID_T) id;
+  np->x = x;
+  np->y = y;
+  np->z = z;
+}
+
+static index_t K(node_id)(const NodeDB *ndb, index_t li)
+{
+  return ((const K(NodeData) *) ndb->node_data)[li].id;
+}
+
+static void K(node_xyz)(const NodeDB *ndb, index_t li,
+			coord_t *x, coord_t *y, coord_t *z)
+{
+  const K(NodeData) *np = (const K(NodeData) *) ndb->node_data + li;
+
+  *x = np->x;
+  *y = np->y;
+  *z = np->z;
+}
+
+static void K(sort_nodes)(NodeDB *ndb)
+{
+  qsort(ndb->node_data, ndb->n_node, sizeof(K(NodeData)), K(node_compar));
+}
+
+/* local ID of the node having globalID id, or -1 if not found */
+static index_t K(find_node)(const NodeDB *ndb, index_t id)
+{
+  K(NodeData) node1, *n1p;
+
+  node1.id = (ID_T) id;
+  if (node1.id != id)
+    return -1; /* not representable, hence not registered */
+  n1p = bsearch(&node1, ndb->node_data, ndb->n_node, sizeof(K(NodeData)),
+		K(node_compar));
+  if (n1p == NULL)
+    return -1;
+  return n1p - (K(NodeData) *) ndb->node_data;
+}
+
+/* local IDs of the n (at most LOOKUP_CHUNK) nodes having globalIDs
+   ids[], or -1 if not found, set in li[].  The binary searches of all
+   the IDs advance together and the next probe of each is prefetched,
+   so that their cache misses overlap. */
+static void K(find_nodes)(const NodeDB *ndb, int n, const index_t *ids,
+			  index_t *li)
+{
+  const K(NodeData) *nd = (const K(NodeData) *) ndb->node_data;
+  index_t lo[LOOKUP_CHUNK], hi[LOOKUP_CHUNK], mid;
+  int k, active;
+
+  for (k = 0; k < n; k++) {
+    li[k] = -1;
+    lo[k] = 0;
+    /* an ID not representable is not registered */
+    hi[k] = ((ID_T) ids[k] == ids[k]) ? ndb->n_node : 0;
+  }
+  PREFETCH(&nd[ndb->n_node / 2]);
+
+  do {
+    active = 0;
+    for (k = 0; k < n; k++) {
+      if (lo[k] >= hi[k])
+	continue;
+      mid = lo[k] + (hi[k] - lo[k]) / 2;
+      if (nd[mid].id < ids[k]) {
+	lo[k] = mid + 1;
+      } else if (nd[mid].id > ids[k]) {
+	hi[k] = mid;
+      } else {
+	li[k] = mid;
+	hi[k] = lo[k];
+	continue;
+      }
+      if (lo[k] < hi[k]) {
+	PREFETCH(&nd[lo[k] + (hi[k] - lo[k]) / 2]);
+	active = 1;
+      }
+    }
+  } while (active);
+}
@@ -9,8 +9,10 @@ typedef int index_t;
 
 #ifdef USE_DOUBLE
 typedef double coord_t;
+#define SCN_COORD "lf" /* scanf conversion of coord_t */
 #else
 typedef float coord_t;
+#define SCN_COORD "f"
 #endif
 
 #endif /* PRECISION_H */
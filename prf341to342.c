@@ -0,0 +1,663 @@
+/*
+ * prf341to342.c
+ *   Refine partitioned FrontSTR-format 341 mesh data into 342 mesh data
+ *   in parallel with MPI
+ *
+ * Each rank reads SOURCE.<rank>.msh (e.g. written by meshpart) and
+ * writes DEST.<rank>.msh.  Node and element IDs are global.  A middle
+ * node on an edge shared by several ranks gets the same global ID on
+ * all of them: the edge is owned by the lowest rank having it, and
+ * the owner numbers it.  The ranks sharing an edge find each other
+ * through a distributed directory, where a node or an edge is handled
+ * by the rank given by a hash of its IDs.
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <mpi.h>
+#include "util.h"
+#include "coordfmt.h"
+#include "meshio.h"
+#include "nodedata.h"
+#include "edgedata.h"
+#include "elemdata.h"
+
+enum { MAX_MNODE_INIT = 1024, MAX_MNODE_GROW = 2 };
+
+static int myrank, nprocs;
+
+static void usage(void)
+{
+  if (myrank == 0)
+    fprintf(stderr,
+	    "Usage: mpirun -np N %s [OPTION] SOURCE DEST\n"
+	    "Refine partitioned FrontSTR-format 341 mesh files "
+	    "SOURCE.<rank>.msh into "
+	    "342 mesh files DEST.<rank>.msh.\n"
+	    "  -R   print coordinates in the shortest form reading back "
+	    "exactly\n"
+	    "  -v   verbose mode\n"
+	    "  -h   display help\n",
+	    progname());
+  MPI_Finalize();
+  exit(1);
+}
+
+static void print_header(FILE *to_file, const char *from_file_name)
+{
+  time_t t;
+  time(&t);
+  fprintf(to_file,
+	  "##############################################################\n"
+	  "# FrontSTR 342 mesh file refined by %s (domain %d/%d)\n"
+	  "# Date: %s"
+	  "# Original 341 mesh: %s\n"
+	  "# CAUTION: BCs are not applied on middle nodes.\n"
+	  "##############################################################\n",
+	  progname(), myrank, nprocs, ctime(&t), from_file_name);
+}
+
+static void proceed_node_data(const char *line, NodeDB *ndb, FILE *to_file)
+{
+  long long node_id;
+  coord_t x, y, z;
+
+  if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4) {
+    fprintf(stderr, "Error: reading node data failed\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  new_node(ndb, node_id, x, y, z);
+
+  print_node_line(to_file, node_id, x, y, z);
+}
+
+static const int mnid[6][3] = {
+  {1, 2, 4},
+  {0, 2, 5},
+  {0, 1, 6},
+  {0, 3, 7},
+  {1, 3, 8},
+  {2, 3, 9}
+};
+
+/* middle nodes created on this rank, in the order of creation.
+   k-th middle node has the temporary ID first+k and lies between
+   end[2*k] and end[2*k+1] (end[2*k] < end[2*k+1]) */
+typedef struct MiddleNodes {
+  index_t n;
+  index_t max;
+  index_t first;
+  index_t *end;
+  index_t *gid; /* global ID, set by number_middle_nodes() */
+} MiddleNodes;
+
+static void proceed_elem_data(const char *line, EdgeDB *edb, ElemDB *eldb,
+			      MiddleNodes *mn)
+{
+  int nret, i;
+  long long elem_id, nl[4], dummy;
+  index_t n[10];
+
+  nret = sscanf(line,
+                "%lld,%lld,%lld,%lld,%lld,%lld",
+                &elem_id, nl, nl+1, nl+2, nl+3, &dummy);
+  if (nret != 5) {
+    fprintf(stderr, "Error: reading element data failed\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  for (i = 0; i < 4; i++) n[i] = nl[i];
+
+  for (i = 0; i < 6; i++) {
+    index_t i1 = n[mnid[i][0]], i2 = n[mnid[i][1]];
+
+    if (!middle_node(edb, i1, i2, &n[mnid[i][2]]))
+      continue;
+
+    if (mn->n == 0)
+      mn->first = n[mnid[i][2]];
+    if (mn->n == mn->max) {
+      mn->max *= MAX_MNODE_GROW;
+      mn->end = (index_t *) erealloc(mn->end, 2 * mn->max * sizeof(index_t));
+    }
+    mn->end[2*mn->n] = (i1 < i2) ? i1 : i2;
+    mn->end[2*mn->n+1] = (i1 < i2) ? i2 : i1;
+    mn->n++;
+  }
+  new_elem(eldb, elem_id, n);
+}
+
+/*
+ * distributed directory
+ */
+
+/* function computing a reply for each of n records of width w
+   received by the directory; src[i] is the rank which sent record i */
+typedef void (*DirFunc)(const long long *rec, index_t n, int w,
+			const int *src, long long *reply);
+
+/* send n records key[w*i..w*i+w-1] to rank dest[i], let f compute the
+   replies there and return the reply to record i in result[i] */
+static void directory_query(const long long *key, index_t n, int w,
+			    const int *dest, DirFunc f, long long *result)
+{
+  int *scnt, *rcnt, *sdsp, *rdsp, *src;
+  int r, j;
+  index_t i, nrecv, *pos;
+  long long *sbuf, *rbuf, *sreply, *rreply;
+
+  scnt = (int *) emalloc(4 * nprocs * sizeof(int));
+  rcnt = scnt + nprocs;
+  sdsp = rcnt + nprocs;
+  rdsp = sdsp + nprocs;
+
+  for (r = 0; r < nprocs; r++) scnt[r] = 0;
+  for (i = 0; i < n; i++) scnt[dest[i]]++;
+  MPI_Alltoall(scnt, 1, MPI_INT, rcnt, 1, MPI_INT, MPI_COMM_WORLD);
+  sdsp[0] = rdsp[0] = 0;
+  for (r = 1; r < nprocs; r++) {
+    sdsp[r] = sdsp[r-1] + scnt[r-1];
+    rdsp[r] = rdsp[r-1] + rcnt[r-1];
+  }
+  nrecv = rdsp[nprocs-1] + rcnt[nprocs-1];
+
+  /* pack records in the order of destination */
+  pos = (index_t *) emalloc((n + 1) * sizeof(index_t));
+  sbuf = (long long *) emalloc((w * n + 1) * sizeof(long long));
+  for (i = 0; i < n; i++) {
+    pos[i] = sdsp[dest[i]]++;
+    for (j = 0; j < w; j++)
+      sbuf[w*pos[i]+j] = key[w*i+j];
+  }
+  for (r = 0; r < nprocs; r++) {
+    sdsp[r] -= scnt[r];
+    scnt[r] *= w; sdsp[r] *= w;
+    rcnt[r] *= w; rdsp[r] *= w;
+  }
+  rbuf = (long long *) emalloc((w * nrecv + 1) * sizeof(long long));
+  MPI_Alltoallv(sbuf, scnt, sdsp, MPI_LONG_LONG,
+		rbuf, rcnt, rdsp, MPI_LONG_LONG, MPI_COMM_WORLD);
+  for (r = 0; r < nprocs; r++) {
+    scnt[r] /= w; sdsp[r] /= w;
+    rcnt[r] /= w; rdsp[r] /= w;
+  }
+
+  src = (int *) emalloc((nrecv + 1) * sizeof(int));
+  for (r = 0; r < nprocs; r++)
+    for (j = 0; j < rcnt[r]; j++)
+      src[rdsp[r]+j] = r;
+
+  rreply = (long long *) emalloc((nrecv + 1) * sizeof(long long));
+  f(rbuf, nrecv, w, src, rreply);
+
+  /* send replies back */
+  sreply = (long long *) emalloc((n + 1) * sizeof(long long));
+  MPI_Alltoallv(rreply, rcnt, rdsp, MPI_LONG_LONG,
+		sreply, scnt, sdsp, MPI_LONG_LONG, MPI_COMM_WORLD);
+  for (i = 0; i < n; i++)
+    result[i] = sreply[pos[i]];
+
+  free(scnt);
+  free(pos);
+  free(sbuf);
+  free(rbuf);
+  free(src);
+  free(rreply);
+  free(sreply);
+}
+
+/* context of rec_compar() */
+static const long long *cmp_rec;
+static const int *cmp_src;
+static int cmp_w;
+
+/* compare records by key (first two values), then by source rank */
+static int rec_compar(const void *vi1, const void *vi2)
+{
+  index_t i1 = *(const index_t *) vi1, i2 = *(const index_t *) vi2;
+  int j, nk = (cmp_w < 2) ? cmp_w : 2;
+
+  for (j = 0; j < nk; j++) {
+    if (cmp_rec[cmp_w*i1+j] < cmp_rec[cmp_w*i2+j]) return -1;
+    if (cmp_rec[cmp_w*i1+j] > cmp_rec[cmp_w*i2+j]) return 1;
+  }
+  if (cmp_src[i1] != cmp_src[i2]) return (cmp_src[i1] < cmp_src[i2]) ? -1 : 1;
+  return (i1 < i2) ? -1 : (i1 > i2);
+}
+
+/* sort received records; return the permutation */
+static index_t *sort_records(const long long *rec, index_t n, int w,
+			     const int *src)
+{
+  index_t *idx, i;
+
+  idx = (index_t *) emalloc((n + 1) * sizeof(index_t));
+  for (i = 0; i < n; i++) idx[i] = i;
+  cmp_rec = rec;
+  cmp_src = src;
+  cmp_w = w;
+  qsort(idx, n, sizeof(index_t), rec_compar);
+  return idx;
+}
+
+static int same_key(const long long *rec, int w, index_t i1, index_t i2)
+{
+  return rec[w*i1] == rec[w*i2] && (w < 2 || rec[w*i1+1] == rec[w*i2+1]);
+}
+
+/* reply 1 if the node is held by more than one rank */
+static void dir_shared_node(const long long *rec, index_t n, int w,
+			    const int *src, long long *reply)
+{
+  index_t *idx, i, j, k;
+
+  idx = sort_records(rec, n, w, src);
+  for (i = 0; i < n; i = j) {
+    for (j = i + 1; j < n && same_key(rec, w, idx[i], idx[j]); j++);
+    for (k = i; k < j; k++)
+      reply[idx[k]] = (src[idx[i]] != src[idx[j-1]]);
+  }
+  free(idx);
+}
+
+/* reply the owner of the edge, i.e. the lowest rank having it */
+static void dir_edge_owner(const long long *rec, index_t n, int w,
+			   const int *src, long long *reply)
+{
+  index_t *idx, i, j, k;
+
+  idx = sort_records(rec, n, w, src);
+  for (i = 0; i < n; i = j) {
+    for (j = i + 1; j < n && same_key(rec, w, idx[i], idx[j]); j++);
+    for (k = i; k < j; k++)
+      reply[idx[k]] = src[idx[i]];
+  }
+  free(idx);
+}
+
+/* reply the global ID of the middle node given by the owner */
+static void dir_edge_gid(const long long *rec, index_t n, int w,
+			 const int *src, long long *reply)
+{
+  index_t *idx, i, j, k;
+  long long gid;
+
+  idx = sort_records(rec, n, w, src);
+  for (i = 0; i < n; i = j) {
+    gid = -1;
+    for (j = i; j < n && same_key(rec, w, idx[i], idx[j]); j++)
+      if (rec[w*idx[j]+2] >= 0) gid = rec[w*idx[j]+2];
+    for (k = i; k < j; k++)
+      reply[idx[k]] = gid;
+  }
+  free(idx);
+}
+
+static int node_dest(index_t id)
+{
+  return (int) ((unsigned long long) id % (unsigned long long) nprocs);
+}
+
+static int edge_dest(index_t i1, index_t i2)
+{
+  return (int) (((unsigned long long) i1 * 1000003ULL +
+		 (unsigned long long) i2) % (unsigned long long) nprocs);
+}
+
+/* give globally consistent IDs to the middle nodes */
+static void number_middle_nodes(NodeDB *ndb, MiddleNodes *mn, int verbose)
+{
+  index_t n_node, i, k, nc;
+  long long *key, *res;
+  int *dest;
+  char *shared;
+  index_t *cand;
+  long long max_id, base, n_owned, offset, n_total, n_shared, n_shared_all;
+
+  n_node = number_of_nodes(ndb);
+
+  /* global IDs of middle nodes start after the largest node ID */
+  max_id = (n_node > 0) ? get_global_node_id(ndb, n_node - 1) : 0;
+  MPI_Allreduce(&max_id, &base, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+  base++;
+
+  /* nodes on partition boundaries */
+  key = (long long *) emalloc((n_node + 1) * sizeof(long long));
+  res = (long long *) emalloc((n_node + 1) * sizeof(long long));
+  dest = (int *) emalloc((n_node + 1) * sizeof(int));
+  for (i = 0; i < n_node; i++) {
+    key[i] = get_global_node_id(ndb, i);
+    dest[i] = node_dest(key[i]);
+  }
+  directory_query(key, n_node, 1, dest, dir_shared_node, res);
+  shared = (char *) emalloc(n_node + 1);
+  for (i = 0; i < n_node; i++)
+    shared[i] = (char) res[i];
+  free(key);
+  free(res);
+  free(dest);
+
+  /* edges whose ends are both on partition boundaries may be shared */
+  cand = (index_t *) emalloc((mn->n + 1) * sizeof(index_t));
+  nc = 0;
+  for (k = 0; k < mn->n; k++)
+    if (shared[get_local_node_id(ndb, mn->end[2*k])] &&
+	shared[get_local_node_id(ndb, mn->end[2*k+1])])
+      cand[nc++] = k;
+  free(shared);
+
+  key = (long long *) emalloc((3 * nc + 1) * sizeof(long long));
+  res = (long long *) emalloc((nc + 1) * sizeof(long long));
+  dest = (int *) emalloc((nc + 1) * sizeof(int));
+  for (i = 0; i < nc; i++) {
+    key[2*i] = mn->end[2*cand[i]];
+    key[2*i+1] = mn->end[2*cand[i]+1];
+    dest[i] = edge_dest(key[2*i], key[2*i+1]);
+  }
+  directory_query(key, nc, 2, dest, dir_edge_owner, res);
+
+  /* number owned edges in the order of creation */
+  mn->gid = (index_t *) emalloc((mn->n + 1) * sizeof(index_t));
+  for (k = 0; k < mn->n; k++)
+    mn->gid[k] = 0;
+  n_shared = 0;
+  for (i = 0; i < nc; i++) {
+    if (res[i] != myrank) {
+      mn->gid[cand[i]] = -1;
+      n_shared++;
+    }
+  }
+  n_owned = 0;
+  for (k = 0; k < mn->n; k++)
+    if (mn->gid[k] == 0) n_owned++;
+  MPI_Exscan(&n_owned, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  if (myrank == 0) offset = 0;
+  n_owned = 0;
+  for (k = 0; k < mn->n; k++)
+    if (mn->gid[k] == 0)
+      mn->gid[k] = base + offset + n_owned++;
+
+  /* get IDs of edges owned by other ranks */
+  for (i = nc - 1; i >= 0; i--) {
+    long long i1 = key[2*i], i2 = key[2*i+1];
+    key[3*i] = i1;
+    key[3*i+1] = i2;
+    key[3*i+2] = mn->gid[cand[i]];
+  }
+  directory_query(key, nc, 3, dest, dir_edge_gid, res);
+  for (i = 0; i < nc; i++) {
+    if (res[i] < 0) {
+      fprintf(stderr, "Error: middle node between %lld and %lld has no owner\n",
+	      (long long) key[3*i], (long long) key[3*i+1]);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    mn->gid[cand[i]] = res[i];
+  }
+
+  free(key);
+  free(res);
+  free(dest);
+  free(cand);
+
+  if (verbose) {
+    MPI_Reduce(&n_owned, &n_total, 1, MPI_LONG_LONG, MPI_SUM, 0,
+	       MPI_COMM_WORLD);
+    MPI_Reduce(&n_shared, &n_shared_all, 1, MPI_LONG_LONG, MPI_SUM, 0,
+	       MPI_COMM_WORLD);
+    if (myrank == 0)
+      fprintf(stderr,
+	      "number of added nodes (middle nodes) : %lld\n"
+	      " middle nodes numbered by other rank : %lld\n",
+	      n_total, n_shared_all);
+  }
+}
+
+/* context of mnode_compar() */
+static const index_t *cmp_gid;
+
+static int mnode_compar(const void *vk1, const void *vk2)
+{
+  index_t g1 = cmp_gid[*(const index_t *) vk1];
+  index_t g2 = cmp_gid[*(const index_t *) vk2];
+
+  return (g1 < g2) ? -1 : (g1 > g2);
+}
+
+static void print_middle_nodes(NodeDB *ndb, const MiddleNodes *mn,
+			       FILE *to_file)
+{
+  index_t *idx, k;
+  coord_t x1, y1, z1, x2, y2, z2;
+
+  idx = (index_t *) emalloc((mn->n + 1) * sizeof(index_t));
+  for (k = 0; k < mn->n; k++) idx[k] = k;
+  cmp_gid = mn->gid;
+  qsort(idx, mn->n, sizeof(index_t), mnode_compar);
+
+  for (k = 0; k < mn->n; k++) {
+    index_t m = idx[k];
+    coord_t x, y, z;
+
+    node_coord(ndb, mn->end[2*m], &x1, &y1, &z1);
+    node_coord(ndb, mn->end[2*m+1], &x2, &y2, &z2);
+    x = 0.5 * (x1 + x2);
+    y = 0.5 * (y1 + y2);
+    z = 0.5 * (z1 + z2);
+    print_node_line(to_file, (long long) mn->gid[m], x, y, z);
+  }
+  free(idx);
+}
+
+static void print_elements(ElemDB *eldb, const MiddleNodes *mn, FILE *to_file)
+{
+  index_t i, n_elem;
+  index_t n[10];
+  int j;
+
+  fprintf(to_file, "%s", get_elem_header(eldb));
+  n_elem = number_of_elems(eldb);
+  for (i = 0; i < n_elem; i++) {
+    get_elem_nodes(eldb, i, n);
+    fprintf(to_file, "%lld", (long long) get_elem_id(eldb, i));
+    for (j = 0; j < 4; j++)
+      fprintf(to_file, ",%lld", (long long) n[j]);
+    for (j = 4; j < 10; j++)
+      fprintf(to_file, ",%lld", (long long) mn->gid[n[j] - mn->first]);
+    fprintf(to_file, "\n");
+  }
+}
+
+static void refine(FILE *from_file, const char *from_file_name,
+		   FILE *to_file, int verbose)
+{
+  char *line;
+  int mode;
+  int header, header_prev = NONE;
+  MeshIO *mio;
+  NodeDB *nodeDB;
+  EdgeDB *edgeDB = NULL;
+  ElemDB *elemDB = NULL;
+  MiddleNodes mn;
+  FILE *rest_file, *out;
+
+  if (verbose && myrank == 0)
+    print_log(stderr, "Starting mesh-type conversion (reading from %s)...",
+              from_file_name);
+
+  print_header(to_file, from_file_name);
+
+  meshio_init(&mio, from_file);
+  node_init(&nodeDB);
+  rest_file = etmpfile();
+  out = to_file;
+
+  mn.n = 0;
+  mn.max = MAX_MNODE_INIT;
+  mn.first = 0;
+  mn.end = (index_t *) emalloc(2 * mn.max * sizeof(index_t));
+  mn.gid = NULL;
+
+  while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
+
+    if (mode == COMMENT) {
+      fprintf(out, "%s", line);
+      continue;
+    }
+
+    if (mode == HEADER) {
+      if (header_prev == NODE && header != NODE) {
+	reduce_node_data(nodeDB);
+	edge_init(&edgeDB, nodeDB);
+      } else if (header_prev == ELEMENT && header != ELEMENT) {
+	/* the rest is written after the element data */
+	out = rest_file;
+      }
+
+      if (header == ELEMENT) {
+	char *p_elem_type;
+	if (header_prev != ELEMENT && elemDB != NULL) {
+	  fprintf(stderr, "Error: more than one ELEMENT section\n");
+	  MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	p_elem_type = strstr(line, "341");
+	if (p_elem_type == NULL) {
+	  fprintf(stderr, "Error: element type is not \"341\"?\n");
+	  MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	p_elem_type[2] = '2';
+	if (elemDB == NULL)
+	  elem_init(&elemDB, line);
+      } else {
+	fprintf(out, "%s", line);
+      }
+      header_prev = header;
+      continue;
+    }
+
+    assert(mode == DATA);
+
+    if (header == NODE) {
+      proceed_node_data(line, nodeDB, out);
+
+    } else if (header == ELEMENT) {
+      proceed_elem_data(line, edgeDB, elemDB, &mn);
+
+    } else {
+      fprintf(out, "%s", line);
+    }
+  }
+
+  if (edgeDB == NULL || elemDB == NULL) {
+    fprintf(stderr, "Error: no node or element data in %s\n", from_file_name);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  if (verbose && myrank == 0)
+    print_log(stderr, "reading mesh completed; numbering middle nodes...");
+
+  number_middle_nodes(nodeDB, &mn, verbose);
+
+  print_middle_nodes(nodeDB, &mn, to_file);
+  print_elements(elemDB, &mn, to_file);
+  rewind(rest_file);
+  file_copy(rest_file, to_file);
+
+  free(mn.end);
+  free(mn.gid);
+  elem_finalize(elemDB);
+  edge_finalize(edgeDB);
+  node_finalize(nodeDB);
+  meshio_finalize(mio);
+  fclose(rest_file);
+
+  if (verbose && myrank == 0)
+    print_log(stderr, "mesh-type conversion completed.");
+}
+
+/* refine SOURCE.<rank>.msh into DEST.<rank>.msh */
+static void refine_files(const char *source, const char *dest, int verbose)
+{
+  FILE *from_file;
+  char from_file_name[1024];
+  FILE *to_file;
+  char to_file_name[1024];
+  jmp_buf env;
+
+  /* an error on one rank would leave the others waiting in a
+     collective: abort them all */
+  if (setjmp(env) != 0) {
+    fprintf(stderr, "%s", error_message());
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  set_error_handler(&env);
+
+  snprintf(from_file_name, sizeof(from_file_name), "%s.%d.msh", source, myrank);
+  snprintf(to_file_name, sizeof(to_file_name), "%s.%d.msh", dest, myrank);
+  from_file = efopen(from_file_name, "r");
+  to_file = efopen(to_file_name, "w");
+
+  refine(from_file, from_file_name, to_file, verbose);
+
+  fclose(from_file);
+  fclose(to_file);
+  set_error_handler(NULL);
+}
+
+int main(int argc, char *argv[])
+{
+  int verbose = 0;
+  double te_s, te_e;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  te_s = MPI_Wtime();
+
+  setprogname(argv[0]);
+  argc--;
+  argv++;
+
+  for (; argc > 0; argc--, argv++) {
+    if (argv[0][0] != '-')
+      break;
+    switch (argv[0][1]) {
+    case 'v':
+      verbose++;
+      break;
+    case 'R':
+      set_coord_format(COORD_SHORTEST);
+      break;
+    case 'h':
+      usage();
+      break;
+    default:
+      if (myrank == 0)
+	fprintf(stderr, "Error: unknown option -%c\n", argv[0][1]);
+      usage();
+    }
+  }
+
+  if (argc != 2) {
+    if (myrank == 0)
+      fprintf(stderr, "Error: SOURCE and DEST are required\n");
+    usage();
+  }
+
+  refine_files(argv[0], argv[1], verbose);
+
+  if (verbose) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    te_e = MPI_Wtime();
+    if (myrank == 0)
+      fprintf(stderr, " Total time [sec]: %.3f (elapse)\n", te_e - te_s);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
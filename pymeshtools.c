@@ -0,0 +1,498 @@
+/*
+ * pymeshtools.c
+ *   Python extension module 'meshtools' on libmeshtools: the arrays of
+ *   a mesh are exported through the buffer protocol without copying
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include "meshtools.h"
+
+static PyObject *MeshError;
+
+/* raise meshtools.Error(message, status) for the last library error */
+static PyObject *raise_error(int status)
+{
+  PyObject *args;
+
+  args = Py_BuildValue("(si)", mt_error_message(), status);
+  if (args != NULL) {
+    PyErr_SetObject(MeshError, args);
+    Py_DECREF(args);
+  }
+  return NULL;
+}
+
+/*
+ * _Array: read-only view of one array of a Mesh, keeping the Mesh alive
+ */
+
+typedef struct {
+  PyObject_HEAD
+  PyObject *owner;
+  void *data;
+  int ndim;
+  Py_ssize_t itemsize;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+  const char *format;
+} ArrayObject;
+
+static void array_dealloc(ArrayObject *self)
+{
+  Py_XDECREF(self->owner);
+  Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int array_getbuffer(ArrayObject *self, Py_buffer *view, int flags)
+{
+  if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "mesh arrays are read-only");
+    return -1;
+  }
+  view->buf = self->data;
+  view->obj = (PyObject *) self;
+  Py_INCREF(self);
+  view->len = self->shape[0] * self->itemsize;
+  if (self->ndim == 2)
+    view->len *= self->shape[1];
+  view->readonly = 1;
+  view->itemsize = self->itemsize;
+  view->format = (flags & PyBUF_FORMAT) ? (char *) self->format : NULL;
+  view->ndim = self->ndim;
+  view->shape = ((flags & PyBUF_ND) == PyBUF_ND) ? self->shape : NULL;
+  view->strides =
+    ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? self->strides : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
+}
+
+static PyBufferProcs array_as_buffer = {
+  (getbufferproc) array_getbuffer,
+  NULL
+};
+
+static PyTypeObject ArrayType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "meshtools._Array",
+  .tp_basicsize = sizeof(ArrayObject),
+  .tp_dealloc = (destructor) array_dealloc,
+  .tp_as_buffer = &array_as_buffer,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_doc = "buffer exporter of a mesh array",
+};
+
+/* memoryview of data[n][m] (m == 0 for a 1-D array) owned by owner */
+static PyObject *array_view(PyObject *owner, const void *data, int is_index,
+			    Py_ssize_t n, Py_ssize_t m)
+{
+  ArrayObject *a;
+  PyObject *view;
+
+  a = PyObject_New(ArrayObject, &ArrayType);
+  if (a == NULL)
+    return NULL;
+  Py_INCREF(owner);
+  a->owner = owner;
+  a->data = (void *) data;
+  if (is_index) {
+    a->itemsize = sizeof(index_t);
+    a->format = (sizeof(index_t) == 8) ? "q" : "i";
+  } else {
+    a->itemsize = sizeof(coord_t);
+    a->format = (sizeof(coord_t) == 8) ? "d" : "f";
+  }
+  a->ndim = (m > 0) ? 2 : 1;
+  a->shape[0] = n;
+  a->shape[1] = m;
+  a->strides[0] = (m > 0) ? m * a->itemsize : a->itemsize;
+  a->strides[1] = a->itemsize;
+
+  view = PyMemoryView_FromObject((PyObject *) a);
+  Py_DECREF(a);
+  return view;
+}
+
+/*
+ * Mesh
+ */
+
+typedef struct {
+  PyObject_HEAD
+  MTMesh *mesh;
+} MeshObject;
+
+static PyTypeObject MeshType;
+
+static PyObject *mesh_wrap(MTMesh *mesh)
+{
+  MeshObject *self;
+
+  self = PyObject_New(MeshObject, &MeshType);
+  if (self == NULL) {
+    mt_mesh_free(mesh);
+    return NULL;
+  }
+  self->mesh = mesh;
+  return (PyObject *) self;
+}
+
+static void mesh_dealloc(MeshObject *self)
+{
+  mt_mesh_free(self->mesh);
+  Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* get a C-contiguous buffer of index_t (is_index) or coord_t items */
+static int get_array(PyObject *obj, Py_buffer *view, int is_index,
+		     const char *name)
+{
+  const char *f;
+  Py_ssize_t size = is_index ? sizeof(index_t) : sizeof(coord_t);
+
+  if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0)
+    return -1;
+  f = (view->format != NULL) ? view->format : "B";
+  if (*f == '@' || *f == '=' || *f == '<')
+    f++;
+  if (strlen(f) != 1 || view->itemsize != size ||
+      strchr(is_index ? "ilqILQ" : "fd", *f) == NULL) {
+    PyErr_Format(PyExc_TypeError, "%s must be an array of %d-byte %s",
+		 name, (int) size, is_index ? "integers" : "floats");
+    PyBuffer_Release(view);
+    return -1;
+  }
+  return 0;
+}
+
+static PyObject *mesh_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"node_ids", "coords", "elem_ids", "conn", NULL};
+  PyObject *o[4];
+  Py_buffer b[4];
+  Py_ssize_t n_node, n_elem, npe = 0;
+  MTMesh *mesh = NULL;
+  int i, nb = 0, status;
+  PyObject *ret = NULL;
+
+  (void) type;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOOO", kwlist,
+				   &o[0], &o[1], &o[2], &o[3]))
+    return NULL;
+  for (nb = 0; nb < 4; nb++)
+    if (get_array(o[nb], &b[nb], nb != 1, kwlist[nb]) < 0)
+      goto out;
+
+  n_node = b[0].len / b[0].itemsize;
+  n_elem = b[2].len / b[2].itemsize;
+  if (n_elem > 0)
+    npe = b[3].len / b[3].itemsize / n_elem;
+  if (b[1].len / b[1].itemsize != 3 * n_node ||
+      (npe != 4 && npe != 10) ||
+      b[3].len / b[3].itemsize != npe * n_elem) {
+    PyErr_SetString(PyExc_ValueError,
+		    "coords must have 3 values per node and conn "
+		    "4 or 10 per element");
+    goto out;
+  }
+
+  status = mt_mesh_create(&mesh, n_node, (const index_t *) b[0].buf,
+			  (const coord_t *) b[1].buf, n_elem, (int) npe,
+			  (const index_t *) b[2].buf,
+			  (const index_t *) b[3].buf);
+  if (status != MT_OK)
+    raise_error(status);
+  else
+    ret = mesh_wrap(mesh);
+
+ out:
+  for (i = 0; i < nb; i++)
+    PyBuffer_Release(&b[i]);
+  return ret;
+}
+
+static PyObject *mesh_get_node_ids(MeshObject *self, void *closure)
+{
+  (void) closure;
+  return array_view((PyObject *) self, mt_node_ids(self->mesh), 1,
+		    mt_number_of_nodes(self->mesh), 0);
+}
+
+static PyObject *mesh_get_coords(MeshObject *self, void *closure)
+{
+  (void) closure;
+  return array_view((PyObject *) self, mt_node_coords(self->mesh), 0,
+		    mt_number_of_nodes(self->mesh), 3);
+}
+
+static PyObject *mesh_get_elem_ids(MeshObject *self, void *closure)
+{
+  (void) closure;
+  return array_view((PyObject *) self, mt_elem_ids(self->mesh), 1,
+		    mt_number_of_elems(self->mesh), 0);
+}
+
+static PyObject *mesh_get_conn(MeshObject *self, void *closure)
+{
+  (void) closure;
+  return array_view((PyObject *) self, mt_elem_conn(self->mesh), 1,
+		    mt_number_of_elems(self->mesh),
+		    mt_nodes_per_elem(self->mesh));
+}
+
+static PyObject *mesh_get_n_nodes(MeshObject *self, void *closure)
+{
+  (void) closure;
+  return PyLong_FromLongLong(mt_number_of_nodes(self->mesh));
+}
+
+static PyObject *mesh_get_n_elems(MeshObject *self, void *closure)
+{
+  (void) closure;
+  return PyLong_FromLongLong(mt_number_of_elems(self->mesh));
+}
+
+static PyObject *mesh_get_npe(MeshObject *self, void *closure)
+{
+  (void) closure;
+  return PyLong_FromLong(mt_nodes_per_elem(self->mesh));
+}
+
+static PyGetSetDef mesh_getset[] = {
+  {"node_ids", (getter) mesh_get_node_ids, NULL,
+   "node IDs (sorted), read-only memoryview of shape (n_nodes,)", NULL},
+  {"coords", (getter) mesh_get_coords, NULL,
+   "node coordinates, read-only memoryview of shape (n_nodes, 3)", NULL},
+  {"elem_ids", (getter) mesh_get_elem_ids, NULL,
+   "element IDs (sorted), read-only memoryview of shape (n_elems,)", NULL},
+  {"conn", (getter) mesh_get_conn, NULL,
+   "node IDs of the elements, read-only memoryview of shape "
+   "(n_elems, nodes_per_elem)", NULL},
+  {"n_nodes", (getter) mesh_get_n_nodes, NULL, "number of nodes", NULL},
+  {"n_elems", (getter) mesh_get_n_elems, NULL, "number of elements", NULL},
+  {"nodes_per_elem", (getter) mesh_get_npe, NULL,
+   "4 (341) or 10 (342)", NULL},
+  {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyObject *mesh_subdivide(MeshObject *self, PyObject *unused)
+{
+  MTMesh *out;
+  int status;
+
+  (void) unused;
+  if ((status = mt_subdivide(self->mesh, &out)) != MT_OK)
+    return raise_error(status);
+  return mesh_wrap(out);
+}
+
+static PyObject *mesh_refine(MeshObject *self, PyObject *unused)
+{
+  MTMesh *out;
+  int status;
+
+  (void) unused;
+  if ((status = mt_refine(self->mesh, &out)) != MT_OK)
+    return raise_error(status);
+  return mesh_wrap(out);
+}
+
+/* bytes of the buffer returned by f */
+static PyObject *mesh_output(MeshObject *self,
+			     int (*f)(const MTMesh *, char **, size_t *))
+{
+  PyObject *ret;
+  char *buf;
+  size_t len;
+  int status;
+
+  if ((status = f(self->mesh, &buf, &len)) != MT_OK)
+    return raise_error(status);
+  ret = PyBytes_FromStringAndSize(buf, len);
+  free(buf);
+  return ret;
+}
+
+static PyObject *mesh_dumps(MeshObject *self, PyObject *unused)
+{
+  (void) unused;
+  return mesh_output(self, mt_mesh_write);
+}
+
+static PyObject *mesh_adv(MeshObject *self, PyObject *unused)
+{
+  (void) unused;
+  return mesh_output(self, mt_convert_adv);
+}
+
+static PyMethodDef mesh_methods[] = {
+  {"subdivide", (PyCFunction) mesh_subdivide, METH_NOARGS,
+   "subdivide() -> Mesh\n\n"
+   "Subdivide each 342 element into 8 341 elements (as sd342to341)."},
+  {"refine", (PyCFunction) mesh_refine, METH_NOARGS,
+   "refine() -> Mesh\n\n"
+   "Refine a 341 mesh into a 342 mesh by adding middle nodes "
+   "(as rf341to342)."},
+  {"dumps", (PyCFunction) mesh_dumps, METH_NOARGS,
+   "dumps() -> bytes\n\nThe mesh in FrontSTR format."},
+  {"adv", (PyCFunction) mesh_adv, METH_NOARGS,
+   "adv() -> bytes\n\nThe mesh in Adventure format (as fstr2adv)."},
+  {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject MeshType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "meshtools.Mesh",
+  .tp_basicsize = sizeof(MeshObject),
+  .tp_dealloc = (destructor) mesh_dealloc,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_doc =
+  "Mesh(node_ids, coords, elem_ids, conn)\n\n"
+  "Mesh of 341 or 342 elements created by copying the arrays (objects\n"
+  "supporting the buffer protocol, e.g. NumPy arrays, of the sizes\n"
+  "given by index_size() and coord_size()).  node_ids and elem_ids have\n"
+  "to be sorted; conn holds 4 or 10 node IDs of each element.\n"
+  "The arrays of a Mesh are read-only memoryviews of its C arrays;\n"
+  "numpy.asarray() on them does not copy.",
+  .tp_methods = mesh_methods,
+  .tp_getset = mesh_getset,
+  .tp_new = mesh_new,
+};
+
+/*
+ * module functions
+ */
+
+static PyObject *meshtools_read(PyObject *module, PyObject *args)
+{
+  PyObject *path;
+  MTMesh *mesh;
+  int status;
+
+  (void) module;
+  if (!PyArg_ParseTuple(args, "O&", PyUnicode_FSConverter, &path))
+    return NULL;
+  status = mt_mesh_read_file(&mesh, PyBytes_AS_STRING(path));
+  Py_DECREF(path);
+  if (status != MT_OK)
+    return raise_error(status);
+  return mesh_wrap(mesh);
+}
+
+static PyObject *meshtools_loads(PyObject *module, PyObject *args)
+{
+  Py_buffer b;
+  MTMesh *mesh;
+  int status;
+
+  (void) module;
+  if (!PyArg_ParseTuple(args, "y*", &b))
+    return NULL;
+  status = mt_mesh_read(&mesh, (const char *) b.buf, b.len);
+  PyBuffer_Release(&b);
+  if (status != MT_OK)
+    return raise_error(status);
+  return mesh_wrap(mesh);
+}
+
+static PyObject *meshtools_count(PyObject *module, PyObject *args)
+{
+  Py_buffer b;
+  index_t n_node, n_elem;
+  int status;
+
+  (void) module;
+  if (!PyArg_ParseTuple(args, "y*", &b))
+    return NULL;
+  status = mt_count((const char *) b.buf, b.len, &n_node, &n_elem);
+  PyBuffer_Release(&b);
+  if (status != MT_OK)
+    return raise_error(status);
+  return Py_BuildValue("(LL)", (long long) n_node, (long long) n_elem);
+}
+
+static PyObject *meshtools_index_size(PyObject *module, PyObject *unused)
+{
+  (void) module;
+  (void) unused;
+  return PyLong_FromLong(mt_index_size());
+}
+
+static PyObject *meshtools_coord_size(PyObject *module, PyObject *unused)
+{
+  (void) module;
+  (void) unused;
+  return PyLong_FromLong(mt_coord_size());
+}
+
+static PyObject *meshtools_set_shortest_coords(PyObject *module,
+					       PyObject *args)
+{
+  int on;
+
+  (void) module;
+  if (!PyArg_ParseTuple(args, "p", &on))
+    return NULL;
+  mt_set_shortest_coords(on);
+  Py_RETURN_NONE;
+}
+
+static PyMethodDef meshtools_methods[] = {
+  {"read", meshtools_read, METH_VARARGS,
+   "read(path) -> Mesh\n\nRead FrontSTR-format mesh file path."},
+  {"loads", meshtools_loads, METH_VARARGS,
+   "loads(data) -> Mesh\n\nRead FrontSTR-format mesh data (bytes)."},
+  {"count", meshtools_count, METH_VARARGS,
+   "count(data) -> (n_nodes, n_elems)\n\n"
+   "Count the nodes and elements in FrontSTR-format mesh data (as "
+   "meshcount)."},
+  {"index_size", meshtools_index_size, METH_NOARGS,
+   "index_size() -> int\n\nBytes of a node or element ID."},
+  {"coord_size", meshtools_coord_size, METH_NOARGS,
+   "coord_size() -> int\n\nBytes of a coordinate."},
+  {"set_shortest_coords", meshtools_set_shortest_coords, METH_VARARGS,
+   "set_shortest_coords(on)\n\n"
+   "Write coordinates in the shortest form reading back exactly in "
+   "dumps()."},
+  {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef meshtools_module = {
+  PyModuleDef_HEAD_INIT,
+  "meshtools",
+  "Mesh conversions of meshtools (libmeshtools) on in-memory meshes.\n\n"
+  "Errors raise meshtools.Error(message, status), status being 1 for\n"
+  "invalid mesh data, 2 for failed I/O and 3 for an invalid argument.\n"
+  "The library is not thread-safe; the GIL is held during the calls.",
+  -1,
+  meshtools_methods,
+  NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_meshtools(void)
+{
+  PyObject *m;
+
+  if (PyType_Ready(&ArrayType) < 0 || PyType_Ready(&MeshType) < 0)
+    return NULL;
+  m = PyModule_Create(&meshtools_module);
+  if (m == NULL)
+    return NULL;
+
+  MeshError = PyErr_NewException("meshtools.Error", NULL, NULL);
+  Py_XINCREF(MeshError);
+  Py_INCREF(&MeshType);
+  if (MeshError == NULL ||
+      PyModule_AddObject(m, "Error", MeshError) < 0 ||
+      PyModule_AddObject(m, "Mesh", (PyObject *) &MeshType) < 0) {
+    Py_XDECREF(MeshError);
+    Py_DECREF(&MeshType);
+    Py_DECREF(m);
+    return NULL;
+  }
+  return m;
+}
@@ -5,5 +5,24 @@ extern void usage(void);
 extern void refine(FILE *from_file, const char *from_file_name,
 		   FILE *to_file, int verbose);
 
+/* program-specific options, listed as in getopt(): a letter followed
+   by ':' takes an argument (either "-xARG" or "-x ARG").  If '-' is
+   listed, long options "--NAME" are passed with '-' and NAME as the
+   argument.  Each option found is passed to refine_option() before
+   refine() is called. */
+extern const char refine_options[];
+extern void refine_option(int opt, const char *arg);
+
+/* options of refine_options whose argument names a file read besides
+   SOURCE, and ones whose argument names a file written besides DEST.
+   With the cache (-C), the files read are hashed into the key, and the
+   cache is not used if any file is written. */
+extern const char input_file_options[];
+extern const char output_file_options[];
+
+/* name of DEST given to the program, or NULL if writing to standard
+   output; valid while refine() is called */
+extern const char *dest_file_name(void);
+
 
 #endif /* REFINE_H */
@@ -7,17 +7,35 @@
  * Last modified on Jun 24, 2013
  *
  */
+#define _POSIX_C_SOURCE 200809L /* for mmap() */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
 #include "util.h"
+#include "coordfmt.h"
 #include "meshio.h"
 #include "nodedata.h"
 #include "edgedata.h"
+#include "cedgedata.h"
+#include "largemem.h"
+#include "checkpoint.h"
+#include "adjdata.h"
+#include "groupdata.h"
 #include "refine.h"
 
+#define DEFAULT_CKPT_PERIOD 600
+
 void usage(void)
 {
   fprintf(stderr,
@@ -26,12 +44,262 @@ void usage(void)
 	  "or standard input, into "
 	  "342 mesh file DEST, "
 	  "or standard output.\n"
-	  "  -v   verbose mode\n"
-	  "  -h   display help\n",
-	  progname());
+	  "  -r MAP  reuse middle-node IDs saved in MAP by the previous "
+	  "refinement\n"
+	  "  -s MAP  save edge to middle-node map in MAP\n"
+	  "  -i PREV refine only the elements changed since PREV, the DEST of\n"
+	  "          the previous refinement, and copy the rest from it\n"
+	  "          (SOURCE must be a file; not with -r, -s, -c, -f or -a)\n"
+	  "  -j N    create middle nodes with N threads (not with -r, -s or -c)\n"
+	  "  -c FILE write checkpoints to FILE (SOURCE must be a file)\n"
+	  "  -p SEC  write a checkpoint every SEC seconds (default: %d)\n"
+	  "  --resume  continue from the checkpoint given by -c\n"
+	  "  -f      free nodes and edges once all their elements are refined\n"
+	  "          (SOURCE must be a file; not with -r, -s or -c)\n"
+	  "  -a FILE write the node adjacency of DEST to FILE in CSR format\n"
+	  "          (not with -r, -c or -f)\n"
+	  "  -v      verbose mode\n"
+	  "  -S      disable reader/writer threads\n"
+	  "  -R      print coordinates in the shortest form reading back "
+	  "exactly\n"
+	  "  -H      allocate large arrays on reserved huge pages\n"
+	  "  -I      interleave large arrays over NUMA nodes\n"
+	  "  -C DIR  take DEST from cache directory DIR if converted before,\n"
+	  "          or store it there (SOURCE and DEST must be files)\n"
+	  "  -X      write the index of DEST to DEST.idx (see meshindex)\n"
+	  "  -h      display help\n",
+	  progname(), DEFAULT_CKPT_PERIOD);
   exit(1);
 }
 
+const char refine_options[] = "r:s:i:j:c:p:fa:-";
+const char input_file_options[] = "ri";
+const char output_file_options[] = "sa";
+
+static const char *map_in_name = NULL;
+static const char *map_out_name = NULL;
+static const char *prev_name = NULL;
+static int n_threads = 1;
+static const char *ckpt_name = NULL;
+static double ckpt_period = DEFAULT_CKPT_PERIOD;
+static int resume = 0;
+static int stop_after = 0; /* from RF341TO342_STOP, for the tests */
+static int streaming = 0;
+static const char *adj_name = NULL;
+
+void refine_option(int opt, const char *arg)
+{
+  if (opt == 'r')
+    map_in_name = arg;
+  else if (opt == 's')
+    map_out_name = arg;
+  else if (opt == 'i')
+    prev_name = arg;
+  else if (opt == 'j') {
+    n_threads = atoi(arg);
+    if (n_threads < 1) {
+      fprintf(stderr, "Error: invalid number of threads: %s\n", arg);
+      usage();
+    }
+  } else if (opt == 'c')
+    ckpt_name = arg;
+  else if (opt == 'p')
+    ckpt_period = atof(arg);
+  else if (opt == 'f')
+    streaming = 1;
+  else if (opt == 'a')
+    adj_name = arg;
+  else if (opt == '-') {
+    if (strcmp(arg, "resume") == 0) {
+      resume = 1;
+    } else {
+      fprintf(stderr, "Error: unknown option --%s\n", arg);
+      usage();
+    }
+  }
+}
+
+/* flags of the node IDs in the previous output (with -i) */
+enum {
+  PREV_COARSE = 1,   /* a node of the source */
+  PREV_MOVED = 2,    /* a node of the source new or moved */
+  PREV_TOUCHED = 4,  /* a corner of an element refined again */
+  PREV_COPIED = 8,   /* a middle node of an element copied */
+  PREV_REUSED = 16,  /* a middle node created again with its ID */
+  PREV_MIDDLE = 32,  /* a middle node of the previous output */
+  PREV_GROUPED = 64, /* a middle node added to the NGROUPs */
+  PREV_LISTED = 128  /* a node of the previous output */
+};
+
+/* an element line of the previous output */
+struct PrevElem {
+  long long id;
+  long long pos;
+};
+
+typedef struct PrevElem PrevElem;
+
+/* the previous output given by -i, mapped in memory.  An element of the
+   source is copied from it if it has an element of the same ID with the
+   same corners, none of which is new or moved, and the middle nodes of
+   the elements copied are copied with them.  The other elements are
+   refined again, reusing the middle-node IDs of the edges between their
+   corners in the previous output, so that the output is the same as
+   with -r, except for the order of the middle nodes.  A node is taken as
+   moved if its line in DEST changes, which is checked by formatting it
+   as the line would be printed. */
+struct PrevMesh {
+  char *buf;
+  long long size;
+  unsigned char *flag;  /* flag[node ID]: PREV_* */
+  long long n_id;       /* size of flag */
+  long long max_id;     /* largest node ID in the previous output */
+  int n_range;
+  int max_range;
+  long long *range;     /* begin and end of the data of each NODE section */
+  PrevElem *elem;       /* element lines, sorted by ID */
+  index_t n_elem;
+  index_t max_elem;
+  index_t cursor;       /* next to the element found last */
+  long long *pos;       /* pos[i]: line of the i-th element of the source
+			   to be copied, or -1 if it is refined */
+  index_t n_pos;
+  index_t max_pos;
+  index_t n_read;       /* elements of the source read so far */
+  index_t n_elem_copied;
+};
+
+typedef struct PrevMesh PrevMesh;
+
+/* changes from the previous refinement (with -r) */
+struct IncStat {
+  char *changed; /* changed[local node ID] is 1 if the node is new or moved */
+  index_t new_mnid; /* middle nodes not in the map have IDs from this */
+  index_t n_node_moved;
+  index_t n_node_removed;
+  index_t n_edge_removed;
+  index_t n_elem;
+  index_t n_elem_affected;
+  PrevMesh *prev; /* the previous output (with -i) */
+};
+
+typedef struct IncStat IncStat;
+
+/* number of elements whose nodes are looked up at once */
+enum { ELEM_BLOCK = 64 };
+
+/* elements read but not refined yet */
+struct ElemBlock {
+  int n_elem;
+  long long elem_id[ELEM_BLOCK];
+  index_t n[ELEM_BLOCK][4];
+};
+
+typedef struct ElemBlock ElemBlock;
+
+/* elements kept in memory to be refined by threads (with -j) */
+struct ElemList {
+  index_t n_elem;
+  index_t max_elem;
+  long long *elem_id;
+  index_t *c; /* 4 corner nodes per element */
+  index_t *e; /* 6 edges (in CEdgeDB) per element */
+  long long n_done; /* number of elements refined before */
+  int n_hdr;
+  int max_hdr;
+  char **hdr; /* ELEMENT header lines */
+  index_t *hdr_at; /* number of elements before each header line */
+};
+
+typedef struct ElemList ElemList;
+
+/* range of elements whose edges are registered by a thread */
+struct EdgeJob {
+  ElemList *list;
+  NodeDB *ndb;
+  CEdgeDB *cedb;
+  index_t begin;
+  index_t end;
+  int full; /* 1 if the edge table got full */
+};
+
+typedef struct EdgeJob EdgeJob;
+
+/* checkpointing (with -c).  The output before the end of the ELEMENT
+   part and the elements are written to files named after the
+   checkpoint, instead of to_file and a temporary file, so that they
+   can be cut back to a checkpoint; they are copied to to_file at the
+   end of the ELEMENT part. */
+struct Checkpoint {
+  char *node_name; /* output other than the elements */
+  char *elem_name; /* elements */
+  long long in_size; /* size of the source file */
+  double last; /* time of the last checkpoint */
+  int n_written; /* checkpoints written by this run */
+};
+
+typedef struct Checkpoint Checkpoint;
+
+/* IDs of middle nodes, growing as needed */
+struct MidList {
+  index_t n;
+  index_t max;
+  index_t *id;
+};
+
+typedef struct MidList MidList;
+
+/* streaming (with -f): the elements using each node are counted in a
+   pre-pass over the source, and a node is removed with its edges once
+   they are all refined.  Memory for the edges is then proportional to
+   the nodes on the front between the refined elements and the others,
+   if the elements are ordered roughly in space. */
+struct Frontier {
+  int *remain;     /* remain[local ID]: elements using the node not
+		      refined yet, negated once one of them is refined */
+  index_t n_done;  /* nodes with remain 0 not removed yet */
+  index_t n_front; /* nodes with remain < 0 */
+  index_t max_front;
+  index_t n_node;  /* nodes before removing any */
+  int n_compact;
+  int n_group;     /* NGROUP sections after the ELEMENT part */
+  int n_word;      /* words of group bits per node */
+  unsigned long long *group; /* bit g of group[n_word * local ID + g / 64]
+				is set if the node is in group g */
+  MidList *mid;    /* middle nodes of each group created so far */
+};
+
+typedef struct Frontier Frontier;
+
+enum { NAME_LEN = 64 };
+
+/* NGROUPs extended to the middle nodes: a middle node is added to a
+   group given after the ELEMENT part if both ends of its edge are in
+   the group, in a section of the same name following the group.  The
+   members are marked over the local node IDs, and the edges between
+   them are taken from the edge table at the end of the section.  While
+   streaming, the edges are gone by then; the groups of each node are
+   read as bits in the pre-pass instead, and the middle nodes are
+   collected as they are created. */
+struct NodeGroups {
+  char name[NAME_LEN]; /* group of the current section, "" if none */
+  int generate;
+  int n_group;         /* NGROUP sections after the ELEMENT part */
+  char *mark;          /* mark[local ID] is 1 for the members */
+  index_t n_member;
+  index_t max_member;
+  index_t *member;     /* local IDs of the members */
+  index_t *ids;        /* IDs on a data line */
+  index_t max_ids;
+  MidList mid;
+};
+
+typedef struct NodeGroups NodeGroups;
+
+/* nodes are removed when at least this many or half of the nodes kept
+   are done, so that the time for removal stays linear */
+enum { MIN_COMPACT = 4096 };
+
 static void print_header(FILE *to_file, const char *from_file_name)
 {
   time_t t;
@@ -41,7 +309,7 @@ static void print_header(FILE *to_file, const char *from_file_name)
 	  "# FrontSTR 342 mesh file refined by %s\n"
 	  "# Date: %s"
 	  "# Original 341 mesh: %s\n"
-	  "# CAUTION: BCs are not applied on middle nodes.\n"
+	  "# CAUTION: BCs are applied on middle nodes only by NGROUPs.\n"
 	  "##############################################################\n",
 	  progname(), ctime(&t), from_file_name);
 }
@@ -49,16 +317,16 @@ static void print_header(FILE *to_file, const char *from_file_name)
 static void proceed_node_data(const char *line, NodeDB *ndb, FILE *to_file)
 {
   long long node_id;
-  float x, y, z;
+  coord_t x, y, z;
 
-  if (sscanf(line, "%lld,%f,%f,%f", &node_id, &x, &y, &z) != 4) {
+  if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4) {
     fprintf(stderr, "Error: reading node data failed\n");
     exit(1);
   }
   new_node(ndb, node_id, x, y, z);
 
   /* fprintf(to_file, "%s", line); */
-  fprintf(to_file, "%lld,%f,%f,%f\n", node_id, x, y, z);
+  print_node_line(to_file, node_id, x, y, z);
 }
 
 const int mnid[6][3] = {
@@ -70,25 +338,801 @@ const int mnid[6][3] = {
   {2, 3, 9}
 };
 
-static void proceed_elem_data(const char *line, NodeDB *ndb, EdgeDB *edb,
-			      FILE *node_file, FILE *elem_file)
+/* read the edge map saved by the previous refinement.  Coordinates of
+   the nodes are compared with the current ones, and the middle-node IDs
+   are reserved for the edges whose both ends still exist. */
+static void load_edge_map(FILE *map_file, NodeDB *ndb, EdgeDB *edb,
+			  IncStat *inc)
+{
+  char *line;
+  int mode, header;
+  int in_edge = 0;
+  MeshIO *mio;
+  long long id, i1, i2, mid;
+  coord_t x, y, z;
+  coord_t cx, cy, cz;
+  index_t i, n_node;
+
+  n_node = number_of_nodes(ndb);
+  sort_node_data(ndb);
+  inc->changed = (char *) emalloc(n_node);
+  for (i = 0; i < n_node; i++)
+    inc->changed[i] = 1;
+  inc->new_mnid = get_global_node_id(ndb, n_node - 1) + 1;
+
+  meshio_init(&mio, map_file);
+  while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
+    if (mode == COMMENT)
+      continue;
+    if (mode == HEADER) {
+      in_edge = (header == OTHER && strncmp(line, "!EDGE", 5) == 0);
+      continue;
+    }
+    if (header == NODE) {
+      if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &id, &x, &y, &z) != 4) {
+	fprintf(stderr, "Error: reading node data in edge map failed\n");
+	exit(1);
+      }
+      if (!has_node(ndb, id)) {
+	inc->n_node_removed++;
+	continue;
+      }
+      node_coord(ndb, id, &cx, &cy, &cz);
+      if (cx == x && cy == y && cz == z)
+	inc->changed[get_local_node_id(ndb, id)] = 0;
+      else
+	inc->n_node_moved++;
+
+    } else if (in_edge) {
+      if (sscanf(line, "%lld,%lld,%lld", &i1, &i2, &mid) != 3) {
+	fprintf(stderr, "Error: reading edge data in edge map failed\n");
+	exit(1);
+      }
+      if (!reserve_edge(edb, i1, i2, mid))
+	inc->n_edge_removed++;
+      if (mid >= inc->new_mnid)
+	inc->new_mnid = mid + 1;
+    }
+  }
+  meshio_finalize(mio);
+}
+
+/* write the nodes of the 341 mesh and the edge to middle-node map */
+static void save_edge_map(FILE *map_file, const char *from_file_name,
+			  NodeDB *ndb, EdgeDB *edb)
+{
+  index_t i, id;
+  coord_t x, y, z;
+
+  fprintf(map_file,
+	  "# Edge to middle-node map written by %s\n"
+	  "# Original 341 mesh: %s\n"
+	  "!NODE\n", progname(), from_file_name);
+  for (i = 0; i < number_of_nodes(ndb); i++) {
+    id = get_global_node_id(ndb, i);
+    node_coord(ndb, id, &x, &y, &z);
+    fprintf(map_file, "%lld,%.9g,%.9g,%.9g\n", (long long) id, x, y, z);
+  }
+  fprintf(map_file, "!EDGE\n");
+  edge_save(edb, map_file);
+}
+
+static void print_inc_stat(const IncStat *inc, NodeDB *ndb, EdgeDB *edb,
+			   FILE *log_file)
 {
-  int nret, i;
-  long long elem_id, nl[4], dummy;
-  index_t n[10];
+  index_t i, n_changed = 0;
 
-  nret = sscanf(line,
-                "%lld,%lld,%lld,%lld,%lld,%lld",
-                &elem_id, nl, nl+1, nl+2, nl+3, &dummy);
-  if (nret != 5) {
+  for (i = 0; i < number_of_nodes(ndb); i++)
+    n_changed += inc->changed[i];
+
+  fprintf(log_file,
+	  "         nodes new / moved / removed : %lld / %lld / %lld\n"
+	  "       middle nodes reused / removed : %lld / %lld\n"
+	  "           elements affected / total : %lld / %lld\n",
+	  (long long) (n_changed - inc->n_node_moved),
+	  (long long) inc->n_node_moved, (long long) inc->n_node_removed,
+	  (long long) number_of_reused_edges(edb),
+	  (long long) (inc->n_edge_removed + number_of_unused_edges(edb)),
+	  (long long) inc->n_elem_affected, (long long) inc->n_elem);
+}
+
+/* read up to max integers separated by commas or blanks from p into
+   v[]; return the number read */
+static int parse_ids(const char *p, long long *v, int max)
+{
+  long long x;
+  int k, neg;
+
+  for (k = 0; k < max; k++) {
+    while (*p == ' ' || *p == '\t' || *p == ',')
+      p++;
+    neg = (*p == '-');
+    if (neg || *p == '+')
+      p++;
+    if (*p < '0' || *p > '9')
+      break;
+    for (x = 0; *p >= '0' && *p <= '9'; p++)
+      x = 10 * x + (*p - '0');
+    v[k] = neg ? -x : x;
+  }
+  return k;
+}
+
+/* read the element ID and the corner nodes n[4] of an element line */
+static void parse_elem_data(const char *line, long long *elem_id, index_t *n)
+{
+  int i;
+  long long v[6];
+
+  if (parse_ids(line, v, 6) != 5) {
     fprintf(stderr, "Error: reading element data failed\n");
     exit(1);
   }
-  for (i = 0; i < 4; i++) n[i] = nl[i];
+  *elem_id = v[0];
+  for (i = 0; i < 4; i++) n[i] = v[1+i];
+}
 
-  for (i = 0; i < 6; i++)
-    if (middle_node(edb, n[mnid[i][0]], n[mnid[i][1]], &n[mnid[i][2]]))
-      print_last_middle_node(ndb, node_file);
+/* make flag[id] available, with the new ones cleared */
+static void prev_grow_flag(PrevMesh *pv, long long id)
+{
+  long long n;
+
+  if (id < pv->n_id)
+    return;
+  n = (2 * pv->n_id > id + 1) ? 2 * pv->n_id : id + 1;
+  pv->flag = (unsigned char *) erealloc_large(pv->flag, n);
+  memset(pv->flag + pv->n_id, 0, n - pv->n_id);
+  pv->n_id = n;
+}
+
+/* a node line at p ending at eol: a node of the source is marked as not
+   moved if the line is the same as it would be printed now */
+static void prev_node_line(PrevMesh *pv, NodeDB *ndb, const char *p,
+			   const char *eol)
+{
+  char buf[COORD_LINE_BUFSIZE];
+  long long id;
+  coord_t x, y, z;
+  int len;
+
+  if (parse_ids(p, &id, 1) != 1 || id < 0)
+    error_exit(1, "Error: reading node data in %s failed\n", prev_name);
+  prev_grow_flag(pv, id);
+  if (id > pv->max_id)
+    pv->max_id = id;
+  pv->flag[id] |= PREV_LISTED;
+  if (!(pv->flag[id] & PREV_COARSE))
+    return;
+  node_coord(ndb, id, &x, &y, &z);
+  len = format_node_line(buf, sizeof(buf), id, x, y, z);
+  if (len == eol - p && memcmp(buf, p, len) == 0)
+    pv->flag[id] &= ~PREV_MOVED;
+}
+
+static void prev_add_elem(PrevMesh *pv, long long id, long long pos)
+{
+  if (pv->n_elem == pv->max_elem) {
+    pv->max_elem = (pv->max_elem == 0) ? 1024 : 2 * pv->max_elem;
+    pv->elem = (PrevElem *)
+      erealloc_large(pv->elem, pv->max_elem * sizeof(PrevElem));
+  }
+  pv->elem[pv->n_elem].id = id;
+  pv->elem[pv->n_elem].pos = pos;
+  pv->n_elem++;
+}
+
+static int prev_elem_compar(const void *v1, const void *v2)
+{
+  long long i1 = ((const PrevElem *) v1)->id;
+  long long i2 = ((const PrevElem *) v2)->id;
+
+  if (i1 < i2) return -1;
+  else if (i1 == i2) return 0;
+  else return 1;
+}
+
+/* map the previous output given by -i, compare its nodes with the nodes
+   of the source in ndb, and index its element lines by ID */
+static void prev_init(PrevMesh *pv, NodeDB *ndb)
+{
+  struct stat st;
+  int fd, header = NONE, sorted = 1;
+  index_t i, n_node = number_of_nodes(ndb);
+  const char *p, *eol, *end;
+  long long id;
+
+  fd = open(prev_name, O_RDONLY);
+  if (fd < 0)
+    error_exit(2, "open: %s: %s\n", prev_name, strerror(errno));
+  if (fstat(fd, &st) != 0)
+    error_exit(2, "fstat: %s: %s\n", prev_name, strerror(errno));
+  /* e.g. if DEST is the same file, which is truncated */
+  if (st.st_size == 0)
+    error_exit(1, "Error: %s is empty\n", prev_name);
+  pv->size = st.st_size;
+  pv->buf = (char *) mmap(NULL, pv->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (pv->buf == MAP_FAILED)
+    error_exit(2, "mmap: %s: %s\n", prev_name, strerror(errno));
+  close(fd);
+
+  sort_node_data(ndb);
+  pv->flag = NULL;
+  pv->n_id = 0;
+  pv->max_id = 0;
+  if (n_node > 0)
+    prev_grow_flag(pv, get_global_node_id(ndb, n_node - 1));
+  for (i = 0; i < n_node; i++)
+    pv->flag[get_global_node_id(ndb, i)] = PREV_COARSE | PREV_MOVED;
+  pv->n_range = pv->max_range = 0;
+  pv->range = NULL;
+  pv->elem = NULL;
+  pv->n_elem = pv->max_elem = 0;
+  pv->cursor = 0;
+  pv->pos = NULL;
+  pv->n_pos = pv->max_pos = 0;
+  pv->n_read = 0;
+  pv->n_elem_copied = 0;
+
+  end = pv->buf + pv->size;
+  for (p = pv->buf; p < end; p = eol + 1) {
+    eol = (const char *) memchr(p, '\n', end - p);
+    if (eol == NULL)
+      eol = end;
+    if (p == eol || p[0] == '#' || (p[0] == '!' && eol - p > 1 && p[1] == '!'))
+      continue;
+    if (p[0] == '!') {
+      if (header == NODE)
+	pv->range[2 * pv->n_range - 1] = p - pv->buf;
+      header = meshio_header(p);
+      if (header == NODE) {
+	if (pv->n_range == pv->max_range) {
+	  pv->max_range = (pv->max_range == 0) ? 4 : 2 * pv->max_range;
+	  pv->range = (long long *)
+	    erealloc(pv->range, 2 * pv->max_range * sizeof(long long));
+	}
+	pv->range[2 * pv->n_range] = eol + 1 - pv->buf;
+	pv->range[2 * pv->n_range + 1] = pv->size;
+	pv->n_range++;
+      }
+    } else if (header == NODE) {
+      prev_node_line(pv, ndb, p, eol);
+    } else if (header == ELEMENT) {
+      if (parse_ids(p, &id, 1) != 1)
+	error_exit(1, "Error: reading element data in %s failed\n",
+		   prev_name);
+      if (pv->n_elem > 0 && pv->elem[pv->n_elem - 1].id > id)
+	sorted = 0;
+      prev_add_elem(pv, id, p - pv->buf);
+    }
+  }
+  if (!sorted)
+    qsort(pv->elem, pv->n_elem, sizeof(PrevElem), prev_elem_compar);
+}
+
+/* position of the line of element id in the previous output, or -1.
+   The elements are looked for after the one found last first, as the
+   source mostly has them in the same order. */
+static long long prev_find_elem(PrevMesh *pv, long long id)
+{
+  index_t lo = 0, hi = pv->n_elem, mid;
+
+  if (pv->cursor < pv->n_elem && pv->elem[pv->cursor].id == id)
+    return pv->elem[pv->cursor++].pos;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (pv->elem[mid].id < id)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == pv->n_elem || pv->elem[lo].id != id)
+    return -1;
+  pv->cursor = lo + 1;
+  return pv->elem[lo].pos;
+}
+
+/* decide whether the m elements of IDs elem_id[] and corners n[4*m]
+   are copied from the previous output or refined again */
+static void prev_check_elems(PrevMesh *pv, int m, const long long *elem_id,
+			     const index_t *n)
+{
+  long long pos, v[11];
+  int e, k, copy;
+
+  if (pv->n_pos + m > pv->max_pos) {
+    pv->max_pos = (pv->max_pos == 0) ? 1024 : 2 * pv->max_pos;
+    pv->pos = (long long *)
+      erealloc_large(pv->pos, pv->max_pos * sizeof(long long));
+  }
+  for (e = 0; e < m; e++) {
+    const index_t *c = n + 4 * e;
+
+    pos = prev_find_elem(pv, elem_id[e]);
+    copy = (pos >= 0 && parse_ids(pv->buf + pos, v, 11) == 11);
+    for (k = 0; k < 4 && copy; k++)
+      copy = (v[1+k] == c[k] && c[k] >= 0 && c[k] < pv->n_id &&
+	      (pv->flag[c[k]] & (PREV_COARSE | PREV_MOVED)) == PREV_COARSE);
+    /* the middle-node ID may be taken by a node of the source */
+    for (k = 4; k < 10 && copy; k++)
+      copy = (v[1+k] > 0 && v[1+k] < pv->n_id &&
+	      !(pv->flag[v[1+k]] & PREV_COARSE));
+    if (copy) {
+      for (k = 4; k < 10; k++)
+	pv->flag[v[1+k]] |= PREV_COPIED;
+      pv->n_elem_copied++;
+    } else {
+      /* a corner not in the source is reported by the main pass */
+      for (k = 0; k < 4; k++)
+	if (c[k] >= 0 && c[k] < pv->n_id)
+	  pv->flag[c[k]] |= PREV_TOUCHED;
+      pos = -1;
+    }
+    pv->pos[pv->n_pos++] = pos;
+  }
+}
+
+/* reserve the middle-node IDs of the edges of the previous output
+   between the corners of elements refined again, and let new middle
+   nodes have IDs larger than any in it */
+static void prev_reserve_edges(PrevMesh *pv, NodeDB *ndb, EdgeDB *edb)
+{
+  long long v[11];
+  index_t i;
+  int k, touched;
+
+  for (i = 0; i < pv->n_elem; i++) {
+    if (parse_ids(pv->buf + pv->elem[i].pos, v, 11) != 11)
+      continue;
+    touched = 0;
+    for (k = 1; k <= 10 && v[k] >= 0 && v[k] < pv->n_id; k++) {
+      if (k > 4)
+	pv->flag[v[k]] |= PREV_MIDDLE;
+      else if (pv->flag[v[k]] & PREV_TOUCHED)
+	touched++;
+    }
+    /* an edge is reserved only if both ends are touched */
+    if (k <= 10 || touched < 2)
+      continue;
+    for (k = 0; k < 6; k++) {
+      long long i1 = v[1+mnid[k][0]], i2 = v[1+mnid[k][1]];
+
+      if ((pv->flag[i1] & PREV_TOUCHED) && (pv->flag[i2] & PREV_TOUCHED))
+	reserve_edge(edb, i1, i2, v[1+mnid[k][2]]);
+    }
+  }
+  set_middle_node_base(ndb, pv->max_id + 1);
+
+  /* the elements are found by the positions in pos from now on */
+  free_large(pv->elem);
+  pv->elem = NULL;
+  pv->n_elem = pv->max_elem = 0;
+}
+
+/* mark middle node id created again with its ID in the previous output */
+static void prev_mark_reused(PrevMesh *pv, index_t id)
+{
+  if (id > 0 && id < pv->n_id)
+    pv->flag[id] |= PREV_REUSED;
+}
+
+/* position of the line of the next element of the source in the
+   previous output if it is copied, or -1 */
+static long long prev_next_elem(PrevMesh *pv)
+{
+  if (pv->n_read == pv->n_pos)
+    error_exit(1, "Error: the source has changed while refining\n");
+  return pv->pos[pv->n_read++];
+}
+
+/* write the line at pos of the previous output to fp */
+static void prev_write_line(const PrevMesh *pv, long long pos, FILE *fp)
+{
+  const char *p = pv->buf + pos;
+  const char *eol = (const char *) memchr(p, '\n', pv->size - pos);
+
+  if (eol == NULL) {
+    fwrite(p, 1, pv->size - pos, fp);
+    fputc('\n', fp);
+  } else {
+    fwrite(p, 1, eol + 1 - p, fp);
+  }
+}
+
+/* write the middle nodes of the elements copied that are not created
+   again, in the order of the previous output */
+static void prev_copy_middle_nodes(PrevMesh *pv, FILE *fp)
+{
+  const char *p, *eol, *end;
+  long long id;
+  int r;
+
+  for (r = 0; r < pv->n_range; r++) {
+    p = pv->buf + pv->range[2*r];
+    end = pv->buf + pv->range[2*r+1];
+    for (; p < end; p = eol + 1) {
+      eol = (const char *) memchr(p, '\n', end - p);
+      if (eol == NULL)
+	eol = end;
+      if (p == eol || p[0] == '#' || parse_ids(p, &id, 1) != 1 ||
+	  id < 0 || id >= pv->n_id)
+	continue;
+      if ((pv->flag[id] & PREV_COPIED) && !(pv->flag[id] & PREV_REUSED))
+	prev_write_line(pv, p - pv->buf, fp);
+    }
+  }
+}
+
+/* the nodes of the previous output are counted by their flags: the
+   nodes other than the middle nodes are those of the previous source */
+static void print_prev_stat(const PrevMesh *pv, NodeDB *ndb, EdgeDB *edb,
+			    FILE *log_file)
+{
+  index_t n_reused = number_of_reused_edges(edb);
+  long long id, n[5] = {0, 0, 0, 0, 0};
+  unsigned char f;
+
+  for (id = 0; id < pv->n_id; id++) {
+    f = pv->flag[id];
+    if (f & PREV_MIDDLE)
+      n[(f & (PREV_COPIED | PREV_REUSED)) ? 3 : 4]++;
+    if ((f & PREV_COARSE) && (!(f & PREV_LISTED) || (f & PREV_MIDDLE)))
+      n[0]++;
+    else if ((f & PREV_COARSE) && (f & PREV_MOVED))
+      n[1]++;
+    else if ((f & PREV_LISTED) && !(f & (PREV_COARSE | PREV_MIDDLE)))
+      n[2]++;
+  }
+  fprintf(log_file,
+	  "         nodes new / moved / removed : %lld / %lld / %lld\n"
+	  "  middle nodes copied / reused / new : %lld / %lld / %lld\n"
+	  "                middle nodes removed : %lld\n"
+	  "           elements copied / refined : %lld / %lld\n",
+	  n[0], n[1], n[2],
+	  n[3] - (long long) n_reused, (long long) n_reused,
+	  (long long) (number_of_middle_nodes(ndb) - n_reused), n[4],
+	  (long long) pv->n_elem_copied,
+	  (long long) (pv->n_pos - pv->n_elem_copied));
+}
+
+static void prev_finalize(PrevMesh *pv)
+{
+  munmap(pv->buf, pv->size);
+  free_large(pv->flag);
+  free(pv->range);
+  free_large(pv->elem);
+  free_large(pv->pos);
+}
+
+/* append id to ml */
+static void mid_list_add(MidList *ml, index_t id)
+{
+  if (ml->n == ml->max) {
+    ml->max = (ml->max > 0) ? 2 * ml->max : 16;
+    ml->id = (index_t *) erealloc(ml->id, ml->max * sizeof(index_t));
+  }
+  ml->id[ml->n++] = id;
+}
+
+static int id_compar(const void *v1, const void *v2)
+{
+  index_t i1 = *(const index_t *) v1;
+  index_t i2 = *(const index_t *) v2;
+
+  if (i1 < i2) return -1;
+  else if (i1 == i2) return 0;
+  else return 1;
+}
+
+/* set the group bits of the nodes from the members of the NGROUPs
+   after the ELEMENT part, given by group g[i] and local ID li[i] */
+static void frontier_groups(Frontier *fr, index_t n, const int *g,
+			    const index_t *li)
+{
+  index_t i;
+
+  fr->n_word = (fr->n_group + 63) / 64;
+  fr->group = NULL;
+  fr->mid = NULL;
+  if (fr->n_group == 0)
+    return;
+  fr->group = (unsigned long long *)
+    emalloc_large(fr->n_node * fr->n_word * sizeof(unsigned long long));
+  memset(fr->group, 0, fr->n_node * fr->n_word * sizeof(unsigned long long));
+  for (i = 0; i < n; i++)
+    fr->group[fr->n_word * li[i] + g[i] / 64] |= 1ULL << (g[i] % 64);
+  fr->mid = (MidList *) emalloc(fr->n_group * sizeof(MidList));
+  for (i = 0; i < fr->n_group; i++) {
+    fr->mid[i].n = fr->mid[i].max = 0;
+    fr->mid[i].id = NULL;
+  }
+}
+
+/* count the elements using each node in the rest of the source, from
+   offset in a section of type header, and read the NGROUPs after the
+   ELEMENT part.  With pv (-i), the elements are checked against the
+   previous output instead of counted, and no node is removed. */
+static void frontier_init(Frontier *fr, const char *from_file_name,
+			  long long offset, int header, NodeDB *ndb,
+			  PrevMesh *pv)
+{
+  FILE *fp;
+  MeshIO *mio;
+  char *line;
+  int mode, h, m = 0, k, seen_elem, generate = 0, cur = -1;
+  long long elem_id[ELEM_BLOCK];
+  index_t n[4*ELEM_BLOCK], li[4*ELEM_BLOCK], i;
+  index_t *ids = NULL, max_ids = 0, n_ids;
+  index_t n_mem = 0, max_mem = 0, *mem_li = NULL;
+  int *mem_g = NULL;
+
+  fr->n_node = number_of_nodes(ndb);
+  fr->remain = NULL;
+  if (pv == NULL) {
+    fr->remain = (int *) emalloc_large(fr->n_node * sizeof(int));
+    for (i = 0; i < fr->n_node; i++)
+      fr->remain[i] = 0;
+  }
+  fr->n_done = 0;
+  fr->n_front = 0;
+  fr->max_front = 0;
+  fr->n_compact = 0;
+  fr->n_group = 0;
+  seen_elem = (header == ELEMENT);
+
+  /* middle nodes keep getting IDs after the last node when it is
+     removed */
+  sort_node_data(ndb);
+  set_middle_node_base(ndb, get_global_node_id(ndb, fr->n_node - 1) + 1);
+
+  fp = efopen(from_file_name, "r");
+  meshio_init(&mio, fp);
+  meshio_seek(mio, offset, header);
+  do {
+    line = meshio_readline(mio, &mode, &h);
+    if (line != NULL && mode == DATA && h == ELEMENT) {
+      parse_elem_data(line, &elem_id[m], n + 4 * m);
+      if (++m < ELEM_BLOCK)
+	continue;
+    }
+    if (line != NULL && mode == HEADER) {
+      cur = -1;
+      if (h == ELEMENT)
+	seen_elem = 1;
+      else if (h == NGROUP && seen_elem) {
+	cur = fr->n_group++;
+	generate = group_is_generate(line);
+      }
+    } else if (line != NULL && mode == DATA && h == NGROUP && cur >= 0) {
+      n_ids = parse_group_data(line, generate, &ids, &max_ids);
+      for (i = 0; i < n_ids; i++) {
+	if (!has_node(ndb, ids[i]))
+	  continue;
+	if (n_mem == max_mem) {
+	  max_mem = (max_mem > 0) ? 2 * max_mem : 16;
+	  mem_li = (index_t *) erealloc(mem_li, max_mem * sizeof(index_t));
+	  mem_g = (int *) erealloc(mem_g, max_mem * sizeof(int));
+	}
+	mem_li[n_mem] = get_local_node_id(ndb, ids[i]);
+	mem_g[n_mem++] = cur;
+      }
+    }
+    if (pv != NULL) {
+      prev_check_elems(pv, m, elem_id, n);
+    } else {
+      lookup_nodes(ndb, 4 * m, n, li, NULL);
+      for (k = 0; k < 4 * m; k++)
+	fr->remain[li[k]]++;
+    }
+    m = 0;
+  } while (line != NULL);
+  meshio_finalize(mio);
+  fclose(fp);
+
+  for (i = 0; i < fr->n_node && fr->remain != NULL; i++)
+    if (fr->remain[i] == 0)
+      fr->n_done++;
+
+  frontier_groups(fr, n_mem, mem_g, mem_li);
+  free(ids);
+  free(mem_li);
+  free(mem_g);
+}
+
+/* release the frontier */
+static void frontier_finalize(Frontier *fr)
+{
+  int g;
+
+  free_large(fr->remain);
+  if (fr->n_group > 0)
+    free_large(fr->group);
+  for (g = 0; g < fr->n_group; g++)
+    free(fr->mid[g].id);
+  free(fr->mid);
+}
+
+/* add middle node mnid of the edge between the nodes of local IDs li1
+   and li2 to the groups of both */
+static void frontier_add_middle_node(Frontier *fr, index_t li1, index_t li2,
+				     index_t mnid)
+{
+  const unsigned long long *g1 = fr->group + fr->n_word * li1;
+  const unsigned long long *g2 = fr->group + fr->n_word * li2;
+  unsigned long long bits;
+  int w, b;
+
+  for (w = 0; w < fr->n_word; w++) {
+    bits = g1[w] & g2[w];
+    for (b = 0; bits != 0; b++, bits >>= 1)
+      if (bits & 1)
+	mid_list_add(&fr->mid[64 * w + b], mnid);
+  }
+}
+
+/* remove the nodes done with their edges */
+static void compact_frontier(Frontier *fr, NodeDB *ndb, EdgeDB *edb)
+{
+  index_t i, n = 0, n_node = number_of_nodes(ndb);
+  char *drop;
+
+  drop = (char *) emalloc_large(n_node);
+  for (i = 0; i < n_node; i++) {
+    drop[i] = (fr->remain[i] == 0);
+    if (drop[i])
+      continue;
+    if (fr->n_group > 0)
+      memmove(fr->group + fr->n_word * n, fr->group + fr->n_word * i,
+	      fr->n_word * sizeof(unsigned long long));
+    fr->remain[n++] = fr->remain[i];
+  }
+  compact_edge_data(edb, drop);
+  compact_node_data(ndb, drop);
+  free_large(drop);
+  fr->remain = (int *) erealloc_large(fr->remain, n * sizeof(int));
+  if (fr->n_group > 0)
+    fr->group = (unsigned long long *)
+      erealloc_large(fr->group, fr->n_word * n * sizeof(unsigned long long));
+
+  fr->n_done = 0;
+  fr->n_compact++;
+}
+
+/* count down the elements using the n nodes of local IDs li[] just
+   refined, and remove the nodes done if there are enough of them */
+static void release_nodes(Frontier *fr, int n, const index_t *li,
+			  NodeDB *ndb, EdgeDB *edb)
+{
+  int k;
+
+  for (k = 0; k < n; k++) {
+    int *r = &(fr->remain[li[k]]);
+
+    if (*r > 0) {
+      *r = -*r;
+      fr->n_front++;
+    }
+    if (++*r == 0) {
+      fr->n_front--;
+      fr->n_done++;
+    }
+  }
+  if (fr->n_front > fr->max_front)
+    fr->max_front = fr->n_front;
+  if (fr->n_done >= MIN_COMPACT &&
+      fr->n_done >= (number_of_nodes(ndb) - fr->n_done) / 2)
+    compact_frontier(fr, ndb, edb);
+}
+
+static void print_frontier_stat(const Frontier *fr, const NodeDB *ndb,
+				FILE *log_file)
+{
+  fprintf(log_file,
+	  "             initial number of nodes : %lld\n"
+	  "number of added nodes (middle nodes) : %lld\n"
+	  "          maximum nodes on the front : %lld (%f%%)\n"
+	  "    number of removals of done nodes : %d\n",
+	  (long long) fr->n_node,
+	  (long long) number_of_middle_nodes(ndb),
+	  (long long) fr->max_front,
+	  100.0 * (float) fr->max_front / (float) fr->n_node, fr->n_compact);
+}
+
+/* add the middle nodes of the elements copied from the previous output
+   to the groups of both ends of their edges */
+static void prev_group_middle_nodes(PrevMesh *pv, Frontier *fr, NodeDB *ndb)
+{
+  long long v[11], m;
+  index_t c[4], li[4], i;
+  char *in_group; /* in_group[node ID] is 1 if the node is in a group */
+  int k, w, n_in;
+
+  if (fr->n_group == 0)
+    return;
+  in_group = (char *) emalloc_large(pv->n_id);
+  memset(in_group, 0, pv->n_id);
+  for (i = 0; i < fr->n_node; i++)
+    for (w = 0; w < fr->n_word; w++)
+      if (fr->group[fr->n_word * i + w] != 0)
+	in_group[get_global_node_id(ndb, i)] = 1;
+
+  for (i = 0; i < pv->n_pos; i++) {
+    if (pv->pos[i] < 0)
+      continue;
+    parse_ids(pv->buf + pv->pos[i], v, 5);
+    for (k = n_in = 0; k < 4; k++)
+      n_in += in_group[v[1+k]];
+    if (n_in < 2)
+      continue;
+    parse_ids(pv->buf + pv->pos[i], v, 11);
+    for (k = 0; k < 4; k++)
+      c[k] = v[1+k];
+    lookup_nodes(ndb, 4, c, li, NULL);
+    for (k = 0; k < 6; k++) {
+      m = v[1+mnid[k][2]];
+      if (pv->flag[m] & PREV_GROUPED)
+	continue;
+      pv->flag[m] |= PREV_GROUPED;
+      frontier_add_middle_node(fr, li[mnid[k][0]], li[mnid[k][1]], m);
+    }
+  }
+  free_large(in_group);
+}
+
+/* add the element of corner nodes of local IDs li[4] and nodes n[10]
+   to adb, on local node numbers in ascending order of node ID: the
+   middle nodes have consecutive IDs after the largest one of the
+   others, which the local IDs are sorted by */
+static void add_adjacency(AdjDB *adb, NodeDB *ndb, const index_t *li,
+			  const index_t *n)
+{
+  index_t ln[10], n_node = number_of_nodes(ndb);
+  index_t base = get_global_node_id(ndb, n_node - 1) + 1;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    ln[i] = li[i];
+  for (i = 4; i < 10; i++)
+    ln[i] = n_node + (n[i] - base);
+  adj_add_elem(adb, ln);
+}
+
+/* refine an element with corner nodes c[4] of local IDs li[4].  With
+   fr, the middle nodes created are added to the groups of their ends. */
+static void refine_elem(long long elem_id, const index_t *c, const index_t *li,
+			NodeDB *ndb, EdgeDB *edb,
+			FILE *node_file, FILE *elem_file, IncStat *inc,
+			Frontier *fr, AdjDB *adb)
+{
+  int i, affected = 0;
+  index_t n[10], ret;
+
+  for (i = 0; i < 4; i++) n[i] = c[i];
+
+  for (i = 0; i < 6; i++) {
+    ret = middle_node_local(edb, n[mnid[i][0]], li[mnid[i][0]],
+			    n[mnid[i][1]], li[mnid[i][1]], &n[mnid[i][2]]);
+    if (ret == 0)
+      continue;
+    if (ret == 2 && inc->prev != NULL)
+      prev_mark_reused(inc->prev, n[mnid[i][2]]);
+    print_last_middle_node(ndb, node_file);
+    if (fr != NULL && fr->n_group > 0)
+      frontier_add_middle_node(fr, li[mnid[i][0]], li[mnid[i][1]],
+			       n[mnid[i][2]]);
+  }
+
+  if (inc->changed != NULL) {
+    for (i = 0; i < 4; i++)
+      if (inc->changed[li[i]])
+	affected = 1;
+    for (i = 4; i < 10; i++)
+      if (n[i] >= inc->new_mnid)
+	affected = 1;
+    inc->n_elem++;
+    inc->n_elem_affected += affected;
+  }
+  if (adb != NULL)
+    add_adjacency(adb, ndb, li, n);
 
   fprintf(elem_file,"%lld", elem_id);
   for (i = 0; i < 10; i++)
@@ -96,6 +1140,444 @@ static void proceed_elem_data(const char *line, NodeDB *ndb, EdgeDB *edb,
   fprintf(elem_file, "\n");
 }
 
+/* refine the elements in blk, looking up all their nodes first.  With
+   fr, the nodes done are removed afterwards. */
+static void flush_elem_block(ElemBlock *blk, NodeDB *ndb, EdgeDB *edb,
+			     FILE *node_file, FILE *elem_file, IncStat *inc,
+			     Frontier *fr, AdjDB *adb)
+{
+  index_t li[4*ELEM_BLOCK];
+  int e;
+
+  lookup_nodes(ndb, 4 * blk->n_elem, blk->n[0], li, NULL);
+  prefetch_edge_data(edb, 4 * blk->n_elem, li);
+  for (e = 0; e < blk->n_elem; e++)
+    refine_elem(blk->elem_id[e], blk->n[e], li + 4 * e,
+		ndb, edb, node_file, elem_file, inc, fr, adb);
+  if (fr != NULL && fr->remain != NULL)
+    release_nodes(fr, 4 * blk->n_elem, li, ndb, edb);
+  blk->n_elem = 0;
+}
+
+static void proceed_elem_data(const char *line, ElemBlock *blk,
+			      NodeDB *ndb, EdgeDB *edb,
+			      FILE *node_file, FILE *elem_file, IncStat *inc,
+			      Frontier *fr, AdjDB *adb)
+{
+  parse_elem_data(line, &blk->elem_id[blk->n_elem], blk->n[blk->n_elem]);
+
+  if (++blk->n_elem == ELEM_BLOCK)
+    flush_elem_block(blk, ndb, edb, node_file, elem_file, inc, fr, adb);
+}
+
+static void elem_list_init(ElemList *list)
+{
+  list->n_elem = 0;
+  list->max_elem = 0;
+  list->elem_id = NULL;
+  list->c = NULL;
+  list->e = NULL;
+  list->n_done = 0;
+  list->n_hdr = 0;
+  list->max_hdr = 0;
+  list->hdr = NULL;
+  list->hdr_at = NULL;
+}
+
+static void elem_list_finalize(ElemList *list)
+{
+  free_large(list->elem_id);
+  free_large(list->c);
+  free_large(list->e);
+  free(list->hdr);
+  free(list->hdr_at);
+}
+
+/* keep an ELEMENT header line to be written before the next element */
+static void elem_list_header(ElemList *list, const char *line)
+{
+  if (list->n_hdr == list->max_hdr) {
+    list->max_hdr = (list->max_hdr == 0) ? 4 : 2 * list->max_hdr;
+    list->hdr = (char **) erealloc(list->hdr,
+				   list->max_hdr * sizeof(char *));
+    list->hdr_at = (index_t *) erealloc(list->hdr_at,
+					list->max_hdr * sizeof(index_t));
+  }
+  list->hdr[list->n_hdr] = estrdup(line);
+  list->hdr_at[list->n_hdr] = list->n_elem;
+  list->n_hdr++;
+}
+
+static void elem_list_add(ElemList *list, const char *line)
+{
+
+  if (list->n_elem == list->max_elem) {
+    list->max_elem = (list->max_elem == 0) ? 1024 : 2 * list->max_elem;
+    list->elem_id = (long long *)
+      erealloc_large(list->elem_id, list->max_elem * sizeof(long long));
+    list->c = (index_t *)
+      erealloc_large(list->c, 4 * list->max_elem * sizeof(index_t));
+    list->e = (index_t *)
+      erealloc_large(list->e, 6 * list->max_elem * sizeof(index_t));
+  }
+
+  parse_elem_data(line, &list->elem_id[list->n_elem],
+		  list->c + 4 * list->n_elem);
+  list->n_elem++;
+}
+
+/* register the edges of the elements of a job; 6 * (element number) +
+   (local edge number) is given as the reference, so that the middle
+   nodes are numbered as in proceed_elem_data() */
+static void *register_edges(void *arg)
+{
+  EdgeJob *job = (EdgeJob *) arg;
+  ElemList *list = job->list;
+  index_t li[4*ELEM_BLOCK], i, e;
+  int m, j, k;
+
+  job->full = 0;
+  for (i = job->begin; i < job->end; i += m) {
+    m = (job->end - i < ELEM_BLOCK) ? (int) (job->end - i) : ELEM_BLOCK;
+    lookup_nodes(job->ndb, 4 * m, list->c + 4 * i, li, NULL);
+    for (j = 0; j < m; j++) {
+      e = i + j;
+      for (k = 0; k < 6; k++) {
+	list->e[6*e+k] = cedge_middle_node(job->cedb, li[4*j+mnid[k][0]],
+					   li[4*j+mnid[k][1]],
+					   6 * (list->n_done + e) + k);
+	if (list->e[6*e+k] < 0) {
+	  job->full = 1;
+	  return NULL;
+	}
+      }
+    }
+  }
+  return NULL;
+}
+
+static void run_jobs(EdgeJob *job, int n)
+{
+  int t;
+#ifdef USE_PTHREAD
+  pthread_t *thread;
+
+  thread = (pthread_t *) emalloc(n * sizeof(pthread_t));
+  for (t = 1; t < n; t++)
+    if (pthread_create(&thread[t], NULL, register_edges, &job[t]) != 0)
+      error_exit(2, "pthread_create failed\n");
+  register_edges(&job[0]);
+  for (t = 1; t < n; t++)
+    pthread_join(thread[t], NULL);
+  free(thread);
+#else
+  for (t = 0; t < n; t++)
+    register_edges(&job[t]);
+#endif
+}
+
+/* refine the elements in list with n_threads threads sharing the edge
+   table *cedb_p (created if NULL).  Middle nodes are written to
+   node_file and elements to elem_file in the same order and with the
+   same IDs as by proceed_elem_data(). */
+static void refine_elem_list(ElemList *list, NodeDB *ndb, CEdgeDB **cedb_p,
+			     FILE *node_file, FILE *elem_file, AdjDB *adb)
+{
+  EdgeJob *job;
+  index_t i, li[4], n[10];
+  int t, k, h, full;
+
+  /* a tetrahedral mesh has about as many edges as nodes and elements */
+  if (*cedb_p == NULL)
+    cedge_init(cedb_p, ndb, number_of_nodes(ndb) + list->n_elem);
+  else
+    cedge_reserve(*cedb_p, number_of_cedges(*cedb_p) + list->n_elem);
+
+  job = (EdgeJob *) emalloc(n_threads * sizeof(EdgeJob));
+  for (t = 0; t < n_threads; t++) {
+    job[t].list = list;
+    job[t].ndb = ndb;
+    job[t].cedb = *cedb_p;
+    job[t].begin = (index_t) ((long long) list->n_elem * t / n_threads);
+    job[t].end = (index_t) ((long long) list->n_elem * (t+1) / n_threads);
+  }
+  do {
+    run_jobs(job, n_threads);
+    full = 0;
+    for (t = 0; t < n_threads; t++)
+      full |= job[t].full;
+    if (full)
+      cedge_grow(*cedb_p);
+  } while (full);
+  free(job);
+
+  cedge_renumber(*cedb_p, node_file);
+
+  h = 0;
+  for (i = 0; i < list->n_elem; i++) {
+    for (; h < list->n_hdr && list->hdr_at[h] == i; h++)
+      fprintf(elem_file, "%s", list->hdr[h]);
+    fprintf(elem_file,"%lld", list->elem_id[i]);
+    for (k = 0; k < 4; k++)
+      fprintf(elem_file, ",%lld", (long long) list->c[4*i+k]);
+    for (k = 0; k < 6; k++)
+      fprintf(elem_file, ",%lld",
+	      (long long) cedge_mnid(*cedb_p, list->e[6*i+k]));
+    fprintf(elem_file, "\n");
+    if (adb != NULL) {
+      lookup_nodes(ndb, 4, list->c + 4 * i, li, NULL);
+      for (k = 0; k < 6; k++)
+	n[4+k] = cedge_mnid(*cedb_p, list->e[6*i+k]);
+      add_adjacency(adb, ndb, li, n);
+    }
+  }
+  for (; h < list->n_hdr; h++)
+    fprintf(elem_file, "%s", list->hdr[h]);
+  for (h = 0; h < list->n_hdr; h++)
+    free(list->hdr[h]);
+
+  list->n_done += list->n_elem;
+  list->n_elem = 0;
+  list->n_hdr = 0;
+}
+
+static void node_groups_init(NodeGroups *ng)
+{
+  ng->name[0] = '\0';
+  ng->generate = 0;
+  ng->n_group = 0;
+  ng->mark = NULL;
+  ng->n_member = ng->max_member = 0;
+  ng->member = NULL;
+  ng->ids = NULL;
+  ng->max_ids = 0;
+  ng->mid.n = ng->mid.max = 0;
+  ng->mid.id = NULL;
+}
+
+static void node_groups_finalize(NodeGroups *ng)
+{
+  if (ng->mark != NULL)
+    free_large(ng->mark);
+  free(ng->member);
+  free(ng->ids);
+  free(ng->mid.id);
+}
+
+/* start the NGROUP section of header line.  The groups before the end
+   of the ELEMENT part are left as they are. */
+static void begin_node_group(NodeGroups *ng, const char *line, int elem_done)
+{
+  char name[NAME_LEN];
+
+  if (!group_name(line, name, NAME_LEN)) {
+    fprintf(stderr, "Error: NGROUP without NGRP name\n");
+    exit(1);
+  }
+  if (!elem_done) {
+    fprintf(stderr, "Warning: NGROUP %s before the ELEMENT part is not "
+	    "extended to middle nodes\n", name);
+    return;
+  }
+  strcpy(ng->name, name);
+  ng->generate = group_is_generate(line);
+  ng->n_member = 0;
+}
+
+/* mark the members of the current group on line */
+static void proceed_node_group_data(NodeGroups *ng, const char *line,
+				    NodeDB *ndb)
+{
+  index_t n, i, li;
+
+  if (ng->mark == NULL) {
+    ng->mark = (char *) emalloc_large(number_of_nodes(ndb));
+    memset(ng->mark, 0, number_of_nodes(ndb));
+  }
+  n = parse_group_data(line, ng->generate, &ng->ids, &ng->max_ids);
+  for (i = 0; i < n; i++) {
+    if (!has_node(ndb, ng->ids[i]))
+      continue;
+    li = get_local_node_id(ndb, ng->ids[i]);
+    if (ng->mark[li])
+      continue;
+    ng->mark[li] = 1;
+    if (ng->n_member == ng->max_member) {
+      ng->max_member = (ng->max_member > 0) ? 2 * ng->max_member : 16;
+      ng->member = (index_t *) erealloc(ng->member,
+					ng->max_member * sizeof(index_t));
+    }
+    ng->member[ng->n_member++] = li;
+  }
+}
+
+/* end the current group: its middle nodes are taken from fr while
+   streaming, or else from the edge table cedb (with threads) or edb,
+   and written in a section of the same name in ascending order */
+static void end_node_group(NodeGroups *ng, EdgeDB *edb, CEdgeDB *cedb,
+			   Frontier *fr, FILE *out, int verbose)
+{
+  MidList *ml = &ng->mid;
+  index_t i, n;
+
+  if (fr != NULL) {
+    ml = (ng->n_group < fr->n_group) ? &fr->mid[ng->n_group] : NULL;
+  } else {
+    ml->n = 0;
+    if (cedb != NULL)
+      ml->n = cedge_group_middle_nodes(cedb, ng->mark, 0, &ml->id, &ml->max);
+    else if (edb != NULL)
+      ml->n = group_middle_nodes(edb, ng->n_member, ng->member, ng->mark,
+				 0, &ml->id, &ml->max);
+    for (i = 0; i < ng->n_member; i++)
+      ng->mark[ng->member[i]] = 0;
+  }
+
+  if (ml != NULL && ml->n > 0) {
+    qsort(ml->id, ml->n, sizeof(index_t), id_compar);
+    /* with -i, a middle node copied may be created again */
+    for (i = n = 1; i < ml->n; i++)
+      if (ml->id[i] != ml->id[n-1])
+	ml->id[n++] = ml->id[i];
+    ml->n = n;
+    fprintf(out, "!NGROUP, NGRP=%s\n", ng->name);
+    for (i = 0; i < ml->n; i++)
+      fprintf(out, "%lld\n", (long long) ml->id[i]);
+  }
+  if (verbose)
+    print_log(stderr, "%lld middle nodes added to NGROUP %s",
+	      (long long) (ml != NULL ? ml->n : 0), ng->name);
+  if (fr != NULL && ml != NULL) {
+    free(ml->id);
+    ml->id = NULL;
+    ml->n = ml->max = 0;
+  }
+  ng->n_group++;
+  ng->name[0] = '\0';
+}
+
+static char *part_name(const char *suffix)
+{
+  char *name = (char *) emalloc(strlen(ckpt_name) + strlen(suffix) + 1);
+
+  strcpy(name, ckpt_name);
+  strcat(name, suffix);
+  return name;
+}
+
+static void ckpt_init(Checkpoint *ck, const char *from_file_name)
+{
+  FILE *fp;
+
+  if (strcmp(from_file_name, "stdin") == 0)
+    error_exit(1, "Error: -c needs the source given as a file\n");
+  fp = efopen(from_file_name, "r");
+  ck->in_size = ckpt_file_size(fp);
+  fclose(fp);
+
+  ck->node_name = part_name(".node");
+  ck->elem_name = part_name(".elem");
+  ck->last = get_wtime();
+}
+
+/* remove the checkpoint and its files after the conversion */
+static void ckpt_finalize(Checkpoint *ck)
+{
+  ckpt_remove(ckpt_name);
+  remove(ck->node_name);
+  remove(ck->elem_name);
+  free(ck->node_name);
+  free(ck->elem_name);
+}
+
+/* write a checkpoint in the ELEMENT part, where no element is pending
+   in the element block */
+static void write_checkpoint(Checkpoint *ck, MeshIO *mio, NodeDB *ndb,
+			     EdgeDB *edb, const IncStat *inc,
+			     FILE *node_file, FILE *elem_file, int verbose)
+{
+  FILE *fp;
+  long long pos[4];
+  int has_changed = (inc->changed != NULL);
+
+  ckpt_sync(node_file);
+  ckpt_sync(elem_file);
+
+  pos[0] = ck->in_size;
+  pos[1] = meshio_tell(mio);
+  pos[2] = ckpt_tell(node_file);
+  pos[3] = ckpt_tell(elem_file);
+
+  fp = ckpt_create(ckpt_name);
+  ckpt_write(fp, pos, sizeof(pos));
+  ckpt_write(fp, &inc->new_mnid, sizeof(index_t));
+  ckpt_write(fp, &inc->n_node_moved, sizeof(index_t));
+  ckpt_write(fp, &inc->n_node_removed, sizeof(index_t));
+  ckpt_write(fp, &inc->n_edge_removed, sizeof(index_t));
+  ckpt_write(fp, &inc->n_elem, sizeof(index_t));
+  ckpt_write(fp, &inc->n_elem_affected, sizeof(index_t));
+  ckpt_write(fp, &has_changed, sizeof(int));
+  write_node_checkpoint(ndb, fp);
+  if (has_changed)
+    ckpt_write(fp, inc->changed, number_of_nodes(ndb));
+  write_edge_checkpoint(edb, fp);
+  ckpt_commit(fp, ckpt_name);
+
+  if (verbose)
+    print_log(stderr, "checkpoint written at %lld of %lld bytes of input",
+	      pos[1], pos[0]);
+  ck->last = get_wtime();
+
+  if (++ck->n_written == stop_after) {
+    fprintf(stderr, "%s: stopped after checkpoint %d\n", progname(),
+	    stop_after);
+    exit(1);
+  }
+}
+
+/* restore the state at the last checkpoint: the source file is opened
+   as *in_p and read by *mio_p from the position of the checkpoint, and
+   the output files are cut back to it */
+static void read_checkpoint(Checkpoint *ck, const char *from_file_name,
+			    FILE **in_p, MeshIO **mio_p, NodeDB *ndb,
+			    EdgeDB **edb_p, IncStat *inc,
+			    FILE **node_file_p, FILE **elem_file_p)
+{
+  FILE *fp;
+  long long pos[4];
+  int has_changed;
+
+  fp = ckpt_open(ckpt_name);
+  ckpt_read(fp, pos, sizeof(pos));
+  if (pos[0] != ck->in_size)
+    error_exit(1, "Error: %s has changed since the checkpoint\n",
+	       from_file_name);
+  ckpt_read(fp, &inc->new_mnid, sizeof(index_t));
+  ckpt_read(fp, &inc->n_node_moved, sizeof(index_t));
+  ckpt_read(fp, &inc->n_node_removed, sizeof(index_t));
+  ckpt_read(fp, &inc->n_edge_removed, sizeof(index_t));
+  ckpt_read(fp, &inc->n_elem, sizeof(index_t));
+  ckpt_read(fp, &inc->n_elem_affected, sizeof(index_t));
+  ckpt_read(fp, &has_changed, sizeof(int));
+  read_node_checkpoint(ndb, fp);
+  if (has_changed) {
+    inc->changed = (char *) emalloc(number_of_nodes(ndb));
+    ckpt_read(fp, inc->changed, number_of_nodes(ndb));
+  }
+  read_edge_checkpoint(edb_p, ndb, fp);
+  fclose(fp);
+
+  *in_p = efopen(from_file_name, "r");
+  ckpt_seek(*in_p, pos[1]);
+  meshio_init(mio_p, *in_p);
+  meshio_resume(*mio_p, pos[1], ELEMENT);
+
+  *node_file_p = efopen(ck->node_name, "r+");
+  ckpt_truncate(*node_file_p, pos[2]);
+  *elem_file_p = efopen(ck->elem_name, "r+");
+  ckpt_truncate(*elem_file_p, pos[3]);
+}
+
 void refine(FILE *from_file, const char *from_file_name,
 	    FILE *to_file, int verbose)
 {
@@ -104,41 +1586,179 @@ void refine(FILE *from_file, const char *from_file_name,
   int header, header_prev = NONE;
   MeshIO *mio;
   NodeDB *nodeDB;
-  EdgeDB *edgeDB;
+  EdgeDB *edgeDB = NULL;
+  CEdgeDB *cedgeDB = NULL;
+  FILE *out = to_file; /* output other than the elements */
+  FILE *in_file = NULL; /* source reopened to resume */
   FILE *tmp_file;
+  FILE *map_file;
+  IncStat inc;
+  ElemBlock blk;
+  ElemList list;
+  Checkpoint ck;
+  Frontier fr;
+  Frontier *frp = NULL; /* &fr while streaming, or with -i */
+  PrevMesh pv;
+  PrevMesh *pvp = NULL; /* &pv with -i */
+  long long pos;
+  AdjDB *adjDB = NULL;
+  NodeGroups ng;
+  int elem_done = 0; /* 1 after the end of the ELEMENT part */
+  int threaded = (n_threads > 1);
+
+  inc.changed = NULL;
+  inc.n_node_moved = inc.n_node_removed = inc.n_edge_removed = 0;
+  inc.n_elem = inc.n_elem_affected = 0;
+  inc.new_mnid = 0;
+  inc.prev = NULL;
 
   if (verbose) {
     print_log(stderr, "Starting mesh-type conversion (reading from %s)...",
               from_file_name);
   }
 
-  print_header(to_file, from_file_name);
+  if (resume && ckpt_name == NULL)
+    error_exit(1, "Error: --resume needs the checkpoint given by -c\n");
+  /* stop after the N-th checkpoint as if interrupted, to test
+     --resume */
+  if (getenv("RF341TO342_STOP") != NULL)
+    stop_after = atoi(getenv("RF341TO342_STOP"));
+  if (streaming &&
+      (map_in_name != NULL || map_out_name != NULL || ckpt_name != NULL))
+    error_exit(1, "Error: -f cannot be combined with -r, -s or -c\n");
+  if (streaming && strcmp(from_file_name, "stdin") == 0)
+    error_exit(1, "Error: -f needs the source given as a file\n");
+  if (adj_name != NULL &&
+      (map_in_name != NULL || ckpt_name != NULL || streaming))
+    error_exit(1, "Error: -a cannot be combined with -r, -c or -f\n");
+  if (prev_name != NULL &&
+      (map_in_name != NULL || map_out_name != NULL || ckpt_name != NULL ||
+       streaming || adj_name != NULL))
+    error_exit(1, "Error: -i cannot be combined with -r, -s, -c, -f or -a\n");
+  if (prev_name != NULL && strcmp(from_file_name, "stdin") == 0)
+    error_exit(1, "Error: -i needs the source given as a file\n");
+  if (threaded && (map_in_name != NULL || map_out_name != NULL ||
+		   ckpt_name != NULL || streaming || prev_name != NULL)) {
+    fprintf(stderr, "Warning: -j is ignored with -r, -s, -c, -f or -i\n");
+    threaded = 0;
+  }
 
-  meshio_init(&mio, from_file);
   node_init(&nodeDB);
-  tmp_file = etmpfile();
+  if (adj_name != NULL)
+    adj_init(&adjDB, 10);
+  blk.n_elem = 0;
+  elem_list_init(&list);
+  node_groups_init(&ng);
+
+  ck.node_name = ck.elem_name = NULL;
+  ck.in_size = 0;
+  ck.last = 0.0;
+  ck.n_written = 0;
+  if (ckpt_name != NULL)
+    ckpt_init(&ck, from_file_name);
+
+  if (resume) {
+    read_checkpoint(&ck, from_file_name, &in_file, &mio, nodeDB, &edgeDB,
+		    &inc, &out, &tmp_file);
+    header_prev = ELEMENT;
+    if (verbose)
+      print_log(stderr, "Resuming from checkpoint %s at %lld bytes...",
+		ckpt_name, meshio_tell(mio));
+  } else {
+    if (ckpt_name != NULL) {
+      out = efopen(ck.node_name, "w+");
+      tmp_file = efopen(ck.elem_name, "w+");
+    } else {
+      tmp_file = etmpfile();
+    }
+    print_header(out, from_file_name);
+    meshio_init(&mio, from_file);
+  }
 
   while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
 
+    /* keep the order of the output */
+    if (blk.n_elem > 0 && !(mode == DATA && header == ELEMENT))
+      flush_elem_block(&blk, nodeDB, edgeDB, out, tmp_file, &inc, frp,
+		       adjDB);
+
     if (mode == COMMENT) {
-      fprintf(to_file, "%s", line);
+      fprintf(out, "%s", line);
       continue;
     }
 
     if (mode == HEADER) {
+      if (ng.name[0] != '\0')
+	end_node_group(&ng, edgeDB, cedgeDB, frp, out, verbose);
+
       /* check the previous header */
       if (header_prev == NODE && header != NODE) {
 	if (verbose)
 	  print_log(stderr, "reading NODE-part completed.");
 	reduce_node_data(nodeDB);
-	edge_init(&edgeDB, nodeDB);
+	if (!threaded)
+	  edge_init(&edgeDB, nodeDB);
+	if (streaming && frp == NULL) {
+	  if (verbose)
+	    print_log(stderr, "Counting elements of each node...");
+	  frontier_init(&fr, from_file_name, meshio_tell(mio), header,
+			nodeDB, NULL);
+	  frp = &fr;
+	}
+	if (prev_name != NULL && pvp == NULL) {
+	  if (verbose)
+	    print_log(stderr, "Comparing with previous output %s...",
+		      prev_name);
+	  prev_init(&pv, nodeDB);
+	  frontier_init(&fr, from_file_name, meshio_tell(mio), header,
+			nodeDB, &pv);
+	  frp = &fr;
+	  prev_reserve_edges(&pv, nodeDB, edgeDB);
+	  prev_group_middle_nodes(&pv, &fr, nodeDB);
+	  pvp = inc.prev = &pv;
+	}
+	if (map_in_name != NULL) {
+	  if (verbose)
+	    print_log(stderr, "Reading edge map %s...", map_in_name);
+	  map_file = efopen(map_in_name, "r");
+	  load_edge_map(map_file, nodeDB, edgeDB, &inc);
+	  fclose(map_file);
+	}
 
       } else if (header_prev == ELEMENT && header != ELEMENT) {
-	if (verbose) {
+	if (verbose)
 	  print_log(stderr, "reading ELEMENT-part completed.");
-	  print_edge_stat(edgeDB, stderr);
+	elem_done = 1;
+	if (threaded) {
+	  if (verbose)
+	    print_log(stderr, "Refining elements with %d threads...",
+		      n_threads);
+	  refine_elem_list(&list, nodeDB, &cedgeDB, out, tmp_file, adjDB);
+	}
+	if (pvp != NULL) {
+	  if (verbose)
+	    print_log(stderr, "Copying middle nodes of previous output...");
+	  prev_copy_middle_nodes(pvp, out);
+	}
+	if (verbose) {
+	  if (threaded)
+	    print_cedge_stat(cedgeDB, stderr);
+	  else if (pvp != NULL)
+	    print_prev_stat(pvp, nodeDB, edgeDB, stderr);
+	  else if (frp != NULL)
+	    print_frontier_stat(frp, nodeDB, stderr);
+	  else
+	    print_edge_stat(edgeDB, stderr);
+	  if (inc.changed != NULL)
+	    print_inc_stat(&inc, nodeDB, edgeDB, stderr);
 	  print_log(stderr, "Copying element data...");
 	}
+	if (out != to_file) {
+	  rewind(out);
+	  file_copy(out, to_file);
+	  fclose(out);
+	  out = to_file;
+	}
 	rewind(tmp_file);
 	file_copy(tmp_file, to_file);
 	if (verbose)
@@ -149,7 +1769,7 @@ void refine(FILE *from_file, const char *from_file_name,
       if (header == NODE) {
 	if (verbose && header_prev != NODE)
 	  print_log(stderr, "Start reading NODE-part...");
-	fprintf(to_file, "%s", line);
+	fprintf(out, "%s", line);
 
       } else if (header == ELEMENT) {
 	char *p_elem_type;
@@ -161,10 +1781,15 @@ void refine(FILE *from_file, const char *from_file_name,
 	  exit(1);
 	}
 	p_elem_type[2] = '2';
-	fprintf(tmp_file, "%s", line);
+	if (threaded)
+	  elem_list_header(&list, line);
+	else
+	  fprintf(tmp_file, "%s", line);
 
       } else {
-	fprintf(to_file, "%s", line);
+	if (header == NGROUP)
+	  begin_node_group(&ng, line, elem_done);
+	fprintf(out, "%s", line);
       }
       header_prev = header;
       continue;
@@ -173,20 +1798,78 @@ void refine(FILE *from_file, const char *from_file_name,
     assert(mode == DATA);
 
     if (header == NODE) {
-      proceed_node_data(line, nodeDB, to_file);
+      proceed_node_data(line, nodeDB, out);
 
     } else if (header == ELEMENT) {
-      proceed_elem_data(line, nodeDB, edgeDB, to_file, tmp_file);
+      if (threaded) {
+	elem_list_add(&list, line);
+      } else if (pvp != NULL && (pos = prev_next_elem(pvp)) >= 0) {
+	if (blk.n_elem > 0)
+	  flush_elem_block(&blk, nodeDB, edgeDB, out, tmp_file, &inc, frp,
+			   adjDB);
+	prev_write_line(pvp, pos, tmp_file);
+      } else {
+	proceed_elem_data(line, &blk, nodeDB, edgeDB, out, tmp_file, &inc,
+			  frp, adjDB);
+      }
+      if (ckpt_name != NULL && blk.n_elem == 0 &&
+	  get_wtime() - ck.last >= ckpt_period)
+	write_checkpoint(&ck, mio, nodeDB, edgeDB, &inc, out, tmp_file,
+			 verbose);
 
     } else {
-      fprintf(to_file, "%s", line);
+      if (header == NGROUP && ng.name[0] != '\0' && frp == NULL)
+	proceed_node_group_data(&ng, line, nodeDB);
+      fprintf(out, "%s", line);
     }
   }
+  if (blk.n_elem > 0)
+    flush_elem_block(&blk, nodeDB, edgeDB, out, tmp_file, &inc, frp,
+		     adjDB);
+  if (ng.name[0] != '\0')
+    end_node_group(&ng, edgeDB, cedgeDB, frp, out, verbose);
+  if (out != to_file) {
+    rewind(out);
+    file_copy(out, to_file);
+    fclose(out);
+  }
+
+  if (map_out_name != NULL) {
+    if (verbose)
+      print_log(stderr, "Writing edge map %s...", map_out_name);
+    map_file = efopen(map_out_name, "w");
+    save_edge_map(map_file, from_file_name, nodeDB, edgeDB);
+    fclose(map_file);
+  }
+
+  if (adjDB != NULL) {
+    if (verbose)
+      print_log(stderr, "Writing node adjacency %s...", adj_name);
+    map_file = efopen(adj_name, "wb");
+    adj_write(adjDB, number_of_nodes(nodeDB) +
+	      number_of_middle_nodes(nodeDB), map_file);
+    fclose(map_file);
+    adj_finalize(adjDB);
+  }
 
-  edge_finalize(edgeDB);
+  free(inc.changed);
+  if (frp != NULL)
+    frontier_finalize(&fr);
+  if (pvp != NULL)
+    prev_finalize(pvp);
+  node_groups_finalize(&ng);
+  elem_list_finalize(&list);
+  if (cedgeDB != NULL)
+    cedge_finalize(cedgeDB);
+  if (edgeDB != NULL)
+    edge_finalize(edgeDB);
   node_finalize(nodeDB);
   meshio_finalize(mio);
   fclose(tmp_file);
+  if (in_file != NULL)
+    fclose(in_file);
+  if (ckpt_name != NULL)
+    ckpt_finalize(&ck);
 
   if (verbose)
     print_log(stderr, "mesh-type conversion completed.");
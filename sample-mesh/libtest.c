@@ -0,0 +1,113 @@
+/*
+ * libtest.c
+ *   Test of libmeshtools: subdivide and refine a mesh in memory
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "meshtools.h"
+
+static char *read_file(const char *path, size_t *len)
+{
+  FILE *fp;
+  char *buf;
+  long size;
+
+  if ((fp = fopen(path, "r")) == NULL) {
+    perror(path);
+    exit(2);
+  }
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  rewind(fp);
+  buf = (char *) malloc(size);
+  *len = fread(buf, 1, size, fp);
+  fclose(fp);
+  return buf;
+}
+
+static void check(int status, const char *what)
+{
+  if (status != MT_OK) {
+    printf("%s failed (%d): %s", what, status, mt_error_message());
+    exit(1);
+  }
+}
+
+/* compare the len bytes of buf with file path */
+static void compare_file(const char *buf, size_t len, const char *path,
+			 const char *name)
+{
+  char *ref;
+  size_t rlen;
+
+  ref = read_file(path, &rlen);
+  if (len == rlen && memcmp(buf, ref, len) == 0)
+    printf("%s: same as %s\n", name, path);
+  else
+    printf("%s: differs from %s\n", name, path);
+  free(ref);
+}
+
+static void print_mesh(const MTMesh *mesh, const char *name)
+{
+  char *buf;
+  size_t len;
+  index_t n_node, n_elem;
+
+  check(mt_mesh_write(mesh, &buf, &len), "mt_mesh_write");
+  check(mt_count(buf, len, &n_node, &n_elem), "mt_count");
+  printf("%s: %lld nodes, %lld elements, %d nodes per element\n", name,
+	 (long long) n_node, (long long) n_elem, mt_nodes_per_elem(mesh));
+  free(buf);
+}
+
+int main(int argc, char *argv[])
+{
+  MTMesh *mesh, *m341, *m342, *failed;
+  char *buf, *adv;
+  size_t len, alen;
+  const char *bad = "!NODE\n1,0.0,0.0,0.0\n!ELEMENT, TYPE=341\n1,1,2,3\n";
+  int status;
+
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "Usage: libtest MESHFILE [ADVFILE]\n");
+    return 1;
+  }
+
+  buf = read_file(argv[1], &len);
+  check(mt_mesh_read(&mesh, buf, len), "mt_mesh_read");
+  free(buf);
+  print_mesh(mesh, "original");
+
+  /* the Adventure mesh of the original, byte by byte as fstr2adv */
+  if (argc == 3) {
+    check(mt_convert_adv(mesh, &adv, &alen), "mt_convert_adv");
+    compare_file(adv, alen, argv[2], "adventure of original");
+    free(adv);
+  }
+
+  check(mt_subdivide(mesh, &m341), "mt_subdivide");
+  print_mesh(m341, "subdivided");
+
+  check(mt_refine(m341, &m342), "mt_refine");
+  print_mesh(m342, "refined");
+
+  check(mt_convert_adv(m342, &adv, &alen), "mt_convert_adv");
+  printf("adventure: %lu bytes\n", (unsigned long) alen);
+  free(adv);
+
+  /* errors are returned, not exited */
+  status = mt_refine(mesh, &failed);
+  printf("refine 342 mesh: status %d: %s", status, mt_error_message());
+  status = mt_mesh_read(&failed, bad, strlen(bad));
+  printf("read bad mesh: status %d: %s", status, mt_error_message());
+
+  mt_mesh_free(mesh);
+  mt_mesh_free(m341);
+  mt_mesh_free(m342);
+  return 0;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+# test of prf341to342 on a single machine.
+# set MPIRUN (e.g. "mpirun --oversubscribe") and NP as needed.
+MPIRUN=${MPIRUN:-mpirun}
+NP=${NP:-4}
+nerr=0
+
+# node lines "id,x,y,z" in NODE sections
+node_lines() {
+    awk '/^!/ {s = $0; next} /^#/ {next} s ~ /^!NODE/ {gsub(/ /, ""); print}' "$@"
+}
+
+../meshpart -n $NP -o tmp-part A341.msh > /dev/null
+if ! $MPIRUN -np $NP ../prf341to342 tmp-part tmp-ref; then
+    echo TEST-MPI FAILED
+    nerr=1
+else
+    # every node has one global ID with the same coordinate on all ranks,
+    # and as many middle nodes are added as with rf341to342
+    nid=`node_lines tmp-ref.*.msh | cut -d, -f1 | sort -u | wc -l`
+    nline=`node_lines tmp-ref.*.msh | sort -u | wc -l`
+    nused=`node_lines tmp-part.*.msh | cut -d, -f1 | sort -u | wc -l`
+    nmid=$((`../rf341to342 A341.msh | node_lines | wc -l` - \
+	`node_lines A341.msh | wc -l`))
+    nref=$((nused + nmid))
+    nelem=`for f in tmp-ref.*.msh; do ../meshcount $f; done | \
+	awk '{n += $3} END {print n}'`
+    if [ $nid -ne $nline -o $nid -ne $nref -o $nelem -ne 240 ]; then
+	echo TEST-MPI FAILED: $nid IDs, $nline nodes, $nref expected, $nelem elements
+	nerr=1
+    fi
+fi
+rm -f tmp-part.*.msh tmp-ref.*.msh
+
+if [ $nerr -gt 0 ]; then
+    echo "SUMMARY: MPI TEST FAILED"
+else
+    echo "SUMMARY: MPI TEST PASSED"
+fi
@@ -0,0 +1,83 @@
+# test of the Python module meshtools (run by 'make check-python'):
+# the same conversions as libtest, and the arrays shared without copying
+import sys
+import meshtools
+
+nerr = 0
+
+
+def fail(what):
+    global nerr
+    print("TEST-PYTHON FAILED: " + what)
+    nerr += 1
+
+
+def summary(mesh, name):
+    n_node, n_elem = meshtools.count(mesh.dumps())
+    return "%s: %d nodes, %d elements, %d nodes per element\n" % (
+        name, n_node, n_elem, mesh.nodes_per_elem)
+
+
+out = ""
+with open("A342.msh", "rb") as f:
+    mesh = meshtools.loads(f.read())
+out += summary(mesh, "original")
+with open("A342-adv.msh", "rb") as f:
+    same = mesh.adv() == f.read()
+out += "adventure of original: %s A342-adv.msh\n" % (
+    "same as" if same else "differs from")
+m341 = mesh.subdivide()
+out += summary(m341, "subdivided")
+m342 = m341.refine()
+out += summary(m342, "refined")
+out += "adventure: %d bytes\n" % len(m342.adv())
+try:
+    mesh.refine()
+except meshtools.Error as e:
+    out += "refine 342 mesh: status %d: %s" % (e.args[1], e.args[0])
+try:
+    meshtools.loads(b"!NODE\n1,0.0,0.0,0.0\n!ELEMENT, TYPE=341\n1,1,2,3\n")
+except meshtools.Error as e:
+    out += "read bad mesh: status %d: %s" % (e.args[1], e.args[0])
+with open("A342-lib.out") as f:
+    if out != f.read():
+        fail("output differs from A342-lib.out")
+
+# arrays of the mesh read from the file
+mesh = meshtools.read("A342.msh")
+coords = mesh.coords
+conn = mesh.conn
+if coords.shape != (525, 3) or conn.shape != (240, 10) or \
+   not coords.readonly or mesh.node_ids[0] != 1001 or \
+   conn.tolist()[0] != [1001, 1003, 1103, 3101, 1053, 1052, 1002, 2051,
+                        2052, 2102]:
+    fail("arrays of A342.msh")
+
+# a mesh from the arrays of another is the same mesh; the views keep
+# their mesh alive
+copy = meshtools.Mesh(mesh.node_ids, coords, mesh.elem_ids, conn)
+del mesh
+if copy.dumps() != meshtools.read("A342.msh").dumps() or \
+   coords.tolist() != copy.coords.tolist():
+    fail("mesh created from arrays")
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+if numpy is not None:
+    a = numpy.asarray(m342.coords)
+    b = numpy.asarray(m342.coords)
+    if a.shape != (3321, 3) or a.flags.writeable or \
+       not numpy.shares_memory(a, b):
+        fail("numpy views of coords")
+    m = meshtools.Mesh(numpy.asarray(m342.node_ids), a,
+                       numpy.asarray(m342.elem_ids),
+                       numpy.asarray(m342.conn))
+    if m.subdivide().n_elems != 8 * 1920:
+        fail("mesh created from numpy arrays")
+
+if nerr > 0:
+    print("SUMMARY: PYTHON TEST FAILED")
+    sys.exit(1)
+print("SUMMARY: PYTHON TEST PASSED")
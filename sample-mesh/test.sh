@@ -18,12 +18,117 @@ do_test() {
     rm -f tmp.out
 }
 
+do_mesh_test() {
+    num=$1
+    cmd=$2
+    arg=$3
+    ref=$4
+    opt=$5
+    ntest=$((ntest+1))
+    ../$cmd $arg > tmp.out || (echo TEST-$num FAILED; nerr=$((nerr+1)); exit)
+    if ! ../meshdiff $opt $ref tmp.out > /dev/null; then
+	echo TEST-$num FAILED
+        nerr=$((nerr+1))
+    fi
+    rm -f tmp.out
+}
+
 do_test 1 sd342to341 A342.msh A342-sd341.msh 4
 do_test 2 rf341to342 A341.msh A341-rf342.msh 4
 do_test 3 fstr2adv A341.msh A341-adv.msh 0
 do_test 4 fstr2adv A342.msh A342-adv.msh 0
 do_test 5 meshcount A341.msh A341-mc.out 0
 do_test 6 meshcount A342.msh A342-mc.out 0
+do_test 7 meshpart "-n 4 A342.msh tmp-part" A342-part.out 0
+if [ `diff A342-part.1.msh tmp-part.1.msh | wc -l` -gt 4 ]; then
+    echo TEST-7 FAILED
+    nerr=$((nerr+1))
+fi
+rm -f tmp-part.*.msh
+do_test 8 sample-mesh/libtest "A342.msh A342-adv.msh" A342-lib.out 0
+../rf341to342 -s tmp.map A341.msh > /dev/null
+do_test 9 rf341to342 "-r tmp.map A341-mod.msh" A341-mod-rf342.msh 4
+rm -f tmp.map
+do_test 10 lrf341to341 "-b 0,0,0,2,1,1 A341.msh" A341-lrf341.msh 4
+do_test 11 rf341to342 "-R A341.msh" A341-rf342-R.msh 4
+do_test 12 fstr2adv "-t vtu A342.msh" A342.vtu 0
+do_test 13 rf341to342 "-j 4 A341.msh" A341-rf342.msh 4
+do_test 14 rf341to342 "-c tmp.ckpt -p 0 A341.msh" A341-rf342.msh 4
+../meshindex -s 16 A342.msh
+do_test 15 meshcount A342.msh A342-mc.out 0
+do_test 16 meshindex "-n 3052 -e 200 A342.msh" A342-idx.out 0
+do_test 17 rf341to342 "-f A341.msh" A341-rf342.msh 4
+rm -f A342.msh.idx
+../meshd -d A342.msh 2> /dev/null
+do_test 18 meshq "A342.msh count" A342-mc.out 0
+../meshq A342.msh stop
+do_test 19 rf341to342 "-a tmp.csr A341.msh" A341-rf342.msh 4
+if ! cmp -s tmp.csr A341-rf342.csr; then
+    echo TEST-19 FAILED
+    nerr=$((nerr+1))
+fi
+rm -f tmp.csr
+ntest=$((ntest+1))
+../rf341to342 -C tmp-cache A341.msh tmp1.msh
+../rf341to342 -C tmp-cache A341.msh tmp2.msh
+../rf341to342 A341-mod.msh tmp2.msh
+../rf341to342 -C tmp-cache A341.msh tmp3.msh
+if [ `diff A341-rf342.msh tmp3.msh | wc -l` -gt 4 ] || \
+   ! cmp -s tmp1.msh tmp3.msh; then
+    echo TEST-20 FAILED
+    nerr=$((nerr+1))
+fi
+rm -rf tmp-cache tmp1.msh tmp2.msh tmp3.msh
+do_test 21 meshmerge "-t 1e-3 -j 2 A341-dup.msh" A341-dup-mm.msh 4
+do_test 22 meshlocate "-j 2 A342.msh A342-pts.txt" A342-loc.out 0
+do_test 23 lin342to341 A342.msh A342-lin341.msh 4
+do_mesh_test 24 rf341to342 "-R A341.msh" A341-rf342.msh "-a 1e-6"
+do_test 25 meshpart "-g -n 4 A342.msh tmp-part" A342-part-g.out 0
+if [ `diff A342-part-g.1.msh tmp-part.1.msh | wc -l` -gt 4 ]; then
+    echo TEST-25 FAILED
+    nerr=$((nerr+1))
+fi
+rm -f tmp-part.*.msh
+ntest=$((ntest+1))
+RF341TO342_STOP=2 ../rf341to342 -c tmp.ckpt -p 0 A341.msh tmp.out 2> /dev/null
+touch tmp.ckpt.tmp
+../rf341to342 -c tmp.ckpt --resume A341.msh tmp.out
+if [ `diff A341-rf342.msh tmp.out | wc -l` -gt 4 ] || \
+   [ -n "`ls tmp.ckpt* 2> /dev/null`" ]; then
+    echo TEST-26 FAILED
+    nerr=$((nerr+1))
+fi
+rm -f tmp.out tmp.ckpt*
+ntest=$((ntest+1))
+../meshdiff A341.msh A341-mod.msh > tmp.out
+if [ $? -ne 1 ] || ! cmp -s A341-mod-diff.out tmp.out; then
+    echo TEST-27 FAILED
+    nerr=$((nerr+1))
+fi
+rm -f tmp.out
+../rf341to342 A341.msh tmp-prev.msh
+do_test 28 rf341to342 "-i tmp-prev.msh A341-mod.msh" A341-mod-rf342-i.msh 4
+rm -f tmp-prev.msh
+../meshindex -s 16 A342.msh
+do_test 29 sd342to341 "-j 3 A342.msh" A342-sd341.msh 4
+rm -f A342.msh.idx
+ntest=$((ntest+1))
+mkdir -p tmp-xdmf
+../fstr2adv -t xdmf -b tmp-xdmf/A342.raw A342.msh tmp-xdmf/A342.xmf
+if ! cmp -s A342.xmf tmp-xdmf/A342.xmf || \
+   ! cmp -s A342.raw tmp-xdmf/A342.raw; then
+    echo TEST-30 FAILED
+    nerr=$((nerr+1))
+fi
+rm -rf tmp-xdmf
+ntest=$((ntest+1))
+../sd342to341 -w 1 -d tmp.inp A342-bad.msh > /dev/null 2> tmp.err
+if ! cmp -s A342-bad-diag.out tmp.err || \
+   ! cmp -s A342-bad-diag.inp tmp.inp; then
+    echo TEST-31 FAILED
+    nerr=$((nerr+1))
+fi
+rm -f tmp.inp tmp.err
 
 if [ $nerr -gt 0 ]; then
     echo "SUMMARY: $nerr of $ntest TEST(S) FAILED"
@@ -13,12 +13,50 @@
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
 #include "util.h"
+#include "coordfmt.h"
 #include "meshio.h"
+#include "indexdata.h"
 #include "nodedata.h"
+#include "subdivide.h"
+#include "arstat.h"
+#include "diag.h"
 #include "refine.h"
 
-#define BIG_ASPECT_RATIO 500
+#define DEFAULT_DIAG_FILE "sd342to341-warn.inp"
+
+/* number of elements whose nodes are looked up at once */
+enum { ELEM_BLOCK = 64 };
+
+/* elements read but not subdivided yet */
+struct ElemBlock {
+  int n_elem;
+  long long elem_id[ELEM_BLOCK];
+  index_t n[ELEM_BLOCK][10];
+};
+
+typedef struct ElemBlock ElemBlock;
+
+/* bytes of the NODE section parsed by a thread at once */
+enum { NODE_CHUNK = 1 << 22 };
+
+/* a part of the NODE section parsed by a thread */
+typedef struct NodeJob {
+  const char *file_name;
+  long long begin;      /* byte range of the lines */
+  long long end;
+  index_t n_node;
+  index_t max_node;
+  long long *id;
+  coord_t *xyz;
+  char *out;            /* the lines as printed by proceed_node_data */
+  size_t len;
+  size_t max_len;
+  int error;
+} NodeJob;
 
 void usage(void)
 {
@@ -29,12 +67,50 @@ void usage(void)
 	  "or standard input, into "
 	  "341 mesh file DEST, "
 	  "or standard output.\n"
-	  "  -v   verbose mode\n"
-	  "  -h   display help\n",
-	  progname());
+	  "  -d FILE  write elements with warnings to FILE in AVS UCD format\n"
+	  "           (default: %s)\n"
+	  "  -w N     print at most N warnings of each kind "
+	  "(default: %d, -1: all)\n"
+	  "  -j N     read the NODE section with N threads if SOURCE is "
+	  "indexed\n"
+	  "           (see meshindex; default: 1)\n"
+	  "  -v       verbose mode\n"
+	  "  -S       disable reader/writer threads\n"
+	  "  -R       print coordinates in the shortest form reading back "
+	  "exactly\n"
+	  "  -H       allocate large arrays on reserved huge pages\n"
+	  "  -I       interleave large arrays over NUMA nodes\n"
+	  "  -C DIR   take DEST from cache directory DIR if converted before,\n"
+	  "           or store it there (SOURCE and DEST must be files)\n"
+	  "  -X       write the index of DEST to DEST.idx (see meshindex)\n"
+	  "  -h       display help\n",
+	  progname(), DEFAULT_DIAG_FILE, DIAG_MAX_PRINT);
   exit(1);
 }
 
+const char refine_options[] = "d:w:j:";
+const char input_file_options[] = "";
+const char output_file_options[] = "d";
+
+static const char *diag_file = DEFAULT_DIAG_FILE;
+static int max_print = DIAG_MAX_PRINT;
+static int n_threads = 1;
+
+void refine_option(int opt, const char *arg)
+{
+  if (opt == 'd')
+    diag_file = arg;
+  else if (opt == 'w')
+    max_print = atoi(arg);
+  else if (opt == 'j') {
+    n_threads = atoi(arg);
+    if (n_threads < 1) {
+      fprintf(stderr, "Error: invalid number of threads: %s\n", arg);
+      usage();
+    }
+  }
+}
+
 static void print_header(FILE *to_file, const char *from_file_name)
 {
   time_t t;
@@ -52,223 +128,254 @@ static void print_header(FILE *to_file, const char *from_file_name)
 static void proceed_node_data(const char *line, NodeDB *ndb, FILE *to_file)
 {
   long long node_id;
-  float x, y, z;
+  coord_t x, y, z;
 
-  if (sscanf(line, "%lld,%f,%f,%f", &node_id, &x, &y, &z) != 4) {
+  if (sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD, &node_id, &x, &y, &z) != 4) {
     fprintf(stderr, "Error: reading node data failed\n");
     exit(1);
   }
   new_node(ndb, node_id, x, y, z);
 
   /* fprintf(to_file, "%s", line); */
-  fprintf(to_file, "%lld,%f,%f,%f\n", node_id, x, y, z);
+  print_node_line(to_file, node_id, x, y, z);
 }
 
-typedef struct ARStat {
-  coord_t min; /* min of aspect ratio */
-  coord_t max;     /* max of aspect ratio */
-  index_t min_elem_id;
-  index_t max_elem_id;
-  coord_t vmin;
-  coord_t vmax;
-  index_t vmin_elem_id;
-  index_t vmax_elem_id;
-} ARStat;
-
-static void arstat_init(ARStat *ars)
+/* make room for len more chars and a newline in job->out */
+static void grow_node_out(NodeJob *job, size_t len)
 {
-  ars->min = 1e+10;
-  ars->max = 0;
-  ars->min_elem_id = -1;
-  ars->max_elem_id = -1;
-  ars->vmin = 1e+10;
-  ars->vmax = 0;
-  ars->vmin_elem_id = -1;
-  ars->vmax_elem_id = -1;
+  if (job->len + len + 1 > job->max_len) {
+    job->max_len = 2 * job->max_len + len + 1;
+    job->out = (char *) erealloc(job->out, job->max_len);
+  }
 }
 
-static void arstat_update(ARStat *ars, coord_t ar, coord_t vr, index_t elem_id, int *nerr)
+/* parse the lines of job->file_name from job->begin to job->end, in
+   the NODE section, into job->id and job->xyz and print them to
+   job->out as proceed_node_data does; job->error is set on failure */
+static void *read_node_part(void *arg)
 {
-  if (ar > BIG_ASPECT_RATIO) {
-    fprintf(stderr, "warning: big aspect ratio: %f at elem %lld\n",
-	    ar, (long long) elem_id);
-    (*nerr)++;
-  }
-  if (ar < ars->min) {
-    ars->min = ar;
-    ars->min_elem_id = elem_id;
-  }
-  if (ar > ars->max) {
-    ars->max = ar;
-    ars->max_elem_id = elem_id;
-  }
-  if (vr < 0.5 || vr > 2.0) {
-    fprintf(stderr, "warning: strange volume ratio: %f at elem %lld\n",
-	    vr, (long long) elem_id);
-    (*nerr)++;
-  }
-  if (vr < ars->vmin) {
-    ars->vmin = vr;
-    ars->vmin_elem_id = elem_id;
+  NodeJob *job = (NodeJob *) arg;
+  FILE *fp;
+  MeshIO *mio;
+  char *line;
+  int mode, header;
+  size_t len;
+  long long node_id;
+  coord_t x, y, z;
+
+  job->n_node = 0;
+  job->len = 0;
+  fp = fopen(job->file_name, "r");
+  if (fp == NULL) {
+    job->error = 1;
+    return NULL;
   }
-  if (vr > ars->vmax) {
-    ars->vmax = vr;
-    ars->vmax_elem_id = elem_id;
+  meshio_init(&mio, fp);
+  meshio_seek(mio, job->begin, NODE);
+  while (meshio_tell(mio) < job->end &&
+	 (line = meshio_readline(mio, &mode, &header)) != NULL) {
+    if (mode == COMMENT) {
+      len = strlen(line);
+      grow_node_out(job, len);
+      memcpy(job->out + job->len, line, len);
+      job->len += len;
+      continue;
+    }
+    if (mode != DATA ||
+	sscanf(line, "%lld,%" SCN_COORD ",%" SCN_COORD ",%" SCN_COORD,
+	       &node_id, &x, &y, &z) != 4) {
+      job->error = 1;
+      break;
+    }
+    if (job->n_node == job->max_node) {
+      job->max_node = 2 * job->max_node + 1024;
+      job->id = (long long *) erealloc(job->id,
+				       job->max_node * sizeof(long long));
+      job->xyz = (coord_t *) erealloc(job->xyz,
+				      3 * job->max_node * sizeof(coord_t));
+    }
+    job->id[job->n_node] = node_id;
+    job->xyz[3 * job->n_node] = x;
+    job->xyz[3 * job->n_node + 1] = y;
+    job->xyz[3 * job->n_node + 2] = z;
+    job->n_node++;
+    grow_node_out(job, COORD_LINE_BUFSIZE);
+    len = format_node_line(job->out + job->len, job->max_len - job->len,
+			   node_id, x, y, z);
+    if (len >= job->max_len - job->len) {
+      grow_node_out(job, len + 1);
+      format_node_line(job->out + job->len, job->max_len - job->len,
+		       node_id, x, y, z);
+    }
+    job->len += len;
+    job->out[job->len++] = '\n';
   }
+  if (ferror(fp))
+    job->error = 1;
+  meshio_finalize(mio);
+  fclose(fp);
+  return NULL;
 }
 
-static void print_arstat(const ARStat *ars, FILE *fp)
+static void run_node_jobs(NodeJob *job, int n)
 {
-  fprintf(fp,
-	  "aspect ratio: min = %f (elemID: %lld), max = %f (elemID: %lld)\n",
-	  ars->min, (long long) ars->min_elem_id, ars->max, (long long) ars->max_elem_id);
-  fprintf(fp,
-	  "volume ratio: min = %f (elemID: %lld), max = %f (elemID: %lld)\n",
-	  ars->vmin, (long long) ars->vmin_elem_id, ars->vmax, (long long) ars->vmax_elem_id);
+  int t;
+#ifdef USE_PTHREAD
+  pthread_t *thread;
+  char *started;
+
+  thread = (pthread_t *) emalloc(n * sizeof(pthread_t));
+  started = (char *) emalloc(n);
+  /* a part whose thread cannot be created is read on this thread */
+  for (t = 1; t < n; t++)
+    started[t] =
+      (pthread_create(&thread[t], NULL, read_node_part, &job[t]) == 0);
+  read_node_part(&job[0]);
+  for (t = 1; t < n; t++) {
+    if (started[t])
+      pthread_join(thread[t], NULL);
+    else
+      read_node_part(&job[t]);
+  }
+  free(started);
+  free(thread);
+#else
+  for (t = 0; t < n; t++)
+    read_node_part(&job[t]);
+#endif
 }
 
-static coord_t volcheck(index_t eid, index_t n,
-		    index_t n0, index_t n1, index_t n2, index_t n3, NodeDB *ndb, int *nerr)
+/* read NODE section k of file_name, indexed by idx, with n_threads
+   threads, each parsing a part of about NODE_CHUNK bytes at a time;
+   the nodes are added to ndb and printed to to_file in the order of
+   the file */
+static void read_node_section(const MeshIndex *idx, int k,
+			      const char *file_name,
+			      NodeDB *ndb, FILE *to_file)
 {
-  coord_t vol;
-  if ((vol = penta_vol(ndb, n0, n1, n2, n3)) <= 0) {
-    fprintf(stderr, "Warning: negative volume: %e at elem %lld/%lld\n",
-	    vol, (long long) eid, (long long) n);
-    (*nerr)++;
+  const MeshSection *sec = meshindex_section(idx, k);
+  long long *offsets;
+  NodeJob *job;
+  index_t i;
+  int n_part, p, t, n;
+
+  n_part = (int) ((sec->end - sec->data_offset) / NODE_CHUNK) + 1;
+  if (n_part < n_threads)
+    n_part = n_threads;
+  offsets = (long long *) emalloc((n_part + 1) * sizeof(long long));
+  n_part = meshindex_split(idx, k, n_part, offsets);
+
+  job = (NodeJob *) emalloc(n_threads * sizeof(NodeJob));
+  for (t = 0; t < n_threads; t++) {
+    job[t].file_name = file_name;
+    job[t].max_node = 0;
+    job[t].id = NULL;
+    job[t].xyz = NULL;
+    job[t].max_len = 0;
+    job[t].out = NULL;
+    job[t].error = 0;
+  }
+
+  for (p = 0; p < n_part; p += n) {
+    n = (n_part - p < n_threads) ? n_part - p : n_threads;
+    for (t = 0; t < n; t++) {
+      job[t].begin = offsets[p + t];
+      job[t].end = offsets[p + t + 1];
+    }
+    run_node_jobs(job, n);
+    for (t = 0; t < n; t++) {
+      if (job[t].error) {
+	fprintf(stderr, "Error: reading node data failed\n");
+	exit(1);
+      }
+      for (i = 0; i < job[t].n_node; i++)
+	new_node(ndb, job[t].id[i], job[t].xyz[3 * i],
+		 job[t].xyz[3 * i + 1], job[t].xyz[3 * i + 2]);
+      fwrite(job[t].out, 1, job[t].len, to_file);
+    }
   }
-  return vol;
+
+  for (t = 0; t < n_threads; t++) {
+    free(job[t].id);
+    free(job[t].xyz);
+    free(job[t].out);
+  }
+  free(job);
+  free(offsets);
 }
 
-static void elemout(index_t elem_id, index_t *n, NodeDB *ndb)
+static void subdivide_one(long long elem_id, const index_t *n,
+			  const coord_t *xyz,
+			  NodeDB *ndb,
+			  FILE *to_file,
+			  ARStat *ars,
+			  Diag *diag)
 {
-  char fname[128];
-  FILE *fp;
   int i;
-  coord_t x, y, z;
+  index_t sub[8][4];
+  coord_t vol[9];
+  coord_t ar, vol1, vol8;
+  int nerr;
 
-  sprintf(fname, "e%lld.inp", (long long) elem_id);
-  fp = efopen(fname, "w");
+  ar = subdivide_elem(n, xyz, sub, vol);
 
-  fprintf(fp, "1\ndata\nstep1\n10 1\n");
-  for (i = 0; i < 10; i++) {
-    node_coord(ndb, n[i], &x, &y, &z);
-    fprintf(fp, "%d %f %f %f\n", i+1, x, y, z);
-  }
-  fprintf(fp, "1 0 tet2 1 2 4 3 7 8 6 9 10 5\n"
-	  "1 0\n1 1\nID,\n");
-  for (i = 0; i < 10; i++) {
-    fprintf(fp, "%d %lld\n", i+1, (long long) n[i]);
-  }
-  fclose(fp);
+  nerr = 0;
+  vol1 = volcheck(diag, elem_id, 0, vol[0], &nerr);
+  vol8 = 0;
+  for (i = 1; i <= 8; i++)
+    vol8 += volcheck(diag, elem_id, i, vol[i], &nerr);
+
+  for (i = 0; i < 8; i++)
+    fprintf(to_file, "%lld,%lld,%lld,%lld,%lld\n",
+	    8*elem_id-7+i, (long long) sub[i][0], (long long) sub[i][1],
+	    (long long) sub[i][2], (long long) sub[i][3]);
+
+  arstat_update(ars, diag, ar, vol8/vol1, elem_id, &nerr);
+
+  if (nerr > 0)
+    diag_elem(diag, elem_id, nerr, n, ndb);
+}
+
+/* subdivide the elements in blk, looking up all their nodes first */
+static void flush_elem_block(ElemBlock *blk,
+			     NodeDB *ndb,
+			     FILE *to_file,
+			     ARStat *ars,
+			     Diag *diag)
+{
+  index_t li[10*ELEM_BLOCK];
+  coord_t xyz[30*ELEM_BLOCK];
+  int e;
+
+  lookup_nodes(ndb, 10 * blk->n_elem, blk->n[0], li, xyz);
+  for (e = 0; e < blk->n_elem; e++)
+    subdivide_one(blk->elem_id[e], blk->n[e], xyz + 30 * e,
+		  ndb, to_file, ars, diag);
+  blk->n_elem = 0;
 }
 
 static void proceed_elem_data(const char *line,
+			      ElemBlock *blk,
 			      NodeDB *ndb,
 			      FILE *to_file,
-			      ARStat *ars)
+			      ARStat *ars,
+			      Diag *diag)
 {
   int nret, i;
-  long long elem_id, nl[10], dummy;
-  index_t n[10];
-  coord_t ndist47, ndist58, ndist69;
-  coord_t ar, vol1, vol8;
-  int nerr;
+  long long nl[10], dummy;
 
   nret = sscanf(line,
                 "%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld",
-                &elem_id, nl, nl+1, nl+2, nl+3, nl+4,
+                &blk->elem_id[blk->n_elem], nl, nl+1, nl+2, nl+3, nl+4,
                 nl+5, nl+6, nl+7, nl+8, nl+9, &dummy);
   if (nret != 11) {
     fprintf(stderr, "Error: reading element data failed\n");
     exit(1);
   }
-  for (i = 0; i < 10; i++) n[i] = (index_t) nl[i];
-
-  nerr = 0;
-  vol1 = volcheck(elem_id, 0, n[0], n[1], n[2], n[3], ndb, &nerr);
-  vol8 = 0;
-
-  fprintf(to_file, "%lld,%lld,%lld,%lld,%lld\n"
-	  "%lld,%lld,%lld,%lld,%lld\n"
-	  "%lld,%lld,%lld,%lld,%lld\n"
-	  "%lld,%lld,%lld,%lld,%lld\n",
-	  8*elem_id-7, nl[0], nl[6], nl[5], nl[7],
-	  8*elem_id-6, nl[6], nl[1], nl[4], nl[8],
-	  8*elem_id-5, nl[5], nl[4], nl[2], nl[9],
-	  8*elem_id-4, nl[7], nl[8], nl[9], nl[3]);
-
-  vol8 += volcheck(elem_id, 1, n[0], n[6], n[5], n[7], ndb, &nerr);
-  vol8 += volcheck(elem_id, 2, n[6], n[1], n[4], n[8], ndb, &nerr);
-  vol8 += volcheck(elem_id, 3, n[5], n[4], n[2], n[9], ndb, &nerr);
-  vol8 += volcheck(elem_id, 4, n[7], n[8], n[9], n[3], ndb, &nerr);
-
-  ndist47 = node_dist2(ndb, n[4], n[7]);
-  ndist58 = node_dist2(ndb, n[5], n[8]);
-  ndist69 = node_dist2(ndb, n[6], n[9]);
-
-  if (ndist47 < ndist58 && ndist47 < ndist69) {
-    fprintf(to_file, "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n",
-	    8*elem_id-3, nl[4], nl[7], nl[5], nl[6],
-	    8*elem_id-2, nl[4], nl[7], nl[6], nl[8],
-	    8*elem_id-1, nl[4], nl[7], nl[8], nl[9],
-	    8*elem_id, nl[4], nl[7], nl[9], nl[5]);
-
-    vol8 += volcheck(elem_id, 5, n[4], n[7], n[5], n[6], ndb, &nerr);
-    vol8 += volcheck(elem_id, 6, n[4], n[7], n[6], n[8], ndb, &nerr);
-    vol8 += volcheck(elem_id, 7, n[4], n[7], n[8], n[9], ndb, &nerr);
-    vol8 += volcheck(elem_id, 8, n[4], n[7], n[9], n[5], ndb, &nerr);
-
-    if (ndist58 < ndist69)
-      ar = ndist69/ndist47;
-    else
-      ar = ndist58/ndist47;
-  } else if (ndist58 < ndist69) {
-    fprintf(to_file, "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n",
-	    8*elem_id-3, nl[5], nl[8], nl[6], nl[4],
-	    8*elem_id-2, nl[5], nl[8], nl[4], nl[9],
-	    8*elem_id-1, nl[5], nl[8], nl[9], nl[7],
-	    8*elem_id, nl[5], nl[8], nl[7], nl[6]);
-
-    vol8 += volcheck(elem_id, 5, n[5], n[8], n[6], n[4], ndb, &nerr);
-    vol8 += volcheck(elem_id, 6, n[5], n[8], n[4], n[9], ndb, &nerr);
-    vol8 += volcheck(elem_id, 7, n[5], n[8], n[9], n[7], ndb, &nerr);
-    vol8 += volcheck(elem_id, 8, n[5], n[8], n[7], n[6], ndb, &nerr);
-
-    if (ndist47 < ndist69)
-      ar = ndist69/ndist58;
-    else
-      ar = ndist47/ndist58;
-  } else {
-    fprintf(to_file, "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n"
-	    "%lld,%lld,%lld,%lld,%lld\n",
-	    8*elem_id-3, nl[6], nl[9], nl[4], nl[5],
-	    8*elem_id-2, nl[6], nl[9], nl[5], nl[7],
-	    8*elem_id-1, nl[6], nl[9], nl[7], nl[8],
-	    8*elem_id, nl[6], nl[9], nl[8], nl[4]);
-
-    vol8 += volcheck(elem_id, 5, n[6], n[9], n[4], n[5], ndb, &nerr);
-    vol8 += volcheck(elem_id, 6, n[6], n[9], n[5], n[7], ndb, &nerr);
-    vol8 += volcheck(elem_id, 7, n[6], n[9], n[7], n[8], ndb, &nerr);
-    vol8 += volcheck(elem_id, 8, n[6], n[9], n[8], n[4], ndb, &nerr);
-
-    if (ndist47 < ndist58)
-      ar = ndist58/ndist69;
-    else
-      ar = ndist47/ndist69;
-  }
-  arstat_update(ars, ar, vol8/vol1, elem_id, &nerr);
+  for (i = 0; i < 10; i++) blk->n[blk->n_elem][i] = (index_t) nl[i];
 
-  if (nerr > 0) {
-    elemout(elem_id, n, ndb);
-  }
+  if (++blk->n_elem == ELEM_BLOCK)
+    flush_elem_block(blk, ndb, to_file, ars, diag);
 }
 
 void refine(FILE *from_file, const char *from_file_name,
@@ -280,6 +387,11 @@ void refine(FILE *from_file, const char *from_file_name,
   MeshIO *mio;
   NodeDB *nodeDB;
   ARStat ars;
+  Diag *diag;
+  ElemBlock blk;
+  MeshIndex *idx = NULL;
+  int section = -1; /* number of the current section in idx */
+  int skip = 0;     /* the section was read by read_node_section */
 
   if (verbose) {
     print_log(stderr, "Starting mesh-type conversion (reading from %s)...",
@@ -291,15 +403,32 @@ void refine(FILE *from_file, const char *from_file_name,
   meshio_init(&mio, from_file);
   node_init(&nodeDB);
   arstat_init(&ars);
+  diag_init(&diag, diag_file, max_print);
+  blk.n_elem = 0;
+
+  /* with the index of the source, the NODE section is parsed by
+     threads reading it by parts, and its lines are skipped here */
+  if (n_threads > 1 && strcmp(from_file_name, "stdin") != 0)
+    meshindex_load(&idx, from_file_name);
 
   while ((line = meshio_readline(mio, &mode, &header)) != NULL) {
 
+    /* keep the order of the output */
+    if (blk.n_elem > 0 && !(mode == DATA && header == ELEMENT))
+      flush_elem_block(&blk, nodeDB, to_file, &ars, diag);
+
+    if (skip && mode != HEADER)
+      continue;
+
     if (mode == COMMENT) {
       fprintf(to_file, "%s", line);
       continue;
     }
 
     if (mode == HEADER) {
+      section++;
+      skip = 0;
+
       /* check the previous header */
       if (verbose) {
 	if (header_prev == NODE && header != NODE)
@@ -313,6 +442,12 @@ void refine(FILE *from_file, const char *from_file_name,
 	if (verbose && header_prev != NODE)
 	  print_log(stderr, "Start reading NODE-part...");
 	fprintf(to_file, "%s", line);
+	if (idx != NULL && section < meshindex_n_section(idx) &&
+	    meshindex_section(idx, section)->data_offset ==
+	    meshio_tell(mio)) {
+	  read_node_section(idx, section, from_file_name, nodeDB, to_file);
+	  skip = 1;
+	}
 
       } else if (header == ELEMENT) {
 	char *p_elem_type;
@@ -339,7 +474,7 @@ void refine(FILE *from_file, const char *from_file_name,
       proceed_node_data(line, nodeDB, to_file);
 
     } else if (header == ELEMENT) {
-      proceed_elem_data(line, nodeDB, to_file, &ars);
+      proceed_elem_data(line, &blk, nodeDB, to_file, &ars, diag);
 
     } else if (header == EGROUP) {
       long long elem_id;
@@ -356,7 +491,11 @@ void refine(FILE *from_file, const char *from_file_name,
       fprintf(to_file, "%s", line);
     }
   }
+  if (blk.n_elem > 0)
+    flush_elem_block(&blk, nodeDB, to_file, &ars, diag);
 
+  if (idx != NULL)
+    meshindex_finalize(idx);
   node_finalize(nodeDB);
   meshio_finalize(mio);
 
@@ -364,4 +503,8 @@ void refine(FILE *from_file, const char *from_file_name,
     print_log(stderr, "mesh-type conversion completed.");
     print_arstat(&ars, stderr);
   }
+  if (diag_count(diag) > 0)
+    print_diag(diag, stderr);
+
+  diag_finalize(diag);
 }
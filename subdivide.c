@@ -0,0 +1,108 @@
+/*
+ * subdivide.c
+ *   Subdivide a 342 element into 8 341 elements
+ *
+ * Created on Oct 19, 2026 (split from sd342to341.c)
+ *
+ */
+#include <stdio.h>
+#include "subdivide.h"
+
+/* sub-elements at the corners */
+static const int corner[4][4] = {
+  {0, 6, 5, 7},
+  {6, 1, 4, 8},
+  {5, 4, 2, 9},
+  {7, 8, 9, 3}
+};
+
+/* sub-elements of the inner octahedron, split along n4-n7, n5-n8 or
+   n6-n9 */
+static const int octa[3][4][4] = {
+  {{4, 7, 5, 6}, {4, 7, 6, 8}, {4, 7, 8, 9}, {4, 7, 9, 5}},
+  {{5, 8, 6, 4}, {5, 8, 4, 9}, {5, 8, 9, 7}, {5, 8, 7, 6}},
+  {{6, 9, 4, 5}, {6, 9, 5, 7}, {6, 9, 7, 8}, {6, 9, 8, 4}}
+};
+
+/* square of distance between the a-th and b-th nodes */
+static coord_t dist2(const coord_t *xyz, int a, int b)
+{
+  coord_t dx, dy, dz;
+
+  dx = xyz[3*a] - xyz[3*b];
+  dy = xyz[3*a+1] - xyz[3*b+1];
+  dz = xyz[3*a+2] - xyz[3*b+2];
+  return dx*dx + dy*dy + dz*dz;
+}
+
+/* volume of the tetrahedron of the c[0..3]-th nodes */
+static coord_t tet_vol(const coord_t *xyz, const int *c)
+{
+  coord_t v1[3], v2[3], v3[3];
+  int k;
+
+  for (k = 0; k < 3; k++) {
+    v1[k] = xyz[3*c[1]+k] - xyz[3*c[0]+k];
+    v2[k] = xyz[3*c[2]+k] - xyz[3*c[0]+k];
+    v3[k] = xyz[3*c[3]+k] - xyz[3*c[0]+k];
+  }
+
+  return ((v1[1] * v2[2] - v1[2] * v2[1]) * v3[0] +
+	  (v1[2] * v2[0] - v1[0] * v2[2]) * v3[1] +
+	  (v1[0] * v2[1] - v1[1] * v2[0]) * v3[2]) / 6.0;
+}
+
+/* subdivide a 342 element n[10], whose node coordinates are given in
+   xyz[30] (e.g. by lookup_nodes), into 8 341 elements sub[8][4],
+   splitting the inner octahedron along its shortest diagonal to keep
+   the aspect ratio as small as possible.
+   vol[0] is set to the volume of the corner tetrahedron n[0..3] and
+   vol[1..8] to the volumes of the sub-elements.
+   return value is the aspect ratio, i.e. the ratio of the longest
+   diagonal to the shortest (both squared). */
+coord_t subdivide_elem(const index_t *n, const coord_t *xyz,
+		       index_t sub[8][4], coord_t *vol)
+{
+  static const int tet[4] = {0, 1, 2, 3};
+  coord_t ndist47, ndist58, ndist69;
+  coord_t ar;
+  int d, i, j;
+
+  ndist47 = dist2(xyz, 4, 7);
+  ndist58 = dist2(xyz, 5, 8);
+  ndist69 = dist2(xyz, 6, 9);
+
+  if (ndist47 < ndist58 && ndist47 < ndist69) {
+    d = 0;
+    if (ndist58 < ndist69)
+      ar = ndist69/ndist47;
+    else
+      ar = ndist58/ndist47;
+  } else if (ndist58 < ndist69) {
+    d = 1;
+    if (ndist47 < ndist69)
+      ar = ndist69/ndist58;
+    else
+      ar = ndist47/ndist58;
+  } else {
+    d = 2;
+    if (ndist47 < ndist58)
+      ar = ndist58/ndist69;
+    else
+      ar = ndist47/ndist69;
+  }
+
+  for (i = 0; i < 4; i++)
+    for (j = 0; j < 4; j++) {
+      sub[i][j] = n[corner[i][j]];
+      sub[4+i][j] = n[octa[d][i][j]];
+    }
+
+  vol[0] = tet_vol(xyz, tet);
+  for (i = 0; i < 4; i++) {
+    vol[1+i] = tet_vol(xyz, corner[i]);
+    vol[5+i] = tet_vol(xyz, octa[d][i]);
+  }
+
+  return ar;
+}
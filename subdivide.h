@@ -0,0 +1,9 @@
+#ifndef SUBDIVIDE_H
+#define SUBDIVIDE_H
+
+#include "precision.h"
+
+extern coord_t subdivide_elem(const index_t *n, const coord_t *xyz,
+			      index_t sub[8][4], coord_t *vol);
+
+#endif /* SUBDIVIDE_H */
@@ -9,21 +9,57 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
 #include <stdarg.h>
+#include <setjmp.h>
 #include <sys/resource.h>
 #include <sys/time.h>
 #include "util.h"
 
+static jmp_buf *error_env = NULL;
+static char error_msg[1024];
+
+/* print the error message and exit with status, or, if an error
+   handler is set, save the message and jump to the handler.
+   status 1 means bad mesh data, 2 means failure of the system */
+void error_exit(int status, const char *format, ...)
+{
+  va_list ap;
+
+  va_start(ap, format);
+  vsnprintf(error_msg, sizeof(error_msg), format, ap);
+  va_end(ap);
+
+  if (error_env != NULL)
+    longjmp(*error_env, status);
+
+  fprintf(stderr, "%s", error_msg);
+  exit(status);
+}
+
+/* set the jump buffer used by error_exit() instead of exit();
+   NULL restores exit().  return value is the previous one. */
+jmp_buf *set_error_handler(jmp_buf *env)
+{
+  jmp_buf *prev = error_env;
+  error_env = env;
+  return prev;
+}
+
+/* message of the last error */
+const char *error_message(void)
+{
+  return error_msg;
+}
+
 void *emalloc(size_t size)
 {
   void *ptr;
   ptr = malloc(size);
-  if (ptr == NULL) {
-    perror("malloc");
-    fprintf(stderr, "malloc of %lu bytes failed\n", size);
-    exit(2);
-  }
+  if (ptr == NULL)
+    error_exit(2, "malloc: %s\nmalloc of %lu bytes failed\n",
+	       strerror(errno), (unsigned long) size);
   return ptr;
 }
 
@@ -31,11 +67,9 @@ void *erealloc(void *ptr, size_t size)
 {
   void *rptr;
   rptr = realloc(ptr, size);
-  if (rptr == NULL) {
-    perror("realloc");
-    fprintf(stderr, "realloc of %lu bytes failed\n", size);
-    exit(2);
-  }
+  if (rptr == NULL)
+    error_exit(2, "realloc: %s\nrealloc of %lu bytes failed\n",
+	       strerror(errno), (unsigned long) size);
   return rptr;
 }
 
@@ -50,10 +84,8 @@ FILE *efopen(const char *path, const char *mode)
 {
   FILE *fp;
   fp = fopen(path, mode);
-  if (fp == NULL) {
-    perror("fopen");
-    exit(2);
-  }
+  if (fp == NULL)
+    error_exit(2, "fopen: %s\n", strerror(errno));
   return fp;
 }
 
@@ -68,10 +100,8 @@ FILE *etmpfile(void)
   tmp_file = efopen(tmpname, "w+");
   */
   tmp_file = tmpfile();
-  if (tmp_file == NULL) {
-    perror("tmpfile");
-    exit(2);
-  }
+  if (tmp_file == NULL)
+    error_exit(2, "tmpfile: %s\n", strerror(errno));
   return tmp_file;
 }
 
@@ -99,10 +129,8 @@ void setprogname(const char *str)
     p++;
 
   name = (char *) malloc((strlen(p)+1) * sizeof(char));
-  if (name == NULL) {
-    perror("in setprogname()");
-    exit(2);
-  }
+  if (name == NULL)
+    error_exit(2, "in setprogname(): %s\n", strerror(errno));
   strcpy(name, p);
 }
 
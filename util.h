@@ -3,6 +3,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <setjmp.h>
+
+extern void error_exit(int status, const char *format, ...);
+extern jmp_buf *set_error_handler(jmp_buf *env);
+extern const char *error_message(void);
 
 extern void *emalloc(size_t size);
 extern void *erealloc(void *ptr, size_t size);
@@ -19,4 +24,11 @@ extern void print_log(FILE *fp, const char *format, ...);
 extern double get_cputime(void);
 extern double get_wtime(void);
 
+/* hint to bring the data at address p into the cache */
+#ifdef __GNUC__
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p) ((void) 0)
+#endif
+
 #endif /* UTIL_H */
@@ -0,0 +1,310 @@
+/*
+ * vizout.c
+ *   Binary mesh output for visualization: VTK XML unstructured grid
+ *   (.vtu) with appended raw data, and XDMF with a raw data file
+ *
+ * Created on Oct 19, 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vizout.h"
+#include "util.h"
+
+/* binary arrays are written through a buffer of BUF_SIZE bytes,
+   converted to little endian */
+enum { BUF_SIZE = 1 << 16 };
+
+typedef struct RawOut {
+  FILE *fp;
+  int swap; /* 1 on big-endian hosts */
+  size_t len;
+  unsigned char buf[BUF_SIZE];
+} RawOut;
+
+/* kinds of arrays */
+enum { A_COORD, A_CONN, A_OFFSET, A_TYPE, A_NODE_ID, A_ELEM_ID, N_ARRAY };
+
+/* sizes of the values of the arrays */
+typedef struct ArraySize {
+  index_t n[N_ARRAY]; /* number of values */
+  int size[N_ARRAY]; /* size of a value in bytes */
+} ArraySize;
+
+/* FrontSTR to VTK (and XDMF) node order of 342 elements;
+   see also f2a in print_elem_adv */
+static const int f2v[10] = {0, 1, 2, 3, 6, 4, 5, 7, 8, 9};
+
+static void raw_init(RawOut *ro, FILE *fp)
+{
+  unsigned int one = 1;
+
+  ro->fp = fp;
+  ro->swap = (*(unsigned char *) &one == 0);
+  ro->len = 0;
+}
+
+static void raw_flush(RawOut *ro)
+{
+  if (ro->len > 0 && fwrite(ro->buf, 1, ro->len, ro->fp) != ro->len)
+    error_exit(2, "Error: writing binary data failed\n");
+  ro->len = 0;
+}
+
+/* append a value of size bytes in little endian */
+static void raw_put(RawOut *ro, const void *v, int size)
+{
+  const unsigned char *p = (const unsigned char *) v;
+  int i;
+
+  if (ro->len + size > BUF_SIZE)
+    raw_flush(ro);
+  if (ro->swap)
+    for (i = 0; i < size; i++)
+      ro->buf[ro->len + i] = p[size - 1 - i];
+  else
+    memcpy(ro->buf + ro->len, p, size);
+  ro->len += size;
+}
+
+/* append an integer as 4 or 8 bytes */
+static void raw_put_int(RawOut *ro, long long v, int size)
+{
+  int v4 = (int) v;
+
+  if (size == 4)
+    raw_put(ro, &v4, 4);
+  else
+    raw_put(ro, &v, 8);
+}
+
+static int fits_int(index_t id)
+{
+  return (index_t) (int) id == id;
+}
+
+static int elem_type_npe(const ElemDB *eldb)
+{
+  int npe = nodes_per_elem(eldb);
+
+  if (npe != 4 && npe != 10)
+    error_exit(1, "Error: element type not supported\n");
+  return npe;
+}
+
+/* the number and the size of the values of each array; integers are
+   4 bytes if they fit, 8 bytes otherwise */
+static void array_size(NodeDB *ndb, ElemDB *eldb, ArraySize *as)
+{
+  index_t n_node = number_of_nodes(ndb);
+  index_t n_elem = number_of_elems(eldb);
+  int npe = elem_type_npe(eldb);
+
+  sort_node_data(ndb);
+
+  as->n[A_COORD] = 3 * n_node;
+  as->size[A_COORD] = sizeof(coord_t);
+  as->n[A_CONN] = npe * n_elem;
+  as->size[A_CONN] = fits_int(n_node) ? 4 : 8;
+  as->n[A_OFFSET] = n_elem;
+  as->size[A_OFFSET] = fits_int(npe * n_elem) ? 4 : 8;
+  as->n[A_TYPE] = n_elem;
+  as->size[A_TYPE] = 1;
+  as->n[A_NODE_ID] = n_node;
+  as->size[A_NODE_ID] =
+    (n_node == 0 || fits_int(get_global_node_id(ndb, n_node - 1))) ? 4 : 8;
+  as->n[A_ELEM_ID] = n_elem;
+  as->size[A_ELEM_ID] =
+    (n_elem == 0 || fits_int(get_elem_id(eldb, n_elem - 1))) ? 4 : 8;
+}
+
+/* write the values of array a; elements are streamed from eldb and
+   nodes from ndb without building the arrays in memory */
+static void write_array(RawOut *ro, int a, const ArraySize *as,
+			NodeDB *ndb, ElemDB *eldb)
+{
+  index_t i, n[10];
+  coord_t x, y, z;
+  int j, npe = nodes_per_elem(eldb);
+  unsigned char type = (npe == 10) ? 24 : 10; /* VTK_(QUADRATIC_)TETRA */
+
+  switch (a) {
+  case A_COORD:
+    for (i = 0; i < as->n[A_NODE_ID]; i++) {
+      get_local_node_coord(ndb, i, &x, &y, &z);
+      raw_put(ro, &x, sizeof(coord_t));
+      raw_put(ro, &y, sizeof(coord_t));
+      raw_put(ro, &z, sizeof(coord_t));
+    }
+    break;
+  case A_CONN:
+    for (i = 0; i < as->n[A_ELEM_ID]; i++) {
+      get_elem_nodes(eldb, i, n);
+      for (j = 0; j < npe; j++)
+	raw_put_int(ro, get_local_node_id(ndb, n[(npe == 10) ? f2v[j] : j]),
+		    as->size[A_CONN]);
+    }
+    break;
+  case A_OFFSET:
+    for (i = 0; i < as->n[A_ELEM_ID]; i++)
+      raw_put_int(ro, (long long) npe * (i + 1), as->size[A_OFFSET]);
+    break;
+  case A_TYPE:
+    for (i = 0; i < as->n[A_ELEM_ID]; i++)
+      raw_put(ro, &type, 1);
+    break;
+  case A_NODE_ID:
+    for (i = 0; i < as->n[A_NODE_ID]; i++)
+      raw_put_int(ro, get_global_node_id(ndb, i), as->size[A_NODE_ID]);
+    break;
+  case A_ELEM_ID:
+    for (i = 0; i < as->n[A_ELEM_ID]; i++)
+      raw_put_int(ro, get_elem_id(eldb, i), as->size[A_ELEM_ID]);
+    break;
+  }
+}
+
+static const char *vtk_int_type(int size)
+{
+  return (size == 4) ? "Int32" : "Int64";
+}
+
+/* print the mesh in VTK XML unstructured grid format; all arrays are
+   in the appended section, in raw binary */
+void print_mesh_vtu(NodeDB *ndb, ElemDB *eldb, FILE *fp)
+{
+  /* order of the arrays in the appended section */
+  static const int order[N_ARRAY] = {
+    A_COORD, A_CONN, A_OFFSET, A_TYPE, A_NODE_ID, A_ELEM_ID
+  };
+  ArraySize as;
+  RawOut *ro;
+  unsigned long long offset[N_ARRAY], off = 0, nbytes;
+  int k;
+
+  array_size(ndb, eldb, &as);
+  for (k = 0; k < N_ARRAY; k++) {
+    offset[order[k]] = off;
+    off += sizeof(nbytes) + (unsigned long long) as.n[order[k]] * as.size[order[k]];
+  }
+
+  fprintf(fp,
+	  "<?xml version=\"1.0\"?>\n"
+	  "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" "
+	  "byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+	  "<UnstructuredGrid>\n"
+	  "<Piece NumberOfPoints=\"%lld\" NumberOfCells=\"%lld\">\n",
+	  (long long) as.n[A_NODE_ID], (long long) as.n[A_ELEM_ID]);
+  fprintf(fp,
+	  "<PointData Scalars=\"NodeID\">\n"
+	  "<DataArray type=\"%s\" Name=\"NodeID\" format=\"appended\" "
+	  "offset=\"%llu\"/>\n"
+	  "</PointData>\n"
+	  "<CellData Scalars=\"ElemID\">\n"
+	  "<DataArray type=\"%s\" Name=\"ElemID\" format=\"appended\" "
+	  "offset=\"%llu\"/>\n"
+	  "</CellData>\n",
+	  vtk_int_type(as.size[A_NODE_ID]), offset[A_NODE_ID],
+	  vtk_int_type(as.size[A_ELEM_ID]), offset[A_ELEM_ID]);
+  fprintf(fp,
+	  "<Points>\n"
+	  "<DataArray type=\"Float%d\" NumberOfComponents=\"3\" "
+	  "format=\"appended\" offset=\"%llu\"/>\n"
+	  "</Points>\n"
+	  "<Cells>\n"
+	  "<DataArray type=\"%s\" Name=\"connectivity\" format=\"appended\" "
+	  "offset=\"%llu\"/>\n"
+	  "<DataArray type=\"%s\" Name=\"offsets\" format=\"appended\" "
+	  "offset=\"%llu\"/>\n"
+	  "<DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" "
+	  "offset=\"%llu\"/>\n"
+	  "</Cells>\n"
+	  "</Piece>\n"
+	  "</UnstructuredGrid>\n"
+	  "<AppendedData encoding=\"raw\">\n_",
+	  8 * as.size[A_COORD], offset[A_COORD],
+	  vtk_int_type(as.size[A_CONN]), offset[A_CONN],
+	  vtk_int_type(as.size[A_OFFSET]), offset[A_OFFSET],
+	  offset[A_TYPE]);
+
+  ro = (RawOut *) emalloc(sizeof(RawOut));
+  raw_init(ro, fp);
+  for (k = 0; k < N_ARRAY; k++) {
+    nbytes = (unsigned long long) as.n[order[k]] * as.size[order[k]];
+    raw_put(ro, &nbytes, sizeof(nbytes));
+    write_array(ro, order[k], &as, ndb, eldb);
+  }
+  raw_flush(ro);
+  free(ro);
+
+  fprintf(fp, "\n</AppendedData>\n</VTKFile>\n");
+}
+
+/* print a DataItem of XDMF referring to array a in the raw file */
+static void print_xdmf_item(FILE *fp, const ArraySize *as, int a, int ncol,
+			    unsigned long long seek, const char *raw_name)
+{
+  fprintf(fp, "<DataItem Dimensions=\"%lld", (long long) as->n[a] / ncol);
+  if (ncol > 1)
+    fprintf(fp, " %d", ncol);
+  fprintf(fp, "\" NumberType=\"%s\" Precision=\"%d\" Format=\"Binary\" "
+	  "Endian=\"Little\" Seek=\"%llu\">%s</DataItem>\n",
+	  (a == A_COORD) ? "Float" : "Int", as->size[a], seek, raw_name);
+}
+
+/* print the mesh in XDMF format to fp, and the arrays to raw_fp, which
+   is referred to as raw_name in fp */
+void print_mesh_xdmf(NodeDB *ndb, ElemDB *eldb, FILE *fp,
+		     FILE *raw_fp, const char *raw_name)
+{
+  static const int order[3] = {A_CONN, A_COORD, A_NODE_ID};
+  ArraySize as;
+  RawOut *ro;
+  unsigned long long seek[N_ARRAY], off = 0;
+  int k, npe;
+
+  array_size(ndb, eldb, &as);
+  npe = nodes_per_elem(eldb);
+  for (k = 0; k < 3; k++) {
+    seek[order[k]] = off;
+    off += (unsigned long long) as.n[order[k]] * as.size[order[k]];
+  }
+  seek[A_ELEM_ID] = off;
+
+  fprintf(fp,
+	  "<?xml version=\"1.0\"?>\n"
+	  "<Xdmf Version=\"3.0\">\n"
+	  "<Domain>\n"
+	  "<Grid Name=\"mesh\" GridType=\"Uniform\">\n"
+	  "<Topology TopologyType=\"%s\" NumberOfElements=\"%lld\">\n",
+	  (npe == 10) ? "Tet_10" : "Tetrahedron", (long long) as.n[A_ELEM_ID]);
+  print_xdmf_item(fp, &as, A_CONN, npe, seek[A_CONN], raw_name);
+  fprintf(fp,
+	  "</Topology>\n"
+	  "<Geometry GeometryType=\"XYZ\">\n");
+  print_xdmf_item(fp, &as, A_COORD, 3, seek[A_COORD], raw_name);
+  fprintf(fp,
+	  "</Geometry>\n"
+	  "<Attribute Name=\"NodeID\" AttributeType=\"Scalar\" "
+	  "Center=\"Node\">\n");
+  print_xdmf_item(fp, &as, A_NODE_ID, 1, seek[A_NODE_ID], raw_name);
+  fprintf(fp,
+	  "</Attribute>\n"
+	  "<Attribute Name=\"ElemID\" AttributeType=\"Scalar\" "
+	  "Center=\"Cell\">\n");
+  print_xdmf_item(fp, &as, A_ELEM_ID, 1, seek[A_ELEM_ID], raw_name);
+  fprintf(fp,
+	  "</Attribute>\n"
+	  "</Grid>\n"
+	  "</Domain>\n"
+	  "</Xdmf>\n");
+
+  ro = (RawOut *) emalloc(sizeof(RawOut));
+  raw_init(ro, raw_fp);
+  for (k = 0; k < 3; k++)
+    write_array(ro, order[k], &as, ndb, eldb);
+  write_array(ro, A_ELEM_ID, &as, ndb, eldb);
+  raw_flush(ro);
+  free(ro);
+}
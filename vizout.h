@@ -0,0 +1,12 @@
+#ifndef VIZOUT_H
+#define VIZOUT_H
+
+#include <stdio.h>
+#include "nodedata.h"
+#include "elemdata.h"
+
+extern void print_mesh_vtu(NodeDB *ndb, ElemDB *eldb, FILE *fp);
+extern void print_mesh_xdmf(NodeDB *ndb, ElemDB *eldb, FILE *fp,
+			    FILE *raw_fp, const char *raw_name);
+
+#endif /* VIZOUT_H */